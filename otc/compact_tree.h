@@ -0,0 +1,515 @@
+#ifndef OTCETERA_COMPACT_TREE_H
+#define OTCETERA_COMPACT_TREE_H
+// A frozen copy of a tree, stored as arrays in preorder, for trees that are only read.
+// Depends on: otc_base_includes.h error.h tree_iter.h
+// Depended on by: test/test_otc_compact_tree.cpp test/bench_otc_compact_tree.cpp
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "otc/otc_base_includes.h"
+#include "otc/error.h"
+#include "otc/tree_iter.h"
+
+namespace otc {
+template<typename T> class CompactTree;
+
+// A node of a CompactTree: the tree, and the position of the node in preorder.  It behaves like
+//   a pointer to a RootedTreeNode (nd->get_parent(), nd == nullptr, if (nd) ...), so code that is
+//   written for RootedTree nodes with auto, like count_leaves or get_mrca_ott_id_pair, also runs
+//   on a CompactTree.  So do the Newick writers that the web services use (write_newick_generic
+//   and IncrementalNewickWriter), with CompactNode<T> as the node type.  Nodes order by position, so they can be the keys of std::maps and sets.
+template<typename T>
+class CompactNode {
+    const CompactTree<T> * tree = nullptr;
+    std::uint32_t pos = 0;
+    public:
+    using data_type = T;
+
+    CompactNode() = default;
+    CompactNode(std::nullptr_t) {
+    }
+    CompactNode(const CompactTree<T> * t, std::uint32_t p)
+        :tree(t),
+        pos(p) {
+    }
+    const CompactNode * operator->() const {
+        return this;
+    }
+    // For code that dereferences a node pointer to pass the node on, like iter_child_const(*nd)
+    //   in write_newick_generic.
+    const CompactNode & operator*() const {
+        return *this;
+    }
+    explicit operator bool() const {
+        return tree != nullptr;
+    }
+    friend bool operator==(const CompactNode & a, const CompactNode & b) {
+        return a.tree == b.tree and a.pos == b.pos;
+    }
+    friend bool operator!=(const CompactNode & a, const CompactNode & b) {
+        return not (a == b);
+    }
+    friend bool operator<(const CompactNode & a, const CompactNode & b) {
+        return a.pos < b.pos;
+    }
+    std::uint32_t get_position() const {
+        return pos;
+    }
+    const CompactTree<T> * get_tree() const {
+        return tree;
+    }
+
+    bool is_tip() const;
+    bool is_internal() const {
+        return not is_tip();
+    }
+    bool has_children() const {
+        return not is_tip();
+    }
+    CompactNode get_parent() const;
+    CompactNode get_first_child() const;
+    CompactNode get_last_child() const;
+    CompactNode get_next_sib() const;
+    unsigned get_out_degree() const;
+    bool is_outdegree_one_node() const;
+    // One past the last node of the subtree, in preorder: nd is an ancestor of (or equal to) x if
+    //   nd.get_position() <= x.get_position() < nd.get_subtree_end().
+    std::uint32_t get_subtree_end() const;
+    bool has_ott_id() const;
+    OttId get_ott_id() const;
+    std::string_view get_name() const;
+    const T & get_data() const;
+};
+
+// CompactTree holds the shape, OTT ids, names and data of a tree in parallel arrays, indexed by
+//   the preorder position of the nodes.  A RootedTreeNode costs five pointers, a std::string and
+//   an OttId, plus a heap block for every name that does not fit in the string; here a node costs
+//   two 32-bit indices (the parent, and the end of its subtree), an OttId and a name offset, and
+//   the names share one buffer.
+//
+// The first child of an internal node is the next node in preorder, and the next sibling of a
+//   node is the node just past its subtree, if that is still inside the parent's subtree.  So
+//   the preorder and leaf traversals are scans of the arrays.
+//
+// The tree cannot be changed once it is built.
+template<typename T>
+class CompactTree {
+    public:
+    using node_type = CompactNode<T>;
+    using node_data_type = T;
+    static constexpr std::uint32_t NO_NODE = std::numeric_limits<std::uint32_t>::max();
+
+    CompactTree() = default;
+
+    // Copies the nodes of tree, with data_of(nd) as the data of node nd.
+    template<typename Tree, typename F>
+    CompactTree(const Tree & tree, F data_of) {
+        std::size_t num_nodes = 0;
+        std::size_t num_name_chars = 0;
+        for (auto nd : iter_pre_const(tree)) {
+            ++num_nodes;
+            num_name_chars += nd->get_name().size();
+        }
+        if (num_nodes >= NO_NODE) {
+            throw OTCError() << "CompactTree: " << num_nodes << " nodes are too many.";
+        }
+        parent.reserve(num_nodes);
+        subtree_end.resize(num_nodes);
+        ott_ids.reserve(num_nodes);
+        name_starts.reserve(num_nodes + 1);
+        name_chars.reserve(num_name_chars);
+        data.reserve(num_nodes);
+        // The ancestors of the current node, with their positions.
+        std::vector<std::pair<const typename Tree::node_type *, std::uint32_t>> open;
+        for (auto nd : iter_pre_const(tree)) {
+            const auto pos = static_cast<std::uint32_t>(parent.size());
+            while (not open.empty() and open.back().first != nd->get_parent()) {
+                subtree_end[open.back().second] = pos;
+                open.pop_back();
+            }
+            parent.push_back(open.empty() ? NO_NODE : open.back().second);
+            ott_ids.push_back(nd->has_ott_id() ? nd->get_ott_id() : std::numeric_limits<OttId>::max());
+            name_starts.push_back(static_cast<std::uint32_t>(name_chars.size()));
+            name_chars.append(nd->get_name());
+            data.push_back(data_of(nd));
+            open.emplace_back(nd, pos);
+        }
+        for (const auto & o : open) {
+            subtree_end[o.second] = static_cast<std::uint32_t>(num_nodes);
+        }
+        name_starts.push_back(static_cast<std::uint32_t>(name_chars.size()));
+    }
+
+    // Copies the nodes of tree, and their data.
+    template<typename Tree>
+    explicit CompactTree(const Tree & tree)
+        :CompactTree(tree, [](const typename Tree::node_type * nd) {return T(nd->get_data());}) {
+    }
+
+    CompactTree(const CompactTree &) = delete;
+    CompactTree & operator=(const CompactTree &) = delete;
+    CompactTree(CompactTree &&) = default;
+    CompactTree & operator=(CompactTree &&) = default;
+
+    std::size_t size() const {
+        return parent.size();
+    }
+    bool empty() const {
+        return parent.empty();
+    }
+    node_type get_root() const {
+        return empty() ? node_type() : node_type(this, 0);
+    }
+    // The node at pos in preorder.
+    node_type node_at(std::uint32_t pos) const {
+        assert(pos < size());
+        return node_type(this, pos);
+    }
+
+    std::size_t memory_used() const {
+        return parent.capacity() * sizeof(std::uint32_t)
+               + subtree_end.capacity() * sizeof(std::uint32_t)
+               + ott_ids.capacity() * sizeof(OttId)
+               + name_starts.capacity() * sizeof(std::uint32_t)
+               + name_chars.capacity()
+               + data.capacity() * sizeof(T);
+    }
+
+    private:
+    std::vector<std::uint32_t> parent;       // NO_NODE for the root
+    std::vector<std::uint32_t> subtree_end;  // one past the last descendant
+    std::vector<OttId> ott_ids;              // numeric_limits<OttId>::max() if none, as in RootedTreeNode
+    std::vector<std::uint32_t> name_starts;  // the name of node i is name_chars[name_starts[i], name_starts[i+1])
+    std::string name_chars;
+    std::vector<T> data;
+    friend class CompactNode<T>;
+};
+
+template<typename T>
+inline bool CompactNode<T>::is_tip() const {
+    return tree->subtree_end[pos] == pos + 1;
+}
+
+template<typename T>
+inline CompactNode<T> CompactNode<T>::get_parent() const {
+    const auto p = tree->parent[pos];
+    return (p == CompactTree<T>::NO_NODE) ? CompactNode() : CompactNode(tree, p);
+}
+
+template<typename T>
+inline CompactNode<T> CompactNode<T>::get_first_child() const {
+    return is_tip() ? CompactNode() : CompactNode(tree, pos + 1);
+}
+
+template<typename T>
+inline CompactNode<T> CompactNode<T>::get_next_sib() const {
+    const auto p = tree->parent[pos];
+    const auto next = tree->subtree_end[pos];
+    if (p == CompactTree<T>::NO_NODE or next >= tree->subtree_end[p]) {
+        return CompactNode();
+    }
+    return CompactNode(tree, next);
+}
+
+template<typename T>
+inline CompactNode<T> CompactNode<T>::get_last_child() const {
+    auto c = get_first_child();
+    if (c) {
+        for (auto n = c.get_next_sib(); n; n = n.get_next_sib()) {
+            c = n;
+        }
+    }
+    return c;
+}
+
+template<typename T>
+inline unsigned CompactNode<T>::get_out_degree() const {
+    unsigned n = 0;
+    for (auto c = get_first_child(); c; c = c.get_next_sib()) {
+        ++n;
+    }
+    return n;
+}
+
+template<typename T>
+inline bool CompactNode<T>::is_outdegree_one_node() const {
+    return not is_tip() and tree->subtree_end[pos + 1] == tree->subtree_end[pos];
+}
+
+template<typename T>
+inline std::uint32_t CompactNode<T>::get_subtree_end() const {
+    return tree->subtree_end[pos];
+}
+
+template<typename T>
+inline bool CompactNode<T>::has_ott_id() const {
+    return tree->ott_ids[pos] != std::numeric_limits<OttId>::max();
+}
+
+template<typename T>
+inline OttId CompactNode<T>::get_ott_id() const {
+    assert(has_ott_id());
+    return tree->ott_ids[pos];
+}
+
+template<typename T>
+inline std::string_view CompactNode<T>::get_name() const {
+    const auto first = tree->name_starts[pos];
+    return std::string_view(tree->name_chars.data() + first, tree->name_starts[pos + 1] - first);
+}
+
+template<typename T>
+inline const T & CompactNode<T>::get_data() const {
+    return tree->data[pos];
+}
+
+// Iterators over a CompactTree, visiting nodes in the same order as those of tree_iter.h.
+
+// Positions first ... last - 1, or only the tips among them.
+template<typename T>
+class compact_preorder_iterator {
+    const CompactTree<T> * tree = nullptr;
+    std::uint32_t pos = 0;
+    std::uint32_t last = 0;
+    bool tips_only = false;
+
+    void skip() {
+        if (tips_only) {
+            while (pos < last and not tree->node_at(pos).is_tip()) {
+                ++pos;
+            }
+        }
+    }
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = CompactNode<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const CompactNode<T> *;
+    using reference = CompactNode<T>;
+
+    compact_preorder_iterator(const CompactTree<T> * t, std::uint32_t p, std::uint32_t l, bool tips)
+        :tree(t),
+        pos(p),
+        last(l),
+        tips_only(tips) {
+        skip();
+    }
+    CompactNode<T> operator*() const {
+        return tree->node_at(pos);
+    }
+    compact_preorder_iterator & operator++() {
+        ++pos;
+        skip();
+        return *this;
+    }
+    bool operator==(const compact_preorder_iterator & other) const {
+        return pos == other.pos;
+    }
+    bool operator!=(const compact_preorder_iterator & other) const {
+        return pos != other.pos;
+    }
+};
+
+// The leftmost tip below a node is reached by following first children, which are the next
+//   positions, so each step is amortized O(1).
+template<typename T>
+class compact_postorder_iterator {
+    CompactNode<T> curr;
+    CompactNode<T> last_node;
+
+    static CompactNode<T> leftmost_tip(CompactNode<T> nd) {
+        while (not nd.is_tip()) {
+            nd = nd.get_first_child();
+        }
+        return nd;
+    }
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = CompactNode<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const CompactNode<T> *;
+    using reference = CompactNode<T>;
+
+    explicit compact_postorder_iterator(CompactNode<T> subtree_root)
+        :curr(subtree_root ? leftmost_tip(subtree_root) : subtree_root),
+        last_node(subtree_root) {
+    }
+    CompactNode<T> operator*() const {
+        return curr;
+    }
+    compact_postorder_iterator & operator++() {
+        if (curr == last_node) {
+            curr = nullptr;
+        } else {
+            auto n = curr.get_next_sib();
+            curr = n ? leftmost_tip(n) : curr.get_parent();
+        }
+        return *this;
+    }
+    bool operator==(const compact_postorder_iterator & other) const {
+        return curr == other.curr;
+    }
+    bool operator!=(const compact_postorder_iterator & other) const {
+        return curr != other.curr;
+    }
+};
+
+// Follows get_next_sib() (for children) or get_parent() (for ancestors).
+template<typename T, bool ancestors>
+class compact_link_iterator {
+    CompactNode<T> curr;
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = CompactNode<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const CompactNode<T> *;
+    using reference = CompactNode<T>;
+
+    explicit compact_link_iterator(CompactNode<T> c)
+        :curr(c) {
+    }
+    CompactNode<T> operator*() const {
+        return curr;
+    }
+    compact_link_iterator & operator++() {
+        curr = ancestors ? curr.get_parent() : curr.get_next_sib();
+        return *this;
+    }
+    bool operator==(const compact_link_iterator & other) const {
+        return curr == other.curr;
+    }
+    bool operator!=(const compact_link_iterator & other) const {
+        return curr != other.curr;
+    }
+};
+
+template<typename It>
+class CompactRange {
+    It first;
+    It last;
+    public:
+    CompactRange(It f, It l)
+        :first(f),
+        last(l) {
+    }
+    It begin() const {
+        return first;
+    }
+    It end() const {
+        return last;
+    }
+};
+
+template<typename T>
+using CompactPreorderRange = CompactRange<compact_preorder_iterator<T>>;
+template<typename T>
+using CompactPostorderRange = CompactRange<compact_postorder_iterator<T>>;
+template<typename T>
+using CompactChildRange = CompactRange<compact_link_iterator<T, false>>;
+template<typename T>
+using CompactAncRange = CompactRange<compact_link_iterator<T, true>>;
+
+// The nodes of the subtree below nd (or only its tips), in preorder.
+template<typename T>
+inline CompactPreorderRange<T> compact_preorder_range(CompactNode<T> nd, bool tips_only) {
+    if (not nd) {
+        return CompactPreorderRange<T>({nullptr, 0, 0, false}, {nullptr, 0, 0, false});
+    }
+    const auto first = nd.get_position();
+    const auto last = nd.get_subtree_end();
+    return CompactPreorderRange<T>({nd.get_tree(), first, last, tips_only}, {nd.get_tree(), last, last, tips_only});
+}
+
+// The iter_* functions of tree_iter.h, for CompactTrees and their nodes.  There are overloads for
+//   non-const trees only so that they are picked over the templates of tree_iter.h.
+template<typename T>
+inline CompactPreorderRange<T> iter_pre_const(const CompactTree<T> & tree) {
+    return compact_preorder_range(tree.get_root(), false);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_pre(const CompactTree<T> & tree) {
+    return iter_pre_const(tree);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_pre(CompactTree<T> & tree) {
+    return iter_pre_const(tree);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_pre_n_const(CompactNode<T> nd) {
+    return compact_preorder_range(nd, false);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_pre_n(CompactNode<T> nd) {
+    return compact_preorder_range(nd, false);
+}
+
+template<typename T>
+inline CompactPreorderRange<T> iter_leaf_const(const CompactTree<T> & tree) {
+    return compact_preorder_range(tree.get_root(), true);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_leaf(const CompactTree<T> & tree) {
+    return iter_leaf_const(tree);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_leaf(CompactTree<T> & tree) {
+    return iter_leaf_const(tree);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_leaf_n_const(CompactNode<T> nd) {
+    return compact_preorder_range(nd, true);
+}
+template<typename T>
+inline CompactPreorderRange<T> iter_leaf_n(CompactNode<T> nd) {
+    return compact_preorder_range(nd, true);
+}
+
+template<typename T>
+inline CompactPostorderRange<T> iter_post_n_const(CompactNode<T> nd) {
+    return CompactPostorderRange<T>(compact_postorder_iterator<T>(nd), compact_postorder_iterator<T>(nullptr));
+}
+template<typename T>
+inline CompactPostorderRange<T> iter_post_n(CompactNode<T> nd) {
+    return iter_post_n_const(nd);
+}
+template<typename T>
+inline CompactPostorderRange<T> iter_post_const(const CompactTree<T> & tree) {
+    return iter_post_n_const(tree.get_root());
+}
+template<typename T>
+inline CompactPostorderRange<T> iter_post(const CompactTree<T> & tree) {
+    return iter_post_const(tree);
+}
+template<typename T>
+inline CompactPostorderRange<T> iter_post(CompactTree<T> & tree) {
+    return iter_post_const(tree);
+}
+
+template<typename T>
+inline CompactChildRange<T> iter_child_const(CompactNode<T> nd) {
+    using It = compact_link_iterator<T, false>;
+    return CompactChildRange<T>(It(nd.get_first_child()), It(nullptr));
+}
+template<typename T>
+inline CompactChildRange<T> iter_child(CompactNode<T> nd) {
+    return iter_child_const(nd);
+}
+
+template<typename T>
+inline CompactAncRange<T> iter_anc_const(CompactNode<T> nd) {
+    using It = compact_link_iterator<T, true>;
+    return CompactAncRange<T>(It(nd.get_parent()), It(nullptr));
+}
+template<typename T>
+inline CompactAncRange<T> iter_anc(CompactNode<T> nd) {
+    return iter_anc_const(nd);
+}
+
+} // namespace otc
+#endif
@@ -2,6 +2,7 @@
 #define OTCETERA_CONFLICT_H
 #include "otc/tree.h"
 #include "otc/induced_tree.h"
+#include "otc/lca_index.h"
 #include "otc/tree_operations.h"
 #include "otc/supertree_util.h" // for count_leaves( )
 #include <unordered_map>
@@ -143,7 +144,8 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
     compute_depth(induced_tree1);
     compute_depth(induced_tree2);
 
-    std::function<node_type*(node_type*,node_type*)> mrca_of_pair = [](node_type* n1, node_type* n2) {return mrca_from_depth(n1,n2);};
+    // Nodes of induced_tree2 are only ever removed below an MRCA, so the index stays valid.
+    LCAIndex<node_type> lca_index2(induced_tree2.get_root());
 
     // 2. Record the number of tips <= each node, to determine when MRCAs contain more descendants than expected.
     compute_tips(induced_tree1);
@@ -203,7 +205,7 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
         std::vector<node_type*> leaves2 = map_to_summary(leaves1);
 
         // The MRCA should be the last node in the vector.
-        node_type* MRCA = MRCA_of_group(leaves2, mrca_of_pair);
+        node_type* MRCA = lca_index2.mrca_of_group(leaves2);
 
         // Find the nodes in the induced tree of those nodes
         std::set<node_type*> node_set = find_induced_nodes(leaves2, MRCA);
@@ -283,10 +285,10 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
 
 template <typename Tree1_t, typename Tree2_t>
 void perform_conflict_analysis(const Tree1_t& tree1,
-                               const std::unordered_map<OttId, const typename Tree1_t::node_type*>& ottid_to_node1,
+                               const OttIdIndex<const typename Tree1_t::node_type*>& ottid_to_node1,
                                std::function<const typename Tree1_t::node_type*(const typename Tree1_t::node_type*,const typename Tree1_t::node_type*)> MRCA_of_pair1,
                                const Tree2_t& tree2,
-                               const std::unordered_map<OttId, const typename Tree2_t::node_type*>& ottid_to_node2,
+                               const OttIdIndex<const typename Tree2_t::node_type*>& ottid_to_node2,
                                std::function<const typename Tree2_t::node_type*(const typename Tree2_t::node_type*,const typename Tree2_t::node_type*)> MRCA_of_pair2,
                                node_logger_t log_supported_by,
                                node_logger_t log_partial_path_of,
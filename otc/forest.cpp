@@ -61,12 +61,13 @@ template<typename T, typename U>
 void RootedForest<T, U>::attach_all_known_tips_as_new_tree() {
     tree_type & t = create_new_tree();
     t.root = create_node(nullptr, &t);
-    for (auto & o2n : ott_id_to_node_map) {
-        if (o2n.first == rootID) {
+    // In order of OTT id, so that the children of the root come out the same way every time.
+    for (auto ott_id : keys(ott_id_to_node_map)) {
+        if (ott_id == rootID) {
             assert(false);
             throw OTCError("root as tip");
         }
-        auto nd = o2n.second;
+        auto nd = ott_id_to_node_map.at(ott_id);
         if (!node_is_attached(*nd)) {
             //t.connectedIds.insert(o2n.first);
             add_and_update_child(t.root, nd, t);
@@ -98,12 +99,12 @@ void RootedForest<T, U>::attach_all_detached_tips() {
     tree_type & t = trees.begin()->second;
     std::list<node_type *> excludedFromRoot;
     std::list<node_type *> attachableAtRoot;
-    for (auto & o2n : ott_id_to_node_map) {
-        if (o2n.first == rootID) {
+    for (auto ott_id : keys(ott_id_to_node_map)) {
+        if (ott_id == rootID) {
             assert(false);
             throw OTCError("root as tip");
         }
-        auto nd = o2n.second;
+        auto nd = ott_id_to_node_map.at(ott_id);
         if (!node_is_attached(*nd)) {
             if (t.is_excluded_from_root(nd)) {
                 excludedFromRoot.push_back(nd);
@@ -225,7 +226,7 @@ std::list<OverlapFTreePair<T, U> > RootedForest<T, U>::get_sorted_overlapping_tr
     std::map<std::size_t, std::list<MyOverlapFTreePair> > byOverlapSize;
     for (auto & tpIt : trees) {
         tree_type * ftree = &(tpIt.second);
-        const OttIdSet & inTree = ftree->get_included_ott_ids();
+        const auto & inTree = ftree->get_included_ott_ids();
         const OttIdSet inter = set_intersection_as_set(inTree, inc);
         if (!inter.empty()) {
             const auto k = inter.size();
@@ -125,7 +125,7 @@ class RootedForest {
     const std::list<InterTreeBand<T> > & get_all_bands() const {
         return all_bands;
     }
-    const std::map<OttId, node_type *> & get_ott_id_to_node_mapping() const {
+    const OttIdIndex<node_type *> & get_ott_id_to_node_mapping() const {
         return ott_id_to_node_map;
     }
     const std::map<std::size_t, tree_type> & get_trees() const {
@@ -187,7 +187,7 @@ class RootedForest {
     std::map<std::size_t,  tree_type> trees;
     std::size_t next_tree_id;
     OttIdSet ott_id_set;
-    std::map<OttId, node_type *> & ott_id_to_node_map; // alias to this data field in node_src for convenience
+    OttIdIndex<node_type *> & ott_id_to_node_map; // alias to this data field in node_src for convenience
     std::map<node_type *, tree_type*> node_to_tree; 
     std::list<InterTreeBand<T> > all_bands;
     // added_splits_by_leaf_set
@@ -230,7 +230,7 @@ inline RootedTreeNode<T> * RootedForest<T, U>::create_leaf(RootedTreeNode<T> * p
     auto n = create_node(p, ftree);
     assert(n->get_next_sib() == nullptr);
     n->set_ott_id(oid);
-    ott_id_to_node_map[oid] = n;
+    ott_id_to_node_map.set(oid, n);
     n->get_data().des_ids.insert(oid);
     ott_id_set.insert(oid);
     return n;
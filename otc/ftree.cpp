@@ -34,7 +34,7 @@ void PhyloStatement::write_as_newick(std::ofstream & out) const {
 template<typename T>
 bool ExcludeConstraints<T>::is_excluded_from(const node_type * ndToCheck,
                                            const node_type * potentialAttachment,
-                                           const std::map<OttId, node_type*> * o2n) const {
+                                           const OttIdIndex<node_type *> * o2n) const {
     const auto & ndi = ndToCheck->get_data().des_ids;
     if (ndi.size() == 1) {
         auto nit = by_exclude_node.find(ndToCheck);
@@ -9,6 +9,7 @@
 #include "otc/otc_base_includes.h"
 #include "otc/tree.h"
 #include "otc/util.h"
+#include "otc/ott_id_index.h"
 namespace otc {
 template<typename T, typename U> class GreedyBandedForest;
 template<typename T, typename U> class RootedForest;
@@ -147,7 +148,7 @@ class ExcludeConstraints {
     bool add_exclude_statement(const node_type * nd2Exclude, const node_type * forbiddenAttach);
     bool is_excluded_from(const node_type * ndToCheck,
                         const node_type * potentialAttachment,
-                        const std::map<OttId, node_type*> * ott_id_to_node_map) const;
+                        const OttIdIndex<node_type *> * ott_id_to_node_map) const;
     bool has_nodes_excluded_from_it(const node_type *n) const {
         return contains(by_node_with_constraints, n);
     }
@@ -240,7 +241,7 @@ class FTree {
     using NdToConstrainedAt = std::map<node_type *, std::set<node_type *> >;
     FTree(std::size_t treeID,
           RootedForest<T, U> & theForest,
-          std::map<OttId, node_type *> & ottIdToNodeRef)
+          OttIdIndex<node_type *> & ottIdToNodeRef)
         :tree_id(treeID),
          root(nullptr),
          forest(theForest),
@@ -269,7 +270,7 @@ class FTree {
     // OTT Ids of nodes on the graph only....
     const OttIdSet get_connected_ott_ids() const;
     // includes OTT Ids of nodes in includesConstraints
-    const OttIdSet & get_included_ott_ids() {
+    const auto & get_included_ott_ids() {
         return get_root()->get_data().des_ids;
     }
     bool ott_id_is_connected(OttId ottId) const {
@@ -345,7 +346,7 @@ class FTree {
     InterTreeBandBookkeeping<T> bands;
     //std::map<node_type *, std::list<PhyloStatementSource> > supportedBy; // only for non-roots
     RootedForest<T, U> & forest;
-    std::map<OttId, node_type *> & ott_id_to_node_map;
+    OttIdIndex<node_type *> & ott_id_to_node_map;
 };
 
 template<typename T, typename U>
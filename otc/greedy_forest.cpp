@@ -290,7 +290,6 @@ void GreedyBandedForest<T, U>::merge_trees_to_first_post_band_handling(Supertree
     auto trIt = begin(trees);
     auto & firstTree = trIt->second;
     auto firstTreeRoot = firstTree.get_root();
-    OttIdSet idsIncluded = firstTreeRoot->get_data().des_ids;
     for (++trIt; trIt != end(trees);) {
         debug_invariants_check();
         auto & currTree = trIt->second;
@@ -6,6 +6,7 @@
 #include "otc/tree.h"
 #include "otc/tree_operations.h"
 #include "otc/otc_base_includes.h"
+#include "otc/ott_id_index.h"
 
 namespace otc {
 template <typename N>
@@ -141,9 +142,9 @@ get_induced_tree(const std::vector<const typename Tree_In_t::node_type*>& leaves
 template <typename Tree1_t, typename Tree2_t>
 std::vector<const typename Tree1_t::node_type*> get_induced_leaves(
                     const Tree1_t& T1,
-                    const std::unordered_map<OttId, const typename Tree1_t::node_type*>& nodes1,
+                    const OttIdIndex<const typename Tree1_t::node_type*>& nodes1,
                     const Tree2_t& T2,
-                    const std::unordered_map<OttId, const typename Tree2_t::node_type*>& nodes2) {
+                    const OttIdIndex<const typename Tree2_t::node_type*>& nodes2) {
   std::vector<const typename Tree1_t::node_type*> leaves;
     if (nodes2.size() < nodes1.size()) {
         for(auto leaf: iter_leaf_const(T2)) {
@@ -167,10 +168,10 @@ std::vector<const typename Tree1_t::node_type*> get_induced_leaves(
 // Get the subtree of T1 connecting the leaves of T1 that are also in T2.
 template <typename Tree_In1_t, typename Tree_In2_t, typename Tree_Out_t>
 std::unique_ptr<Tree_Out_t> get_induced_tree(const Tree_In1_t& T1,
-                                             const std::unordered_map<OttId, const typename Tree_In1_t::node_type*>& nodes1,
+                                             const OttIdIndex<const typename Tree_In1_t::node_type*>& nodes1,
                                              std::function<const typename Tree_In1_t::node_type*(const typename Tree_In1_t::node_type*,const typename Tree_In1_t::node_type*)> MRCA_of_pair,
                                              const Tree_In2_t& T2,
-                                             const std::unordered_map<OttId, const typename Tree_In2_t::node_type*>& nodes2) {
+                                             const OttIdIndex<const typename Tree_In2_t::node_type*>& nodes2) {
     auto induced_leaves = get_induced_leaves(T1, nodes1, T2, nodes2);
     auto induced_tree = get_induced_tree<Tree_In1_t, Tree_Out_t>(induced_leaves, MRCA_of_pair);
     induced_tree->set_name(T1.get_name());
@@ -0,0 +1,231 @@
+#ifndef OTCETERA_LCA_INDEX_H
+#define OTCETERA_LCA_INDEX_H
+// Constant-time MRCA (lowest common ancestor) queries on a fixed tree.
+// Depends on: error.h
+// Depended on by: conflict.h, taxonomy/taxonomy.h, tree_operations.h
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "otc/error.h"
+
+namespace otc {
+
+template <typename N, typename = void>
+struct node_has_traversal_indices: std::false_type {};
+
+template <typename N>
+struct node_has_traversal_indices<N, std::void_t<decltype(std::declval<N&>().get_data().trav_enter)>>: std::true_type {};
+
+// LCAIndex answers MRCA queries for the subtree below a root in O(1) time, after an O(n) setup.
+//
+// If the nodes are numbered in preorder, and pre(u) < pre(v), then the MRCA of u and v is the
+//   parent of the shallowest node in the preorder range (pre(u), pre(v)].  That node is the
+//   child of the MRCA on the path to v (or v itself).  We find it with a range-minimum query on the
+//   node depths: blocks of 64 nodes are summarized by a sparse table, and positions within a block
+//   are handled with one 64-bit mask per node.  This takes about 20 bytes per node.
+//
+// Nodes whose data has trav_enter (e.g. the taxonomy and the summary tree in the web services)
+//   are located by that preorder index; otherwise the index keeps a node -> position map.
+//
+// The index is not updated when the tree changes.  Deleting the descendants of a node does not
+//   change the MRCA of the nodes that remain, so queries on the remaining nodes stay valid
+//   (this is how perform_conflict_analysis uses it).
+template <typename N>
+class LCAIndex {
+    static constexpr bool use_trav_enter = node_has_traversal_indices<N>::value;
+    static constexpr std::size_t block_size = 64;
+
+    std::vector<N*> preorder;
+    std::vector<std::uint32_t> depth;
+    std::vector<std::uint64_t> in_block_minima;
+    // sparse_table[k][b] is the position of the shallowest node in blocks b ... b + 2^k - 1.
+    std::vector<std::vector<std::uint32_t>> sparse_table;
+    std::unordered_map<const N*, std::uint32_t> position_map;
+    std::uint32_t first_trav_enter = 0;
+
+    std::uint32_t shallower(std::uint32_t i, std::uint32_t j) const {
+        return (depth[j] < depth[i]) ? j : i;
+    }
+
+    std::uint32_t shallowest_in_block(std::size_t first, std::size_t last) const {
+        // Bits of in_block_minima[last] mark the positions in last's block (up to last) that are
+        //  shallower than everything after them.  The first one at or after first is the minimum.
+        auto mask = in_block_minima[last] & (~std::uint64_t(0) << (first % block_size));
+        return static_cast<std::uint32_t>((last - last % block_size) + __builtin_ctzll(mask));
+    }
+
+    std::uint32_t shallowest(std::size_t first, std::size_t last) const {
+        const auto b1 = first / block_size;
+        const auto b2 = last / block_size;
+        if (b1 == b2) {
+            return shallowest_in_block(first, last);
+        }
+        auto m = shallower(shallowest_in_block(first, b1 * block_size + block_size - 1),
+                           shallowest_in_block(b2 * block_size, last));
+        if (b1 + 1 < b2) {
+            const auto k = floor_log2(b2 - b1 - 1);
+            const auto & level = sparse_table[k];
+            m = shallower(m, shallower(level[b1 + 1], level[b2 - (std::size_t(1) << k)]));
+        }
+        return m;
+    }
+
+    static std::size_t floor_log2(std::size_t x) {
+        std::size_t k = 0;
+        while (x >>= 1) {
+            k++;
+        }
+        return k;
+    }
+
+    void build_block_minima() {
+        const auto n = preorder.size();
+        in_block_minima.resize(n);
+        for (std::size_t block_start = 0; block_start < n; block_start += block_size) {
+            std::uint64_t stack = 0;
+            const auto block_end = std::min(n, block_start + block_size);
+            for (auto i = block_start; i < block_end; ++i) {
+                while (stack) {
+                    const auto top = block_start + 63 - __builtin_clzll(stack);
+                    if (depth[top] < depth[i]) {
+                        break;
+                    }
+                    stack &= ~(std::uint64_t(1) << (top - block_start));
+                }
+                stack |= std::uint64_t(1) << (i - block_start);
+                in_block_minima[i] = stack;
+            }
+        }
+        const auto n_blocks = (n + block_size - 1) / block_size;
+        sparse_table.emplace_back(n_blocks);
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            sparse_table[0][b] = shallowest_in_block(b * block_size, std::min(n, b * block_size + block_size) - 1);
+        }
+        for (std::size_t k = 1; (std::size_t(1) << k) <= n_blocks; ++k) {
+            const auto width = std::size_t(1) << (k - 1);
+            std::vector<std::uint32_t> level(n_blocks - 2 * width + 1);
+            const auto & prev = sparse_table[k - 1];
+            for (std::size_t b = 0; b < level.size(); ++b) {
+                level[b] = shallower(prev[b], prev[b + width]);
+            }
+            sparse_table.push_back(std::move(level));
+        }
+    }
+
+    public:
+    explicit LCAIndex(N* root) {
+        if (root == nullptr) {
+            return;
+        }
+        if constexpr (use_trav_enter) {
+            first_trav_enter = root->get_data().trav_enter;
+        }
+        // Preorder traversal of the subtree below root, using only parent/child/sibling links.
+        std::uint32_t d = 0;
+        for (N* nd = root; nd != nullptr;) {
+            const auto pos = static_cast<std::uint32_t>(preorder.size());
+            if constexpr (use_trav_enter) {
+                if (nd->get_data().trav_enter != first_trav_enter + pos) {
+                    throw OTCError() << "LCAIndex: trav_enter of node " << pos << " in preorder is stale.";
+                }
+            } else {
+                position_map.emplace(nd, pos);
+            }
+            preorder.push_back(nd);
+            depth.push_back(d);
+            if (nd->get_first_child() != nullptr) {
+                nd = nd->get_first_child();
+                d++;
+                continue;
+            }
+            while (nd != root and nd->get_next_sib() == nullptr) {
+                nd = nd->get_parent();
+                d--;
+            }
+            nd = (nd == root) ? nullptr : nd->get_next_sib();
+        }
+        build_block_minima();
+    }
+
+    std::size_t size() const {
+        return preorder.size();
+    }
+
+    std::size_t position(const N* nd) const {
+        if constexpr (use_trav_enter) {
+            assert(nd->get_data().trav_enter - first_trav_enter < preorder.size());
+            return nd->get_data().trav_enter - first_trav_enter;
+        } else {
+            return position_map.at(nd);
+        }
+    }
+
+    /// Same contract as mrca_from_depth: a null argument returns the other one.
+    N* mrca(N* n1, N* n2) const {
+        assert(n1 or n2);
+        if (not n1) {
+            return n2;
+        }
+        if (not n2) {
+            return n1;
+        }
+        if (n1 == n2) {
+            return n1;
+        }
+        auto p1 = position(n1);
+        auto p2 = position(n2);
+        if (p1 > p2) {
+            std::swap(p1, p2);
+        }
+        // preorder[m] is an ancestor of (or equal to) the later node, so it is still in the tree.
+        const auto m = shallowest(p1 + 1, p2);
+        return preorder[m]->get_parent();
+    }
+
+    N* operator()(N* n1, N* n2) const {
+        return mrca(n1, n2);
+    }
+
+    /// The MRCA of a group is the MRCA of its first and last members in preorder.
+    template <typename C>
+    N* mrca_of_group(const C& nodes) const {
+        N* first = nullptr;
+        N* last = nullptr;
+        std::size_t first_pos = 0;
+        std::size_t last_pos = 0;
+        for (N* nd : nodes) {
+            const auto pos = position(nd);
+            if (first == nullptr or pos < first_pos) {
+                first = nd;
+                first_pos = pos;
+            }
+            if (last == nullptr or pos > last_pos) {
+                last = nd;
+                last_pos = pos;
+            }
+        }
+        if (first == nullptr) {
+            return nullptr;
+        }
+        return mrca(first, last);
+    }
+
+    std::size_t memory_used() const {
+        std::size_t total = preorder.capacity() * sizeof(N*);
+        total += depth.capacity() * sizeof(std::uint32_t);
+        total += in_block_minima.capacity() * sizeof(std::uint64_t);
+        for (const auto & level : sparse_table) {
+            total += level.capacity() * sizeof(std::uint32_t);
+        }
+        total += position_map.size() * (sizeof(const N*) + sizeof(std::uint32_t) + sizeof(void*));
+        total += position_map.bucket_count() * sizeof(void*);
+        return total;
+    }
+};
+
+} // namespace otc
+#endif
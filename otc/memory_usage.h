@@ -7,6 +7,7 @@
 #include "otc/error.h"
 #include "otc/util.h"
 #include "otc/debug.h"
+#include <iomanip>
 #include <vector>
 #include <unordered_map>
 #include <set>
@@ -142,9 +143,33 @@ inline std::size_t calc_memory_used_by_tree(const T & tree, MemoryBookkeeper &mb
     mb["tree detached nodes"] += dd;
     std::size_t total = dd + td + tn;
     total += sizeof(int *); // count root pointer
+    std::size_t num_nodes = 0;
     for (auto nd : iter_node_const(tree)) {
         assert(nd);
         total += calc_memory_used_by_node(*nd, mb);
+        num_nodes++;
+    }
+    // Node layout: slab slack for arena trees, or the allocator's per-node header for heap trees.
+    //  The other layout is reported as an estimate (not added to the total) for comparison.
+    using node_type = typename T::node_type;
+    constexpr std::size_t heap_overhead_per_node = 2 * sizeof(std::size_t); // approximate malloc chunk header + rounding
+    const std::size_t heap_layout = num_nodes * heap_overhead_per_node;
+    const auto arena = tree.get_node_arena();
+    std::size_t arena_layout;
+    if (arena) {
+        arena_layout = (arena->capacity() - num_nodes) * sizeof(node_type);
+        arena_layout += arena->num_slabs() * (sizeof(void *) + heap_overhead_per_node);
+        mb["node layout arena slabs (overhead)"] += arena_layout;
+        mb["node layout heap (estimate, not in total)"] += heap_layout;
+        total += arena_layout;
+    } else {
+        constexpr auto slab_size = NodeArena<node_type>::slab_size;
+        const std::size_t num_slabs = (num_nodes + slab_size - 1) / slab_size;
+        arena_layout = (num_slabs * slab_size - num_nodes) * sizeof(node_type);
+        arena_layout += num_slabs * (sizeof(void *) + heap_overhead_per_node);
+        mb["node layout heap (overhead)"] += heap_layout;
+        mb["node layout arena slabs (estimate, not in total)"] += arena_layout;
+        total += heap_layout;
     }
     return total;
 }
@@ -1,4 +1,7 @@
 #include "otc/newick.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <cstring>
 #include <string>
 namespace otc {
@@ -13,6 +16,88 @@ static const char * _ILL_AFTER_COLON = "Illegal character after \":\" character.
 static const char * _ILL_NO_SEMICOLON = "Expecting ; after a newick description.";
 static const char * _ILL_FIRST_CHAR = "Expecting a newick tree to start with \"(\".";
 
+// The chars that finish_reading_unquoted appends to a label as they are: isgraph, and not one of
+//   (),:;'[ or _.  Computed with the same isgraph as the char-by-char loop.
+enum label_char_t : unsigned char {
+    NOT_LABEL_CHAR = 0,
+    PLAIN_LABEL_CHAR = 1,
+    UNDERSCORE_CHAR = 2
+};
+
+static const unsigned char * label_char_table() {
+    static const auto table = [] {
+        std::array<unsigned char, 256> t;
+        for (int i = 0; i < 256; ++i) {
+            const char c = static_cast<char>(i);
+            if (c == '_') {
+                t[i] = UNDERSCORE_CHAR;
+            } else if (std::isgraph(c) and std::strchr("(),:;'[", c) == nullptr) {
+                t[i] = PLAIN_LABEL_CHAR;
+            } else {
+                t[i] = NOT_LABEL_CHAR;
+            }
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// std::streambuf keeps its get area protected.  This gives the tokenizer a view of the chars that
+//   are already buffered, so that a run of label chars can be consumed in one step rather than
+//   through one sbumpc call per char.
+class BufferedChars: public std::streambuf {
+    public:
+        static const char * next(std::streambuf * b) {
+            return (b->*&BufferedChars::gptr)();
+        }
+        static const char * end(std::streambuf * b) {
+            return (b->*&BufferedChars::egptr)();
+        }
+        static void consume(std::streambuf * b, std::size_t n) {
+            (b->*&BufferedChars::gbump)(static_cast<int>(n));
+        }
+};
+
+void NewickTokenizer::iterator::read_label_run() {
+    if (this->has_pushed or this->at_end) {
+        return;
+    }
+    const auto table = label_char_table();
+    auto buf = this->input_stream.rdbuf();
+    for (;;) {
+        const char * first = BufferedChars::next(buf);
+        const char * last = BufferedChars::end(buf);
+        const char * c = first;
+        bool underscore = false;
+        for (; c != last; ++c) {
+            const auto k = table[static_cast<unsigned char>(*c)];
+            if (k == NOT_LABEL_CHAR) {
+                break;
+            }
+            underscore = underscore or k == UNDERSCORE_CHAR;
+        }
+        const std::size_t n = c - first;
+        if (n > 0) {
+            const auto start = this->current_word.size();
+            this->current_word.append(first, n);
+            if (underscore) {
+                std::replace(this->current_word.begin() + start, this->current_word.end(), '_', ' ');
+            }
+            BufferedChars::consume(buf, n);
+            this->current_pos->pos += n;
+            this->current_pos->colNumber += n;
+        }
+        if (c != last) {
+            return;
+        }
+        // The run reaches the end of the buffer: refill it (sgetc does not consume), unless the
+        //   stream is at EOF or unbuffered.
+        if (buf->sgetc() == EOF or BufferedChars::next(buf) == BufferedChars::end(buf)) {
+            return;
+        }
+    }
+}
+
 void NewickTokenizer::iterator::on_label_exit(char n, bool fromWS) {
     bool whitespaceFound = fromWS;
     if (std::strchr("(),:;", n) == nullptr) {
@@ -76,6 +161,7 @@ void NewickTokenizer::iterator::finish_reading_quoted_str(){
 }
 void NewickTokenizer::iterator::finish_reading_unquoted(bool continuingLabel){
     for (;;) {
+        this->read_label_run();
         char c;
         if(!advance_reader_one_logical_char(c)) {
             throw OTCParsingError("Unexpected EOF in label. Expecting a ; to end a newick.", '\0', (*this->current_pos));
@@ -170,7 +256,6 @@ void NewickTokenizer::iterator::consume_next_token() {
             }
             throw OTCParsingError("Unexpected EOF. Semicolon expected at the end of the newick.", '\0', *this->current_pos);
         } else {
-            LOG(TRACE) << "in consume_next_token with n =\"" << n << "\"";
             if (this->previous_token_state == NWK_NOT_IN_TREE) {
                 if (n == '(') {
                     this->current_token_state = NWK_OPEN;
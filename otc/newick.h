@@ -27,6 +27,9 @@ inline std::unique_ptr<T> read_next_newick(std::istream &inp, FilePosStruct & po
     std::stack<typename T::node_type *> nodeStack;
     T * rawTreePtr = new T();
     std::unique_ptr<T> treePtr(rawTreePtr);
+    if (parsingRules.use_node_arena) {
+        rawTreePtr->use_node_arena();
+    }
     typename T::node_type * currNode = rawTreePtr->create_root();
     // If we read a label or colon, we might consume multiple tokens;
     for (; tokenIt != tokenizer.end(); ) {
@@ -2,7 +2,6 @@
 #define OTCETERA_NEWICK_TOKENIZER_H
 #include <iostream>
 #include <fstream>
-#include <stack>
 #include <map>
 #include <stdexcept>
 #include "otc/otc_base_includes.h"
@@ -19,6 +18,7 @@ struct ParsingRules {
     bool prune_unrecognized_input_tips = false;
     bool require_ott_ids = true;  // Every label must include an OttId
     bool set_ott_ids = true;      // Read and set OttIds for labels that have them.
+    bool use_node_arena = false;  // Allocate the nodes from slabs owned by the tree (see RootedTree::use_node_arena).
 };
 
 typedef std::shared_ptr<const std::string> ConstStrPtr;
@@ -235,16 +235,22 @@ class NewickTokenizer {
                 void finish_reading_unquoted(bool continuingLabel);
                 void finish_reading_quoted_str();
                 void on_label_exit(char nextChar, bool enteringFromWhitespace);
+                // Appends the run of plain label chars that is waiting in the stream's buffer.
+                void read_label_run();
                 char peek() {
-                    if (!pushed.empty()) {
-                        return pushed.top();
+                    if (has_pushed) {
+                        return pushed;
                     }
                     char c = static_cast<char>(this->input_stream.rdbuf()->sgetc());
-                    pushed.push(c);
+                    has_pushed = true;
+                    pushed = c;
                     return c;
                 }
+                // At most one char is ever pushed back: each push follows a read.
                 void push(char c) {
-                    this->pushed.push(c);
+                    assert(!has_pushed);
+                    has_pushed = true;
+                    this->pushed = c;
                     if (c == '\n') {
                         this->current_pos->colNumber = last_line_ind;
                         this->current_pos->lineNumber -= 1;
@@ -256,9 +262,9 @@ class NewickTokenizer {
                 void throw_scc_err(char c) const __attribute__ ((noreturn));
                 //deals with \r\n as \n Hence "LogicalChar"
                 bool advance_reader_one_logical_char(char & c) {
-                    if (!pushed.empty()) {
-                        c = pushed.top();
-                        pushed.pop();
+                    if (has_pushed) {
+                        c = pushed;
+                        has_pushed = false;
                     } else {
                         if (this->at_end) {
                             c = EOF;
@@ -333,7 +339,8 @@ class NewickTokenizer {
                 newick_token_state_t current_token_state;
                 newick_token_state_t previous_token_state;
                 long num_unclosed_parens;
-                std::stack<char> pushed;
+                bool has_pushed = false;
+                char pushed = '\0';
                 std::vector<std::string> comments;
                 std::size_t last_line_ind;
                 friend class NewickTokenizer;
@@ -188,7 +188,7 @@ void NodeEmbedding<T, U>::resolve_parent_in_favor_of_this_node(
         U * phChild = p2p.first;
         phChild->detach_this_node();
         insertedNodePtr->add_child(phChild);
-        const OttIdSet & cd = phChild->get_data().des_ids;
+        const auto & cd = phChild->get_data().des_ids;
         insertedNodePtr->get_data().des_ids.insert(cd.begin(), cd.end());
     }
     T * scaffoldAncestor = nullptr;
@@ -879,7 +879,7 @@ void NodeEmbedding<T, U>::collapse_group(T & scaffold_node, SupertreeContext<T,
                     sc.log(IGNORE_TIP_MAPPED_TO_NONMONOPHYLETIC_TAXON, *lp->phylo_child);
                     OttIdSet innerOTTId;
                     innerOTTId.insert(lp->phylo_child->get_ott_id());
-                    OttIdSet n = scaffold_node.get_data().des_ids; // expand the internal name to it taxonomic content
+                    OttIdSet n = as_ott_id_set(scaffold_node.get_data().des_ids); // expand the internal name to it taxonomic content
                     n.erase(lp->phylo_child->get_ott_id());
                     lp->update_des_ids_for_self_and_anc(innerOTTId, n, sn2ne);
                     indsOfTreesMappedToInternal.insert(treeIndex);
@@ -1053,7 +1053,7 @@ void report_on_conflicting(std::ostream & out,
     const PathPairing<T, U> * ep = *epIt;
     const U * phyloPar = ep->phylo_parent;
     const U * deepestPhylo = nullptr;
-    std::map<OttIdSet, const U *> desIdSet2NdConflicting;
+    std::map<DesIdSet, const U *> desIdSet2NdConflicting;
     if (is_proper_subset(scaffold_des, phyloPar->get_data().des_ids)) {
         deepestPhylo = phyloPar;
     } else {
@@ -1,7 +1,9 @@
 #ifndef OTCETERA_NODE_NAMING_H
 #define OTCETERA_NODE_NAMING_H
 
+#include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 #include "otc/otc_base_includes.h"
@@ -127,5 +129,44 @@ inline std::string make_mrca_name(OttId number1, OttId number2) {
     return mrca_prefix + std::to_string(number1) + "ott" + std::to_string(number2);
 }
 
+// If node_id is "ott" followed by digits (as made by make_name("ott", id)), sets raw_ott_id to the
+//   number and returns true.  A number too big for a long is returned as LONG_MAX, so that
+//   check_ott_id_size rejects it.
+inline bool parse_ott_node_id(std::string_view node_id, long & raw_ott_id) {
+    if (node_id.size() < 4 or node_id.compare(0, 3, "ott") != 0) {
+        return false;
+    }
+    long n = 0;
+    for (auto c: node_id.substr(3)) {
+        if (c < '0' or c > '9') {
+            return false;
+        }
+        const int digit = c - '0';
+        if (n > (std::numeric_limits<long>::max() - digit) / 10) {
+            n = std::numeric_limits<long>::max();
+        } else if (n != std::numeric_limits<long>::max()) {
+            n = 10 * n + digit;
+        }
+    }
+    raw_ott_id = n;
+    return true;
+}
+
+// If node_id is "mrca" followed by two OTT node ids (as made by make_mrca_name), sets first_id
+//   and second_id to them and returns true.
+inline bool parse_mrca_node_id(std::string_view node_id, std::string_view & first_id, std::string_view & second_id) {
+    if (node_id.size() < 12 or node_id.compare(0, 7, "mrcaott") != 0) {
+        return false;
+    }
+    auto second_start = node_id.find("ott", 7);
+    if (second_start == std::string_view::npos) {
+        return false;
+    }
+    first_id = node_id.substr(4, second_start - 4);
+    second_id = node_id.substr(second_start);
+    long bogus;
+    return parse_ott_node_id(first_id, bogus) and parse_ott_node_id(second_id, bogus);
+}
+
 } //namespace otc
 #endif
@@ -205,7 +205,7 @@ inline OttIdSet get_all_ott_ids(const Tree& taxonomy) {
 
 template<>
 inline OttIdSet get_all_ott_ids(const TreeMappedWithSplits &taxonomy) {
-    return taxonomy.get_root()->get_data().des_ids;
+    return as_ott_id_set(taxonomy.get_root()->get_data().des_ids);
 }
  
 template<typename T>
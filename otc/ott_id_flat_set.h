@@ -0,0 +1,167 @@
+#ifndef OTCETERA_OTT_ID_FLAT_SET_H
+#define OTCETERA_OTT_ID_FLAT_SET_H
+// A set of OTT ids stored as a sorted vector.
+// Depends on: otc_base_includes.h
+// Depended on by: tree_data.h, util.h
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+#include "otc/otc_base_includes.h"
+
+namespace otc {
+
+// OttIdFlatSet has the parts of the std::set<OttId> interface that the des_ids of tree nodes use,
+//   so it can stand in for OttIdSet there (see DesIdSet in tree_data.h).
+//
+// A std::set spends a ~40-byte red-black tree node on every id, and every node of a tree keeps the
+//   ids of all of its descendants, so the des_ids of a deep tree like the OTT scaffold hold far more
+//   ids than the tree has tips.  Here an id costs sizeof(OttId) bytes, and the set operations
+//   (subset, intersection, difference) are merges of two sorted arrays.  Inserting one id in the
+//   middle is linear, so ranges should be added with the range insert, which merges.
+class OttIdFlatSet {
+    std::vector<OttId> ids;
+
+    public:
+    using key_type = OttId;
+    using value_type = OttId;
+    using size_type = std::size_t;
+    using const_iterator = std::vector<OttId>::const_iterator;
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::vector<OttId>::const_reverse_iterator;
+    using reverse_iterator = const_reverse_iterator;
+
+    OttIdFlatSet() = default;
+    OttIdFlatSet(std::initializer_list<OttId> il) {
+        insert(il.begin(), il.end());
+    }
+    template<typename It>
+    OttIdFlatSet(It first, It last) {
+        insert(first, last);
+    }
+    OttIdFlatSet(const OttIdSet & s)
+        :ids(s.begin(), s.end()) {
+    }
+    explicit operator OttIdSet() const {
+        return OttIdSet(ids.begin(), ids.end());
+    }
+
+    const_iterator begin() const { return ids.begin(); }
+    const_iterator end() const { return ids.end(); }
+    const_iterator cbegin() const { return ids.begin(); }
+    const_iterator cend() const { return ids.end(); }
+    const_reverse_iterator rbegin() const { return ids.rbegin(); }
+    const_reverse_iterator rend() const { return ids.rend(); }
+    size_type size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+    void clear() { ids.clear(); }
+    void swap(OttIdFlatSet & other) { ids.swap(other.ids); }
+    void reserve(size_type n) { ids.reserve(n); }
+    void shrink_to_fit() { ids.shrink_to_fit(); }
+    std::size_t capacity() const { return ids.capacity(); }
+
+    const_iterator lower_bound(OttId id) const {
+        return std::lower_bound(ids.begin(), ids.end(), id);
+    }
+    const_iterator upper_bound(OttId id) const {
+        return std::upper_bound(ids.begin(), ids.end(), id);
+    }
+    const_iterator find(OttId id) const {
+        auto it = lower_bound(id);
+        return (it != ids.end() and *it == id) ? it : ids.end();
+    }
+    size_type count(OttId id) const {
+        return std::binary_search(ids.begin(), ids.end(), id) ? 1 : 0;
+    }
+
+    std::pair<const_iterator, bool> insert(OttId id) {
+        if (ids.empty() or ids.back() < id) {
+            ids.push_back(id);
+            return {std::prev(ids.end()), true};
+        }
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (*it == id) {
+            return {it, false};
+        }
+        return {ids.insert(it, id), true};
+    }
+    const_iterator insert(const_iterator, OttId id) {
+        return insert(id).first;
+    }
+    // Appends the range and merges it in, so adding the des_ids of a child is linear.
+    template<typename It>
+    void insert(It first, It last) {
+        const auto old_size = ids.size();
+        ids.insert(ids.end(), first, last);
+        auto mid = ids.begin() + old_size;
+        if (not std::is_sorted(mid, ids.end())) {
+            std::sort(mid, ids.end());
+        }
+        if (old_size > 0 and mid != ids.end() and *mid <= ids[old_size - 1]) {
+            std::inplace_merge(ids.begin(), mid, ids.end());
+        }
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    void insert(std::initializer_list<OttId> il) {
+        insert(il.begin(), il.end());
+    }
+
+    size_type erase(OttId id) {
+        auto it = find(id);
+        if (it == ids.end()) {
+            return 0;
+        }
+        ids.erase(it);
+        return 1;
+    }
+    const_iterator erase(const_iterator it) {
+        return ids.erase(it);
+    }
+
+    bool operator==(const OttIdFlatSet & other) const { return ids == other.ids; }
+    bool operator!=(const OttIdFlatSet & other) const { return ids != other.ids; }
+    bool operator<(const OttIdFlatSet & other) const { return ids < other.ids; }
+};
+
+// For passing des_ids to code that wants an OttIdSet: a copy for an OttIdFlatSet, and the set
+//   itself (no copy) for an OttIdSet.
+inline OttIdSet as_ott_id_set(const OttIdFlatSet & s) {
+    return OttIdSet(s.begin(), s.end());
+}
+inline const OttIdSet & as_ott_id_set(const OttIdSet & s) {
+    return s;
+}
+
+// Gives back the spare capacity left by filling a set one child at a time; nothing to do for an OttIdSet.
+inline void shrink_to_fit(OttIdFlatSet & s) {
+    s.shrink_to_fit();
+}
+inline void shrink_to_fit(OttIdSet &) {
+}
+
+// Found by ADL, like std::begin and std::end are for std::sets.
+inline OttIdFlatSet::const_iterator begin(const OttIdFlatSet & s) {
+    return s.begin();
+}
+inline OttIdFlatSet::const_iterator end(const OttIdFlatSet & s) {
+    return s.end();
+}
+
+inline bool operator==(const OttIdFlatSet & fs, const OttIdSet & s) {
+    return fs.size() == s.size() and std::equal(fs.begin(), fs.end(), s.begin());
+}
+inline bool operator==(const OttIdSet & s, const OttIdFlatSet & fs) {
+    return fs == s;
+}
+inline bool operator!=(const OttIdFlatSet & fs, const OttIdSet & s) {
+    return not (fs == s);
+}
+inline bool operator!=(const OttIdSet & s, const OttIdFlatSet & fs) {
+    return not (fs == s);
+}
+
+} // namespace otc
+#endif
@@ -0,0 +1,327 @@
+#ifndef OTCETERA_OTT_ID_INDEX_H
+#define OTCETERA_OTT_ID_INDEX_H
+// A map from OTT ids to pointers that is an array lookup for dense ids.
+// Depends on: otc_base_includes.h
+// Depended on by: tree_data.h, tree_operations.h, taxonomy/taxonomy.h, ws/tolws.h
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "otc/otc_base_includes.h"
+
+namespace otc {
+
+// OttIdIndex maps OTT ids to non-null pointers (usually nodes).  It has the parts of the std::map
+//   and unordered_map interfaces that the OTT id -> node maps use, so it can replace them.  Values
+//   are set with set(id, value) rather than operator[].
+//
+// OTT ids are fairly dense integers (the synth tree has ~2.3M of them below ~8M), so values are kept
+//   in a vector indexed by id, and a lookup is a bounds check and a load.  The vector only grows
+//   if it stays within SLOTS_PER_ID slots per id; other ids (negative ids, or the ids of a small
+//   tree, which are spread over the whole range) go in a small open-addressing hash table.  When
+//   the vector grows, the ids that now fit move into it.  Callers that know the largest id should
+//   call reserve_ids first, so that no id lands in the table only because it came early.
+//
+// As with an unordered_map, iteration order is unspecified (it is the ids in the vector in
+//   increasing order, then the others).  Use keys() to visit the ids in order.
+template<typename T>
+class OttIdIndex {
+    static_assert(std::is_pointer<T>::value, "OttIdIndex values must be pointers, null meaning absent.");
+    static constexpr std::size_t SLOTS_PER_ID = 4;
+    static constexpr std::size_t MIN_SLOTS = 1024;
+    static constexpr std::size_t MIN_CELLS = 16;
+    static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+    std::vector<T> slots;
+    std::size_t num_in_slots = 0;
+    // Linear probing; the number of cells is a power of two, at most half of them are used, and
+    //   an unused cell has a null value.
+    std::vector<std::pair<OttId, T>> cells;
+    std::size_t num_in_cells = 0;
+
+    bool in_slots(OttId id) const {
+        return id >= 0 and static_cast<std::size_t>(id) < slots.size();
+    }
+
+    std::size_t home_cell(OttId id) const {
+        const auto h = static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<std::size_t>(h ^ (h >> 32)) & (cells.size() - 1);
+    }
+
+    std::size_t find_cell(OttId id) const {
+        if (num_in_cells == 0) {
+            return NOT_FOUND;
+        }
+        for (auto i = home_cell(id);; i = (i + 1) & (cells.size() - 1)) {
+            if (cells[i].second == nullptr) {
+                return NOT_FOUND;
+            }
+            if (cells[i].first == id) {
+                return i;
+            }
+        }
+    }
+
+    void set_cell(OttId id, T value) {
+        if (2 * (num_in_cells + 1) > cells.size()) {
+            rehash_cells(std::max(MIN_CELLS, 2 * cells.size()));
+        }
+        auto i = home_cell(id);
+        while (cells[i].second != nullptr and cells[i].first != id) {
+            i = (i + 1) & (cells.size() - 1);
+        }
+        if (cells[i].second == nullptr) {
+            ++num_in_cells;
+        }
+        cells[i] = {id, value};
+    }
+
+    // Shifts the cells after i back, so that no probe sequence runs through an unused cell.
+    void erase_cell(std::size_t i) {
+        const auto mask = cells.size() - 1;
+        for (auto j = (i + 1) & mask; cells[j].second != nullptr; j = (j + 1) & mask) {
+            const auto h = home_cell(cells[j].first);
+            const bool stays = (i <= j) ? (i < h and h <= j) : (i < h or h <= j);
+            if (not stays) {
+                cells[i] = cells[j];
+                i = j;
+            }
+        }
+        cells[i] = {0, nullptr};
+        --num_in_cells;
+    }
+
+    void rehash_cells(std::size_t num_cells) {
+        std::vector<std::pair<OttId, T>> old_cells(num_cells, std::pair<OttId, T>(0, nullptr));
+        old_cells.swap(cells);
+        num_in_cells = 0;
+        for (const auto & c : old_cells) {
+            if (c.second != nullptr) {
+                set_cell(c.first, c.second);
+            }
+        }
+    }
+
+    void grow_slots(std::size_t new_size) {
+        slots.reserve(new_size);
+        slots.resize(new_size, nullptr);
+        if (num_in_cells == 0) {
+            return;
+        }
+        for (auto & c : cells) {
+            if (c.second != nullptr and in_slots(c.first)) {
+                slots[c.first] = c.second;
+                ++num_in_slots;
+                --num_in_cells;
+                c.second = nullptr;
+            }
+        }
+        // Shrink the table to fit the ids that are left.
+        auto num_cells = MIN_CELLS;
+        while (num_cells < 2 * num_in_cells) {
+            num_cells *= 2;
+        }
+        if (num_in_cells == 0) {
+            std::vector<std::pair<OttId, T>>().swap(cells);
+        } else {
+            rehash_cells(num_cells);
+        }
+    }
+
+    public:
+    using key_type = OttId;
+    using mapped_type = T;
+    using value_type = std::pair<const OttId, T>;
+    using size_type = std::size_t;
+
+    // Iterates over the slots in increasing order of id, then over the cells of the table.
+    class const_iterator {
+        const OttIdIndex * index = nullptr;
+        std::size_t pos = 0;
+        std::pair<OttId, T> current;
+
+        void settle() {
+            const auto & slots = index->slots;
+            while (pos < slots.size() and slots[pos] == nullptr) {
+                ++pos;
+            }
+            if (pos < slots.size()) {
+                current = {static_cast<OttId>(pos), slots[pos]};
+                return;
+            }
+            const auto & cells = index->cells;
+            while (pos < slots.size() + cells.size() and cells[pos - slots.size()].second == nullptr) {
+                ++pos;
+            }
+            if (pos < slots.size() + cells.size()) {
+                current = cells[pos - slots.size()];
+            }
+        }
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<OttId, T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        const_iterator() = default;
+        const_iterator(const OttIdIndex * i, std::size_t p)
+            :index(i),
+            pos(p) {
+            settle();
+        }
+        reference operator*() const {
+            return current;
+        }
+        pointer operator->() const {
+            return &current;
+        }
+        const_iterator & operator++() {
+            ++pos;
+            settle();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto r = *this;
+            ++(*this);
+            return r;
+        }
+        bool operator==(const const_iterator & other) const {
+            return pos == other.pos;
+        }
+        bool operator!=(const const_iterator & other) const {
+            return not (*this == other);
+        }
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(this, slots.size() + cells.size());
+    }
+
+    // The value for id, or nullptr.
+    T lookup(OttId id) const {
+        if (in_slots(id)) {
+            return slots[id];
+        }
+        const auto i = find_cell(id);
+        return (i == NOT_FOUND) ? nullptr : cells[i].second;
+    }
+
+    const_iterator find(OttId id) const {
+        if (in_slots(id)) {
+            return (slots[id] == nullptr) ? end() : const_iterator(this, id);
+        }
+        const auto i = find_cell(id);
+        return (i == NOT_FOUND) ? end() : const_iterator(this, slots.size() + i);
+    }
+
+    std::size_t count(OttId id) const {
+        return lookup(id) != nullptr ? 1 : 0;
+    }
+
+    T at(OttId id) const {
+        auto v = lookup(id);
+        if (v == nullptr) {
+            throw std::out_of_range("OttIdIndex::at");
+        }
+        return v;
+    }
+
+    // Sets the value for id, replacing any value it had.
+    void set(OttId id, T value) {
+        assert(value != nullptr);
+        if (not in_slots(id) and id >= 0) {
+            // Grow by at least a quarter, so the table is only emptied O(log n) times.  Doubling is
+            //   capped by the density limit, or a random fill would stall just short of it.
+            const auto limit = SLOTS_PER_ID * (size() + 1) + MIN_SLOTS;
+            const auto new_size = std::max({static_cast<std::size_t>(id) + 1, std::min(2 * slots.size(), limit), MIN_SLOTS});
+            if (new_size <= limit and new_size >= slots.size() + slots.size() / 4) {
+                grow_slots(new_size);
+            }
+        }
+        if (in_slots(id)) {
+            if (slots[id] == nullptr) {
+                ++num_in_slots;
+            }
+            slots[id] = value;
+        } else {
+            set_cell(id, value);
+        }
+    }
+
+    std::pair<const_iterator, bool> insert(const value_type & v) {
+        auto it = find(v.first);
+        if (it != end()) {
+            return {it, false};
+        }
+        set(v.first, v.second);
+        return {find(v.first), true};
+    }
+
+    std::size_t erase(OttId id) {
+        if (in_slots(id)) {
+            if (slots[id] == nullptr) {
+                return 0;
+            }
+            slots[id] = nullptr;
+            --num_in_slots;
+            return 1;
+        }
+        const auto i = find_cell(id);
+        if (i == NOT_FOUND) {
+            return 0;
+        }
+        erase_cell(i);
+        return 1;
+    }
+
+    // Makes room for ids up to max_id, whatever the density.
+    void reserve_ids(OttId max_id) {
+        if (max_id >= 0 and static_cast<std::size_t>(max_id) >= slots.size()) {
+            grow_slots(static_cast<std::size_t>(max_id) + 1);
+        }
+    }
+
+    std::size_t size() const {
+        return num_in_slots + num_in_cells;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    void clear() {
+        std::vector<T>().swap(slots);
+        std::vector<std::pair<OttId, T>>().swap(cells);
+        num_in_slots = 0;
+        num_in_cells = 0;
+    }
+
+    std::size_t memory_used() const {
+        return slots.capacity() * sizeof(T) + cells.capacity() * sizeof(std::pair<OttId, T>);
+    }
+};
+
+// The ids, in increasing order.
+template<typename T>
+inline OttIdSet keys(const OttIdIndex<T> & index) {
+    std::vector<OttId> ids;
+    ids.reserve(index.size());
+    for (const auto & el : index) {
+        ids.push_back(el.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    return OttIdSet(ids.begin(), ids.end());
+}
+
+} // namespace otc
+#endif
@@ -88,7 +88,7 @@ class PathPairing {
         scaffold_anc(parent.scaffold_node),
         phylo_child(child.phylo_node),
         phylo_parent(parent.phylo_node),
-        curr_child_ott_id_set(child.phylo_node->get_data().des_ids) {
+        curr_child_ott_id_set(as_ott_id_set(child.phylo_node->get_data().des_ids)) {
         assert(phylo_child->get_parent() == phylo_parent);
         assert(scaffold_anc == scaffold_des || is_ancestor_des_no_iter(scaffold_anc, scaffold_des));
     }
@@ -99,7 +99,7 @@ class PathPairing {
         scaffold_anc(scafPar),
         phylo_child(child.phylo_node),
         phylo_parent(phyPar),
-        curr_child_ott_id_set(child.phylo_node->get_data().des_ids) {
+        curr_child_ott_id_set(as_ott_id_set(child.phylo_node->get_data().des_ids)) {
         assert(phylo_child->get_parent() == phylo_parent);
         assert(scaffold_anc == scaffold_des || is_ancestor_des_no_iter(scaffold_anc, scaffold_des));
     }
@@ -110,7 +110,7 @@ class PathPairing {
     const OttIdSet & get_ott_id_set() const {
         return curr_child_ott_id_set;
     }
-    const OttIdSet & get_phylo_child_des_id() const {
+    const auto & get_phylo_child_des_id() const {
         return phylo_child->get_data().des_ids;
     }
 };
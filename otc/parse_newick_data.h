@@ -99,7 +99,7 @@ inline void set_ott_id_and_add_to_map(RootedTree<T, U> & tree,
                                       labelToken->content(),
                                       labelToken->get_start_pos());
             }
-            treeData.ott_id_to_node[ottID] = &node;
+            treeData.ott_id_to_node.set(ottID, &node);
         } else if (parsingRules.require_ott_ids and not parsingRules.prune_unrecognized_input_tips) {
             throw OTCParsingError("Expecting a name for a taxon to end with an ott##### where the numbers are the OTT Id.",
                                   labelToken->content(),
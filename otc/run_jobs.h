@@ -0,0 +1,72 @@
+#ifndef OTCETERA_RUN_JOBS_H
+#define OTCETERA_RUN_JOBS_H
+// Spreads independent jobs over a few threads.
+// Depends on: (nothing in otc)
+// Depended on by: taxonomy/taxonomy.cpp, tools/solve-subproblems.cpp, tools/conflict-stats.cpp, ws/tolws.cpp
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace otc {
+
+// Calls job(i) for each i in [0,n), on the calling thread and up to n_extra_threads others.  Each
+//   thread takes the next job until none are left, so jobs start in order of i.
+// The first exception thrown by a job stops the remaining jobs from starting, and is rethrown once
+//   every thread has been joined.  If a thread cannot be started, the jobs run on the threads that
+//   were.
+inline void run_jobs_on_threads(std::size_t n, unsigned n_extra_threads, const std::function<void(std::size_t)> & job) {
+    std::atomic<std::size_t> next_job(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        for (auto i = next_job++; i < n; i = next_job++) {
+            try {
+                job(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (not error) {
+                    error = std::current_exception();
+                }
+                next_job = n;
+            }
+        }
+    };
+    // Joins the threads that were started, however this scope is left.
+    struct JoinGuard {
+        std::vector<std::thread> threads;
+        ~JoinGuard() {
+            for (auto & t : threads) {
+                t.join();
+            }
+        }
+    } guard;
+    if (n_extra_threads + 1 > n) {
+        n_extra_threads = (n > 0) ? static_cast<unsigned>(n - 1) : 0;
+    }
+    try {
+        guard.threads.reserve(n_extra_threads);
+        for (unsigned t = 0; t < n_extra_threads; ++t) {
+            guard.threads.emplace_back(worker);
+        }
+    } catch (const std::system_error &) {
+        // Too many threads: carry on with the ones we have.
+    } catch (const std::bad_alloc &) {
+    }
+    worker();
+    for (auto & t : guard.threads) {
+        t.join();
+    }
+    guard.threads.clear();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace otc
+#endif
@@ -0,0 +1,1130 @@
+#include <algorithm>
+#include <set>
+#include <list>
+#include <deque>
+#include <iterator>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <optional>
+#include <boost/filesystem.hpp>
+
+#include "otc/solve_subproblem.h"
+#include "otc/tree_operations.h"
+#include "otc/supertree_util.h"
+#include "otc/tree_iter.h"
+#include "otc/induced_tree.h"
+
+using namespace otc;
+namespace fs = boost::filesystem;
+
+using std::vector;
+using std::unique_ptr;
+using std::set;
+using std::list;
+using std::map;
+using std::string;
+using std::optional;
+
+namespace {
+
+typedef TreeMappedWithSplits Tree_t;
+typedef Tree_t::node_type node_t;
+
+int depth(const Tree_t::node_type* nd)
+{
+    return nd->get_data().depth;
+}
+
+/// Create a SORTED vector from a set
+template <typename T>
+vector<T> set_to_vector(const set<T>& s) {
+    vector<T> v;
+    v.reserve(s.size());
+    std::copy(s.begin(), s.end(), std::back_inserter(v));
+    return v;
+}
+
+struct RSplit {
+    vector<int> in;
+    vector<int> out;
+    vector<int> all;
+    RSplit() = default;
+    RSplit(const set<int>& i, const set<int>& a) {
+        in  = set_to_vector(i);
+        all = set_to_vector(a);
+        set_difference(begin(all), end(all), begin(in), end(in), std::inserter(out, out.end()));
+        assert(in.size() + out.size() == all.size());
+    }
+};
+
+RSplit split_from_include_exclude(const set<int>& i, const set<int>& e) {
+    RSplit s;
+    s.in = set_to_vector(i);
+    s.out = set_to_vector(e);
+    set_union(begin(i),end(i),begin(e),end(e),std::inserter(s.all,s.all.end()));
+    return s;
+}
+
+int merge_components(int c1, int c2, vector<int>& component, vector<list<int>>& elements);
+unique_ptr<Tree_t> BUILD(const vector<int>& tips, const vector<const RSplit*>& splits);
+void add_names(Tree_t& tree, const vector<Tree_t::node_type const*>& taxa);
+template <typename S>
+set<int> remap_ids(const S& s1, const map<OttId,int>& id_map);
+unique_ptr<Tree_t> combine(const vector<unique_ptr<Tree_t> >& trees, const set<OttId>&, bool incremental, bool verbose);
+unique_ptr<Tree_t> make_unresolved_tree(const vector<unique_ptr<Tree_t>>& trees, bool use_ids);
+
+/// Merge components c1 and c2 and return the component name that survived
+int merge_components(int ic1, int ic2, vector<int>& component, vector<list<int>>& elements) {
+    std::size_t c1 = static_cast<std::size_t>(ic1);
+    std::size_t c2 = static_cast<std::size_t>(ic2);
+    if (elements[c2].size() > elements[c1].size()) {
+        std::swap(c1, c2);
+    }
+    for(int i: elements[c2]) {
+        component[static_cast<std::size_t>(i)] = static_cast<int>(c1);
+    }
+    elements[c1].splice(elements[c1].end(), elements[c2]);
+    return static_cast<int>(c1);
+}
+
+// id -> index within the current BUILD( ) call; thread-local so that subproblems can be solved in parallel.
+thread_local vector<int> indices;
+
+/// Construct a tree with all the splits mentioned, and return a null pointer if this is not possible
+unique_ptr<Tree_t> BUILD(const vector<int>& tips, const vector<const RSplit*>& splits) {
+#pragma clang diagnostic ignored  "-Wsign-conversion"
+#pragma clang diagnostic ignored  "-Wsign-compare"
+#pragma clang diagnostic ignored  "-Wshorten-64-to-32"
+#pragma GCC diagnostic ignored  "-Wsign-compare"
+    std::unique_ptr<Tree_t> tree(new Tree_t());
+    tree->create_root();
+    // 1. First handle trees of size 1 and 2
+    if (tips.size() == 1) {
+        tree->get_root()->set_ott_id(*tips.begin());
+        return tree;
+    } else if (tips.size() == 2) {
+        auto Node1a = tree->create_child(tree->get_root());
+        auto Node1b = tree->create_child(tree->get_root());
+        auto it = tips.begin();
+        Node1a->set_ott_id(*it++);
+        Node1b->set_ott_id(*it++);
+        return tree;
+    }
+    // 2. Initialize the mapping from elements to components
+    vector<int> component;       // element index  -> component
+    vector<list<int> > elements;  // component -> element indices
+    for (int i=0;i<tips.size();i++) {
+        indices[tips[i]] = i;
+        component.push_back(i);
+        elements.push_back({i});
+    }
+    // 3. For each split, all the leaves in the include group must be in the same component
+    for(const auto& split: splits) {
+        int c1 = -1;
+        for(int i: split->in) {
+            int j = indices[i];
+            int c2 = component[j];
+            if (c1 != -1 and c1 != c2) {
+                merge_components(c1,c2,component,elements);
+            }
+            c1 = component[j];
+        }
+    }
+    // 4. If we can't subdivide the leaves in any way, then the splits are not consistent, so return failure
+    if (elements[component[0]].size() == tips.size()) {
+        return {};
+    }
+    // 5. Make a vector of labels for the partition components
+    vector<int> component_labels;                           // index -> component label
+    vector<int> component_label_to_index(tips.size(),-1);   // component label -> index
+    for (int c=0;c<tips.size();c++) {
+        if (c == component[c]) {
+            int index = component_labels.size();
+            component_labels.push_back(c);
+            component_label_to_index[c] = index;
+        }
+    }
+    // 6. Create the vector of tips in each connected component 
+    vector<vector<int>> subtips(component_labels.size());
+    for(int i=0;i<component_labels.size();i++) {
+        vector<int>& s = subtips[i];
+        int c = component_labels[i];
+        for (int j: elements[c]) {
+            s.push_back(tips[j]);
+        }
+    }
+    // 7. Determine the splits that are not satisfied yet and go into each component
+    vector<vector<const RSplit*>> subsplits(component_labels.size());
+    for(const auto& split: splits) {
+        int first = indices[*split->in.begin()];
+        assert(first >= 0);
+        int c = component[first];
+        // if none of the exclude group are in the component, then the split is satisfied by the top-level partition.
+        bool satisfied = true;
+        for(int x: split->out){
+            if (indices[x] != -1 and component[indices[x]] == c) {
+                satisfied = false;
+                break;
+            }
+        }
+        if (not satisfied) {
+            int i = component_label_to_index[c];
+            subsplits[i].push_back(split);
+        }
+    }
+    // 8. Clear our map from id -> index, for use by subproblems.
+    for(int id: tips) {
+        indices[id] = -1;
+    }
+    // 9. Recursively solve the sub-problems of the partition components
+    for(int i=0;i<subtips.size();i++) {
+        auto subtree = BUILD(subtips[i], subsplits[i]);
+        if (not subtree) {
+            return {};
+        }
+        add_subtree(tree->get_root(), *subtree);
+    }
+    return tree;
+}
+
+/// The state of one level of the BUILD recursion, kept alive so that splits can be added one at a time.
+///
+/// Each node holds the tips of one BUILD subproblem, the splits that were handed to it, and the
+///  partition of its tips into components ("parts").  Each part has its own node, which holds the
+///  splits that the partition at this level does not satisfy.  This is exactly the recursion tree
+///  that BUILD(tips, splits) walks, so adding a split to it accepts or rejects the split in the same
+///  way that re-running BUILD from scratch would.
+///
+/// When a split joins several parts, the smaller parts are merged into the largest one in place,
+///  so we do not rebuild large components.  Every change is recorded in a journal so that a
+///  rejected split can be rolled back.
+struct BuildNode {
+    vector<int> tips;
+    vector<const RSplit*> splits;                   // every split handed to this node
+    std::unordered_map<int,int> component;          // tip -> part
+    vector<unique_ptr<BuildNode>> parts;            // part -> node (null once merged into another part)
+    vector<vector<const RSplit*>> satisfied;        // part -> splits inside it that the partition satisfies
+    int n_parts = 0;
+
+    static unique_ptr<BuildNode> create(vector<int>&& tips, vector<const RSplit*>&& splits);
+    bool add_split(const RSplit* split);
+  private:
+    bool is_satisfied_in_part(const RSplit* split, const vector<int>& part_tips) const;
+    bool insert_split(const RSplit* split);
+    bool merge_parts(vector<int>& touched, const RSplit* split);
+    void add_singleton(int tip);
+};
+
+/// One undoable change to a BuildNode.
+struct BuildUndo {
+    enum class Op {pop_split, pop_tip, pop_part, set_component, erase_component, restore_part, pop_satisfied,
+                   restore_satisfied, restore_n_parts};
+    Op op;
+    BuildNode* node;
+    int key = 0;
+    int value = 0;
+    unique_ptr<BuildNode> part;
+    vector<const RSplit*> saved;
+};
+
+thread_local vector<BuildUndo> build_journal;
+// Give up on in-place merging when a single split makes more changes than this.
+thread_local std::size_t build_journal_limit = 0;
+
+void log_undo(BuildUndo::Op op, BuildNode* node, int key = 0, int value = 0) {
+    build_journal.push_back({op, node, key, value, {}, {}});
+}
+
+void roll_back(BuildUndo& u) {
+    auto node = u.node;
+    switch (u.op) {
+    case BuildUndo::Op::pop_split:         node->splits.pop_back(); break;
+    case BuildUndo::Op::pop_tip:           node->tips.pop_back(); break;
+    case BuildUndo::Op::pop_part:          node->parts.pop_back(); node->satisfied.pop_back(); break;
+    case BuildUndo::Op::set_component:     node->component[u.key] = u.value; break;
+    case BuildUndo::Op::erase_component:   node->component.erase(u.key); break;
+    case BuildUndo::Op::restore_part:      node->parts[u.key] = std::move(u.part); break;
+    case BuildUndo::Op::pop_satisfied:     node->satisfied[u.key].pop_back(); break;
+    case BuildUndo::Op::restore_satisfied: node->satisfied[u.key] = std::move(u.saved); break;
+    case BuildUndo::Op::restore_n_parts:   node->n_parts = u.value; break;
+    }
+}
+
+/// Is @split satisfied by the partition, given that its include group lies in the part with tips @part_tips?
+///
+/// The exclude groups of splits are often nearly all the leaves, so we scan whichever side is smaller.
+bool BuildNode::is_satisfied_in_part(const RSplit* split, const vector<int>& part_tips) const {
+    if (part_tips.size() < split->out.size()) {
+        for(int x: part_tips) {
+            if (std::binary_search(split->out.begin(), split->out.end(), x)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    int c = component.at(part_tips.front());
+    for(int x: split->out) {
+        auto it = component.find(x);
+        if (it != component.end() and it->second == c) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Construct the BUILD state from scratch, and return a null pointer if the splits are not consistent.
+unique_ptr<BuildNode> BuildNode::create(vector<int>&& tips, vector<const RSplit*>&& splits) {
+    unique_ptr<BuildNode> node(new BuildNode());
+    node->tips = std::move(tips);
+    node->splits = std::move(splits);
+    // 1. Trees of size 1 and 2 are always resolvable, as in BUILD( ).
+    if (node->tips.size() <= 2) {
+        return node;
+    }
+    // 2. Compute the partition, exactly as in BUILD( ).
+    const int n = node->tips.size();
+    vector<int> component(n);
+    vector<list<int>> elements(n);
+    node->component.reserve(n);
+    for (int i=0;i<n;i++) {
+        node->component[node->tips[i]] = i;
+        component[i] = i;
+        elements[i] = {i};
+    }
+    for(const auto& split: node->splits) {
+        int c1 = -1;
+        for(int i: split->in) {
+            int j = node->component.at(i);
+            int c2 = component[j];
+            if (c1 != -1 and c1 != c2) {
+                merge_components(c1,c2,component,elements);
+            }
+            c1 = component[j];
+        }
+    }
+    if (elements[component[0]].size() == node->tips.size()) {
+        return {};
+    }
+    // 3. Number the parts, and point each tip at its part.
+    vector<int> label_to_part(n,-1);
+    vector<vector<int>> subtips;
+    for (int c=0;c<n;c++) {
+        if (c == component[c]) {
+            label_to_part[c] = subtips.size();
+            subtips.emplace_back();
+            for(int j: elements[c]) {
+                subtips.back().push_back(node->tips[j]);
+            }
+        }
+    }
+    for (int i=0;i<n;i++) {
+        node->component[node->tips[i]] = label_to_part[component[i]];
+    }
+    // 4. Hand each unsatisfied split to the part containing its include group.
+    node->satisfied.resize(subtips.size());
+    vector<vector<const RSplit*>> subsplits(subtips.size());
+    for(const auto& split: node->splits) {
+        int c = node->component.at(split->in.front());
+        if (node->is_satisfied_in_part(split, subtips[c])) {
+            node->satisfied[c].push_back(split);
+        } else {
+            subsplits[c].push_back(split);
+        }
+    }
+    // 5. Recursively solve the sub-problems of the parts.
+    node->n_parts = subtips.size();
+    for(int i=0;i<subtips.size();i++) {
+        auto part = create(std::move(subtips[i]), std::move(subsplits[i]));
+        if (not part) {
+            return {};
+        }
+        node->parts.push_back(std::move(part));
+    }
+    return node;
+}
+
+/// Add @split if it is consistent with the splits already added, and return whether it was added.
+///  If the split is rejected, the state is rolled back to what it was before the call.
+///
+/// Merging in place is usually much cheaper than rebuilding, but a badly conflicting split can
+///  cascade through many levels before it is rejected.  If the journal grows too large, we roll
+///  back and rebuild this node from scratch instead, which costs the same as a single BUILD( ).
+bool BuildNode::add_split(const RSplit* split) {
+    assert(build_journal.empty());
+    build_journal_limit = 4*tips.size() + 1000;
+    bool ok = insert_split(split);
+    bool too_big = build_journal.size() > build_journal_limit;
+    if (not ok) {
+        while (not build_journal.empty()) {
+            roll_back(build_journal.back());
+            build_journal.pop_back();
+        }
+    }
+    build_journal.clear();
+    if (not ok and too_big) {
+        vector<int> all_tips = tips;
+        vector<const RSplit*> all_splits = splits;
+        all_splits.push_back(split);
+        auto rebuilt = create(std::move(all_tips), std::move(all_splits));
+        if (not rebuilt) {
+            return false;
+        }
+        std::swap(*this, *rebuilt);
+        return true;
+    }
+    return ok;
+}
+
+/// Add a new tip to a node with more than 2 tips, in a part of its own.
+void BuildNode::add_singleton(int tip) {
+    assert(tips.size() > 2);
+    tips.push_back(tip);
+    log_undo(BuildUndo::Op::pop_tip, this);
+    parts.push_back(create({tip}, {}));
+    satisfied.emplace_back();
+    log_undo(BuildUndo::Op::pop_part, this);
+    component[tip] = parts.size() - 1;
+    log_undo(BuildUndo::Op::erase_component, this, tip);
+    log_undo(BuildUndo::Op::restore_n_parts, this, 0, n_parts);
+    n_parts++;
+}
+
+/// Add @split, recording every change in the journal.  On failure, the caller must roll back the journal.
+bool BuildNode::insert_split(const RSplit* split) {
+    if (build_journal.size() > build_journal_limit) {
+        return false;
+    }
+    if (tips.size() > 2) {
+        // 1. Find the parts that the include group touches.
+        vector<int> touched;
+        for(int i: split->in) {
+            int c = component.at(i);
+            if (std::find(touched.begin(), touched.end(), c) == touched.end()) {
+                touched.push_back(c);
+            }
+        }
+        if (touched.size() == 1) {
+            // 2. The partition does not change.  Pass the split down if the partition does not satisfy it.
+            int c = touched[0];
+            if (is_satisfied_in_part(split, parts[c]->tips)) {
+                satisfied[c].push_back(split);
+                log_undo(BuildUndo::Op::pop_satisfied, this, c);
+            } else if (not parts[c]->insert_split(split)) {
+                return false;
+            }
+        } else if (n_parts - static_cast<int>(touched.size()) + 1 < 2) {
+            // 3. Merging the touched parts would leave only one part, so the split is rejected.
+            return false;
+        } else if (not merge_parts(touched, split)) {
+            return false;
+        }
+    }
+    splits.push_back(split);
+    log_undo(BuildUndo::Op::pop_split, this);
+    return true;
+}
+
+/// Merge the @touched parts into the largest of them, and add @split to the merged part.
+bool BuildNode::merge_parts(vector<int>& touched, const RSplit* split) {
+    std::sort(touched.begin(), touched.end(), [this](int c1, int c2) {
+            return parts[c1]->tips.size() > parts[c2]->tips.size();
+        });
+    const int p = touched[0];
+    auto unsatisfied_in_merged = [this,&touched](const RSplit* s, int skip) {
+        for(int c: touched) {
+            if (c != skip and not is_satisfied_in_part(s, parts[c]->tips)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // 1. The merged part must satisfy the splits that were handed to the smaller parts,
+    //    and also any satisfied splits that now have exclude-group members inside it.
+    vector<const RSplit*> to_add;
+    vector<const RSplit*> still_satisfied;
+    for(int c: touched) {
+        if (c != p) {
+            to_add.insert(to_add.end(), parts[c]->splits.begin(), parts[c]->splits.end());
+        }
+        for(auto s: satisfied[c]) {
+            if (unsatisfied_in_merged(s, c)) {
+                to_add.push_back(s);
+            } else {
+                still_satisfied.push_back(s);
+            }
+        }
+    }
+    if (unsatisfied_in_merged(split, -1)) {
+        to_add.push_back(split);
+    } else {
+        still_satisfied.push_back(split);
+    }
+    for(int c: touched) {
+        build_journal.push_back({BuildUndo::Op::restore_satisfied, this, c, 0, {}, std::move(satisfied[c])});
+        satisfied[c].clear();
+    }
+    satisfied[p] = std::move(still_satisfied);
+    // 2. Point the tips of the smaller parts at the merged part, and retire the smaller parts.
+    vector<BuildNode*> merged_away;
+    for(int c: touched) {
+        if (c == p) {
+            continue;
+        }
+        for(int tip: parts[c]->tips) {
+            log_undo(BuildUndo::Op::set_component, this, tip, c);
+            component[tip] = p;
+        }
+        merged_away.push_back(parts[c].get());
+        build_journal.push_back({BuildUndo::Op::restore_part, this, c, 0, std::move(parts[c]), {}});
+    }
+    log_undo(BuildUndo::Op::restore_n_parts, this, 0, n_parts);
+    n_parts -= (touched.size() - 1);
+    // 3a. A part with at most 2 tips has no partition to merge into, so rebuild it.  This is cheap.
+    if (parts[p]->tips.size() <= 2) {
+        vector<int> merged_tips = parts[p]->tips;
+        vector<const RSplit*> merged_splits = parts[p]->splits;
+        for(auto q: merged_away) {
+            merged_tips.insert(merged_tips.end(), q->tips.begin(), q->tips.end());
+        }
+        merged_splits.insert(merged_splits.end(), to_add.begin(), to_add.end());
+        auto merged = create(std::move(merged_tips), std::move(merged_splits));
+        if (not merged) {
+            return false;
+        }
+        build_journal.push_back({BuildUndo::Op::restore_part, this, p, 0, std::move(parts[p]), {}});
+        parts[p] = std::move(merged);
+        return true;
+    }
+    // 3b. Otherwise move the tips of the smaller parts into the largest part, and add the splits one at a time.
+    for(auto q: merged_away) {
+        for(int tip: q->tips) {
+            parts[p]->add_singleton(tip);
+        }
+    }
+    for(auto s: to_add) {
+        if (not parts[p]->insert_split(s)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool is_subset(const std::set<T>& set_two, const std::set<T>& set_one) {
+    return std::includes(set_one.begin(), set_one.end(), set_two.begin(), set_two.end());
+}
+
+Tree_t::node_type* add_monotypic_parent(Tree_t& tree, Tree_t::node_type* nd) {
+    if (nd->get_parent()) {
+        auto p = nd->get_parent();
+        auto monotypic = tree.create_child(p);
+        nd->detach_this_node();
+        monotypic->add_child(nd);
+        return monotypic;
+    } else {
+        auto monotypic = tree.create_root();
+        monotypic->add_child(nd);
+        return monotypic;
+    }
+}
+
+void add_root_and_tip_names(Tree_t& summary, Tree_t& taxonomy) {
+    // name root
+    summary.get_root()->set_name(taxonomy.get_root()->get_name());
+    if (taxonomy.get_root()->has_ott_id())
+	summary.get_root()->set_ott_id(taxonomy.get_root()->get_ott_id());
+    // name tips
+    auto summaryOttIdToNode = get_ottid_to_node_map(summary);
+    for(auto nd: iter_leaf_const(taxonomy)) {
+        auto id = nd->get_ott_id();
+        auto nd2 = summaryOttIdToNode.at(id);
+        nd2->set_name( nd->get_name());
+    }
+}
+
+Tree_t::node_type* find_mrca_of_desids(const DesIdSet& ids, const OttIdIndex<Tree_t::node_type*>& summaryOttIdToNode) {
+    int first = *ids.begin();
+    auto node = summaryOttIdToNode.at(first);
+    while( not is_subset(ids, node->get_data().des_ids) )
+        node = node->get_parent();
+    return node;
+}
+
+bool is_ancestor_of(const Tree_t::node_type* n1, const Tree_t::node_type* n2) {
+    // make sure the depth fields are initialized
+    assert(n1 == n2 or depth(n1) != 0 or depth(n2) != 0);
+    if (depth(n2) > depth(n1)) {
+        while (depth(n2) != depth(n1)) {
+            n2 = n2->get_parent();
+        }
+        return (n2 == n1);
+    } else {
+        return false;
+    }
+}
+
+
+const Tree_t::node_type* find_unique_maximum(const vector<const Tree_t::node_type*>& nodes)
+{
+    for(int i=0;i<nodes.size();i++)
+    {
+        bool is_ancestor = true;
+        for(int j=0;j<nodes.size() and is_ancestor;j++) {
+            if (j==i) {
+                continue;
+            }
+            if (not is_ancestor_of(nodes[i],nodes[j])) {
+                is_ancestor = false;
+            }
+        }
+        if (is_ancestor) {
+            return nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+const Tree_t::node_type* select_canonical_ottid(const vector<const Tree_t::node_type*>& names) {
+    // We should only have to make this choice if there are at least 2 names to choose from.
+    assert(names.size() >= 2);
+    // Do something more intelligent here - perhaps prefer non-incertae-sedis taxa, and then choose lowest ottid.
+    return names.front();
+}
+
+void register_ottid_equivalences(const Tree_t::node_type* canonical, const vector<const Tree_t::node_type*>& names) {
+    // First pass - actually we should write on a JSON file.
+    std::cerr << canonical->get_name() << " (canonical): equivalent to ";
+    for(auto name: names)
+        std::cerr << name->get_name() << " ";
+    std::cerr << "\n";
+}
+
+optional<OttId> find_ancestor_id(const Tree_t::node_type* nd)
+{
+    // Don't call this on the root node: it will abort.
+    assert(nd->get_parent());
+
+    while(auto p = nd->get_parent())
+    {
+	if (p->has_ott_id()) return p->get_ott_id();
+	nd = p;
+    }
+
+    // We should never get here if we don't call this on the root node.
+    return {};
+}
+
+bool is_ancestral_to(const Tree_t::node_type* anc, const Tree_t::node_type* n1)
+{
+    if (depth(n1) < depth(anc)) return false;
+
+    while(depth(n1) > depth(anc))
+    {
+	assert(n1->get_parent());
+	n1 = n1->get_parent();
+    }
+
+    assert(depth(n1) == depth(anc));
+
+    return (n1 == anc);
+}
+
+map<const Tree_t::node_type*,const Tree_t::node_type*> check_placement(const Tree_t& summary, const Tree_t& taxonomy)
+{
+    for(auto nd: iter_post_const(summary))
+    {
+	if (nd->get_parent() and nd->get_name().size() and not nd->has_ott_id())
+	{
+	    LOG(WARNING)<<"Named taxonomy node has no OTTID!  Not checking for incertae sedis placement.";
+	    return {};
+	}
+    }
+
+    map<const Tree_t::node_type*,const Tree_t::node_type*> placements;
+
+    auto node_from_id = get_ottid_to_const_node_map(taxonomy);
+
+    for(auto nd: iter_post_const(summary))
+	if (nd->get_parent() and nd->has_ott_id())
+	{
+	    auto id = nd->get_ott_id();
+	    auto anc_id = find_ancestor_id(nd);
+
+	    // ancestor is the root
+	    if (not anc_id) continue;
+
+	    auto tax_nd = node_from_id.at(id);
+	    auto tax_anc = node_from_id.at(*anc_id);
+	    if (not is_ancestral_to(tax_anc, tax_nd))
+		placements[tax_nd] = tax_anc;
+	}
+
+    return placements;
+}
+
+//  Given a list of taxon nodes that are known NOT to conflict with the summary tree,
+//   * map each name to the MRCA of its include group.
+//   * copy the (i) node name and (ii) ottid to the MRCA on the summary tree.
+//
+//  If multiple names get assigned to a single node, try to handle this by
+//    making a monotypic parent assigning the rootmost name to that.
+//  Otherwise choose a name arbitrarily.
+void add_names(Tree_t& summary, const vector<const Tree_t::node_type*>& compatible_taxa)
+{
+    auto summaryOttIdToNode = get_ottid_to_node_map(summary);
+
+    // 1. Set the des_ids for the summary
+    clear_and_fill_des_ids(summary);
+
+    // 2. Place each taxon N at the MRCA of its include group.
+    map<Tree_t::node_type*, vector<const Tree_t::node_type*>> name_groups;
+    for(auto n2: compatible_taxa)
+    {
+        auto mrca = find_mrca_of_desids(n2->get_data().des_ids, summaryOttIdToNode);
+
+        if (not name_groups.count(mrca)) {
+            name_groups[mrca] = {};
+        }
+        name_groups[mrca].push_back(n2);
+
+	// Any extra desids are here because an incertae sedis taxon was placed inside this node,
+	// or inside a child.
+    }
+
+    // 3. Handle each summary 
+    for(auto& name_group: name_groups)
+    {
+        auto summary_node = name_group.first;
+        auto& names = name_group.second;
+
+        // 3.1. As long as there is a unique root-most name, put that name in a monotypic parent.
+        // This can occur when a node has two children, and one of them is an incertae sedis taxon that is moved more tip-ward.
+        while (auto max = find_unique_maximum(names))
+	{
+            if (names.size() == 1) {
+                summary_node->set_name(max->get_name());
+		if (max->has_ott_id())
+		    summary_node->set_ott_id(max->get_ott_id());
+            } else {
+                auto p = add_monotypic_parent(summary, summary_node);
+                p->set_name(max->get_name());
+		if (max->has_ott_id())
+		    p->set_ott_id(max->get_ott_id());
+                p->get_data().des_ids = p->get_first_child()->get_data().des_ids;
+            }
+
+	    // Move the "removed" elements to the end and the erase them.  Weird.
+            names.erase(std::remove(names.begin(), names.end(), max), names.end());
+        }
+
+        // 3.2. Select a canonical name from the remaining names.
+        if (not names.empty())
+	{
+            // Select a specific ottid as the canonical name for this summary node
+            auto canonical = select_canonical_ottid(names);
+            summary_node->set_name(canonical->get_name());
+
+            // Write out the equivalence of the remaining ottids to the canonical ottid
+            names.erase(std::remove(names.begin(), names.end(), canonical), names.end());
+            register_ottid_equivalences(canonical, names);
+        }
+    }
+}
+
+template <typename S>
+set<int> remap_ids(const S& s1, const map<OttId,int>& id_map) {
+    set<int> s2;
+    for(auto x: s1) {
+        auto it = id_map.find(x);
+        assert(it != id_map.end());
+        s2.insert(it->second);
+    }
+    return s2;
+}
+
+template <typename Tree_t>
+vector<typename Tree_t::node_type const*> get_siblings(typename Tree_t::node_type const* nd) {
+    vector<typename Tree_t::node_type const*> sibs;
+    for(auto sib = nd->get_first_sib(); sib; sib = sib->get_next_sib()) {
+        if (sib != nd) {
+            sibs.push_back(sib);
+        }
+    }
+    return sibs;
+}
+
+template<typename Tree_T>
+map<typename Tree_t::node_type const*, set<OttId>> construct_include_sets(const Tree_t& tree, const set<OttId>& incertae_sedis)
+{
+    map<typename Tree_t::node_type const*, set<OttId>> include;
+
+    for(auto nd: iter_post_const(tree))
+    {
+	// 1. Initialize set for this node.
+	auto& inc = include[nd];
+
+	// 2. Add OttId for tip nodes
+	if (nd->is_tip())
+	{
+	    inc.insert(nd->get_ott_id());
+	}
+	else if (nd == tree.get_root())
+	    continue;
+
+	// 3. Add Ids of children only if they are NOT incertae sedis
+	for(auto nd2: iter_child_const(*nd))
+	{
+            if (not incertae_sedis.count(nd2->get_ott_id()))
+	    {
+                auto& inc_child = nd2->get_data().des_ids;
+                inc.insert(begin(inc_child),end(inc_child));
+            }
+        }
+    }
+    return include;
+}
+
+template<typename Tree_T>
+map<typename Tree_t::node_type const*, set<OttId>> construct_exclude_sets(const Tree_t& tree, const set<OttId>& incertae_sedis)
+{
+    map<typename Tree_t::node_type const*, set<OttId>> exclude;
+
+    // 1. Set exclude set for root node to the empty set.
+    exclude[tree.get_root()];
+
+    for(auto nd: iter_pre_const(tree))
+    {
+	// 2. Skip tips and the root node.
+        if (nd->is_tip() || nd == tree.get_root())
+	{
+            continue;
+        }
+	
+	// 3. Start with the exclude set for the parent.  This should already exist.
+        set<OttId> ex = exclude.at(nd->get_parent());
+
+        // 4. The exclude set should ALSO include ALL (not just some) descendants of siblings.
+        for(auto nd2: get_siblings<Tree_t>(nd))
+	{
+            if (not incertae_sedis.count(nd2->get_ott_id()))
+	    {
+		// 5. In this variant, we DO exclude descendants that are accessed through a node marked I.S.
+                auto& ex_sib = nd2->get_data().des_ids;
+                ex.insert(begin(ex_sib),end(ex_sib));
+            }
+        }
+        exclude[nd] = ex;
+    }
+    return exclude;
+}
+
+template<typename Tree_T>
+map<typename Tree_t::node_type const*, set<OttId>> construct_exclude_sets2(const Tree_t& tree, const set<OttId>& incertae_sedis)
+{
+    auto include = construct_include_sets<Tree_t>(tree, incertae_sedis);
+
+    map<typename Tree_t::node_type const*, set<OttId>> exclude;
+
+    // 1. Set exclude set for root node to the empty set.
+    exclude[tree.get_root()];       
+
+    for(auto nd: iter_pre_const(tree))
+    {
+	// 2. Skip tips and the root node.
+        if (nd->is_tip() || nd == tree.get_root())
+	{
+            continue;
+        }
+
+	// 3. Start with the exclude set for the parent.  This should already exist.
+        set<OttId> ex = exclude.at(nd->get_parent());
+
+        // 4. The exclude set should also include SOME (not all) descendants of siblings.
+        for(auto nd2: get_siblings<Tree_t>(nd))
+	{
+            if (not incertae_sedis.count(nd2->get_ott_id()))
+	    {
+		// 5. In this variant, we do NOT exclude any descendants that are accessed through a node marked I.S.
+                auto& ex_sib = include[nd2];
+                ex.insert(begin(ex_sib),end(ex_sib));
+            }
+        }
+        exclude[nd] = ex;
+    }
+    return exclude;
+}
+
+/// Get the list of splits, and add them one at a time if they are consistent with previous splits
+unique_ptr<Tree_t> combine(const vector<unique_ptr<Tree_t>>& trees, const set<OttId>& incertae_sedis, bool incremental, bool verbose) {
+    // 0. Standardize names to 0..n-1 for this subproblem
+    const auto& taxonomy = trees.back();
+    auto all_leaves = taxonomy->get_root()->get_data().des_ids;
+    // index -> id
+    vector<OttId> ids;
+    // id -> index
+    map<OttId,int> id_map;
+    for(OttId id: all_leaves) {
+        int i = ids.size();
+        id_map[id] = i;
+        ids.push_back(id);
+        assert(id_map[ids[i]] == i);
+        assert(ids[id_map[id]] == id);
+    }
+    auto remap = [&id_map](const auto& argIds) {return remap_ids(argIds, id_map);};
+    vector<int> all_leaves_indices;
+    for(int i=0;i<all_leaves.size();i++) {
+        all_leaves_indices.push_back(i);
+    }
+    indices.resize(all_leaves.size());
+    for(auto& i: indices) {
+        i=-1;
+    }
+    /// Incrementally add splits from @splits_to_try to @consistent if they are consistent with it.
+    // A deque, so that the BUILD state can keep pointers to the splits while we append to it.
+    std::deque<RSplit> consistent;
+    auto build_state = BuildNode::create(vector<int>(all_leaves_indices), {});
+    assert(build_state);
+    auto add_split_if_consistent = [&all_leaves_indices,verbose,incremental,&consistent,&build_state](auto nd, RSplit&& split) {
+            consistent.push_back(std::move(split));
+
+            bool ok;
+            if (incremental) {
+                ok = build_state->add_split(&consistent.back());
+            } else {
+                vector<const RSplit*> split_ptrs;
+                for(const auto& s: consistent) {
+                    split_ptrs.push_back(&s);
+                }
+                ok = (bool)BUILD(all_leaves_indices, split_ptrs);
+            }
+            if (not ok) {
+                consistent.pop_back();
+                if (verbose and nd->has_ott_id()) {
+                    LOG(INFO) << "Reject: ott" << nd->get_ott_id() << "\n";
+                }
+                return false;
+            } else if (verbose and nd->has_ott_id()) {
+                LOG(INFO) << "Keep: ott" << nd->get_ott_id() << "\n";
+            }
+            return true;
+        };
+    // 1. Find splits in order of input trees
+    vector<Tree_t::node_type const*> compatible_taxa;
+    for(int i=0;i<trees.size();i++) {
+        const auto& tree = trees[i];
+        auto root = tree->get_root();
+        const auto& leafTaxa = root->get_data().des_ids;
+        const auto leafTaxaIndices = remap(leafTaxa);
+#ifndef NDEBUG
+#pragma clang diagnostic ignored  "-Wunreachable-code-loop-increment"
+        for(const auto& leaf: set_difference_as_set(leafTaxa, all_leaves)) {
+            throw OTCError() << "OTT Id " << leaf << " not in taxonomy!";
+        }
+#endif
+        // Handle the taxonomy tree specially when it has Incertae sedis taxa.
+        if (i == trees.size()-1 and not incertae_sedis.empty()) {
+            auto exclude = construct_exclude_sets<Tree_t>(*tree, incertae_sedis);
+
+            for(auto nd: iter_post_const(*tree)) {
+                if (not nd->is_tip() and nd != root) {
+                    // construct split
+                    const auto descendants = remap(nd->get_data().des_ids);
+                    const auto nondescendants = remap(exclude[nd]);
+                    if (add_split_if_consistent(nd, split_from_include_exclude(descendants, nondescendants))) {
+                        compatible_taxa.push_back(nd);
+                    }
+                }
+            }
+        } else if (i == trees.size()-1) {
+            for(auto nd: iter_post_const(*tree)) {
+                if (not nd->is_tip() and nd != root) {
+                    const auto descendants = remap(nd->get_data().des_ids);
+                    if (add_split_if_consistent(nd, RSplit{descendants, leafTaxaIndices})) {
+                        compatible_taxa.push_back(nd);
+                    }
+                }
+            }
+        } else {
+            for(auto nd: iter_post_const(*tree)) {
+                if (not nd->is_tip() and nd != root) {
+                    const auto descendants = remap(nd->get_data().des_ids);
+                    add_split_if_consistent(nd, RSplit{descendants, leafTaxaIndices});
+                }
+            }
+        }
+    }
+    // 2. Construct final tree and add names
+    vector<const RSplit*> consistent_ptrs;
+    for(const auto& split: consistent) {
+        consistent_ptrs.push_back(&split);
+    }
+    auto tree = BUILD(all_leaves_indices, consistent_ptrs);
+    for(auto nd: iter_pre(*tree)) {
+        if (nd->is_tip()) {
+            int index = nd->get_ott_id();
+            nd->set_ott_id(ids[index]);
+        }
+    }
+    add_root_and_tip_names(*tree, *taxonomy);
+    add_names(*tree, compatible_taxa);
+    return tree;
+}
+
+/// Create an unresolved taxonomy out of all the input trees.
+unique_ptr<Tree_t> make_unresolved_tree(const vector<unique_ptr<Tree_t>>& trees, bool use_ids) {
+    std::unique_ptr<Tree_t> retTree(new Tree_t());
+    retTree->create_root();
+    if (use_ids) {
+        map<OttId,string> names;
+        for(const auto& tree: trees) {
+            for(auto nd: iter_pre_const(*tree)) {
+                if (nd->is_tip()) {
+                    OttId id = nd->get_ott_id();
+                    auto it = names.find(id);
+                    if (it == names.end()) {
+                        names[id] = nd->get_name();
+                    }
+                }
+            }
+        }
+        for(const auto& n: names) {
+            auto node = retTree->create_child(retTree->get_root());
+            node->set_ott_id(n.first);
+            node->set_name(n.second);
+        }
+        clear_and_fill_des_ids(*retTree);
+    } else {
+        set<string> names;
+        for(const auto& tree: trees) {
+            for(auto nd: iter_pre_const(*tree)) {
+                if (nd->is_tip()) {
+                    names.insert(nd->get_name());
+                }
+            }
+        }
+        for(const auto& n: names) {
+            auto node = retTree->create_child(retTree->get_root());
+            node->set_name(n);
+        }
+    }
+    return retTree;
+}
+
+string node_name_is(const node_t* nd, const OttIdSet& incertae_sedis)
+{
+    std::ostringstream msg;
+    if (incertae_sedis.count(nd->get_ott_id())) 
+	msg<<"?";
+    msg <<nd->get_name();
+    if (nd->has_ott_id())
+	msg<<" ["<<nd->get_ott_id()<<"]";
+    return msg.str();
+}
+} // namespace
+
+namespace otc {
+
+OttIdSet load_incertae_sedis_ids(const string& filename) {
+    OttIdSet incertae_sedis;
+    std::ifstream file(filename);
+    if (not file) {
+        throw OTCError() << "Cannot open incertae sedis file '" << fs::absolute(filename) << "'";
+    }
+    while (file) {
+        OttId i;
+        file >> i;
+        incertae_sedis.insert(i);
+    }
+    return incertae_sedis;
+}
+
+void prepare_subproblem_trees(vector<unique_ptr<TreeMappedWithSplits>>& trees, const SolveSubproblemOptions& options) {
+    // 1. Make a fake taxonomy if asked
+    if (options.synthesize_taxonomy) {
+        trees.push_back(make_unresolved_tree(trees, options.set_ott_ids));
+        LOG(DEBUG) << "taxonomy = " << newick(*trees.back()) << "\n";
+    }
+    // 2. Add fake Ott Ids to tips and compute des_ids (if asked)
+    if (not options.set_ott_ids) {
+        auto name_to_id = create_ids_from_names(*trees.back());
+        for(auto& tree: trees) {
+            set_ids_from_names_and_refresh(*tree, name_to_id);
+        }
+    }
+}
+
+unique_ptr<TreeMappedWithSplits> solve_subproblem(vector<unique_ptr<TreeMappedWithSplits>>& trees,
+                                                  const OttIdSet& incertae_sedis,
+                                                  const SolveSubproblemOptions& options) {
+    // 1. Check if trees are mapping to non-terminal taxa, and either fix the situation or die.
+    for (int i = 0; i < trees.size() - 1; i++) {
+        if (options.clade_tips) {
+            expand_ott_internals_which_are_leaves(*trees[i], *trees.back());
+        } else {
+            require_tips_to_be_mapped_to_terminal_taxa(*trees[i], *trees.back());
+        }
+    }
+
+    // 2. Perform the synthesis
+    auto& taxonomy = *trees.back();
+    compute_depth(taxonomy);
+    auto tree = combine(trees, incertae_sedis, options.incremental, options.verbose);
+
+    // 3. Set the root name (if asked)
+    // FIXME: This could be avoided if the taxonomy tree in the subproblem always had a name for the root node.
+    if (options.root_name) {
+        tree->get_root()->set_name(*options.root_name);
+    }
+
+    // 4. Find placements
+    auto placements = check_placement(*tree, taxonomy);
+    for(auto& p: placements)
+    {
+        auto placed = p.first;
+        auto parent = p.second;
+        auto mrca = mrca_from_depth(placed, parent);
+
+        vector<const node_t*> placement_path;
+        while(parent != mrca)
+        {
+            assert(depth(parent) > depth(mrca));
+            placement_path.push_back(parent);
+            parent = parent->get_parent();
+        }
+        placement_path.push_back(mrca);
+
+        vector<const node_t*> is_path;
+        while(placed != mrca)
+        {
+            assert(depth(placed) > depth(mrca));
+            is_path.push_back(placed);
+            placed = placed->get_parent();
+        }
+        is_path.push_back(mrca);
+
+        std::ostringstream msg;
+
+        for(int i=0;i<is_path.size();i++)
+        {
+            msg <<node_name_is(is_path[i], incertae_sedis);
+            if (i != is_path.size()-1)
+                msg <<" <- ";
+        }
+
+        msg << " placed under ";
+
+        for(int i=0;i<placement_path.size();i++)
+        {
+            msg <<node_name_is(placement_path[i], incertae_sedis);
+            if (i != placement_path.size()-1)
+                msg <<" <- ";
+        }
+
+        LOG(INFO)<<msg.str();
+    }
+
+    return tree;
+}
+
+} // namespace otc
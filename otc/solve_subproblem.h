@@ -0,0 +1,36 @@
+#ifndef OTCETERA_SOLVE_SUBPROBLEM_H
+#define OTCETERA_SOLVE_SUBPROBLEM_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "otc/otc_base_includes.h"
+#include "otc/tree_data.h"
+
+namespace otc {
+
+struct SolveSubproblemOptions {
+    bool set_ott_ids = true;            // trees carry OTT ids (otherwise ids are minted from names)
+    bool synthesize_taxonomy = false;   // make an unresolved taxonomy out of the input tips
+    bool clade_tips = true;             // tips may be mapped to internal nodes of the taxonomy
+    bool incremental = true;            // keep the BUILD state between splits instead of rerunning BUILD
+    bool verbose = false;
+    std::optional<std::string> root_name;
+};
+
+OttIdSet load_incertae_sedis_ids(const std::string& filename);
+
+/// Add a synthesized taxonomy and/or OTT ids minted from names to the trees of a subproblem, as @options asks.
+void prepare_subproblem_trees(std::vector<std::unique_ptr<TreeMappedWithSplits>>& trees,
+                              const SolveSubproblemOptions& options);
+
+/// Compute the summary tree of one subproblem.
+///  @trees are in order of priority, with the taxonomy last.  They are modified by the solve.
+///  This does not touch any global state, so different subproblems can be solved on different threads.
+std::unique_ptr<TreeMappedWithSplits> solve_subproblem(std::vector<std::unique_ptr<TreeMappedWithSplits>>& trees,
+                                                       const OttIdSet& incertae_sedis,
+                                                       const SolveSubproblemOptions& options);
+
+} // namespace otc
+#endif
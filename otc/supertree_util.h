@@ -19,10 +19,10 @@ void update_ancestral_path_ott_id_set(T * nd,
                                 const OttIdSet & newEls,
                                 std::map<const T *, NodeEmbedding<T, U> > & m);
 
-template<typename T>
-bool can_be_resolved_to_display_inc_exc_group(const T *nd, const OttIdSet & incGroup, const OttIdSet & excGroup);
-template<typename T>
-bool can_be_resolved_to_display_only_inc_exc_group(const T *nd, const OttIdSet & incGroup);
+template<typename T, typename S, typename U>
+bool can_be_resolved_to_display_inc_exc_group(const T *nd, const S & incGroup, const U & excGroup);
+template<typename T, typename S>
+bool can_be_resolved_to_display_only_inc_exc_group(const T *nd, const S & incGroup);
 
 template<typename T, typename U>
 void report_on_conflicting(std::ostream & out,
@@ -52,16 +52,16 @@ inline bool can_be_resolved_to_display(const T *nd, const OttIdSet & incGroup, c
     return can_be_resolved_to_display_inc_exc_group(nd, incGroup, excGroup);
 }
 
-template<typename T>
-void add_des_ids_to_node_and_anc(T * nd, const OttIdSet & oid) {
+template<typename T, typename S>
+void add_des_ids_to_node_and_anc(T * nd, const S & oid) {
     nd->get_data().des_ids.insert(begin(oid), end(oid));
     for (auto anc : iter_anc(*nd)) {
         anc->get_data().des_ids.insert(begin(oid), end(oid));
     }
 }
 
-template<typename T>
-void remove_des_ids_from_node_and_anc(T * nd, const OttIdSet & oid) {
+template<typename T, typename S>
+void remove_des_ids_from_node_and_anc(T * nd, const S & oid) {
     nd->get_data().des_ids = set_difference_as_set(nd->get_data().des_ids, oid);
     for (auto anc : iter_anc(*nd)) {
         anc->get_data().des_ids = set_difference_as_set(anc->get_data().des_ids, oid);
@@ -95,7 +95,7 @@ inline std::unique_ptr<TreeMappedWithSplits> clone_tree(const TreeMappedWithSpli
         newRoot->set_ott_id(r->get_ott_id());
         std::map<const NodeWithSplits *, NodeWithSplits *> templateToNew;
         templateToNew[r]= newRoot;
-        std::map<OttId, NodeWithSplits *> & newMap = rawTreePtr->get_data().ott_id_to_node;
+        auto & newMap = rawTreePtr->get_data().ott_id_to_node;
         rawTreePtr->get_data().des_id_sets_contain_internals = tree.get_data().des_id_sets_contain_internals;
         for (auto nd : iter_pre_const(tree)) {
             auto p = nd->get_parent();
@@ -110,7 +110,7 @@ inline std::unique_ptr<TreeMappedWithSplits> clone_tree(const TreeMappedWithSpli
             templateToNew[nd] = nn;
             if (nd->has_ott_id()) {
                 nn->set_ott_id(nd->get_ott_id());
-                newMap[nd->get_ott_id()] = nn;
+                newMap.set(nd->get_ott_id(), nn);
             } else {
                 assert(false);
                 throw OTCError("asserts false but not enabled");
@@ -168,8 +168,8 @@ void sort_children_by_lowest_des_ott_id(T *deepest) {
 
 // returns true if all of the children of nd which intersect with incGroup do NOT intersect w/ excGroup.
 // NOTE: `nd` is assumed to be a common anc of all IDs in incGroup!
-template<typename T>
-inline bool can_be_resolved_to_display_inc_exc_group(const T *nd, const OttIdSet & incGroup, const OttIdSet & excGroup) {
+template<typename T, typename S, typename U>
+inline bool can_be_resolved_to_display_inc_exc_group(const T *nd, const S & incGroup, const U & excGroup) {
     for (auto c : iter_child_const(*nd)) {
         if (have_intersection(incGroup, c->get_data().des_ids) && have_intersection(excGroup, c->get_data().des_ids)) {
             return false;
@@ -180,8 +180,8 @@ inline bool can_be_resolved_to_display_inc_exc_group(const T *nd, const OttIdSet
 
 // returns true if all of the children of nd which intersect with incGroup do NOT intersect w/ excGroup.
 // NOTE: `nd` is assumed to be a common anc of all IDs in incGroup!
-template<typename T>
-inline bool can_be_resolved_to_display_only_inc_exc_group(const T *nd, const OttIdSet & incGroup) {
+template<typename T, typename S>
+inline bool can_be_resolved_to_display_only_inc_exc_group(const T *nd, const S & incGroup) {
     for (auto c : iter_child_const(*nd)) {
         const auto & cdi = c->get_data().des_ids;
         if (have_intersection(incGroup, cdi) && (!is_subset(cdi, incGroup))) {
@@ -261,7 +261,7 @@ inline void set_ids_from_names_and_refresh(T& tree, const std::map<std::string,O
             }
             const auto id = it->second;
             nd->set_ott_id(id);
-            tree.get_data().ott_id_to_node[id] = nd;
+            tree.get_data().ott_id_to_node.set(id, nd);
         } else if (nd->is_tip()){
             throw OTCError() << "Tree tip has no label!";
         }
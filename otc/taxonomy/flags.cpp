@@ -6,6 +6,7 @@
 #include <exception>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -101,7 +102,8 @@ tax_flags flags_from_string(const char* start, const char* end) {
     bitset<32> flags;
     while (start < end) {
         assert(start <= end);
-        const char* sep = std::strchr(start, ',');
+        // Don't look past end: the flags may be followed by other text, not a NUL.
+        const char* sep = static_cast<const char*>(std::memchr(start, ',', end - start));
         if (not sep) {
             sep = end;
         }
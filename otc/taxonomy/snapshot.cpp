@@ -0,0 +1,483 @@
+// Binary snapshots of a RichTaxonomy.
+//
+// A snapshot is a header followed by a payload of sections.  Each section is an array of fixed-size
+//  records (or the bytes of the string pool), starting at an 8-byte aligned offset into the payload.
+//  Records refer to nodes by their preorder index, and to strings by an (offset, size) pair into
+//  the string pool, so the file holds no pointers and can be used directly from a read-only mapping.
+//  Loading maps the file, checks the checksum, and then only has to rebuild the tree links and the
+//  hash tables: the names in the maps are views into the mapping, and nothing is parsed.
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+#include "otc/error.h"
+#include "otc/tree.h"
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/taxonomy/flags.h"
+#include "otc/otc_base_includes.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace otc {
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'O', 'T', 'C', 'T', 'A', 'X', 'S', 'N'};
+// Increment this when the layout of any of the structs below changes.
+constexpr std::uint32_t snapshot_format_version = 1;
+constexpr std::uint32_t snapshot_byte_order_mark = 0x01020304;
+constexpr std::uint32_t no_node = UINT32_MAX;
+
+enum SnapshotSection {
+    SECTION_STRINGS,
+    SECTION_NODES,
+    SECTION_NAMES,
+    SECTION_HOMONYMS,
+    SECTION_NONUNIQUE_NAMES,
+    SECTION_NONUNIQUE_IDS,
+    SECTION_FOREIGN_IDS,
+    SECTION_SYNONYMS,
+    SECTION_FORWARDS,
+    SECTION_FILTERED_RECORDS,
+    NUM_SECTIONS
+};
+
+struct StrRef {
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t format_version;
+    std::uint32_t byte_order_mark;
+    std::uint64_t payload_size;
+    std::uint64_t checksum;
+    // What the snapshot was made from.
+    std::uint64_t taxonomy_file_size;
+    std::int64_t taxonomy_file_time;
+    std::int64_t keep_root;
+    std::uint64_t cleaning_flags;
+    StrRef version;
+    std::uint64_t section_offset[NUM_SECTIONS];
+    std::uint64_t section_count[NUM_SECTIONS];
+};
+
+// The nodes of the taxonomy tree, in preorder.
+struct SnapshotNode {
+    std::int64_t ott_id;
+    std::uint32_t parent;
+    std::uint32_t trav_exit;
+    std::uint32_t depth;
+    std::uint32_t flags;
+    std::uint32_t rank;
+    std::uint32_t padding;
+    StrRef name;
+    StrRef nonunique_name;
+    StrRef source_info;
+};
+
+// An entry of name_to_node, in map order.  node is no_node for homonyms, whose nodes are the
+//  num_homonyms entries of the homonyms section starting at first_homonym.
+struct SnapshotName {
+    StrRef name;
+    std::uint32_t node;
+    std::uint32_t first_homonym;
+    std::uint32_t num_homonyms;
+    std::uint32_t padding;
+};
+
+// An entry of non_unique_taxon_names, in map order, with its ids in the nonunique ids section.
+struct SnapshotNonuniqueName {
+    StrRef name;
+    std::uint64_t first_id;
+    std::uint64_t num_ids;
+};
+
+enum ForeignIdMap {
+    FOREIGN_NCBI,
+    FOREIGN_GBIF,
+    FOREIGN_WORMS,
+    FOREIGN_IF,
+    FOREIGN_IRMNG,
+    NUM_FOREIGN_MAPS
+};
+
+struct SnapshotForeignId {
+    std::int64_t foreign_id;
+    std::uint32_t node;
+    std::uint32_t map;
+};
+
+struct SnapshotSynonym {
+    StrRef name;
+    StrRef source_string;
+    std::uint64_t primary;
+};
+
+struct SnapshotForward {
+    std::int64_t old_id;
+    std::int64_t new_id;
+};
+
+// FNV-1a over 64-bit words.  Each step is a bijection of the running hash, so any change to a
+//  single word changes the checksum.
+std::uint64_t snapshot_checksum(const char* data, std::size_t size) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    const std::uint64_t prime = 0x100000001b3ULL;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    return h ^ (h >> 32);
+}
+
+std::int64_t taxonomy_file_time(const string& dir) {
+    return static_cast<std::int64_t>(fs::last_write_time(dir + "/taxonomy.tsv"));
+}
+
+std::uint64_t taxonomy_file_size(const string& dir) {
+    return fs::file_size(dir + "/taxonomy.tsv");
+}
+
+// The foreign id maps of tree_data, in ForeignIdMap order.
+template <typename T>
+auto foreign_id_maps(T & tree_data) {
+    return std::array{&tree_data.ncbi_id_map, &tree_data.gbif_id_map, &tree_data.worms_id_map,
+                      &tree_data.if_id_map, &tree_data.irmng_id_map};
+}
+
+class SnapshotWriter {
+    std::string strings;
+    // Many views share the same text (e.g. a node's name and its entry in name_to_node).
+    std::unordered_map<const char*, StrRef> string_offsets;
+    std::array<std::string, NUM_SECTIONS> sections;
+    std::array<std::uint64_t, NUM_SECTIONS> counts = {};
+
+    public:
+    StrRef add_string(string_view s) {
+        auto it = string_offsets.find(s.data());
+        if (it != string_offsets.end() and it->second.size == s.size()) {
+            return it->second;
+        }
+        StrRef r{strings.size(), s.size()};
+        strings.append(s.data(), s.size());
+        string_offsets[s.data()] = r;
+        return r;
+    }
+
+    template <typename T>
+    void add(SnapshotSection section, const T & record) {
+        static_assert(std::is_trivially_copyable<T>::value);
+        sections[section].append(reinterpret_cast<const char*>(&record), sizeof(T));
+        counts[section]++;
+    }
+
+    void write(const string& filename, SnapshotHeader & header) {
+        sections[SECTION_STRINGS] = std::move(strings);
+        counts[SECTION_STRINGS] = sections[SECTION_STRINGS].size();
+        string payload;
+        for (int i = 0; i < NUM_SECTIONS; i++) {
+            header.section_offset[i] = payload.size();
+            header.section_count[i] = counts[i];
+            payload += sections[i];
+            payload.resize((payload.size() + 7) & ~std::size_t(7), '\0');
+            string().swap(sections[i]);
+        }
+        header.payload_size = payload.size();
+        header.checksum = snapshot_checksum(payload.data(), payload.size());
+        // Write to a temporary file, and rename it, so that a reader never sees a partial snapshot.
+        const string tmp_filename = filename + ".tmp";
+        {
+            std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(payload.data(), payload.size());
+            if (not out) {
+                throw OTCError() << "Could not write taxonomy snapshot '" << tmp_filename << "'.";
+            }
+        }
+        fs::rename(tmp_filename, filename);
+    }
+};
+
+class SnapshotReader {
+    const char* payload;
+    const SnapshotHeader & header;
+    public:
+    SnapshotReader(const char* p, const SnapshotHeader & h)
+        :payload(p),
+        header(h) {
+    }
+
+    template <typename T>
+    const T* begin(SnapshotSection section) const {
+        return reinterpret_cast<const T*>(payload + header.section_offset[section]);
+    }
+
+    template <typename T>
+    const T* end(SnapshotSection section) const {
+        return begin<T>(section) + header.section_count[section];
+    }
+
+    string_view str(const StrRef & r) const {
+        if (r.offset + r.size > header.section_count[SECTION_STRINGS]) {
+            throw OTCError() << "Taxonomy snapshot string is out of range.";
+        }
+        return string_view(payload + header.section_offset[SECTION_STRINGS] + r.offset, r.size);
+    }
+};
+
+const SnapshotHeader & check_snapshot_header(const boost::iostreams::mapped_file_source & file,
+                                             const string& filename) {
+    if (file.size() < sizeof(SnapshotHeader)) {
+        throw OTCError() << "'" << filename << "' is too short to be a taxonomy snapshot.";
+    }
+    const auto & header = *reinterpret_cast<const SnapshotHeader*>(file.data());
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+        throw OTCError() << "'" << filename << "' is not a taxonomy snapshot.";
+    }
+    if (header.format_version != snapshot_format_version or header.byte_order_mark != snapshot_byte_order_mark) {
+        throw OTCError() << "Taxonomy snapshot '" << filename << "' has format version " << header.format_version
+                         << ", but this build reads version " << snapshot_format_version << " on this architecture.";
+    }
+    if (header.payload_size != file.size() - sizeof(SnapshotHeader)) {
+        throw OTCError() << "Taxonomy snapshot '" << filename << "' is truncated.";
+    }
+    const std::size_t record_size[NUM_SECTIONS] = {1, sizeof(SnapshotNode), sizeof(SnapshotName),
+        sizeof(std::uint32_t), sizeof(SnapshotNonuniqueName), sizeof(std::int64_t), sizeof(SnapshotForeignId),
+        sizeof(SnapshotSynonym), sizeof(SnapshotForward), sizeof(StrRef)};
+    for (int i = 0; i < NUM_SECTIONS; i++) {
+        if (header.section_offset[i] % 8 != 0
+            or header.section_offset[i] > header.payload_size
+            or header.section_count[i] > (header.payload_size - header.section_offset[i]) / record_size[i]) {
+            throw OTCError() << "Taxonomy snapshot '" << filename << "' has a corrupt section table.";
+        }
+    }
+    const char* payload = file.data() + sizeof(SnapshotHeader);
+    if (snapshot_checksum(payload, header.payload_size) != header.checksum) {
+        throw OTCError() << "Taxonomy snapshot '" << filename << "' failed its checksum.";
+    }
+    return header;
+}
+
+} // namespace
+
+void RichTaxonomy::write_snapshot(const std::string& filename) const {
+    static_assert(sizeof(SnapshotHeader) % 8 == 0);
+    SnapshotWriter w;
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.format_version = snapshot_format_version;
+    header.byte_order_mark = snapshot_byte_order_mark;
+    header.taxonomy_file_size = taxonomy_file_size(path);
+    header.taxonomy_file_time = taxonomy_file_time(path);
+    header.keep_root = keep_root;
+    header.cleaning_flags = cleaning_flags.to_ullong();
+    header.version = w.add_string(version);
+    const auto & tree_data = tree->get_data();
+    auto node_index = [](const RTRichTaxNode * nd) {
+        return (nd == nullptr) ? no_node : nd->get_data().trav_enter;
+    };
+    std::uint32_t num_nodes = 0;
+    for (auto nd : iter_pre_const(*tree)) {
+        const auto & d = nd->get_data();
+        if (d.trav_enter != num_nodes++) {
+            throw OTCError() << "Cannot write a taxonomy snapshot: the traversal indices are stale.";
+        }
+        SnapshotNode sn;
+        std::memset(&sn, 0, sizeof(sn));
+        sn.ott_id = nd->get_ott_id();
+        sn.parent = node_index(nd->get_parent());
+        sn.trav_exit = d.trav_exit;
+        sn.depth = d.depth;
+        sn.flags = static_cast<std::uint32_t>(d.flags.to_ulong());
+        sn.rank = d.rank;
+        sn.name = w.add_string(nd->get_name());
+        sn.nonunique_name = w.add_string(d.possibly_nonunique_name);
+        sn.source_info = w.add_string(d.source_info);
+        w.add(SECTION_NODES, sn);
+    }
+    std::uint32_t num_homonyms = 0;
+    for (const auto & [name, nd] : tree_data.name_to_node) {
+        SnapshotName sn;
+        std::memset(&sn, 0, sizeof(sn));
+        sn.name = w.add_string(name);
+        sn.node = node_index(nd);
+        if (nd == nullptr) {
+            sn.first_homonym = num_homonyms;
+            for (auto h : tree_data.homonym_to_node.at(name)) {
+                w.add(SECTION_HOMONYMS, node_index(h));
+                sn.num_homonyms++;
+            }
+            num_homonyms += sn.num_homonyms;
+        }
+        w.add(SECTION_NAMES, sn);
+    }
+    std::uint64_t num_ids = 0;
+    for (const auto & [name, ids] : tree_data.non_unique_taxon_names) {
+        SnapshotNonuniqueName snn{w.add_string(name), num_ids, ids.size()};
+        for (auto id : ids) {
+            w.add(SECTION_NONUNIQUE_IDS, std::int64_t(id));
+        }
+        num_ids += ids.size();
+        w.add(SECTION_NONUNIQUE_NAMES, snn);
+    }
+#   if defined(MAP_FOREIGN_TO_POINTER)
+        auto maps = foreign_id_maps(tree_data);
+        for (std::uint32_t m = 0; m < NUM_FOREIGN_MAPS; m++) {
+            for (const auto & [foreign_id, nd] : *maps[m]) {
+                w.add(SECTION_FOREIGN_IDS, SnapshotForeignId{foreign_id, node_index(nd), m});
+            }
+        }
+#   else
+        auto maps = foreign_id_maps(tree_data);
+        for (std::uint32_t m = 0; m < NUM_FOREIGN_MAPS; m++) {
+            for (const auto & [foreign_id, ott_id] : *maps[m]) {
+                w.add(SECTION_FOREIGN_IDS, SnapshotForeignId{foreign_id, node_index(tree_data.id_to_node.at(ott_id)), m});
+            }
+        }
+#   endif
+    for (const auto & tjs : synonyms) {
+        w.add(SECTION_SYNONYMS, SnapshotSynonym{w.add_string(tjs.name), w.add_string(tjs.source_string), node_index(tjs.primary)});
+    }
+    for (const auto & [old_id, new_id] : forwards) {
+        w.add(SECTION_FORWARDS, SnapshotForward{old_id, new_id});
+    }
+    for (const auto & tr : filtered_records) {
+        w.add(SECTION_FILTERED_RECORDS, w.add_string(tr.line));
+    }
+    w.write(filename, header);
+    LOG(INFO) << "wrote taxonomy snapshot " << filename;
+}
+
+RichTaxonomy RichTaxonomy::load_snapshot(const std::string& filename,
+                                         const std::string& dir,
+                                         std::bitset<32> cf,
+                                         OttId kr) {
+    return RichTaxonomy(dir, cf, kr, filename);
+}
+
+RichTaxonomy::RichTaxonomy(const std::string& dir, std::bitset<32> cf, OttId kr, const std::string& snapshot_filename)
+    :BaseTaxonomy(dir, cf, kr) {
+    try {
+        snapshot_file = std::make_shared<boost::iostreams::mapped_file_source>(snapshot_filename);
+    } catch (std::exception&) {
+        throw OTCError() << "Could not open file '" << snapshot_filename << "'.";
+    }
+    const auto & header = check_snapshot_header(*snapshot_file, snapshot_filename);
+    const SnapshotReader r(snapshot_file->data() + sizeof(SnapshotHeader), header);
+    if (r.str(header.version) != version
+        or header.keep_root != keep_root
+        or header.cleaning_flags != cleaning_flags.to_ullong()
+        or header.taxonomy_file_size != taxonomy_file_size(dir)
+        or header.taxonomy_file_time != taxonomy_file_time(dir)) {
+        throw OTCError() << "Taxonomy snapshot '" << snapshot_filename << "' was not made from the taxonomy in '"
+                         << dir << "' with these cleaning flags and root.";
+    }
+    // 1. The tree.  Nodes are in preorder, so a parent is always created before its children.
+    tree = std::make_unique<RichTaxTree>();
+    tree->use_node_arena();
+    auto & tree_data = tree->get_data();
+    const auto num_nodes = header.section_count[SECTION_NODES];
+    vector<RTRichTaxNode *> nodes;
+    nodes.reserve(num_nodes);
+    auto node_at = [&](std::uint64_t i) -> RTRichTaxNode * {
+        if (i >= nodes.size()) {
+            throw OTCError() << "Taxonomy snapshot '" << snapshot_filename << "' refers to node " << i << " out of order.";
+        }
+        return nodes[i];
+    };
+    for (auto sn = r.begin<SnapshotNode>(SECTION_NODES); sn != r.end<SnapshotNode>(SECTION_NODES); ++sn) {
+        auto nd = nodes.empty() ? tree->create_root() : tree->create_child(node_at(sn->parent));
+        nd->set_ott_id(static_cast<OttId>(sn->ott_id));
+        nd->set_name(string(r.str(sn->name)));
+        auto & d = nd->get_data();
+        d.trav_enter = static_cast<std::uint32_t>(nodes.size());
+        d.trav_exit = sn->trav_exit;
+        d.depth = sn->depth;
+        d.flags = std::bitset<32>(sn->flags);
+        d.rank = static_cast<TaxonomicRank>(sn->rank);
+        d.possibly_nonunique_name = r.str(sn->nonunique_name);
+        d.source_info = string(r.str(sn->source_info));
+        tree_data.id_to_node.insert({nd->get_ott_id(), nd});
+        if (tree_data.flags2json.count(d.flags) == 0) {
+            auto & fj = tree_data.flags2json[d.flags];
+            for (const auto & fs : flags_to_string_vec(d.flags)) {
+                fj.push_back(fs);
+            }
+        }
+        nodes.push_back(nd);
+    }
+    // 2. The name maps.  They were written in map order, so each insertion goes at the end.
+    const auto homonyms = r.begin<std::uint32_t>(SECTION_HOMONYMS);
+    for (auto sn = r.begin<SnapshotName>(SECTION_NAMES); sn != r.end<SnapshotName>(SECTION_NAMES); ++sn) {
+        const auto name = r.str(sn->name);
+        if (sn->node != no_node) {
+            tree_data.name_to_node.emplace_hint(tree_data.name_to_node.end(), name, node_at(sn->node));
+            continue;
+        }
+        tree_data.name_to_node.emplace_hint(tree_data.name_to_node.end(), name, nullptr);
+        if (sn->first_homonym + std::uint64_t(sn->num_homonyms) > header.section_count[SECTION_HOMONYMS]) {
+            throw OTCError() << "Taxonomy snapshot '" << snapshot_filename << "' has a corrupt homonym list.";
+        }
+        auto & hv = tree_data.homonym_to_node.emplace_hint(tree_data.homonym_to_node.end(), name, vector<const RTRichTaxNode *>())->second;
+        for (auto i = sn->first_homonym; i < sn->first_homonym + sn->num_homonyms; ++i) {
+            if (homonyms[i] != no_node) {
+                hv.push_back(node_at(homonyms[i]));
+            }
+        }
+    }
+    const auto nonunique_ids = r.begin<std::int64_t>(SECTION_NONUNIQUE_IDS);
+    for (auto snn = r.begin<SnapshotNonuniqueName>(SECTION_NONUNIQUE_NAMES); snn != r.end<SnapshotNonuniqueName>(SECTION_NONUNIQUE_NAMES); ++snn) {
+        if (snn->first_id + snn->num_ids > header.section_count[SECTION_NONUNIQUE_IDS]) {
+            throw OTCError() << "Taxonomy snapshot '" << snapshot_filename << "' has a corrupt list of non-unique names.";
+        }
+        auto & ids = tree_data.non_unique_taxon_names.emplace_hint(tree_data.non_unique_taxon_names.end(), string(r.str(snn->name)), OttIdSet())->second;
+        for (auto i = snn->first_id; i < snn->first_id + snn->num_ids; ++i) {
+            ids.emplace_hint(ids.end(), static_cast<OttId>(nonunique_ids[i]));
+        }
+    }
+    // 3. The foreign id maps.
+    for (auto sf = r.begin<SnapshotForeignId>(SECTION_FOREIGN_IDS); sf != r.end<SnapshotForeignId>(SECTION_FOREIGN_IDS); ++sf) {
+        if (sf->map >= NUM_FOREIGN_MAPS) {
+            throw OTCError() << "Taxonomy snapshot '" << snapshot_filename << "' has an unknown foreign id map.";
+        }
+#       if defined(MAP_FOREIGN_TO_POINTER)
+            (*foreign_id_maps(tree_data)[sf->map])[static_cast<OttId>(sf->foreign_id)] = node_at(sf->node);
+#       else
+            (*foreign_id_maps(tree_data)[sf->map])[static_cast<OttId>(sf->foreign_id)] = node_at(sf->node)->get_ott_id();
+#       endif
+    }
+    // 4. Synonyms.  Their names are already in name_to_node.
+    for (auto ss = r.begin<SnapshotSynonym>(SECTION_SYNONYMS); ss != r.end<SnapshotSynonym>(SECTION_SYNONYMS); ++ss) {
+        auto primary = node_at(ss->primary);
+        synonyms.emplace_back(string(r.str(ss->name)), primary, string(r.str(ss->source_string)));
+        primary->get_data().junior_synonyms.push_back(&synonyms.back());
+    }
+    // 5. Forwards, and the records that were filtered from the tree.
+    forwards.reserve(header.section_count[SECTION_FORWARDS]);
+    for (auto sf = r.begin<SnapshotForward>(SECTION_FORWARDS); sf != r.end<SnapshotForward>(SECTION_FORWARDS); ++sf) {
+        forwards.emplace(static_cast<OttId>(sf->old_id), static_cast<OttId>(sf->new_id));
+    }
+    filtered_records.reserve(header.section_count[SECTION_FILTERED_RECORDS]);
+    for (auto sr = r.begin<StrRef>(SECTION_FILTERED_RECORDS); sr != r.end<StrRef>(SECTION_FILTERED_RECORDS); ++sr) {
+        filtered_records.push_back(TaxonomyRecord(r.str(*sr)));
+    }
+    index_filtered_records();
+    _fill_ids_to_suppress_set();
+    LOG(INFO) << "loaded taxonomy snapshot " << snapshot_filename << " with " << num_nodes << " taxa";
+}
+
+} // namespace otc
@@ -1,4 +1,3 @@
-// TODO: mmap via BOOST https://techoverflow.net/blog/2013/03/31/mmap-with-boost-iostreams-a-minimalist-example/
 // TODO: write out a reduced taxonomy
 
 #include <iostream>
@@ -12,6 +11,12 @@
 #include <bitset>
 #include <fstream>
 #include <regex>
+#include <algorithm>
+#include <charconv>
+#include <deque>
+#include <numeric>
+#include <cstring>
+#include <thread>
 #include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string/join.hpp>
 namespace fs = boost::filesystem;
@@ -23,6 +28,7 @@ namespace fs = boost::filesystem;
 #include "otc/taxonomy/flags.h"
 #include "otc/config_file.h"
 #include "otc/util.h"
+#include "otc/run_jobs.h"
 #include "otc/otc_base_includes.h"
 
 using namespace otc;
@@ -158,7 +164,6 @@ const map<TaxonomicRank, string> rank_enum_to_name =
     };
 const std::string empty_string;
 const set<string> indexed_source_prefixes = {"ncbi", "gbif", "worms", "if", "irmng"};
-std::set<std::string> rank_strings;
 
 template<typename T>
 void register_taxon_in_maps(std::map<string_view, const T *> & n2n,
@@ -183,29 +188,37 @@ void register_taxon_in_maps(std::map<string_view, const T *> & n2n,
     }
 }
 
-TaxonomyRecord::TaxonomyRecord(const string& line_)
+TaxonomyRecord::TaxonomyRecord(string_view line_)
     :line(line_) {
-    // parse the line
-    // also see boost::make_split_iterator
-    const char* start[8];
-    const char* end[8];
-    start[0] = line.c_str();
+    // parse the line: 7 fields, each terminated by "\t|\t"
+    string_view field[7];
+    std::size_t start = 0;
     for(int i=0; i<7; i++) {
-        end[i] = std::strstr(start[i],"\t|\t");
-        start[i+1] = end[i] + 3;
-    }
-    char *temp;
-    id = std::strtoul(start[0], &temp, 10);
-    parent_id = std::strtoul(start[1], &temp, 10);
-    name = string_view(start[2], end[2] - start[2]);
-    rank = string_view(start[3], end[3] - start[3]);
-    sourceinfo = string_view(start[4], end[4] - start[4]);
-    uniqname = string_view(start[5], end[5] - start[5]);
-    flags = flags_from_string(start[6], end[6]);
+        auto end = line.find("\t|\t", start);
+        if (end == string_view::npos) {
+            throw OTCError() << "Taxonomy line has fewer than 7 fields: '" << line << "'";
+        }
+        field[i] = line.substr(start, end - start);
+        start = end + 3;
+    }
+    auto read_id = [&](string_view f, OttId & i) {
+        auto r = std::from_chars(f.data(), f.data() + f.size(), i);
+        if (r.ec != std::errc() or r.ptr != f.data() + f.size()) {
+            throw OTCError() << "Could not read ID '" << f << "' in taxonomy line: '" << line << "'";
+        }
+    };
+    read_id(field[0], id);
+    if (not field[1].empty()) { // the root has no parent
+        read_id(field[1], parent_id);
+    }
+    name = field[2];
+    rank = field[3];
+    sourceinfo = field[4];
+    uniqname = field[5];
+    flags = flags_from_string(field[6].data(), field[6].data() + field[6].size());
     if (not uniqname.size()) {
         uniqname = name;
     }
-    rank_strings.insert(string(rank));
 }
 
 optional<int> Taxonomy::maybe_index_from_id(OttId id) const
@@ -339,72 +352,117 @@ BaseTaxonomy::BaseTaxonomy(const string& dir,
     }
 }
 
+// Parse the records in [start, end), which holds whole lines, splitting the text into one chunk per thread.
+//  Returns the records of each chunk, in file order.
+vector<vector<TaxonomyRecord>> Taxonomy::read_records_in_parallel(const char* start,
+                                                                  const char* end,
+                                                                  const string& filename) const {
+    const std::size_t min_chunk_size = 1 << 22;
+    const std::size_t n_bytes = end - start;
+    std::size_t n_chunks = std::min<std::size_t>(std::max(1U, std::thread::hardware_concurrency()),
+                                                 1 + n_bytes / min_chunk_size);
+    // Move each chunk boundary forward to the start of a line.
+    vector<const char*> bounds = {start};
+    for(std::size_t i = 1; i < n_chunks; i++) {
+        const char* b = std::max(start + (n_bytes * i) / n_chunks, bounds.back());
+        auto nl = static_cast<const char*>(std::memchr(b, '\n', end - b));
+        bounds.push_back(nl ? nl + 1 : end);
+    }
+    bounds.push_back(end);
+    vector<vector<TaxonomyRecord>> chunks(n_chunks);
+    auto parse_chunk = [&](std::size_t i) {
+        for(const char* line_start = bounds[i]; line_start < bounds[i+1];) {
+            auto nl = static_cast<const char*>(std::memchr(line_start, '\n', bounds[i+1] - line_start));
+            const char* line_end = nl ? nl : bounds[i+1];
+            if (line_end != line_start) {
+                chunks[i].emplace_back(string_view(line_start, line_end - line_start));
+            }
+            line_start = line_end + 1;
+        }
+    };
+    try {
+        run_jobs_on_threads(n_chunks, static_cast<unsigned>(n_chunks - 1), parse_chunk);
+    } catch (std::exception& x) {
+        throw OTCError() << "Error reading '" << filename << "': " << x.what();
+    }
+    LOG(TRACE) << "parsed " << filename << " in " << n_chunks << " chunks";
+    return chunks;
+}
+
 Taxonomy::Taxonomy(const string& dir,
                    bitset<32> cf,
                    OttId kr)
     :BaseTaxonomy(dir, cf, kr) {
     string filename = path + "/taxonomy.tsv";
-    // 1. Open the file.
-    ifstream taxonomy_stream(filename);
-    if (not taxonomy_stream) {
+    // 1. Map the file into memory.  Records refer to the mapped text, so we never copy a line.
+    try {
+        taxonomy_file = std::make_shared<boost::iostreams::mapped_file_source>(filename);
+    } catch (std::exception&) {
         throw OTCError() << "Could not open file '" << filename << "'.";
     }
+    const char* file_start = taxonomy_file->data();
+    const char* file_end = file_start + taxonomy_file->size();
     // 2. Read and check the first line
-    string line;
-    std::getline(taxonomy_stream,line);
-    if (line != "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t") {
+    auto header_end = static_cast<const char*>(std::memchr(file_start, '\n', file_end - file_start));
+    if (not header_end) {
+        header_end = file_end;
+    }
+    if (string_view(file_start, header_end - file_start) != "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t") {
         throw OTCError() << "First line of file '" << filename << "' is not a taxonomy header.";
     }
-    // 3. Read records up to the record containing the root.
-    int count = 0;
-    if (keep_root != -1) {
-        while(std::getline(taxonomy_stream, line)) {
-            count++;
-            // Add line to vector
-            emplace_back(line);
-            if (back().id == keep_root) {
-                break;
-            }
-            pop_back();
-        }
-        if (empty()) {
-            throw OTCError() << "Root id '" << keep_root << "' not found.";
-        }
-    } else {
-        std::getline(taxonomy_stream,line);
-        count++;
-        // Add line to vector
-        emplace_back(line);
-    }
-    back().depth = 1;
-    if ((back().flags & cleaning_flags).any()) {
-        throw OTCError() << "Root taxon (ID = " << back().id << ") removed according to cleaning flags!";
-    }
-    index[back().id] = size() - 1;
-    // 4. Read the remaining records
-    while(std::getline(taxonomy_stream, line)) {
-        count++;
-        // Add line to vector
-        emplace_back(line);
-        // Eliminate records that match the cleaning flags
-        if ((back().flags & cleaning_flags).any()) {
-            pop_back();
-            continue;
+    // 3. Parse the records in batches, filtering each batch before parsing the next, so that we never
+    //    hold more than one batch of unfiltered records.  Lines are independent, so each batch is split
+    //    into chunks that are parsed in parallel.  Records are filtered in file order, since a record
+    //    can only be kept if its parent was kept.
+    const std::size_t batch_size = std::size_t(std::max(1U, std::thread::hardware_concurrency())) << 24;
+    std::size_t count = 0;
+    bool found_root = false;
+    for(const char* batch_start = std::min(header_end + 1, file_end); batch_start < file_end;) {
+        const char* batch_end = file_end;
+        if (std::size_t(file_end - batch_start) > batch_size) {
+            auto nl = static_cast<const char*>(std::memchr(batch_start + batch_size, '\n', file_end - batch_start - batch_size));
+            batch_end = nl ? nl + 1 : file_end;
         }
-        // Eliminate records whose parents have been eliminated, or are not found.
-        auto loc = index.find(back().parent_id);
-        if (loc == index.end()) {
-            pop_back();
-            continue;
+        for(auto& chunk: read_records_in_parallel(batch_start, batch_end, filename)) {
+            count += chunk.size();
+            for(auto& record: chunk) {
+                if (not found_root) {
+                    // Skip records up to the record containing the root.
+                    if (keep_root != -1 and record.id != keep_root) {
+                        continue;
+                    }
+                    found_root = true;
+                    emplace_back(std::move(record));
+                    back().depth = 1;
+                    if ((back().flags & cleaning_flags).any()) {
+                        throw OTCError() << "Root taxon (ID = " << back().id << ") removed according to cleaning flags!";
+                    }
+                    index[back().id] = size() - 1;
+                    continue;
+                }
+                // Eliminate records that match the cleaning flags
+                if ((record.flags & cleaning_flags).any()) {
+                    continue;
+                }
+                // Eliminate records whose parents have been eliminated, or are not found.
+                auto loc = index.find(record.parent_id);
+                if (loc == index.end()) {
+                    continue;
+                }
+                emplace_back(std::move(record));
+                back().parent_index = loc->second;
+                back().depth = (*this)[back().parent_index].depth + 1;
+                (*this)[back().parent_index].out_degree++;
+                index[back().id] = size() - 1;
+            }
         }
-        back().parent_index = loc->second;
-        back().depth = (*this)[back().parent_index].depth + 1;
-        (*this)[back().parent_index].out_degree++;
-        index[back().id] = size() - 1;
+        batch_start = batch_end;
+    }
+    if (keep_root != -1 and not found_root) {
+        throw OTCError() << "Root id '" << keep_root << "' not found.";
     }
     LOG(TRACE) << "records read = " << count;
     LOG(TRACE) << "records kept = " << size();
-    taxonomy_stream.close();
     /*
     if (read_deprecated) {
         read_deprecated_file(path + "/deprecated.tsv");
@@ -418,7 +476,8 @@ RichTaxonomy::RichTaxonomy(const std::string& dir, std::bitset<32> cf, OttId kr)
     { //braced to reduce scope of light_taxonomy to reduced memory
         Taxonomy light_taxonomy(dir, cf, kr); 
         auto nodeNamer = [](const auto&){return string();};
-        tree = light_taxonomy.get_tree<RichTaxTree>(nodeNamer);
+        // The rich taxonomy tree is never pruned, so its nodes can live in slabs.
+        tree = light_taxonomy.get_tree<RichTaxTree>(nodeNamer, true);
         auto & tree_data = tree->get_data();
         std::swap(forwards, light_taxonomy.forwards);
         //std::swap(deprecated, light_taxonomy.deprecated);
@@ -427,23 +486,25 @@ RichTaxonomy::RichTaxonomy(const std::string& dir, std::bitset<32> cf, OttId kr)
         std::swap(path, light_taxonomy.path);
         std::swap(version, light_taxonomy.version);
         std::swap(version_number, light_taxonomy.version_number);
+        // The light taxonomy's file mapping goes away with it, so copy the text of the filtered records.
+        vector<const TaxonomyRecord *> filtered;
+        std::size_t filtered_size = 0;
         for (auto tr_it = light_taxonomy.begin(); tr_it != light_taxonomy.end(); ++tr_it) {
             const auto & tr = *tr_it;
             auto ott_id = tr.id;
             if (tree_data.id_to_node.count(ott_id) == 0) {
-                filtered_records.push_back(TaxonomyRecord(tr.line));
+                filtered.push_back(&tr);
+                filtered_size += tr.line.size();
             }
         }
-        for (auto tr_it = filtered_records.begin(); tr_it != filtered_records.end(); ++tr_it) {
-            const auto & tr = *tr_it;
-            register_taxon_in_maps(tree_data.name_to_record,
-                                   tree_data.homonym_to_record,
-                                   tr.name,
-                                   tr.uniqname,
-                                   &tr);
-            tree_data.id_to_record[tr.id] = &tr;
+        filtered_lines.reserve(filtered_size); // no reallocation, so the records' views stay valid
+        for (auto tr : filtered) {
+            auto line_start = filtered_lines.size();
+            filtered_lines += tr->line;
+            filtered_records.push_back(TaxonomyRecord(string_view(filtered_lines).substr(line_start)));
         }
     }
+    index_filtered_records();
     compute_depth(*tree);
     set_traversal_entry_exit(*tree);
     _fill_ids_to_suppress_set();
@@ -492,8 +553,8 @@ void Taxonomy::read_forwards_file(string filepath) {
             auto fm_it = forwards.find(old_id);
             assert(fm_it != forwards.end());
             auto curr_new_id = fm_it->second;
-            OttId nnid = this->map(fm_it->second);
-            assert(nnid != fm_it->second);
+            OttId nnid = this->map(curr_new_id);
+            assert(nnid != curr_new_id);
             fm_it->second = nnid;
             if (nnid > 0 && nnid != this->map(nnid)) {
                 scratch.insert(old_id);
@@ -578,7 +639,25 @@ RichTaxonomy load_rich_taxonomy(const variables_map& args) {
     if (args.count("clean")) {
         cleaning_flags = flags_from_string(args["clean"].as<string>());
     }
-    return {taxonomy_dir, cleaning_flags, keep_root};
+    if (not args.count("taxonomy-snapshot")) {
+        return {taxonomy_dir, cleaning_flags, keep_root};
+    }
+    // Use the snapshot if it is up to date.  Otherwise, parse the taxonomy and write a new snapshot.
+    const string snapshot_filename = args["taxonomy-snapshot"].as<string>();
+    if (fs::exists(snapshot_filename)) {
+        try {
+            return RichTaxonomy::load_snapshot(snapshot_filename, taxonomy_dir, cleaning_flags, keep_root);
+        } catch (std::exception & x) {
+            LOG(WARNING) << "Not using taxonomy snapshot: " << x.what();
+        }
+    }
+    RichTaxonomy taxonomy(taxonomy_dir, cleaning_flags, keep_root);
+    try {
+        taxonomy.write_snapshot(snapshot_filename);
+    } catch (std::exception & x) {
+        LOG(WARNING) << "Could not write taxonomy snapshot: " << x.what();
+    }
+    return taxonomy;
 }
 
 template<typename T>
@@ -644,7 +723,7 @@ inline void populate_node_from_taxonomy_record(RTRichTaxNode & nd,
     auto & data = nd.get_data();
     auto & tree_data = tree.get_data();
     nd.set_ott_id(tr.id);
-    tree_data.id_to_node[tr.id] = this_node;
+    tree_data.id_to_node.set(tr.id, this_node);
     this_node->set_name(string(tr.uniqname));
     const string & uname = this_node->get_name();
     if (tr.uniqname != tr.name) {
@@ -731,6 +810,18 @@ void RichTaxonomy::read_synonyms() {
     }
 }
 
+void RichTaxonomy::index_filtered_records() {
+    auto & tree_data = tree->get_data();
+    for (const auto & tr : filtered_records) {
+        register_taxon_in_maps(tree_data.name_to_record,
+                               tree_data.homonym_to_record,
+                               tr.name,
+                               tr.uniqname,
+                               &tr);
+        tree_data.id_to_record[tr.id] = &tr;
+    }
+}
+
 void RichTaxonomy::_fill_ids_to_suppress_set()
 {
     for (const auto nd : iter_node_const(*tree))
@@ -738,6 +829,181 @@ void RichTaxonomy::_fill_ids_to_suppress_set()
             ids_to_suppress_from_tnrs.insert(nd->get_ott_id());
 }
 
+string TaxonNameIndex::normalize(string_view name) {
+    string normalized(name);
+    for (auto & c : normalized) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return normalized;
+}
+
+// In postorder, a taxon comes after every taxon whose subtree ends before its own does, and
+//  after its descendants (which share its trav_exit only if they have a larger trav_enter).
+static bool precedes_in_postorder(const TaxonNameIndex::Entry & e1, const TaxonNameIndex::Entry & e2) {
+    const auto & d1 = e1.taxon->get_data();
+    const auto & d2 = e2.taxon->get_data();
+    if (d1.trav_exit != d2.trav_exit) {
+        return d1.trav_exit < d2.trav_exit;
+    }
+    if (d1.trav_enter != d2.trav_enter) {
+        return d1.trav_enter > d2.trav_enter;
+    }
+    return e1.synonym_pos < e2.synonym_pos;
+}
+
+TaxonNameIndex::TaxonNameIndex(const RichTaxTree & tree) {
+    std::size_t num_synonyms = 0;
+    std::size_t text_size = 0;
+    for (auto nd : iter_pre_const(tree)) {
+        const auto & d = nd->get_data();
+        text_size += d.get_nonuniqname().size();
+        for (auto tjs : d.junior_synonyms) {
+            text_size += tjs->get_name().size();
+            num_synonyms++;
+        }
+    }
+    normalized_names.reserve(text_size); // no reallocation, so the entries' views stay valid
+    names.reserve(tree.get_data().id_to_node.size());
+    synonyms.reserve(num_synonyms);
+    auto add_entry = [&](vector<Entry> & entries, string_view name, const RTRichTaxNode * nd,
+                         const TaxonomicJuniorSynonym * tjs, std::uint32_t pos) {
+        const auto start = normalized_names.size();
+        normalized_names += normalize(name);
+        entries.push_back(Entry{string_view(normalized_names).substr(start), nd, tjs, pos});
+    };
+    for (auto nd : iter_pre_const(tree)) {
+        const auto & d = nd->get_data();
+        add_entry(names, d.get_nonuniqname(), nd, nullptr, 0);
+        std::uint32_t pos = 0;
+        for (auto tjs : d.junior_synonyms) {
+            add_entry(synonyms, tjs->get_name(), nd, tjs, pos++);
+        }
+    }
+    auto by_name = [](const Entry & e1, const Entry & e2) {
+        if (e1.name != e2.name) {
+            return e1.name < e2.name;
+        }
+        return precedes_in_postorder(e1, e2);
+    };
+    std::sort(names.begin(), names.end(), by_name);
+    std::sort(synonyms.begin(), synonyms.end(), by_name);
+}
+
+vector<const TaxonNameIndex::Entry *> TaxonNameIndex::find(const vector<Entry> & entries,
+                                                           string_view query,
+                                                           const RTRichTaxNode * context_root,
+                                                           bool prefix) const {
+    vector<const Entry *> hits;
+    if (context_root == nullptr) {
+        return hits;
+    }
+    const auto normalized_query = normalize(query);
+    const string_view q = normalized_query;
+    const auto & context_data = context_root->get_data();
+    auto it = std::lower_bound(entries.begin(), entries.end(), q, [](const Entry & e, string_view n) {
+        return e.name < n;
+    });
+    for (; it != entries.end(); ++it) {
+        if (prefix ? it->name.substr(0, q.size()) != q : it->name != q) {
+            break;
+        }
+        const auto trav_enter = it->taxon->get_data().trav_enter;
+        if (context_data.trav_enter <= trav_enter and trav_enter <= context_data.trav_exit) {
+            hits.push_back(&*it);
+        }
+    }
+    // Hits for an exact match are already in postorder; hits for a prefix are sorted by name first.
+    if (prefix) {
+        std::sort(hits.begin(), hits.end(), [](const Entry * e1, const Entry * e2) {
+            return precedes_in_postorder(*e1, *e2);
+        });
+    }
+    return hits;
+}
+
+// Walk the trie of the names in [first, last), which share their first depth characters, keeping
+//  one row of the edit distance table for each trie node on the current path (rows[depth] compares
+//  that prefix with every prefix of the query).  A branch is abandoned as soon as every entry in its
+//  row exceeds max_distance, since the rows below it can only be larger.
+template <typename It, typename F>
+static void approximate_trie_walk(It first,
+                                  It last,
+                                  std::size_t depth,
+                                  string_view query,
+                                  unsigned max_distance,
+                                  std::deque<vector<unsigned>> & rows,
+                                  F & found) {
+    const auto m = query.size();
+    if (rows.size() < depth + 2) {
+        rows.emplace_back(m + 1);
+    }
+    const auto & row = rows[depth];
+    auto & next_row = rows[depth + 1];
+    // Names that end here sort before the names that continue.
+    for (; first != last and first->name.size() == depth; ++first) {
+        if (row[m] <= max_distance) {
+            found(*first, row[m]);
+        }
+    }
+    while (first != last) {
+        const char c = first->name[depth];
+        auto group_end = std::partition_point(first, last, [&](const auto & e) {return e.name[depth] == c;});
+        next_row[0] = row[0] + 1;
+        unsigned row_min = next_row[0];
+        for (std::size_t j = 1; j <= m; j++) {
+            next_row[j] = std::min({row[j] + 1, next_row[j - 1] + 1, row[j - 1] + (query[j - 1] != c ? 1U : 0U)});
+            row_min = std::min(row_min, next_row[j]);
+        }
+        if (row_min <= max_distance) {
+            approximate_trie_walk(first, group_end, depth + 1, query, max_distance, rows, found);
+        }
+        first = group_end;
+    }
+}
+
+vector<TaxonNameIndex::ApproximateMatch> TaxonNameIndex::find_approximate(string_view query,
+                                                                         const RTRichTaxNode * context_root,
+                                                                         unsigned max_distance) const {
+    vector<ApproximateMatch> matches;
+    if (context_root == nullptr) {
+        return matches;
+    }
+    const auto normalized_query = normalize(query);
+    const auto & context_data = context_root->get_data();
+    auto found = [&](const Entry & e, unsigned distance) {
+        const auto trav_enter = e.taxon->get_data().trav_enter;
+        if (context_data.trav_enter <= trav_enter and trav_enter <= context_data.trav_exit) {
+            const auto length = std::max(normalized_query.size(), e.name.size());
+            matches.push_back(ApproximateMatch{&e, distance, 1.0 - double(distance) / double(length)});
+        }
+    };
+    for (const auto entries : {&names, &synonyms}) {
+        std::deque<vector<unsigned>> rows;
+        rows.emplace_back(normalized_query.size() + 1);
+        std::iota(rows[0].begin(), rows[0].end(), 0U);
+        approximate_trie_walk(entries->begin(), entries->end(), 0, normalized_query, max_distance, rows, found);
+    }
+    // Keep the best match of each taxon.  Names were found before synonyms, so they win ties.
+    std::unordered_map<const RTRichTaxNode *, std::size_t> best_of_taxon;
+    vector<ApproximateMatch> best;
+    for (const auto & m : matches) {
+        auto [it, inserted] = best_of_taxon.emplace(m.entry->taxon, best.size());
+        if (inserted) {
+            best.push_back(m);
+        } else if (m.score > best[it->second].score) {
+            best[it->second] = m;
+        }
+    }
+    std::stable_sort(best.begin(), best.end(), [](const ApproximateMatch & m1, const ApproximateMatch & m2) {
+        return m1.distance < m2.distance;
+    });
+    return best;
+}
+
+std::size_t TaxonNameIndex::memory_used() const {
+    return normalized_names.capacity() + (names.capacity() + synonyms.capacity()) * sizeof(Entry);
+}
+
 string format_with_taxonomy(const string& orig, const string& format, const TaxonomyRecord& rec, const Taxonomy& taxonomy) {
     string result;
     int pos = 0;
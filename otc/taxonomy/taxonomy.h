@@ -1,6 +1,5 @@
 #ifndef OTC_TAXONOMY_TAXONOMY_H
 #define OTC_TAXONOMY_TAXONOMY_H
-// TODO: mmap via BOOST https://techoverflow.net/blog/2013/03/31/mmap-with-boost-iostreams-a-minimalist-example/
 // TODO: write out a reduced taxonomy
 
 #include <iostream>
@@ -12,6 +11,7 @@
 #include <map>
 #include <optional>
 #include <boost/program_options.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/spirit/include/qi_symbols.hpp>
@@ -22,11 +22,11 @@
 #include "otc/error.h"
 #include "otc/tree.h"
 #include "otc/tree_operations.h"
+#include "otc/lca_index.h"
+#include "otc/ott_id_index.h"
 
 #include "json.hpp"
 
-// 1. Write a parser to read the lines faster
-// 2. Avoid memory allocation -- by mmapping the taxonomy file?
 // 3. Convert the flags into a bitmask
 // 4. Should the Rank be a converted to an integer?
 // 5. Can we assign OTT IDs to internal nodes of a tree while accounting for Incertae Sedis taxa?
@@ -115,8 +115,10 @@ inline nlohmann::json sources_vec_as_json(const std::vector<std::string> & vs) {
     return j;
 }
 
+// The fields of a record are views into `line`, which is owned by whoever holds the text
+//  (the memory-mapped taxonomy.tsv, for a Taxonomy). It must outlive the record.
 struct TaxonomyRecord {
-    std::string line;
+    std::string_view line;
     OttId id = 0;
     OttId parent_id = 0;
     int parent_index = 0;
@@ -131,7 +133,7 @@ struct TaxonomyRecord {
     TaxonomyRecord& operator=(const TaxonomyRecord& tr) = delete;
     TaxonomyRecord(TaxonomyRecord&& tr) = default;
     TaxonomyRecord(TaxonomyRecord& tr) = delete;
-    explicit TaxonomyRecord(const std::string& line);
+    explicit TaxonomyRecord(std::string_view line);
     std::vector<std::string> sourceinfoAsVec() const {
         std::string si = std::string(sourceinfo);
         return comma_separated_as_vec(si);
@@ -150,7 +152,7 @@ inline std::vector<int> get_index_vec(std::size_t sz) {
 class BaseTaxonomy {
     protected:
     std::unordered_map<OttId, OttId> forwards;
-    OttId keep_root;
+    OttId keep_root = -1;
     std::bitset<32> cleaning_flags;
     std::string path;
     std::string version;
@@ -170,13 +172,16 @@ class BaseTaxonomy {
 class Taxonomy: public std::vector<TaxonomyRecord>, public BaseTaxonomy {
     protected:
     std::unordered_map<OttId, int> index;
+    // taxonomy.tsv, mapped read-only into memory. The records point into it.
+    std::shared_ptr<boost::iostreams::mapped_file_source> taxonomy_file;
     void read_forwards_file(std::string filepath);
+    std::vector<std::vector<TaxonomyRecord>> read_records_in_parallel(const char* start, const char* end, const std::string& filename) const;
 
     std::optional<int> maybe_index_from_id(OttId) const;
     int index_from_id(OttId) const;
 
 public:
-    template <typename Tree_t> std::unique_ptr<Tree_t> get_tree(std::function<std::string(const TaxonomyRecord&)>) const;
+    template <typename Tree_t> std::unique_ptr<Tree_t> get_tree(std::function<std::string(const TaxonomyRecord&)>, bool use_node_arena = false) const;
 
     TaxonomyRecord& record_from_id(OttId id);
     
@@ -287,7 +292,7 @@ class RTRichTaxTreeData {
     std::unordered_map<std::bitset<32>, nlohmann::json> flags2json;
     std::map<std::string_view, const RTRichTaxNode *> name_to_node; // null if homonym, then check homonym2node
     std::map<std::string_view, const TaxonomyRecord *> name_to_record; // for filtered
-    std::unordered_map<OttId, const RTRichTaxNode *> id_to_node;
+    OttIdIndex<const RTRichTaxNode *> id_to_node;
     std::unordered_map<OttId, const TaxonomyRecord *> id_to_record;
     std::map<std::string_view, std::vector<const RTRichTaxNode *> > homonym_to_node;
     std::map<std::string_view, std::vector<const TaxonomyRecord *> > homonym_to_record;
@@ -298,6 +303,53 @@ class RTRichTaxTreeData {
 
 typedef RootedTree<RTRichTaxNodeData, RTRichTaxTreeData> RichTaxTree;
 
+// A case-folded index of the names and junior synonyms of the taxa in a taxonomy tree, for TNRS.
+//   Entries are sorted by their normalized name, so exact and prefix lookups are binary searches, and
+//   the sorted entries can be walked as a trie for approximate matching.
+//   A lookup is restricted to the subtree of a context taxon by checking the trav_enter of each hit
+//   against the context's [trav_enter, trav_exit] range.  Hits are returned in postorder of their taxa
+//   (and then in the order of the taxon's junior synonyms), as a scan of the context subtree would find them.
+class TaxonNameIndex {
+    public:
+    struct Entry {
+        std::string_view name; // normalized
+        const RTRichTaxNode * taxon;
+        const TaxonomicJuniorSynonym * synonym; // nullptr for the taxon's own (non-unique) name
+        std::uint32_t synonym_pos; // position of synonym in the taxon's junior_synonyms
+    };
+    explicit TaxonNameIndex(const RichTaxTree & tree);
+    /// The form of a name that is used for matching: ASCII letters are lower-cased.
+    static std::string normalize(std::string_view name);
+    /// Taxa whose name is query (or starts with query, if prefix is true), below context_root.
+    std::vector<const Entry *> find_names(std::string_view query, const RTRichTaxNode * context_root, bool prefix) const {
+        return find(names, query, context_root, prefix);
+    }
+    /// Junior synonyms that are query (or start with query, if prefix is true), for taxa below context_root.
+    std::vector<const Entry *> find_synonyms(std::string_view query, const RTRichTaxNode * context_root, bool prefix) const {
+        return find(synonyms, query, context_root, prefix);
+    }
+    struct ApproximateMatch {
+        const Entry * entry;
+        unsigned distance; // edit distance between the normalized query and entry->name
+        double score; // 1 - distance / (length of the longer of the two)
+    };
+    /// Names and junior synonyms within max_distance edits (insertions, deletions or substitutions) of
+    ///   query, for taxa below context_root.  Sorted by distance, with names before synonyms.  A taxon
+    ///   is only returned once, with the best-scoring of its matching names (its name on a tie).
+    std::vector<ApproximateMatch> find_approximate(std::string_view query,
+                                                   const RTRichTaxNode * context_root,
+                                                   unsigned max_distance) const;
+    std::size_t memory_used() const;
+    private:
+    std::string normalized_names; // the text that the entries point into
+    std::vector<Entry> names;
+    std::vector<Entry> synonyms;
+    std::vector<const Entry *> find(const std::vector<Entry> & entries,
+                                    std::string_view query,
+                                    const RTRichTaxNode * context_root,
+                                    bool prefix) const;
+};
+
 class RichTaxonomy: public BaseTaxonomy {
     public:
     const RichTaxTree & get_tax_tree() const {
@@ -306,18 +358,25 @@ class RichTaxonomy: public BaseTaxonomy {
     /// Load the taxonomy from directory dir, and apply cleaning flags cf, and keep subtree below kr
     RichTaxonomy(const std::string& dir, std::bitset<32> cf = std::bitset<32>(), OttId kr = -1);
     RichTaxonomy(RichTaxonomy &&) = default;
+    /// Write the fully built taxonomy to a binary snapshot that load_snapshot can map back in.
+    void write_snapshot(const std::string& filename) const;
+    /// Load the taxonomy from a snapshot instead of parsing the TSV files in dir.  Throws OTCError if
+    ///   filename is not a valid snapshot of the taxonomy in dir, made with the same cf and kr.
+    static RichTaxonomy load_snapshot(const std::string& filename,
+                                      const std::string& dir,
+                                      std::bitset<32> cf = std::bitset<32>(),
+                                      OttId kr = -1);
     const RTRichTaxNode * included_taxon_from_id(OttId ott_id) const {
         //Returns node * or nullptr if not found.
         const auto & td = tree->get_data();
-        auto i2n_it = td.id_to_node.find(ott_id);
-        if (i2n_it == td.id_to_node.end()) {
-            auto fit = forwards.find(ott_id);
-            if (fit == forwards.end()) {
-                return nullptr;
-            }
-            return included_taxon_from_id(fit->second);
+        if (auto nd = td.id_to_node.lookup(ott_id)) {
+            return nd;
         }
-        return i2n_it->second;
+        auto fit = forwards.find(ott_id);
+        if (fit == forwards.end()) {
+            return nullptr;
+        }
+        return included_taxon_from_id(fit->second);
     }
     void add_taxonomic_addition_string(const std::string &s);
     const OttIdSet & get_ids_to_suppress_from_tnrs() const {
@@ -340,9 +399,30 @@ class RichTaxonomy: public BaseTaxonomy {
     const std::list<TaxonomicJuniorSynonym> & get_synonyms_list() const {
         return synonyms;
     }
+    /// The MRCA index of the taxonomy tree, or nullptr if build_lca_index() has not been called.
+    const LCAIndex<const RTRichTaxNode> * get_lca_index() const {
+        return lca_index.get();
+    }
+    // Takes ~20 bytes per taxon, so only callers that compute many MRCAs (the web services) build it.
+    void build_lca_index() {
+        lca_index = std::make_unique<LCAIndex<const RTRichTaxNode>>(tree->get_root());
+    }
+    /// The TNRS name index, or nullptr if build_name_index() has not been called.
+    const TaxonNameIndex * get_name_index() const {
+        return name_index.get();
+    }
+    void build_name_index() {
+        name_index = std::make_unique<TaxonNameIndex>(*tree);
+    }
     private:
+    RichTaxonomy(const std::string& dir, std::bitset<32> cf, OttId kr, const std::string& snapshot_filename);
+    // When loaded from a snapshot, the string_views in the name maps (and filtered_records) point into it.
+    std::shared_ptr<boost::iostreams::mapped_file_source> snapshot_file;
+    std::string filtered_lines; // the text of filtered_records, which point into it
     std::vector<TaxonomyRecord> filtered_records;
     std::unique_ptr<RichTaxTree> tree;
+    std::unique_ptr<LCAIndex<const RTRichTaxNode>> lca_index;
+    std::unique_ptr<TaxonNameIndex> name_index;
     std::list<TaxonomicJuniorSynonym> synonyms;
     // flags: not_otu, environmental, environmental_inherited, viral, hidden, hidden_inherited, was_container
     //    are excluded from being returned in TNRS results.
@@ -352,6 +432,7 @@ class RichTaxonomy: public BaseTaxonomy {
     //    will allow the services to report "is_suppressed_from_synth" option.
     const OttIdSet * is_suppressed_from_synth = nullptr;
     void read_synonyms();
+    void index_filtered_records();
     void _fill_ids_to_suppress_set();
     RichTaxonomy(const RichTaxonomy &) = delete;
 };
@@ -395,9 +476,12 @@ inline void populate_node_from_taxonomy_record(RootedTreeNode<RTTaxNodeData> & n
 
 
 template <typename Tree_t>
-std::unique_ptr<Tree_t> Taxonomy::get_tree(std::function<std::string(const TaxonomyRecord&)> get_name) const {
+std::unique_ptr<Tree_t> Taxonomy::get_tree(std::function<std::string(const TaxonomyRecord&)> get_name, bool use_node_arena) const {
     const auto& taxonomy = *this;
     std::unique_ptr<Tree_t> tree(new Tree_t);
+    if (use_node_arena) {
+        tree->use_node_arena();
+    }
     vector<typename Tree_t::node_type*> node_ptr(size(), nullptr);
     for(auto i = 0U; i < taxonomy.size() ; i++) {
         const auto& line = taxonomy[i];
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <type_traits>
 #include "otc/otc_base_includes.h"
 
 namespace otc {
@@ -249,6 +250,40 @@ class RootedTreeNode {
         friend class RootedTree;
 };
 
+// Bump allocator for the nodes of one tree. Nodes are carved out of fixed-size slabs,
+//  so siblings created together are adjacent in memory, and the whole tree is freed at once.
+//  A slot is not reused after its node is destroyed.
+template<typename N>
+class NodeArena {
+    public:
+        static constexpr std::size_t slab_size = 4096; // nodes per slab
+        void * allocate() {
+            if (used_in_last_slab == slab_size) {
+                slabs.emplace_back(new slot_type[slab_size]);
+                used_in_last_slab = 0;
+            }
+            return &(slabs.back()[used_in_last_slab++]);
+        }
+        // frees every slab. The caller must already have destroyed the nodes.
+        void release() {
+            slabs.clear();
+            used_in_last_slab = slab_size;
+        }
+        std::size_t num_allocated() const {
+            return (slabs.empty() ? 0 : (slabs.size() - 1) * slab_size + used_in_last_slab);
+        }
+        std::size_t capacity() const {
+            return slabs.size() * slab_size;
+        }
+        std::size_t num_slabs() const {
+            return slabs.size();
+        }
+    private:
+        using slot_type = typename std::aligned_storage<sizeof(N), alignof(N)>::type;
+        std::vector<std::unique_ptr<slot_type[]>> slabs;
+        std::size_t used_in_last_slab = slab_size;
+};
+
 template<typename NodeType>
 inline const NodeType* find_root(const NodeType* nd) {
     while(nd->get_parent()) {
@@ -334,7 +369,7 @@ class RootedTree {
             auto nodes = get_subtree_nodes(nd);
             prune_and_dangle(nd);
             for (auto ndi: nodes) {
-                delete ndi;
+                delete_node(const_cast<node_type *>(ndi));
             }
         }
         bool is_detached(node_type * nd) {
@@ -345,6 +380,7 @@ class RootedTree {
         U data;
         std::string name;
         std::set<node_type *> detached;
+        std::unique_ptr<NodeArena<node_type>> node_arena; // null if nodes are heap-allocated one by one
         
     public:
         void set_name(const std::string &n) {
@@ -353,13 +389,39 @@ class RootedTree {
         const std::string & get_name() const {
             return name;
         }
+        // Allocate nodes from contiguous slabs that are freed with the tree, rather than one by one.
+        //  Must be called before any nodes are created.  Nodes of such a tree must not be deleted
+        //  with `delete` or moved into another tree; use delete_node() to remove one.
+        void use_node_arena() {
+            assert(root == nullptr);
+            node_arena = std::make_unique<NodeArena<node_type>>();
+        }
+        bool uses_node_arena() const {
+            return bool(node_arena);
+        }
+        const NodeArena<node_type> * get_node_arena() const {
+            return node_arena.get();
+        }
         node_type * alloc_new_node(node_type *p) {
+            if (node_arena) {
+                return new (node_arena->allocate()) node_type(p);
+            }
             node_type * nd = new node_type(p);
             return nd;
         }
+        void delete_node(node_type * nd) {
+            if (node_arena) {
+                nd->~node_type();
+            } else {
+                delete nd;
+            }
+        }
         void clear() {
             for(auto nd: get_all_attached_nodes()) {
-                delete nd;
+                delete_node(const_cast<node_type *>(nd));
+            }
+            if (node_arena) {
+                node_arena->release();
             }
             root = NULL;
         }
@@ -414,6 +476,7 @@ class RTNodeIncludeBoolData{
 
 template<typename Tree>
 inline void add_subtree(typename Tree::node_type* par, Tree& T2) {
+    assert(not T2.uses_node_arena()); // T2 would free the nodes that it hands over.
     auto c = T2.get_root();
     T2.prune_and_dangle(c);
     par->add_child(c);
@@ -421,6 +484,7 @@ inline void add_subtree(typename Tree::node_type* par, Tree& T2) {
 
 template<typename Tree>
 void replace_with_subtree(typename Tree::node_type* n, Tree& T2) {
+    assert(not T2.uses_node_arena()); // T2 would free the nodes that it hands over.
     // Get the parent of the tip we are replacing
     auto p = n->get_parent();
     // Remove the data from T2 and attach it to this parent
@@ -4,6 +4,8 @@
 #include <map>
 #include <set>
 #include "otc/otc_base_includes.h"
+#include "otc/ott_id_flat_set.h"
+#include "otc/ott_id_index.h"
 
 namespace otc {
 template<typename, typename> class RootedTree;
@@ -13,7 +15,7 @@ template<typename T>
 class RTreeOttIDMapping {
     public:
         typedef RootedTreeNode<T> NodeType;
-        std::map<OttId, NodeType *> ott_id_to_node;
+        OttIdIndex<NodeType *> ott_id_to_node;
         // if a node is pruned, the entry in ott_id_to_node will refer to an alias
         //   if the alias is later pruned, we need to know what nodes it is aliasing
         //   so that ott_id_to_node does not point to dangling nodes.
@@ -21,14 +23,22 @@ class RTreeOttIDMapping {
         std::map<OttId, NodeType *> ott_id_to_detached_node;
         bool des_id_sets_contain_internals;
         NodeType * get_node_by_ott_id(OttId ottId) const {
-            const auto it = ott_id_to_node.find(ottId);
-            return (it == ott_id_to_node.end() ? nullptr : it->second);
+            return ott_id_to_node.lookup(ottId);
         }
 };
 
+// The type of the des_ids of TreeMappedWithSplits nodes.  Building with COMPACT_SPLITS defined
+//   (meson configure -Dcompact_splits=true) stores them as sorted vectors, which take a fraction of
+//   the memory of std::sets on large trees like the OTT scaffold.
+#if defined(COMPACT_SPLITS)
+    using DesIdSet = OttIdFlatSet;
+#else
+    using DesIdSet = OttIdSet;
+#endif
+
 class RTSplits {
     public:
-    std::set<OttId> des_ids;
+    DesIdSet des_ids;
     int depth = 0;
 };
 
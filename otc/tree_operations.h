@@ -2,7 +2,7 @@
 #define OTCETERA_TREE_OPERATIONS_H
 // Functions that operate on trees - may include iteration
 //  over trees (contrast w/tree_util.h)
-// Depends on: tree.h tree_util.h tree_iter.h 
+// Depends on: tree.h tree_util.h tree_iter.h lca_index.h
 // Depended on by: tools
 #include <vector>
 #include <unordered_map>
@@ -12,6 +12,8 @@
 #include "otc/error.h"
 #include "otc/util.h"
 #include "otc/debug.h"
+#include "otc/ott_id_index.h"
+#include "otc/lca_index.h"
 namespace otc {
 template<typename T, typename CONTAINER>
 void show_children_in_set(std::ostream & out, T nd, const CONTAINER & ancestral);
@@ -43,13 +45,18 @@ template<typename T>
 std::size_t check_for_unknown_taxa(std::ostream & err, const T & toCheck, const T & taxonomy);
 template<typename T>
 typename T::node_type * find_mrca_from_id_set(T & tree, const OttIdSet & idSet, OttId trigger);
+template<typename T>
+typename T::node_type * find_mrca_from_id_set(T & tree,
+                                              const OttIdSet & idSet,
+                                              OttId trigger,
+                                              const LCAIndex<typename T::node_type> & lca_index);
 
 template<typename T>
 void prune_and_delete(T & tree, typename T::node_type *toDel);
 template<typename T, typename U>
 inline void cull_refs_to_node_from_data(RootedTree<T, U> & tree, RootedTreeNode<T> *toDel);
 
-const OttIdSet& get_des_ids(RootedTreeNode<RTSplits> & nd);
+const DesIdSet & get_des_ids(RootedTreeNode<RTSplits> & nd);
 template<typename T>
 std::size_t prune_tips_without_ids(T & tree);
 template <typename T>
@@ -188,10 +195,9 @@ inline std::size_t n_internal_out_degree_many(const T & tree) {
 
 template<typename T>
 inline std::size_t n_nodes(const T& tree) {
-#pragma clang diagnostic ignored  "-Wunused-variable"
-#pragma GCC diagnostic ignored  "-Wunused-variable"
     std::size_t count = 0;
     for(auto nd: iter_post_const(tree)){
+        (void)nd;
         count++;
     }
     return count;
@@ -244,6 +250,7 @@ void fill_des_ids(T & tree) {
                 auto & cDesIds = child->get_data().des_ids;
                 des_ids.insert(cDesIds.begin(), cDesIds.end());
             }
+            shrink_to_fit(des_ids);
         }
     }
 }
@@ -261,6 +268,7 @@ void clear_and_fill_des_ids(T & tree) {
                 auto & cDesIds = child->get_data().des_ids;
                 des_ids.insert(cDesIds.begin(), cDesIds.end());
             }
+            shrink_to_fit(des_ids);
         }
     }
 }
@@ -281,6 +289,7 @@ void fill_des_ids_including_internals(T & tree) {
                 auto & cDesIds = child->get_data().des_ids;
                 des_ids.insert(cDesIds.begin(), cDesIds.end());
             }
+            shrink_to_fit(des_ids);
         }
     }
 }
@@ -296,49 +305,72 @@ void compute_depth(T& tree) {
     }
 }
 
-// uses ottID->node mapping, but not the split sets of the nodes
+template<typename T>
+typename T::node_type * find_node_for_designator(T & tree, OttId ott_id, OttId trigger) {
+    auto nd = tree.get_data().ott_id_to_node.lookup(ott_id);
+    if (nd == nullptr) {
+        std::string em = "tip ";
+        em += std::to_string(ott_id);
+        if (trigger >= 0 && trigger != std::numeric_limits<OttId>::max()) {
+            em += " a descendant of ";
+            em += std::to_string(trigger); 
+        }
+        em += " not found.";
+        throw OTCError(em);
+    }
+    return nd;
+}
+
+// uses ottID->node mapping, but not the split sets of the nodes.
+// The nodes on the path from the first tip to the root are numbered, and every node met while
+//  walking up from a later tip is labelled with the number of the path node where the walk joined
+//  the path.  So a walk stops at the first labelled node, and no node is visited twice.
 template<typename T>
 typename T::node_type * find_mrca_from_id_set(T & tree, const OttIdSet & idSet, OttId trigger) {
     typedef typename T::node_type NT_t;
-    auto ott_id_to_node = tree.get_data().ott_id_to_node;
-    std::map<NT_t *, unsigned int> n2c;
-    long shortestPathLen = -1;
-    NT_t * shortestPathNode = nullptr;
+    std::vector<NT_t *> path;
+    std::unordered_map<const NT_t *, std::size_t> joins_path_at;
+    std::vector<const NT_t *> walked;
+    std::size_t mrca_index = 0;
     for (const auto & i : idSet) {
-        const auto rIt = ott_id_to_node.find(i);
-        if (rIt == ott_id_to_node.end()) {
-            std::string em = "tip ";
-            em += std::to_string(i);
-            if (trigger >= 0 && trigger != std::numeric_limits<OttId>::max()) {
-                em += " a descendant of ";
-                em += std::to_string(trigger); 
+        NT_t * nd = find_node_for_designator(tree, i, trigger);
+        if (path.empty()) {
+            for (; nd != nullptr; nd = nd->get_parent()) {
+                joins_path_at.emplace(nd, path.size());
+                path.push_back(nd);
             }
-            em += " not found.";
-            throw OTCError(em);
-        }
-        auto nd = rIt->second;
-        long currPathLen = 0;
-        while (nd != nullptr) {
-            n2c[nd] += 1;
-            currPathLen += 1;
+            continue;
+        }
+        walked.clear();
+        auto jIt = joins_path_at.find(nd);
+        while (jIt == joins_path_at.end()) {
+            walked.push_back(nd);
             nd = nd->get_parent();
+            assert(nd != nullptr);
+            jIt = joins_path_at.find(nd);
         }
-        if (shortestPathLen < 0 || currPathLen < shortestPathLen) {
-            shortestPathLen = currPathLen;
-            shortestPathNode = rIt->second;
+        const auto joinIndex = jIt->second;
+        for (auto w : walked) {
+            joins_path_at.emplace(w, joinIndex);
         }
+        mrca_index = std::max(mrca_index, joinIndex);
     }
-    auto nTips = idSet.size();
-    auto cn = shortestPathNode;
-    while (true) {
-        if (n2c[cn] == nTips) {
-            return cn;
-        }
-        cn = cn->get_parent();
-        assert(cn != nullptr);
+    return path.empty() ? nullptr : path[mrca_index];
+}
+
+// For callers that find the MRCAs of many sets in the same tree: with an LCAIndex of the tree,
+//  this is O(k) for k ids.
+template<typename T>
+typename T::node_type * find_mrca_from_id_set(T & tree,
+                                              const OttIdSet & idSet,
+                                              OttId trigger,
+                                              const LCAIndex<typename T::node_type> & lca_index) {
+    std::vector<typename T::node_type *> nodes;
+    nodes.reserve(idSet.size());
+    for (const auto & i : idSet) {
+        nodes.push_back(find_node_for_designator(tree, i, trigger));
     }
-    assert(false);
-    throw OTCError("asserts disabled, but false");
+    return lca_index.mrca_of_group(nodes);
 }
 
 template<typename T>
@@ -358,7 +390,7 @@ template<typename T>
 inline typename T::node_type * add_child_for_ott_id(typename T::node_type & nd, OttId ottId, T & tree) {
     auto nn = tree.create_child(&nd);
     nn->set_ott_id(ottId);
-    tree.get_data()->ott_id_to_node[ottId] = nn;
+    tree.get_data()->ott_id_to_node.set(ottId, nn);
     return nn;
 }
 
@@ -366,15 +398,15 @@ template<>
 inline NodeWithSplits * add_child_for_ott_id<TreeMappedWithSplits>(NodeWithSplits & nd, OttId ottId, TreeMappedWithSplits & tree) {
     auto nn = tree.create_child(&nd);
     nn->set_ott_id(ottId);
-    tree.get_data().ott_id_to_node[ottId] = nn;
+    tree.get_data().ott_id_to_node.set(ottId, nn);
     return nn;
 }
 
-inline const OttIdSet & get_des_ids(RootedTreeNode<RTSplits> & nd) {
+inline const DesIdSet & get_des_ids(RootedTreeNode<RTSplits> & nd) {
     return nd.get_data().des_ids;
 }
 
-inline void fix_des_ids(RootedTreeNode<RTSplits> & nd, const OttIdSet & ls) {
+inline void fix_des_ids(RootedTreeNode<RTSplits> & nd, const DesIdSet & ls) {
     const auto toRemove = nd.get_data().des_ids;
     assert(!toRemove.empty());
     nd.get_data().des_ids = ls;
@@ -444,7 +476,7 @@ void require_nonredundant_tree(const T & toExpand) {
 template<typename T>
 std::set<const typename T::node_type *> expand_ott_internals_which_are_leaves(T & toExpand, const T & taxonomy) {
     const auto & taxData = taxonomy.get_data();
-    std::map<typename T::node_type *, OttIdSet > replaceNodes;
+    std::map<typename T::node_type *, DesIdSet > replaceNodes;
     for (auto nd : iter_leaf(toExpand)) {
         assert(nd->is_tip());
         assert(nd->has_ott_id());
@@ -675,7 +707,7 @@ inline void change_ott_id_of_internal(RootedTree<T, U> & tree, RootedTreeNode<T>
     del_ott_id_of_internal(tree, nd);
     if (ottId > 0) {
         nd->set_ott_id(ottId);
-        tree.get_data().ott_id_to_node[ottId] = nd;
+        tree.get_data().ott_id_to_node.set(ottId, nd);
     }
 }
 
@@ -816,6 +848,74 @@ inline void write_newick_generic(std::ostream & out,
     out<<';';
 }
 
+// Writes the same Newick as write_newick_generic, but a piece at a time, so that a server can send a
+//    huge tree without ever holding all of it in memory.  Each call to write_some() finishes at most
+//    max_nodes more nodes; it returns false once the closing ';' has been written.
+// The traversal uses an explicit stack, so the writer can be put aside between calls.
+template<typename T, typename Y>
+class IncrementalNewickWriter {
+    struct Frame {
+        T nd;
+        long height_limit;
+        T next_child;
+        bool entered;
+        bool expanded;
+    };
+    std::vector<Frame> stack;
+    Y & nodeNamer;
+    const bool include_all_node_labels;
+    public:
+    IncrementalNewickWriter(T nd, Y & node_namer, bool all_node_labels, long height_limit)
+        :nodeNamer(node_namer),
+        include_all_node_labels(all_node_labels) {
+        assert(nd != nullptr);
+        stack.push_back(Frame{nd, height_limit, nullptr, false, false});
+    }
+
+    bool write_some(std::ostream & out, std::size_t max_nodes) {
+        if (stack.empty()) {
+            return false;
+        }
+        std::size_t num_written = 0;
+        while (num_written < max_nodes and not stack.empty()) {
+            auto & f = stack.back();
+            if (not f.entered) {
+                f.entered = true;
+                if (!(f.nd->is_tip()) && f.height_limit != 0) {
+                    out << '(';
+                    f.expanded = true;
+                    f.next_child = f.nd->get_first_child();
+                }
+            }
+            if (f.next_child != nullptr) {
+                T c = f.next_child;
+                if (c != f.nd->get_first_child()) {
+                    out << ',';
+                }
+                f.next_child = c->get_next_sib();
+                const long nhl = f.height_limit - 1;
+                stack.push_back(Frame{c, nhl, nullptr, false, false});
+                continue;
+            }
+            if (f.expanded) {
+                out << ')';
+            }
+            // We need to call nodeNamer(nd) to mark nd as visited, even if we don't use the name.
+            auto name = nodeNamer(f.nd);
+            if (include_all_node_labels or f.nd->has_ott_id()) {
+                write_escaped_for_newick(out, name);
+            }
+            stack.pop_back();
+            num_written++;
+        }
+        if (not stack.empty()) {
+            return true;
+        }
+        out << ';';
+        return false;
+    }
+};
+
 
 template<typename T>
 inline void db_write_newick(const T *nd) {
@@ -911,8 +1011,8 @@ inline std::string newick_string(const T& Tree) {
     return s.str();
 }
 
-template<typename T>
-inline T * search_anc_for_mrca_of_des_ids(T * nd, const OttIdSet & idSet) {
+template<typename T, typename S>
+inline T * search_anc_for_mrca_of_des_ids(T * nd, const S & idSet) {
     assert(nd != nullptr);
     if (is_subset(idSet, nd->get_data().des_ids)) {
         return nd;
@@ -925,8 +1025,8 @@ inline T * search_anc_for_mrca_of_des_ids(T * nd, const OttIdSet & idSet) {
     return nullptr;
 }
 
-template<typename T>
-inline const typename T::node_type * find_node_with_matching_des_ids(const T & tree, const OttIdSet & idSet) {
+template<typename T, typename S>
+inline const typename T::node_type * find_node_with_matching_des_ids(const T & tree, const S & idSet) {
     assert(!idSet.empty());
     OttId firstId = *begin(idSet);
     auto nd = tree.get_data().ott_id_to_node.at(firstId);
@@ -946,8 +1046,8 @@ inline const typename T::node_type * find_node_with_matching_des_ids(const T & t
     return nullptr;
 }
 
-template<typename T>
-inline const typename T::node_type * find_mrca_using_des_ids(const T & tree, const OttIdSet & idSet) {
+template<typename T, typename S>
+inline const typename T::node_type * find_mrca_using_des_ids(const T & tree, const S & idSet) {
     if (idSet.empty()) {
         assert(false);
         throw OTCError("asserts disabled but false");
@@ -981,14 +1081,14 @@ inline void replace_mappings_to_node_with_alias(typename RootedTree<N,RTreeOttID
                                            RootedTree<N,RTreeOttIDMapping<N>>& tree) {
     if (nd->has_ott_id()) {
         tree.get_data().ott_id_to_detached_node[nd->get_ott_id()] = nd;
-        tree.get_data().ott_id_to_node[nd->get_ott_id()] = alias;
+        tree.get_data().ott_id_to_node.set(nd->get_ott_id(), alias);
         auto & iaf = tree.get_data().is_alias_for;
         iaf[alias].insert(nd->get_ott_id());
         auto na = iaf.find(nd); // if nd was an alias for other nodes, update them too...
         if (na != iaf.end()) {
             for (auto aoi : na->second) {
                 iaf[alias].insert(aoi);
-                tree.get_data().ott_id_to_node[aoi] = alias;
+                tree.get_data().ott_id_to_node.set(aoi, alias);
             }
         }
         iaf.erase(nd);
@@ -1053,7 +1153,7 @@ inline void del_monotypic_node(typename T::node_type* nd, T& tree) {
     } else {
         tree._set_root(child);
     }
-    delete nd;
+    tree.delete_node(nd);
  }
 
 template <typename T>
@@ -1202,7 +1302,7 @@ inline bool are_linearly_related(const T * nd1, const T *nd2) {
 template<typename T>
 inline OttIdSet get_ott_id_set_for_leaves(const T &tree) {
     if (!tree.get_data().des_id_sets_contain_internals) {
-        return tree.get_root()->get_data().des_ids;
+        return as_ott_id_set(tree.get_root()->get_data().des_ids);
     }
     OttIdSet inducingIds;
     for (auto nd : iter_leaf_const(tree)) {
@@ -1222,7 +1322,7 @@ void get_induced_informative_groupings(const T & tree1, std::set<OttIdSet > & in
         if (n == mrca) {
             continue;
         }
-        auto inducedDesIds = n->get_data().des_ids;
+        const auto & inducedDesIds = n->get_data().des_ids;
         const auto x = intersection_of_sets(inducingIds, inducedDesIds);
         if (x.size() > 1) {
             inducedSplits.insert(std::move(x));
@@ -1240,7 +1340,7 @@ void get_informative_groupings(const T & tree2,
         }
         const auto & x = n->get_data().des_ids;
         if (x.size() > 2) {
-            tree2Splits.insert(x);
+            tree2Splits.insert(as_ott_id_set(x));
         }
     }
 }
@@ -1391,22 +1491,22 @@ inline std::string newick(const T &t) {
 
 
 template <typename Tree_t>
-std::unordered_map<OttId, const typename Tree_t::node_type*> get_ottid_to_const_node_map(const Tree_t& T) {
-    std::unordered_map<OttId, const typename Tree_t::node_type*> ottid;
+OttIdIndex<const typename Tree_t::node_type*> get_ottid_to_const_node_map(const Tree_t& T) {
+    OttIdIndex<const typename Tree_t::node_type*> ottid;
     for(auto nd: iter_pre_const(T)) {
         if (nd->has_ott_id()) {
-            ottid[nd->get_ott_id()] = nd;
+            ottid.set(nd->get_ott_id(), nd);
         }
     }
   return ottid;
 }
 
 template <typename Tree_t>
-std::unordered_map<OttId, typename Tree_t::node_type*> get_ottid_to_node_map(Tree_t& T) {
-    std::unordered_map<OttId, typename Tree_t::node_type*> ottid;
+OttIdIndex<typename Tree_t::node_type*> get_ottid_to_node_map(Tree_t& T) {
+    OttIdIndex<typename Tree_t::node_type*> ottid;
     for(auto nd: iter_pre(T)) {
         if (nd->has_ott_id()) {
-            ottid[nd->get_ott_id()] = nd;
+            ottid.set(nd->get_ott_id(), nd);
         }
     }
     return ottid;
@@ -8,9 +8,12 @@
 #include <algorithm>
 #include <iterator>
 #include <list>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 #include "otc/otc_base_includes.h"
 #include "otc/error.h"
+#include "otc/ott_id_flat_set.h"
 
 namespace otc {
 
@@ -42,13 +45,16 @@ QuotingRequirementsEnum determine_newick_quoting_requirements(const std::string
 std::string add_newick_quotes(const std::string &s);
 std::string blanks_to_underscores(const std::string &s);
 void write_escaped_for_newick(std::ostream & out, const std::string & n);
-void write_ott_id_set(std::ostream & out, const char *indent, const OttIdSet &fir, const char * sep);
-void db_write_ott_id_set(const char * label, const OttIdSet &fir);
-void write_ott_id_set_diff(std::ostream & out, const char *indent, const OttIdSet &fir, const char *firN, const OttIdSet & sec, const char *secN);
+template<typename S>
+void write_ott_id_set(std::ostream & out, const char *indent, const S &fir, const char * sep);
+template<typename S>
+void db_write_ott_id_set(const char * label, const S &fir);
+template<typename S1, typename S2>
+void write_ott_id_set_diff(std::ostream & out, const char *indent, const S1 &fir, const char *firN, const S2 & sec, const char *secN);
 template<typename T>
 std::set<T> container_as_set(const std::vector<T> &);
-template<typename T>
-bool is_subset(const T & small, const T & big);
+template<typename T, typename U>
+bool is_subset(const T & small, const U & big);
 template<typename T, typename U>
 bool have_intersection(const T & first, const U & second);
 template<typename T>
@@ -137,9 +143,10 @@ inline std::set<T> keys(const std::map<T, U> & container) {
     return k;
 }
 
+template<typename S>
 inline void write_ott_id_set(std::ostream & out,
                              const char *indent,
-                             const OttIdSet &fir,
+                             const S &fir,
                              const char * sep) {
     for (auto rIt = fir.begin(); rIt != fir.end(); ++rIt) {
         if (rIt != fir.begin()) {
@@ -148,8 +155,9 @@ inline void write_ott_id_set(std::ostream & out,
         out << indent << "ott" << *rIt;
     }
 }
+template<typename S>
 inline void db_write_ott_id_set(const char * label,
-                                const OttIdSet &fir) {
+                                const S &fir) {
     if (!debugging_output_enabled) {
         return;
     }
@@ -157,11 +165,12 @@ inline void db_write_ott_id_set(const char * label,
     write_ott_id_set(std::cerr, " ", fir, " ");
     std::cerr << std::endl;
 }
+template<typename S1, typename S2>
 inline void write_ott_id_set_diff(std::ostream & out,
                             const char *indent,
-                            const OttIdSet &fir,
+                            const S1 &fir,
                             const char *firN,
-                            const OttIdSet & sec,
+                            const S2 & sec,
                             const char *secN) {
     for (const auto & rIt : fir) {
         if (sec.find(rIt) == sec.end()) {
@@ -175,8 +184,8 @@ inline void write_ott_id_set_diff(std::ostream & out,
     }
 }
 
-template<typename T>
-inline bool is_proper_subset(const T & small, const T & big) {
+template<typename T, typename U>
+inline bool is_proper_subset(const T & small, const U & big) {
     if (big.size() <= small.size()) {
         return false;
     }
@@ -188,8 +197,8 @@ inline bool is_proper_subset(const T & small, const T & big) {
     return true;
 }
 
-template<typename T>
-inline bool is_subset(const T & small, const T & big) {
+template<typename T, typename U>
+inline bool is_subset(const T & small, const U & big) {
     if (big.size() < small.size()) {
         return false;
     }
@@ -259,8 +268,8 @@ inline bool ds_are_disjoint(const std::map<T, U> & first,
 // intersection with the first el of set1, so set 1 could be a subset of set2
 // returns true if set1 is a subset of set2 (where the args are the iterators and
 // end iterators for each set)
-template<typename T>
-inline bool finish_subset_compat(T & it1, const T & it1End, T & it2, const T &it2End) {
+template<typename T, typename U>
+inline bool finish_subset_compat(T & it1, const T & it1End, U & it2, const U &it2End) {
     while (it1 != it1End && it2 != it2End) {
         if (*it1 == *it2) {
             ++it1;
@@ -275,8 +284,8 @@ inline bool finish_subset_compat(T & it1, const T & it1End, T & it2, const T &it
 }
 
 // adapted http://stackoverflow.com/posts/1964252/revisions
-template<typename T>
-inline bool are_compatible_des_id_sets(const T & set1, const T & set2) {
+template<typename T, typename U>
+inline bool are_compatible_des_id_sets(const T & set1, const U & set2) {
     if (set1.size() < 2 || set2.size() < 2) {
         return true;
     }
@@ -334,9 +343,9 @@ inline bool are_compatible_des_id_sets(const T & set1, const T & set2) {
 }
 
 
-template<typename T>
-inline bool have_intersection(const T & first, const T & second) {
-    return !are_disjoint<T>(first, second);
+template<typename T, typename U>
+inline bool have_intersection(const T & first, const U & second) {
+    return !are_disjoint(first, second);
 }
 
 template<typename T, typename U>
@@ -376,6 +385,36 @@ inline std::set<T> set_difference_as_set(const std::set<T> & fir, const std::set
     return d;
 }
 
+// The set operations above for OttIdFlatSets, or an OttIdFlatSet and an OttIdSet.  The result is
+//   an OttIdFlatSet if both arguments are, and an OttIdSet otherwise.
+template<typename T, typename U>
+using flat_set_op_result = std::enable_if_t<std::is_same<T, OttIdFlatSet>::value or std::is_same<U, OttIdFlatSet>::value,
+                                            std::conditional_t<std::is_same<T, U>::value, OttIdFlatSet, OttIdSet>>;
+template<typename T, typename U>
+inline flat_set_op_result<T, U> set_intersection_as_set(const T & fir, const U & sec) {
+    std::vector<OttId> d;
+    set_intersection(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return {d.begin(), d.end()};
+}
+template<typename T, typename U>
+inline flat_set_op_result<T, U> set_union_as_set(const T & fir, const U & sec) {
+    std::vector<OttId> d;
+    set_union(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return {d.begin(), d.end()};
+}
+template<typename T, typename U>
+inline flat_set_op_result<T, U> set_sym_difference_as_set(const T & fir, const U & sec) {
+    std::vector<OttId> d;
+    set_symmetric_difference(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return {d.begin(), d.end()};
+}
+template<typename T, typename U>
+inline flat_set_op_result<T, U> set_difference_as_set(const T & fir, const U & sec) {
+    std::vector<OttId> d;
+    set_difference(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return {d.begin(), d.end()};
+}
+
 inline std::size_t find_first_graph_index(const std::string & s) {
     std::size_t pos = 0U;
     for (const auto & c : s) {
@@ -475,16 +514,16 @@ inline void write_escaped_for_newick(std::ostream & out, const std::string & n)
 }
 
 
-template<typename T>
-inline T intersection_of_sets(const T & first, const T &sec) {
+template<typename T, typename U>
+inline T intersection_of_sets(const T & first, const U &sec) {
     T intersection;
     std::set_intersection(first.begin(), first.end(),
                           sec.begin(), sec.end(),
                           std::inserter(intersection, intersection.begin()));
     return intersection;
 }
-template<typename T>
-inline std::size_t size_of_symmetric_difference(const T & first, const T &sec) {
+template<typename T, typename U>
+inline std::size_t size_of_symmetric_difference(const T & first, const U &sec) {
     T diff;
     std::set_symmetric_difference(first.begin(), first.end(),
                                   sec.begin(), sec.end(),
@@ -0,0 +1,84 @@
+// Memory and traversal timings of a RootedTree and its CompactTree with 3M nodes.  Built only with
+//   -Dbenchmarks=true; test_otc_compact_tree.cpp has the checks.
+#include "otc/compact_tree.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <random>
+using namespace otc;
+
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+typedef Tree_t::node_type node_type;
+typedef CompactTree<unsigned> Compact_t;
+
+Compact_t freeze(const Tree_t & tree) {
+    return Compact_t(tree, [](const node_type * nd) {return nd->get_out_degree();});
+}
+
+// A tree with 2.3M named tips below 700k internal nodes, like the synth tree: the memory used by
+//   the RootedTree and by its CompactTree, and the time taken by traversals of each.
+char test_compact_tree_size_and_speed(const TestHarness &) {
+    const std::size_t num_tips = 2300000;
+    const std::size_t num_internals = 700000;
+    std::mt19937 rng(1);
+    Tree_t tree;
+    std::vector<node_type *> internals;
+    internals.push_back(tree.create_root());
+    while (internals.size() < num_internals) {
+        internals.push_back(tree.create_child(internals[rng() % internals.size()]));
+    }
+    std::size_t name_heap_bytes = 0;
+    for (std::size_t i = 0; i < num_tips; ++i) {
+        auto tip = tree.create_child(internals[rng() % internals.size()]);
+        tip->set_ott_id(static_cast<OttId>(i));
+        tip->set_name("Genus species_ott" + std::to_string(i));
+        // Names longer than the small-string buffer get a heap block.
+        if (tip->get_name().capacity() > std::string().capacity()) {
+            name_heap_bytes += tip->get_name().capacity() + 1;
+        }
+    }
+    const auto num_nodes = num_tips + num_internals;
+    const auto tree_bytes = num_nodes * sizeof(node_type) + name_heap_bytes;
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    const Compact_t compact = freeze(tree);
+    auto t1 = clock::now();
+    OttId tree_sum = 0, compact_sum = 0;
+    std::size_t tree_leaves = 0, compact_leaves = 0;
+    for (auto nd : iter_pre_const(tree)) {
+        tree_sum += nd->has_ott_id() ? 1 : 0;
+    }
+    for (auto nd : iter_post_const(tree)) {
+        tree_sum += nd->get_out_degree() == 1 ? 1 : 0;
+    }
+    for (auto nd : iter_leaf_const(tree)) {
+        tree_leaves += nd->get_name().size() > 0;
+    }
+    auto t2 = clock::now();
+    for (auto nd : iter_pre_const(compact)) {
+        compact_sum += nd->has_ott_id() ? 1 : 0;
+    }
+    for (auto nd : iter_post_const(compact)) {
+        compact_sum += nd->get_data() == 1 ? 1 : 0;
+    }
+    for (auto nd : iter_leaf_const(compact)) {
+        compact_leaves += nd->get_name().size() > 0;
+    }
+    auto t3 = clock::now();
+    using ms = std::chrono::duration<double, std::milli>;
+    std::cerr << num_nodes << " nodes: RootedTree ~" << tree_bytes / num_nodes << " bytes per node, CompactTree "
+              << compact.memory_used() / num_nodes << " bytes per node (built in " << ms(t1 - t0).count() << "ms)\n";
+    std::cerr << "  preorder + postorder + leaf traversals: RootedTree " << ms(t2 - t1).count() << "ms, CompactTree "
+              << ms(t3 - t2).count() << "ms\n";
+    if (tree_sum != compact_sum or tree_leaves != compact_leaves) {
+        std::cerr << "traversals gave different results\n";
+        return 'F';
+    }
+    return (2 * compact.memory_used() < tree_bytes) ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests = {TestFn{"compact tree size and speed", test_compact_tree_size_and_speed}};
+    return th.run_tests(tests);
+}
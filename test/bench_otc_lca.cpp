@@ -0,0 +1,161 @@
+// Timings of mrca_from_depth, LCAIndex and find_mrca_from_id_set on trees the size of the synth
+//   tree.  Built only with -Dbenchmarks=true; test_otc_lca.cpp has the checks.
+#include "otc/util.h"
+#include "otc/conflict.h"
+#include "otc/lca_index.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <numeric>
+#include <random>
+using namespace otc;
+
+// find_mrca_from_id_set as it was: copying the OTT id -> node map, and counting the designators
+//   below every ancestor of every designator.
+template<typename T>
+typename T::node_type * mrca_by_counting(T & tree, const OttIdSet & idSet) {
+    typedef typename T::node_type NT_t;
+    auto ott_id_to_node = tree.get_data().ott_id_to_node;
+    std::map<NT_t *, unsigned int> n2c;
+    long shortestPathLen = -1;
+    NT_t * shortestPathNode = nullptr;
+    for (const auto & i : idSet) {
+        auto nd = ott_id_to_node.at(i);
+        long currPathLen = 0;
+        for (auto a = nd; a != nullptr; a = a->get_parent()) {
+            n2c[a] += 1;
+            currPathLen += 1;
+        }
+        if (shortestPathLen < 0 || currPathLen < shortestPathLen) {
+            shortestPathLen = currPathLen;
+            shortestPathNode = nd;
+        }
+    }
+    auto cn = shortestPathNode;
+    while (n2c[cn] != idSet.size()) {
+        cn = cn->get_parent();
+    }
+    return cn;
+}
+
+// A deep tree: a long caterpillar spine with random subtrees hanging off it, like the synth tree.
+//   The time taken by mrca_from_depth and by LCAIndex for the same random pairs.
+char test_deep_tree(const TestHarness &) {
+    typedef ConflictTree::node_type node_type;
+    const std::size_t spine_length = 20000;
+    const std::size_t num_queries = 50000;
+    std::mt19937 rng(1);
+    ConflictTree tree;
+    std::vector<node_type *> nodes;
+    auto nd = tree.create_root();
+    nodes.push_back(nd);
+    for (std::size_t i = 0; i < spine_length; ++i) {
+        nodes.push_back(tree.create_child(nd));
+        nd = tree.create_child(nd);
+        nodes.push_back(nd);
+    }
+    for (std::size_t i = 0; i < 4 * spine_length; ++i) {
+        auto parent = nodes[rng() % nodes.size()];
+        nodes.push_back(tree.create_child(parent));
+    }
+    compute_depth(tree);
+    const LCAIndex<node_type> lca(tree.get_root());
+    std::vector<std::pair<node_type *, node_type *>> queries;
+    for (std::size_t i = 0; i < num_queries; ++i) {
+        queries.emplace_back(nodes[rng() % nodes.size()], nodes[rng() % nodes.size()]);
+    }
+    using clock = std::chrono::steady_clock;
+    std::vector<node_type *> by_depth, by_index;
+    auto t0 = clock::now();
+    for (const auto & q : queries) {
+        by_depth.push_back(mrca_from_depth(q.first, q.second));
+    }
+    auto t1 = clock::now();
+    for (const auto & q : queries) {
+        by_index.push_back(lca.mrca(q.first, q.second));
+    }
+    auto t2 = clock::now();
+    using ms = std::chrono::duration<double, std::milli>;
+    std::cerr << num_queries << " MRCA queries on " << nodes.size() << " nodes: mrca_from_depth "
+              << ms(t1 - t0).count() << "ms, LCAIndex " << ms(t2 - t1).count() << "ms\n";
+    return (by_depth == by_index) ? '.' : 'F';
+}
+
+// The MRCAs of 100k-id designator sets in a tree with the synth tree's 2.3M tips: with the old
+//   algorithm, with find_mrca_from_id_set, and with find_mrca_from_id_set and an LCAIndex.  Half of
+//   the sets are drawn from the tips below one node, so that their MRCA is not just the root.
+char test_mrca_of_id_sets(const TestHarness &) {
+    const std::size_t num_tips = 2300000;
+    const std::size_t num_internals = 700000;
+    const std::size_t spine_length = 200;
+    const std::size_t set_size = 100000;
+    const std::size_t num_sets = 4;
+    std::mt19937 rng(1);
+    TreeMappedWithSplits tree;
+    std::vector<NodeWithSplits *> internals;
+    auto nd = tree.create_root();
+    internals.push_back(nd);
+    for (std::size_t i = 0; i < spine_length; ++i) {
+        nd = tree.create_child(nd);
+        internals.push_back(nd);
+    }
+    while (internals.size() < num_internals) {
+        internals.push_back(tree.create_child(internals[spine_length + rng() % (internals.size() - spine_length)]));
+    }
+    std::vector<NodeWithSplits *> tips;
+    for (std::size_t i = 0; i < num_tips; ++i) {
+        auto tip = tree.create_child(internals[rng() % internals.size()]);
+        tip->set_ott_id(static_cast<OttId>(i));
+        tree.get_data().ott_id_to_node.set(tip->get_ott_id(), tip);
+        tips.push_back(tip);
+    }
+    std::vector<OttIdSet> id_sets;
+    for (std::size_t s = 0; s < num_sets; ++s) {
+        std::vector<OttId> pool;
+        if (s % 2 == 0) {
+            pool.resize(num_tips);
+            std::iota(pool.begin(), pool.end(), 0);
+        } else {
+            // The first nodes below the spine have many tips below them.
+            for (auto tip : iter_leaf_n(*internals[spine_length + s])) {
+                if (tip->has_ott_id()) {
+                    pool.push_back(tip->get_ott_id());
+                }
+            }
+        }
+        std::shuffle(pool.begin(), pool.end(), rng);
+        pool.resize(std::min(set_size, pool.size()));
+        id_sets.emplace_back(pool.begin(), pool.end());
+    }
+    using clock = std::chrono::steady_clock;
+    std::vector<NodeWithSplits *> by_counting, by_walking, by_index;
+    auto t0 = clock::now();
+    for (const auto & ids : id_sets) {
+        by_counting.push_back(mrca_by_counting(tree, ids));
+    }
+    auto t1 = clock::now();
+    for (const auto & ids : id_sets) {
+        by_walking.push_back(find_mrca_from_id_set(tree, ids, -1));
+    }
+    auto t2 = clock::now();
+    const LCAIndex<NodeWithSplits> lca(tree.get_root());
+    auto t3 = clock::now();
+    for (const auto & ids : id_sets) {
+        by_index.push_back(find_mrca_from_id_set(tree, ids, -1, lca));
+    }
+    auto t4 = clock::now();
+    using ms = std::chrono::duration<double, std::milli>;
+    std::cerr << num_sets << " sets of " << set_size << " ids, " << num_tips << " tips: counting "
+              << ms(t1 - t0).count() / num_sets << "ms per set, walking " << ms(t2 - t1).count() / num_sets
+              << "ms per set, LCAIndex " << ms(t4 - t3).count() / num_sets << "ms per set (after "
+              << ms(t3 - t2).count() << "ms to build it)\n";
+    return (by_counting == by_walking and by_counting == by_index) ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"deep tree", test_deep_tree});
+    tests.push_back(TestFn{"MRCA of id sets", test_mrca_of_id_sets});
+    return th.run_tests(tests);
+}
@@ -0,0 +1,47 @@
+// Timing of NewickTokenizer on a tree with as many labels as the synth tree has tips.  Built only
+//   with -Dbenchmarks=true; test_otc_newicktoken.cpp has the checks.
+#include "otc/newick.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <sstream>
+using namespace otc;
+
+void write_caterpillar_newick(std::ostream & out, std::size_t num_tips) {
+    for (std::size_t i = 1; i < num_tips; ++i) {
+        out << '(';
+    }
+    out << "Genus_species_ott0";
+    for (std::size_t i = 1; i < num_tips; ++i) {
+        out << ",Genus_species_ott" << i << ")anc_ott" << (num_tips + i) << ':' << i % 7;
+    }
+    out << ";\n";
+}
+
+// Times the tokenizing of a newick string with 1M labels that are as long as synth tree tip labels.
+char testLongTreeTokenTimes(const TestHarness &) {
+    const std::size_t num_tips = 1000000;
+    std::ostringstream out;
+    write_caterpillar_newick(out, num_tips);
+    const std::string content = out.str();
+    std::istringstream inp(content);
+    FilePosStruct pos;
+    NewickTokenizer tokenizer(inp, pos);
+    std::size_t num_labels = 0, num_tokens = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto & token : tokenizer) {
+        ++num_tokens;
+        if (token.state == NewickTokenizer::NWK_LABEL and token.content().compare(0, 14, "Genus species ") == 0) {
+            ++num_labels;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    const std::chrono::duration<double, std::milli> ms = t1 - t0;
+    std::cerr << num_tokens << " tokens in " << content.size() / 1000000.0 << "MB: " << ms.count() << "ms\n";
+    return (num_labels == num_tips and num_tokens == 7 * (num_tips - 1) + 2) ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn("testLongTreeTokenTimes", testLongTreeTokenTimes)};
+    return th.run_tests(tests);
+}
@@ -0,0 +1,73 @@
+// Timings of the heap and arena node layouts on a tree with 500k nodes.  Built only with
+//   -Dbenchmarks=true; test_otc_node_arena.cpp has the checks.
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <random>
+using namespace otc;
+
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+
+std::unique_ptr<Tree_t> parse(const std::string & newick, bool use_node_arena) {
+    ParsingRules pr;
+    pr.set_ott_ids = false;
+    pr.use_node_arena = use_node_arena;
+    return tree_from_newick_string<Tree_t>(newick, pr);
+}
+
+// Newick for a random tree with num_nodes named nodes.
+std::string random_newick(std::size_t num_nodes) {
+    std::mt19937 rng(1);
+    Tree_t tree;
+    std::vector<Tree_t::node_type *> nodes;
+    nodes.push_back(tree.create_root());
+    while (nodes.size() < num_nodes) {
+        auto parent = nodes[rng() % nodes.size()];
+        auto nd = tree.create_child(parent);
+        nd->set_name("n" + std::to_string(nodes.size()));
+        nodes.push_back(nd);
+    }
+    return newick_string(tree);
+}
+
+// Reports parse, preorder traversal and teardown times for each layout.
+char test_arena_timing(const TestHarness &) {
+    const auto newick = random_newick(500000);
+    using clock = std::chrono::steady_clock;
+    using ms = std::chrono::duration<double, std::milli>;
+    std::string expected;
+    for (bool use_node_arena : {false, true}) {
+        auto t0 = clock::now();
+        auto tree = parse(newick, use_node_arena);
+        auto t1 = clock::now();
+        std::size_t n = 0;
+        for (int i = 0; i < 10; i++) {
+            for (auto nd : iter_pre_const(*tree)) {
+                n += nd->get_name().size();
+            }
+        }
+        auto t2 = clock::now();
+        auto written = newick_string(*tree);
+        auto t3 = clock::now();
+        tree.reset();
+        auto t4 = clock::now();
+        std::cerr << (use_node_arena ? "arena" : "heap ") << " layout: parse " << ms(t1 - t0).count()
+                  << "ms, 10 preorder traversals " << ms(t2 - t1).count()
+                  << "ms, teardown " << ms(t4 - t3).count() << "ms (" << n << ")\n";
+        if (expected.empty()) {
+            expected = written;
+        } else if (expected != written) {
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"arena timing", test_arena_timing});
+    return th.run_tests(tests);
+}
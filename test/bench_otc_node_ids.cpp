@@ -0,0 +1,91 @@
+// Timings of node id parsing and OTT id lookups on ids as dense as the synth tree's.  Built only
+//   with -Dbenchmarks=true; test_otc_node_ids.cpp has the checks.
+#include "otc/node_naming.h"
+#include "otc/ott_id_index.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <random>
+#include <regex>
+#include <unordered_map>
+using namespace otc;
+
+// The patterns that the web services used to match node ids with.
+const std::regex mrca_id_pattern("^mrca(ott\\d+)(ott\\d+)$");
+const std::regex ott_id_pattern("^ott(\\d+)$");
+
+// Resolves the 10,000 ids of a big induced_subtree request (a quarter of them MRCA ids), as
+//   find_node_by_id_str did and as it does now: with the regexes and an unordered_map, and with the
+//   parsers and an OttIdIndex.  About 2M tree ids are spread over 0..8M, like the synth tree's.
+char test_node_id_lookup_times(const TestHarness &) {
+    const std::size_t num_tree_ids = 2300000;
+    const OttId max_ott_id = 8000000;
+    const std::size_t num_queries = 10000;
+    const int repeats = 20;
+    std::mt19937 rng(1);
+    std::vector<int> nodes(num_tree_ids);
+    std::vector<OttId> tree_ids;
+    std::unordered_map<OttId, const int *> id_to_node;
+    OttIdIndex<const int *> index;
+    index.reserve_ids(max_ott_id - 1);
+    for (std::size_t i = 0; i < num_tree_ids; ++i) {
+        OttId id = static_cast<OttId>(rng() % max_ott_id);
+        if (id_to_node.emplace(id, &nodes[i]).second) {
+            index.set(id, &nodes[i]);
+            tree_ids.push_back(id);
+        }
+    }
+    std::vector<std::string> queries;
+    for (std::size_t i = 0; i < num_queries; ++i) {
+        auto id = tree_ids[rng() % tree_ids.size()];
+        if (i % 4 == 0) {
+            queries.push_back(make_mrca_name(id, tree_ids[rng() % tree_ids.size()]));
+        } else {
+            queries.push_back("ott" + std::to_string(id));
+        }
+    }
+    using clock = std::chrono::steady_clock;
+    std::size_t regex_found = 0, parsed_found = 0;
+    auto t0 = clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto & q : queries) {
+            std::smatch matches;
+            if (std::regex_match(q, matches, ott_id_pattern)) {
+                regex_found += id_to_node.count(check_ott_id_size(std::stol(matches[1])));
+            } else if (std::regex_match(q, matches, mrca_id_pattern)) {
+                regex_found += id_to_node.count(check_ott_id_size(std::stol(matches[1].str().substr(3))));
+                regex_found += id_to_node.count(check_ott_id_size(std::stol(matches[2].str().substr(3))));
+            }
+        }
+    }
+    auto t1 = clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto & q : queries) {
+            long raw_ott_id;
+            std::string_view first_id, second_id;
+            if (parse_ott_node_id(q, raw_ott_id)) {
+                parsed_found += index.count(check_ott_id_size(raw_ott_id));
+            } else if (parse_mrca_node_id(q, first_id, second_id)) {
+                parse_ott_node_id(first_id, raw_ott_id);
+                parsed_found += index.count(check_ott_id_size(raw_ott_id));
+                parse_ott_node_id(second_id, raw_ott_id);
+                parsed_found += index.count(check_ott_id_size(raw_ott_id));
+            }
+        }
+    }
+    auto t2 = clock::now();
+    using ns = std::chrono::duration<double, std::nano>;
+    const double lookups = double(num_queries) * repeats;
+    std::cerr << num_queries << " node ids, " << tree_ids.size() << " ids in the tree: regex + unordered_map "
+              << ns(t1 - t0).count() / lookups << "ns per id, parser + OttIdIndex " << ns(t2 - t1).count() / lookups
+              << "ns per id\n";
+    std::cerr << "  memory: unordered_map ~" << (id_to_node.bucket_count() * sizeof(void *) + id_to_node.size() * (sizeof(std::pair<OttId, const int *>) + sizeof(void *))) / (1 << 20)
+              << "MB, OttIdIndex " << index.memory_used() / (1 << 20) << "MB\n";
+    return (regex_found == parsed_found and regex_found == num_queries * repeats * 5 / 4) ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"node id lookup times", test_node_id_lookup_times});
+    return th.run_tests(tests);
+}
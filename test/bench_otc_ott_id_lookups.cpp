@@ -0,0 +1,208 @@
+// Timings of OTT id -> node lookups with the synth tree's id density, against the std::map and
+//   unordered_maps that were used before OttIdIndex.  Built only with -Dbenchmarks=true;
+//   test_otc_ott_id_lookups.cpp has the checks.
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/tree_operations.h"
+#include "otc/induced_tree.h"
+#include "otc/ott_id_index.h"
+#include "otc/test_harness.h"
+#include <chrono>
+#include <map>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+using namespace otc;
+
+typedef TreeMappedWithSplits Tree_t;
+typedef Tree_t::node_type node_type;
+using clock_type = std::chrono::steady_clock;
+using ns = std::chrono::duration<double, std::nano>;
+
+// About 2.3M OTT ids spread over 0..8M, like the synth tree's.
+const std::size_t num_tree_ids = 2300000;
+const OttId max_ott_id = 8000000;
+
+std::vector<OttId> random_distinct_ids(std::size_t n, OttId max_id, std::mt19937 & rng) {
+    OttIdSet seen;
+    std::vector<OttId> ids;
+    while (ids.size() < n) {
+        OttId id = static_cast<OttId>(rng() % max_id);
+        if (seen.insert(id).second) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+// A balanced newick tree with tips labelled by ids[first..last).
+void write_balanced_newick(std::ostream & out, const std::vector<OttId> & ids, std::size_t first, std::size_t last) {
+    if (last - first == 1) {
+        out << "ott" << ids[first];
+        return;
+    }
+    const auto mid = first + (last - first) / 2;
+    out << '(';
+    write_balanced_newick(out, ids, first, mid);
+    out << ',';
+    write_balanced_newick(out, ids, mid, last);
+    out << ')';
+}
+
+std::unique_ptr<Tree_t> balanced_tree(const std::vector<OttId> & ids, const OttIdSet * validator) {
+    std::ostringstream out;
+    write_balanced_newick(out, ids, 0, ids.size());
+    out << ';';
+    ParsingRules rules;
+    rules.ott_id_validator = validator;
+    return tree_from_newick_string<Tree_t>(out.str(), rules);
+}
+
+// The parser checks each tip id against ott_id_to_node, and then sets it.  Times that pattern of
+//   lookups and inserts with the old std::map and with OttIdIndex, and then the whole parse.
+char test_parse_id_map_times(const TestHarness &) {
+    const std::size_t num_tips = 200000;
+    std::mt19937 rng(1);
+    const auto ids = random_distinct_ids(num_tips, max_ott_id, rng);
+    std::vector<int> nodes(num_tips);
+    auto t0 = clock_type::now();
+    std::map<OttId, const int *> id_map;
+    for (std::size_t i = 0; i < num_tips; ++i) {
+        if (not contains(id_map, ids[i])) {
+            id_map[ids[i]] = &nodes[i];
+        }
+    }
+    auto t1 = clock_type::now();
+    OttIdIndex<const int *> index;
+    for (std::size_t i = 0; i < num_tips; ++i) {
+        if (not contains(index, ids[i])) {
+            index.set(ids[i], &nodes[i]);
+        }
+    }
+    auto t2 = clock_type::now();
+    const OttIdSet validator(ids.begin(), ids.end());
+    auto tree = balanced_tree(ids, &validator);
+    auto t3 = clock_type::now();
+    std::cerr << num_tips << " tip ids: std::map " << ns(t1 - t0).count() / num_tips << "ns per id, OttIdIndex "
+              << ns(t2 - t1).count() / num_tips << "ns per id; whole parse " << ns(t3 - t2).count() / 1e6 << "ms\n";
+    for (auto id : ids) {
+        auto nd = tree->get_data().get_node_by_ott_id(id);
+        if (nd == nullptr or nd->get_ott_id() != id) {
+            std::cerr << "ott" << id << " was not mapped to its node\n";
+            return 'F';
+        }
+    }
+    return (id_map.size() == index.size() and index.size() == tree->get_data().ott_id_to_node.size()) ? '.' : 'F';
+}
+
+// Conflict analysis maps the leaves of each input tree onto the summary tree (get_induced_leaves).
+//   Times that for 200 input trees of 1000 tips against a summary tree with the synth tree's id
+//   density, with the unordered_maps that were used before and with OttIdIndex.
+char test_leaf_mapping_times(const TestHarness &) {
+    const std::size_t num_input_trees = 200;
+    const std::size_t tips_per_tree = 1000;
+    std::mt19937 rng(1);
+    const auto summary_ids = random_distinct_ids(num_tree_ids, max_ott_id, rng);
+    std::vector<int> summary_nodes(summary_ids.size());
+    std::unordered_map<OttId, const int *> summary_map;
+    OttIdIndex<const int *> summary_index;
+    for (std::size_t i = 0; i < summary_ids.size(); ++i) {
+        summary_map[summary_ids[i]] = &summary_nodes[i];
+        summary_index.set(summary_ids[i], &summary_nodes[i]);
+    }
+    // Most tips of an input tree are in the summary tree.
+    std::vector<std::unique_ptr<Tree_t>> input_trees;
+    for (std::size_t t = 0; t < num_input_trees; ++t) {
+        std::vector<OttId> tip_ids;
+        OttIdSet seen;
+        while (tip_ids.size() < tips_per_tree) {
+            OttId id = (rng() % 10 == 0) ? static_cast<OttId>(rng() % max_ott_id) : summary_ids[rng() % summary_ids.size()];
+            if (seen.insert(id).second) {
+                tip_ids.push_back(id);
+            }
+        }
+        input_trees.push_back(balanced_tree(tip_ids, nullptr));
+    }
+    std::size_t old_found = 0, new_found = 0;
+    auto t0 = clock_type::now();
+    for (const auto & tree : input_trees) {
+        std::unordered_map<OttId, const node_type *> nodes;
+        for (auto nd : iter_pre_const(*tree)) {
+            if (nd->has_ott_id()) {
+                nodes[nd->get_ott_id()] = nd;
+            }
+        }
+        for (auto leaf : iter_leaf_const(*tree)) {
+            old_found += (summary_map.find(leaf->get_ott_id()) != summary_map.end() and nodes.count(leaf->get_ott_id()));
+        }
+    }
+    auto t1 = clock_type::now();
+    for (const auto & tree : input_trees) {
+        auto nodes = get_ottid_to_const_node_map(*tree);
+        for (auto leaf : iter_leaf_const(*tree)) {
+            new_found += (summary_index.find(leaf->get_ott_id()) != summary_index.end() and nodes.count(leaf->get_ott_id()));
+        }
+    }
+    auto t2 = clock_type::now();
+    const double num_leaves = double(num_input_trees) * tips_per_tree;
+    std::cerr << num_input_trees << " input trees: unordered_map " << ns(t1 - t0).count() / num_leaves
+              << "ns per leaf, OttIdIndex " << ns(t2 - t1).count() / num_leaves << "ns per leaf\n";
+    // And the real mapping, between two parsed trees.
+    auto nodes1 = get_ottid_to_const_node_map(*input_trees[0]);
+    auto nodes2 = get_ottid_to_const_node_map(*input_trees[1]);
+    auto leaves = get_induced_leaves(*input_trees[0], nodes1, *input_trees[1], nodes2);
+    for (auto leaf : leaves) {
+        if (not contains(nodes2, leaf->get_ott_id())) {
+            std::cerr << "induced leaf ott" << leaf->get_ott_id() << " is not in the other tree\n";
+            return 'F';
+        }
+    }
+    return (old_found == new_found) ? '.' : 'F';
+}
+
+// included_taxon_from_id looks an id up in the taxonomy's id_to_node, and only falls back to the
+//   forwarding table if it is missing.  Times 1M lookups, 5% of them misses, with the unordered_map
+//   that was used before and with OttIdIndex.
+char test_taxon_lookup_times(const TestHarness &) {
+    const std::size_t num_queries = 1000000;
+    std::mt19937 rng(2);
+    const auto taxon_ids = random_distinct_ids(num_tree_ids, max_ott_id, rng);
+    std::vector<int> taxa(taxon_ids.size());
+    std::unordered_map<OttId, const int *> id_to_node;
+    OttIdIndex<const int *> index;
+    for (std::size_t i = 0; i < taxon_ids.size(); ++i) {
+        id_to_node.emplace(taxon_ids[i], &taxa[i]);
+        index.set(taxon_ids[i], &taxa[i]);
+    }
+    std::vector<OttId> queries;
+    for (std::size_t i = 0; i < num_queries; ++i) {
+        queries.push_back((i % 20 == 0) ? static_cast<OttId>(rng() % max_ott_id) : taxon_ids[rng() % taxon_ids.size()]);
+    }
+    std::size_t map_found = 0, index_found = 0;
+    auto t0 = clock_type::now();
+    for (auto id : queries) {
+        auto it = id_to_node.find(id);
+        if (it != id_to_node.end() and it->second != nullptr) {
+            ++map_found;
+        }
+    }
+    auto t1 = clock_type::now();
+    for (auto id : queries) {
+        if (index.lookup(id)) {
+            ++index_found;
+        }
+    }
+    auto t2 = clock_type::now();
+    std::cerr << num_queries << " taxon lookups: unordered_map " << ns(t1 - t0).count() / num_queries
+              << "ns per id, OttIdIndex " << ns(t2 - t1).count() / num_queries << "ns per id\n";
+    return (map_found == index_found) ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"parse id map times", test_parse_id_map_times});
+    tests.push_back(TestFn{"leaf mapping times", test_leaf_mapping_times});
+    tests.push_back(TestFn{"taxon lookup times", test_taxon_lookup_times});
+    return th.run_tests(tests);
+}
@@ -0,0 +1,197 @@
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/compact_tree.h"
+#include "otc/supertree_util.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+#include <sstream>
+#include <random>
+using namespace otc;
+
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+typedef Tree_t::node_type node_type;
+// The data column holds the out-degree of each node, so that it can be checked.
+typedef CompactTree<unsigned> Compact_t;
+
+Compact_t freeze(const Tree_t & tree) {
+    return Compact_t(tree, [](const node_type * nd) {return nd->get_out_degree();});
+}
+
+// Positions of the nodes visited by a traversal of the compact tree, as nodes of the original tree.
+template<typename R>
+std::vector<const node_type *> as_nodes(const R & range, const std::vector<const node_type *> & preorder) {
+    std::vector<const node_type *> r;
+    for (auto nd : range) {
+        r.push_back(preorder.at(nd->get_position()));
+    }
+    return r;
+}
+
+template<typename R>
+std::vector<const node_type *> as_vector(const R & range) {
+    std::vector<const node_type *> r;
+    for (auto nd : range) {
+        r.push_back(nd);
+    }
+    return r;
+}
+
+// Names a node of either kind of tree by its name.
+struct NameNamer {
+    template<typename N>
+    std::string operator()(const N & nd) const {
+        return std::string(nd->get_name());
+    }
+};
+
+// Every traversal of the compact tree visits the nodes in the order the RootedTree iterators do,
+//   and the nodes have the same names, ids and shape.
+char check_compact_tree(const Tree_t & tree) {
+    const auto compact = freeze(tree);
+    const auto preorder = as_vector(iter_pre_const(tree));
+    if (compact.size() != preorder.size()) {
+        std::cerr << "compact tree has " << compact.size() << " nodes, but the tree has " << preorder.size() << '\n';
+        return 'F';
+    }
+    if (as_nodes(iter_pre_const(compact), preorder) != preorder
+        or as_nodes(iter_post_const(compact), preorder) != as_vector(iter_post_const(tree))
+        or as_nodes(iter_leaf_const(compact), preorder) != as_vector(iter_leaf_const(tree))) {
+        std::cerr << "whole tree traversals differ\n";
+        return 'F';
+    }
+    for (auto cnd : iter_pre_const(compact)) {
+        const auto nd = preorder[cnd->get_position()];
+        if (cnd->get_name() != nd->get_name()
+            or cnd->has_ott_id() != nd->has_ott_id()
+            or (nd->has_ott_id() and cnd->get_ott_id() != nd->get_ott_id())
+            or cnd->is_tip() != nd->is_tip()
+            or cnd->get_out_degree() != nd->get_out_degree()
+            or cnd->get_data() != nd->get_out_degree()
+            or cnd->is_outdegree_one_node() != nd->is_outdegree_one_node()
+            or (nd->get_parent() == nullptr) != (cnd->get_parent() == nullptr)
+            or (nd->is_internal() and preorder[cnd->get_last_child()->get_position()] != nd->get_last_child())) {
+            std::cerr << "node " << cnd->get_position() << " (" << nd->get_name() << ") differs\n";
+            return 'F';
+        }
+        // preorder_iterator does not stop after a tip that it starts at, so only a tip's own
+        //   subtree is compared for tips.
+        const auto pre_n = nd->is_tip() ? std::vector<const node_type *>{nd} : as_vector(iter_pre_n_const(nd));
+        if (as_nodes(iter_pre_n_const(cnd), preorder) != pre_n
+            or as_nodes(iter_post_n_const(cnd), preorder) != as_vector(iter_post_n_const(*nd))
+            or as_nodes(iter_leaf_n_const(cnd), preorder) != as_vector(iter_leaf_n_const(*nd))
+            or as_nodes(iter_child_const(cnd), preorder) != as_vector(iter_child_const(*nd))
+            or as_nodes(iter_anc_const(cnd), preorder) != as_vector(iter_anc_const(*nd))) {
+            std::cerr << "traversals from node " << cnd->get_position() << " (" << nd->get_name() << ") differ\n";
+            return 'F';
+        }
+        if (nd->is_internal() and get_mrca_ott_id_pair(cnd) != get_mrca_ott_id_pair(nd)) {
+            std::cerr << "get_mrca_ott_id_pair differs for node " << cnd->get_position() << '\n';
+            return 'F';
+        }
+    }
+    // The Newick writers of the web services.
+    for (long height_limit : {-1L, 2L}) {
+        NameNamer tree_namer, compact_namer;
+        std::ostringstream tree_newick, compact_newick, incremental_newick;
+        write_newick_generic<const node_type *, NameNamer>(tree_newick, tree.get_root(), tree_namer, true, height_limit);
+        write_newick_generic<Compact_t::node_type, NameNamer>(compact_newick, compact.get_root(), compact_namer, true, height_limit);
+        NameNamer incremental_namer;
+        IncrementalNewickWriter<Compact_t::node_type, NameNamer> writer(compact.get_root(), incremental_namer, true, height_limit);
+        while (writer.write_some(incremental_newick, 10)) {
+        }
+        if (compact_newick.str() != tree_newick.str() or incremental_newick.str() != tree_newick.str()) {
+            std::cerr << "Newick differs: " << tree_newick.str() << " != " << compact_newick.str() << '\n';
+            return 'F';
+        }
+    }
+    // Generic code that only uses the iterators and node accessors.
+    if (count_leaves(compact) != count_leaves(tree) or n_nodes(compact) != n_nodes(tree)) {
+        std::cerr << "count_leaves or n_nodes differ\n";
+        return 'F';
+    }
+    return '.';
+}
+
+class TestCompactTreeOnTreeFile {
+        const std::string filename;
+    public:
+        TestCompactTreeOnTreeFile(const std::string & fn)
+            :filename(fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            auto fp = h.get_filepath(filename);
+            std::ifstream inp;
+            if (!open_utf8_file(fp, inp)) {
+                return 'U';
+            }
+            ConstStrPtr filenamePtr = ConstStrPtr(new std::string(filename));
+            FilePosStruct pos(filenamePtr);
+            ParsingRules pr;
+            pr.require_ott_ids = false;
+            for (;;) {
+                auto nt = read_next_newick<Tree_t>(inp, pos, pr);
+                if (nt == nullptr) {
+                    return '.';
+                }
+                auto r = check_compact_tree(*nt);
+                if (r != '.') {
+                    return r;
+                }
+            }
+        }
+};
+
+// A random tree with named tips, about as bushy as the synth tree: the CompactTree must take less
+//   than half of the memory of the RootedTree, counting the heap blocks of the names.
+char test_compact_tree_memory(const TestHarness &) {
+    const std::size_t num_tips = 23000;
+    const std::size_t num_internals = 7000;
+    std::mt19937 rng(1);
+    Tree_t tree;
+    std::vector<node_type *> internals;
+    internals.push_back(tree.create_root());
+    while (internals.size() < num_internals) {
+        internals.push_back(tree.create_child(internals[rng() % internals.size()]));
+    }
+    std::size_t name_heap_bytes = 0;
+    for (std::size_t i = 0; i < num_tips; ++i) {
+        auto tip = tree.create_child(internals[rng() % internals.size()]);
+        tip->set_ott_id(static_cast<OttId>(i));
+        tip->set_name("Genus species_ott" + std::to_string(i));
+        // Names longer than the small-string buffer get a heap block.
+        if (tip->get_name().capacity() > std::string().capacity()) {
+            name_heap_bytes += tip->get_name().capacity() + 1;
+        }
+    }
+    const auto tree_bytes = (num_tips + num_internals) * sizeof(node_type) + name_heap_bytes;
+    const Compact_t compact = freeze(tree);
+    if (check_compact_tree(tree) != '.') {
+        return 'F';
+    }
+    if (2 * compact.memory_used() >= tree_bytes) {
+        std::cerr << "CompactTree uses " << compact.memory_used() << " bytes, RootedTree " << tree_bytes << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> filenames = {"3genus-synth.tre",
+                                          "3genus-taxonomy.tre",
+                                          "3genus-AnotmonophyleticCandB.tre",
+                                          "AtoG-ABCEvDFG.tre",
+                                          "AtoG-taxonomy-forkingmono.tre",
+                                          "is_synth.tre",
+                                          "spermatophyta_taxonomy.tre"};
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    for (auto fn : filenames) {
+        const TestCompactTreeOnTreeFile tctotf{fn};
+        TestCallBack tcb = [tctotf](const TestHarness &h) {
+            return tctotf.runTest(h);
+        };
+        tests.push_back(TestFn{fn, tcb});
+    }
+    tests.push_back(TestFn{"compact tree memory", test_compact_tree_memory});
+    return th.run_tests(tests);
+}
@@ -39,10 +39,10 @@ class TestValidTreeStruct {
             OttIdSet ids;
             for (const auto & tp : tv) {
                 const Tree_t & tree = *tp;
-                const OttIdSet & td = tree.get_root()->get_data().des_ids;
+                const auto & td = tree.get_root()->get_data().des_ids;
                 for (auto oid : td) {
                     if (!contains(ids, oid)) {
-                        fsd[oid] = fakeScaffold.create_child(r);
+                        fsd.set(oid, fakeScaffold.create_child(r));
                         ids.insert(oid);
                     }
                 }
@@ -59,7 +59,7 @@ class TestValidTreeStruct {
             OttId groupInd = 0;
             for (const auto & tp : tv) {
                 const Tree_t & tree = *tp;
-                const OttIdSet * incGroup = nullptr;
+                const DesIdSet * incGroup = nullptr;
                 for (auto nd : iter_child(*tree.get_root())) {
                     if (!nd->is_tip()) {
                         if (incGroup != nullptr) {
@@ -71,9 +71,9 @@ class TestValidTreeStruct {
                 if (incGroup == nullptr) {
                     return 'F';
                 }
-                const OttIdSet & leaf_set = tree.get_root()->get_data().des_ids;
+                const auto & leaf_set = tree.get_root()->get_data().des_ids;
                 std::cerr << groupInd + 1 << '\n';
-                gpf.attempt_to_add_grouping(*incGroup, leaf_set, treeInd, groupInd++, nullptr);
+                gpf.attempt_to_add_grouping(as_ott_id_set(*incGroup), as_ott_id_set(leaf_set), treeInd, groupInd++, nullptr);
             }
             NodeEmbeddingWithSplits emptyEmbedding(r);
             gpf.finish_resolution_of_embedded_clade(*r, &emptyEmbedding, &sc);
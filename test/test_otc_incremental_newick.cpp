@@ -0,0 +1,83 @@
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+using namespace otc;
+
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+
+// Names nodes by name and remembers the order in which it was asked.
+struct RecordingNamer {
+    std::vector<std::string> calls;
+    std::string operator()(const Tree_t::node_type * nd) {
+        calls.push_back(nd->get_name());
+        return nd->get_name();
+    }
+};
+
+// Any number of nodes per call should give the Newick, and the namer calls, of write_newick_generic.
+class TestIncrementalNewick {
+        const std::string filename;
+    public:
+        TestIncrementalNewick(const std::string & fn)
+            :filename(fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            auto fp = h.get_filepath(filename);
+            std::ifstream inp;
+            if (!open_utf8_file(fp, inp)) {
+                return 'U';
+            }
+            ParsingRules pr;
+            pr.set_ott_ids = false;
+            ConstStrPtr filenamePtr = ConstStrPtr(new std::string(filename));
+            FilePosStruct pos(filenamePtr);
+            for (;;) {
+                auto tree = read_next_newick<Tree_t>(inp, pos, pr);
+                if (tree == nullptr) {
+                    break;
+                }
+                for (long height_limit : {-1L, 0L, 1L, 2L, 5L}) {
+                    for (bool all_node_labels : {false, true}) {
+                        RecordingNamer expected_namer;
+                        std::ostringstream expected;
+                        write_newick_generic<const Tree_t::node_type *, RecordingNamer>(expected, tree->get_root(), expected_namer, all_node_labels, height_limit);
+                        for (std::size_t max_nodes : {1, 3, 1000}) {
+                            RecordingNamer namer;
+                            IncrementalNewickWriter<const Tree_t::node_type *, RecordingNamer> writer(tree->get_root(), namer, all_node_labels, height_limit);
+                            std::ostringstream obtained;
+                            std::size_t num_calls = 1;
+                            while (writer.write_some(obtained, max_nodes)) {
+                                num_calls++;
+                            }
+                            if (writer.write_some(obtained, max_nodes)) {
+                                return 'F';
+                            }
+                            if (obtained.str() != expected.str() or namer.calls != expected_namer.calls) {
+                                std::cerr << expected.str() << " != " << obtained.str() << '\n';
+                                return 'F';
+                            }
+                            if (max_nodes == 1 and num_calls != namer.calls.size()) {
+                                return 'F';
+                            }
+                        }
+                    }
+                }
+            }
+            return '.';
+        }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> filenames = {"3genus-synth.tre", "3genus-taxonomy.tre", "AtoG-taxonomy-forkingmono.tre"};
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    for (auto fn : filenames) {
+        const TestIncrementalNewick tin{fn};
+        TestCallBack tcb = [tin](const TestHarness &h) {
+            return tin.runTest(h);
+        };
+        tests.push_back(TestFn{fn, tcb});
+    }
+    return th.run_tests(tests);
+}
@@ -0,0 +1,178 @@
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/conflict.h"
+#include "otc/lca_index.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+#include <random>
+using namespace otc;
+
+typedef ConflictTree Tree_t;
+typedef Tree_t::node_type node_type;
+
+// Compare LCAIndex against mrca_from_depth for every pair of nodes, and for the group of all leaves.
+char check_all_pairs(const Tree_t & tree) {
+    const LCAIndex<const node_type> lca(tree.get_root());
+    std::vector<const node_type *> nodes;
+    for (auto nd : iter_pre_const(tree)) {
+        nodes.push_back(nd);
+    }
+    if (lca.size() != nodes.size()) {
+        std::cerr << "index has " << lca.size() << " nodes, but the tree has " << nodes.size() << '\n';
+        return 'F';
+    }
+    for (auto n1 : nodes) {
+        for (auto n2 : nodes) {
+            if (lca.mrca(n1, n2) != mrca_from_depth(n1, n2)) {
+                std::cerr << "MRCA of " << n1->get_name() << " and " << n2->get_name() << " differs\n";
+                return 'F';
+            }
+        }
+    }
+    std::vector<const node_type *> leaves;
+    for (auto nd : iter_leaf_const(tree)) {
+        leaves.push_back(nd);
+    }
+    std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
+    if (lca.mrca_of_group(leaves) != MRCA_of_group(leaves, mrca_of_pair)) {
+        std::cerr << "MRCA of all leaves differs\n";
+        return 'F';
+    }
+    return '.';
+}
+
+class TestLCAOnTreeFile {
+        const std::string filename;
+    public:
+        TestLCAOnTreeFile(const std::string & fn)
+            :filename(fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            auto fp = h.get_filepath(filename);
+            std::ifstream inp;
+            if (!open_utf8_file(fp, inp)) {
+                return 'U';
+            }
+            ConstStrPtr filenamePtr = ConstStrPtr(new std::string(filename));
+            FilePosStruct pos(filenamePtr);
+            ParsingRules pr;
+            pr.set_ott_ids = false;
+            for (;;) {
+                auto nt = read_next_newick<Tree_t>(inp, pos, pr);
+                if (nt == nullptr) {
+                    return '.';
+                }
+                compute_depth(*nt);
+                auto r = check_all_pairs(*nt);
+                if (r != '.') {
+                    return r;
+                }
+            }
+        }
+};
+
+// A deep tree: a long caterpillar spine with random subtrees hanging off it, like the synth tree.
+//   Checks random pairs against mrca_from_depth.  bench_otc_lca.cpp times the two.
+char test_deep_tree(const TestHarness &) {
+    const std::size_t spine_length = 5000;
+    const std::size_t num_queries = 20000;
+    std::mt19937 rng(1);
+    Tree_t tree;
+    std::vector<node_type *> nodes;
+    auto nd = tree.create_root();
+    nodes.push_back(nd);
+    for (std::size_t i = 0; i < spine_length; ++i) {
+        nodes.push_back(tree.create_child(nd));
+        nd = tree.create_child(nd);
+        nodes.push_back(nd);
+    }
+    for (std::size_t i = 0; i < 4 * spine_length; ++i) {
+        auto parent = nodes[rng() % nodes.size()];
+        nodes.push_back(tree.create_child(parent));
+    }
+    compute_depth(tree);
+    const LCAIndex<node_type> lca(tree.get_root());
+    for (std::size_t i = 0; i < num_queries; ++i) {
+        auto a = nodes[rng() % nodes.size()];
+        auto b = nodes[rng() % nodes.size()];
+        if (lca.mrca(a, b) != mrca_from_depth(a, b)) {
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+// find_mrca_from_id_set, with and without an LCAIndex, on a tree whose MRCAs can be read off the
+//   newick string.
+char test_mrca_of_id_sets(const TestHarness &) {
+    const std::string newick = "(((a_ott1,b_ott2)ab_ott10,c_ott3)abc_ott11,((d_ott4,e_ott5)de_ott12,(f_ott6,(g_ott7,h_ott8)gh_ott13)fgh_ott14)dtoh_ott15)root_ott16;";
+    auto tree = tree_from_newick_string<TreeMappedWithSplits>(newick, ParsingRules());
+    const LCAIndex<NodeWithSplits> lca(tree->get_root());
+    const std::vector<std::pair<OttIdSet, OttId>> expected = {
+        {{1, 2}, 10},
+        {{2, 3}, 11},
+        {{1, 2, 3}, 11},
+        {{1, 4}, 16},
+        {{3, 8}, 16},
+        {{4, 5}, 12},
+        {{4, 7}, 15},
+        {{6, 8}, 14},
+        {{7, 8}, 13},
+        {{5, 6, 7}, 15},
+        {{1, 2, 3, 4, 5, 6, 7, 8}, 16},
+        {{6}, 6},
+        {{10, 3}, 11},
+        {{12, 8}, 15},
+        {{13, 7}, 13},
+    };
+    for (const auto & e : expected) {
+        auto by_walking = find_mrca_from_id_set(*tree, e.first, -1);
+        auto by_index = find_mrca_from_id_set(*tree, e.first, -1, lca);
+        if (by_walking == nullptr or by_walking->get_ott_id() != e.second or by_index != by_walking) {
+            std::cerr << "MRCA of {";
+            for (auto id : e.first) {
+                std::cerr << ' ' << id;
+            }
+            std::cerr << " } is not ott" << e.second << '\n';
+            return 'F';
+        }
+    }
+    if (find_mrca_from_id_set(*tree, OttIdSet(), -1) != nullptr
+        or find_mrca_from_id_set(*tree, OttIdSet(), -1, lca) != nullptr) {
+        std::cerr << "the MRCA of no ids is not null\n";
+        return 'F';
+    }
+    for (bool use_index : {false, true}) {
+        try {
+            if (use_index) {
+                find_mrca_from_id_set(*tree, OttIdSet{1, 99}, -1, lca);
+            } else {
+                find_mrca_from_id_set(*tree, OttIdSet{1, 99}, -1);
+            }
+            std::cerr << "an id that is not in the tree was not reported\n";
+            return 'F';
+        } catch (const OTCError &) {
+        }
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> filenames = {"3genus-synth.tre",
+                                          "3genus-taxonomy.tre",
+                                          "3genus-AnotmonophyleticCandB.tre",
+                                          "AtoG-ABCEvDFG.tre",
+                                          "AtoG-taxonomy-forkingmono.tre"};
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    for (auto fn : filenames) {
+        const TestLCAOnTreeFile tlotf{fn};
+        TestCallBack tcb = [tlotf](const TestHarness &h) {
+            return tlotf.runTest(h);
+        };
+        tests.push_back(TestFn{fn, tcb});
+    }
+    tests.push_back(TestFn{"deep tree", test_deep_tree});
+    tests.push_back(TestFn{"MRCA of id sets", test_mrca_of_id_sets});
+    return th.run_tests(tests);
+}
@@ -1,5 +1,6 @@
 #include "otc/newick.h"
 #include "otc/test_harness.h"
+#include <sstream>
 using namespace otc;
 
 char testSingleCharLabelPoly(const TestHarness &);
@@ -16,6 +17,8 @@ char testUnbalancedToManyClose(const TestHarness &);
 char testEmptyClade(const TestHarness &);
 char testEmptySib(const TestHarness &);
 char testEmptyBranchLength(const TestHarness &);
+char testSmallStreamBuffers(const TestHarness &);
+char testCaterpillarTokens(const TestHarness &);
 char genericTokenTest(const TestHarness &th, const std::string &fn, const std::vector<std::string> & expected);
 char genericOTCParsingErrorTest(const TestHarness &th, const std::string &fn);
 
@@ -179,6 +182,110 @@ char testEmptyBranchLength(const TestHarness &th) {
     return r;
 }
 
+// Hands out the content a few chars at a time, so that labels span refills of the get area.
+class SmallChunkStreambuf : public std::streambuf {
+    public:
+        SmallChunkStreambuf(const std::string & c, std::size_t n)
+            :content(c),
+            chunk_size(n) {
+        }
+    protected:
+        int_type underflow() override {
+            if (offset >= content.size()) {
+                return traits_type::eof();
+            }
+            chunk = content.substr(offset, chunk_size);
+            offset += chunk.size();
+            setg(&chunk[0], &chunk[0], &chunk[0] + chunk.size());
+            return traits_type::to_int_type(chunk[0]);
+        }
+    private:
+        const std::string content;
+        const std::size_t chunk_size;
+        std::size_t offset = 0;
+        std::string chunk;
+};
+
+std::vector<std::string> describe_tokens(std::istream & inp, const std::string & fn) {
+    std::vector<std::string> obtained;
+    ConstStrPtr filenamePtr = ConstStrPtr(new std::string(fn));
+    FilePosStruct pos(filenamePtr);
+    NewickTokenizer tokenizer(inp, pos);
+    try {
+        for (const auto & token : tokenizer) {
+            obtained.push_back(std::to_string(token.state) + " " + token.content() + " " + token.get_start_pos().describe());
+        }
+    } catch (const OTCParsingError & x) {
+        obtained.push_back(x.what());
+    }
+    return obtained;
+}
+
+// The tokens, their positions and any error are the same whether the stream's buffer holds the
+//   whole file or a few chars at a time.
+char testSmallStreamBuffers(const TestHarness &th) {
+    for (const auto & fn : {"noids-abcnewick.tre", "noids-bifurcating.tre", "noids-branchlengths.tre",
+                            "noids-quotedwordspolytomy.tre", "noids-polytomywithcomments.tre",
+                            "noids-underscorehandling.tre", "noids-whitespacehandling.tre",
+                            "noids-unbalanced.tre", "noids-emptybranchlength3.tre"}) {
+        std::ifstream inp;
+        if (!th.open_test_file(fn, inp)) {
+            return 'U';
+        }
+        const std::string content((std::istreambuf_iterator<char>(inp)), std::istreambuf_iterator<char>());
+        std::istringstream whole(content);
+        const auto expected = describe_tokens(whole, fn);
+        for (std::size_t n : {1, 3}) {
+            SmallChunkStreambuf buf(content, n);
+            std::istream chunked(&buf);
+            if (!test_vec_element_equality(expected, describe_tokens(chunked, fn))) {
+                std::cerr << fn << " read " << n << " chars at a time differs\n";
+                return 'F';
+            }
+        }
+    }
+    return '.';
+}
+
+void write_caterpillar_newick(std::ostream & out, std::size_t num_tips) {
+    for (std::size_t i = 1; i < num_tips; ++i) {
+        out << '(';
+    }
+    out << "Genus_species_ott0";
+    for (std::size_t i = 1; i < num_tips; ++i) {
+        out << ",Genus_species_ott" << i << ")anc_ott" << (num_tips + i) << ':' << i % 7;
+    }
+    out << ";\n";
+}
+
+// A caterpillar with labels like the synth tree's, read whole and a few chars at a time, so that
+//   the runs of label chars are cut at every point.
+char testCaterpillarTokens(const TestHarness &) {
+    std::ostringstream out;
+    write_caterpillar_newick(out, 3);
+    const std::string content = out.str();
+    const std::vector<std::string> expected = {"(", "(", "Genus species ott0",
+                                               ",", "Genus species ott1",
+                                               ")", "anc ott4", ":", "1",
+                                               ",", "Genus species ott2",
+                                               ")", "anc ott5", ":", "2", ";"};
+    for (std::size_t n : {content.size(), std::size_t(1), std::size_t(3), std::size_t(7)}) {
+        SmallChunkStreambuf buf(content, n);
+        std::istream inp(&buf);
+        FilePosStruct pos;
+        NewickTokenizer tokenizer(inp, pos);
+        std::vector<std::string> obtained;
+        for (const auto & token : tokenizer) {
+            obtained.push_back(token.content());
+        }
+        if (!test_vec_element_equality(expected, obtained)) {
+            std::cerr << "caterpillar read " << n << " chars at a time differs\n";
+            return 'F';
+        }
+    }
+    return '.';
+}
+
 int main(int argc, char *argv[]) {
     TestHarness th(argc, argv);
     TestsVec tests{TestFn("testSingleCharLabelPoly", testSingleCharLabelPoly)
@@ -195,6 +302,8 @@ int main(int argc, char *argv[]) {
                    , TestFn("testEmptyClade", testEmptyClade)
                    , TestFn("testEmptySib", testEmptySib)
                    , TestFn("testEmptyBranchLength", testEmptyBranchLength)
+                   , TestFn("testSmallStreamBuffers", testSmallStreamBuffers)
+                   , TestFn("testCaterpillarTokens", testCaterpillarTokens)
                    
                   };
     return th.run_tests(tests);
@@ -0,0 +1,106 @@
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/tree_operations.h"
+#include "otc/test_harness.h"
+using namespace otc;
+
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+
+std::unique_ptr<Tree_t> parse(const std::string & newick, bool use_node_arena) {
+    ParsingRules pr;
+    pr.set_ott_ids = false;
+    pr.use_node_arena = use_node_arena;
+    return tree_from_newick_string<Tree_t>(newick, pr);
+}
+
+// Trees read into an arena should be indistinguishable from heap-allocated ones.
+class TestArenaRoundTrip {
+        const std::string filename;
+    public:
+        TestArenaRoundTrip(const std::string & fn)
+            :filename(fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            auto fp = h.get_filepath(filename);
+            std::ifstream inp;
+            if (!open_utf8_file(fp, inp)) {
+                return 'U';
+            }
+            std::ostringstream contents;
+            contents << inp.rdbuf();
+            for (auto line : split_string(contents.str(), '\n')) {
+                if (line.empty()) {
+                    continue;
+                }
+                auto heap_tree = parse(line, false);
+                auto arena_tree = parse(line, true);
+                if (heap_tree->uses_node_arena() or not arena_tree->uses_node_arena()) {
+                    return 'F';
+                }
+                if (newick_string(*heap_tree) != newick_string(*arena_tree)) {
+                    std::cerr << newick_string(*heap_tree) << " != " << newick_string(*arena_tree) << '\n';
+                    return 'F';
+                }
+            }
+            return '.';
+        }
+};
+
+// Pruning an arena tree keeps its nodes allocated until clear(), which frees the slabs; the arena
+//   then allocates new ones for a new root.
+char test_arena_delete(const TestHarness &) {
+    auto tree = parse("((a,b)ab,(c,(d,e)de)cde,f)root;", true);
+    Tree_t::node_type * de = nullptr;
+    for (auto nd : iter_pre(*tree)) {
+        if (nd->get_name() == "de") {
+            de = nd;
+        }
+    }
+    tree->prune_and_delete(de);
+    if (newick_string(*tree) != "((a,b)ab,(c)cde,f)root;") {
+        std::cerr << newick_string(*tree) << '\n';
+        return 'F';
+    }
+    const auto arena = tree->get_node_arena();
+    if (arena->num_allocated() != 10) {
+        return 'F';
+    }
+    tree->clear();
+    if (arena->num_allocated() != 0 or arena->num_slabs() != 0) {
+        return 'F';
+    }
+    tree->create_root()->set_name("x");
+    return (newick_string(*tree) == "x;" and arena->num_allocated() == 1) ? '.' : 'F';
+}
+
+// A small tree read into an arena: one node allocated per newick node, and written back as read.
+char test_arena_small_tree(const TestHarness &) {
+    const std::string newick = "((a,b)ab,(c,(d,e)de)cde,f)root;";
+    auto tree = parse(newick, true);
+    const auto arena = tree->get_node_arena();
+    if (arena == nullptr or arena->num_allocated() != 10 or arena->num_slabs() != 1) {
+        std::cerr << "expected 10 nodes in 1 slab\n";
+        return 'F';
+    }
+    if (newick_string(*tree) != newick or n_nodes(*tree) != 10) {
+        std::cerr << newick_string(*tree) << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> filenames = {"3genus-synth.tre", "3genus-taxonomy.tre", "AtoG-taxonomy-forkingmono.tre"};
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    for (auto fn : filenames) {
+        const TestArenaRoundTrip tart{fn};
+        TestCallBack tcb = [tart](const TestHarness &h) {
+            return tart.runTest(h);
+        };
+        tests.push_back(TestFn{fn, tcb});
+    }
+    tests.push_back(TestFn{"arena small tree", test_arena_small_tree});
+    tests.push_back(TestFn{"arena delete", test_arena_delete});
+    return th.run_tests(tests);
+}
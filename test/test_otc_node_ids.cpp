@@ -0,0 +1,185 @@
+#include "otc/node_naming.h"
+#include "otc/ott_id_index.h"
+#include "otc/test_harness.h"
+#include <random>
+#include <regex>
+#include <tuple>
+#include <unordered_map>
+using namespace otc;
+
+// The patterns that the web services used to match node ids with.
+const std::regex mrca_id_pattern("^mrca(ott\\d+)(ott\\d+)$");
+const std::regex ott_id_pattern("^ott(\\d+)$");
+
+const std::vector<std::string> node_ids = {"ott1", "ott0", "ott770315", "ott0012", "ott", "ott-1", "ott12a",
+                                           "xott12", "ott 12", "OTT12", "mrcaott1ott2", "mrcaott770315ott5264",
+                                           "mrcaott1ott", "mrcaottott2", "mrcaott1", "mrca1ott2", "mrcaott1ott2x",
+                                           "mrcaott1ott2ott3", "mrcaott12ott", "", "node12", "ott12ott3"};
+
+// The parsers accept exactly the ids that the regexes matched, and split them the same way.
+char test_parsers_match_regexes(const TestHarness &) {
+    for (const auto & node_id : node_ids) {
+        std::smatch matches;
+        long raw_ott_id = -1;
+        const bool is_ott = parse_ott_node_id(node_id, raw_ott_id);
+        if (is_ott != std::regex_match(node_id, matches, ott_id_pattern)) {
+            std::cerr << "parse_ott_node_id(\"" << node_id << "\") returned " << is_ott << '\n';
+            return 'F';
+        }
+        if (is_ott and raw_ott_id != std::stol(matches[1])) {
+            std::cerr << "parse_ott_node_id(\"" << node_id << "\") gave " << raw_ott_id << '\n';
+            return 'F';
+        }
+        std::string_view first_id, second_id;
+        const bool is_mrca = parse_mrca_node_id(node_id, first_id, second_id);
+        if (is_mrca != std::regex_match(node_id, matches, mrca_id_pattern)) {
+            std::cerr << "parse_mrca_node_id(\"" << node_id << "\") returned " << is_mrca << '\n';
+            return 'F';
+        }
+        if (is_mrca and (first_id != matches[1].str() or second_id != matches[2].str())) {
+            std::cerr << "parse_mrca_node_id(\"" << node_id << "\") gave " << first_id << ' ' << second_id << '\n';
+            return 'F';
+        }
+    }
+    long raw_ott_id = -1;
+    if (not parse_ott_node_id("ott99999999999999999999", raw_ott_id) or raw_ott_id != std::numeric_limits<long>::max()) {
+        std::cerr << "an id too big for a long was not saturated\n";
+        return 'F';
+    }
+    return '.';
+}
+
+// Random sets and erases, of dense ids, huge ids and negative ids, checked against an unordered_map.
+char test_ott_id_index_matches_map(const TestHarness &) {
+    std::mt19937 rng(1);
+    std::vector<int> values(100);
+    OttIdIndex<const int *> index;
+    std::unordered_map<OttId, const int *> expected;
+    for (int i = 0; i < 200000; ++i) {
+        OttId id;
+        switch (rng() % 20) {
+            case 0: id = static_cast<OttId>(rng() % 1000000000); break;
+            case 1: id = -static_cast<OttId>(rng() % 1000); break;
+            default: id = static_cast<OttId>(rng() % 300000);
+        }
+        if (rng() % 5 == 0) {
+            if (index.erase(id) != expected.erase(id)) {
+                std::cerr << "erase(" << id << ") differs\n";
+                return 'F';
+            }
+        } else {
+            const int * v = &values[rng() % values.size()];
+            index.set(id, v);
+            expected[id] = v;
+        }
+    }
+    if (index.size() != expected.size()) {
+        std::cerr << index.size() << " ids in the index, but " << expected.size() << " in the map\n";
+        return 'F';
+    }
+    std::size_t num_iterated = 0;
+    for (const auto & el : index) {
+        auto it = expected.find(el.first);
+        if (it == expected.end() or it->second != el.second) {
+            std::cerr << "iteration gave a wrong value for " << el.first << '\n';
+            return 'F';
+        }
+        ++num_iterated;
+    }
+    if (num_iterated != expected.size()) {
+        std::cerr << "iteration visited " << num_iterated << " ids instead of " << expected.size() << '\n';
+        return 'F';
+    }
+    for (OttId id = -1000; id < 300000; ++id) {
+        auto it = index.find(id);
+        auto eit = expected.find(id);
+        const bool found = (it != index.end());
+        if (found != (eit != expected.end()) or (found and it->second != eit->second) or index.count(id) != expected.count(id)) {
+            std::cerr << "find(" << id << ") differs\n";
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+// Ids whose parses are written out: the OTT id of an ott id, and the two halves of an MRCA id.
+char test_parsers_on_known_ids(const TestHarness &) {
+    const std::vector<std::pair<std::string, long>> ott_ids = {{"ott1", 1}, {"ott0", 0}, {"ott0012", 12},
+                                                               {"ott770315", 770315}, {"ott", -1}, {"ott-1", -1},
+                                                               {"ott12a", -1}, {"OTT12", -1}, {"mrcaott1ott2", -1}};
+    for (const auto & e : ott_ids) {
+        long raw_ott_id = -1;
+        const bool is_ott = parse_ott_node_id(e.first, raw_ott_id);
+        if (is_ott != (e.second >= 0) or (is_ott and raw_ott_id != e.second)) {
+            std::cerr << "parse_ott_node_id(\"" << e.first << "\") gave " << is_ott << ", " << raw_ott_id << '\n';
+            return 'F';
+        }
+    }
+    const std::vector<std::tuple<std::string, std::string, std::string>> mrca_ids = {
+        {"mrcaott1ott2", "ott1", "ott2"},
+        {"mrcaott770315ott5264", "ott770315", "ott5264"},
+        {"mrcaott1ott", "", ""},
+        {"mrcaott1ott2x", "", ""},
+        {"mrcaott1ott2ott3", "", ""},
+        {"ott12ott3", "", ""}};
+    for (const auto & e : mrca_ids) {
+        std::string_view first_id, second_id;
+        const bool is_mrca = parse_mrca_node_id(std::get<0>(e), first_id, second_id);
+        if (is_mrca != not std::get<1>(e).empty()
+            or (is_mrca and (first_id != std::get<1>(e) or second_id != std::get<2>(e)))) {
+            std::cerr << "parse_mrca_node_id(\"" << std::get<0>(e) << "\") gave " << is_mrca << ", " << first_id << ' ' << second_id << '\n';
+            return 'F';
+        }
+    }
+    if (make_mrca_name(770315, 5264) != "mrcaott770315ott5264") {
+        std::cerr << "make_mrca_name(770315, 5264) gave " << make_mrca_name(770315, 5264) << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+// A few ids in the array part and a few in the hash table, with the values written out.
+char test_ott_id_index_known_values(const TestHarness &) {
+    int a = 0, b = 0, c = 0, d = 0;
+    OttIdIndex<const int *> index;
+    index.set(5, &a);
+    index.set(5, &b);
+    index.set(0, &a);
+    index.set(-7, &c);
+    index.set(1000000000, &d);
+    if (index.size() != 4 or index.lookup(5) != &b or index.lookup(0) != &a or index.lookup(-7) != &c
+        or index.lookup(1000000000) != &d or index.lookup(6) != nullptr or index.lookup(-6) != nullptr
+        or index.lookup(999999999) != nullptr or keys(index) != OttIdSet{-7, 0, 5, 1000000000}) {
+        std::cerr << "wrong values after setting 4 ids\n";
+        return 'F';
+    }
+    if (index.erase(5) != 1 or index.erase(5) != 0 or index.erase(-7) != 1 or index.count(5) != 0
+        or index.find(-7) != index.end() or index.size() != 2) {
+        std::cerr << "wrong values after erasing\n";
+        return 'F';
+    }
+    try {
+        index.at(5);
+        std::cerr << "at() of an erased id did not throw\n";
+        return 'F';
+    } catch (const std::out_of_range &) {
+    }
+    // The id beyond the array moves into it when it grows.
+    index.set(5000, &c);
+    index.reserve_ids(10000);
+    if (index.lookup(5000) != &c or index.lookup(1000000000) != &d or index.lookup(0) != &a or index.size() != 3) {
+        std::cerr << "wrong values after reserve_ids\n";
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"parsers on known ids", test_parsers_on_known_ids});
+    tests.push_back(TestFn{"parsers match regexes", test_parsers_match_regexes});
+    tests.push_back(TestFn{"OttIdIndex known values", test_ott_id_index_known_values});
+    tests.push_back(TestFn{"OttIdIndex matches unordered_map", test_ott_id_index_matches_map});
+    return th.run_tests(tests);
+}
@@ -0,0 +1,125 @@
+#include "otc/newick.h"
+#include "otc/util.h"
+#include "otc/tree_operations.h"
+#include "otc/induced_tree.h"
+#include "otc/ott_id_index.h"
+#include "otc/test_harness.h"
+#include <map>
+#include <random>
+using namespace otc;
+
+typedef TreeMappedWithSplits Tree_t;
+typedef Tree_t::node_type node_type;
+// OTT ids go up to about 8M.
+const OttId max_ott_id = 8000000;
+
+// The ids of a small tree are spread over the whole range, so they live in the hash table.  Random
+//   sets and erases of such ids, checked against a std::map; keys() gives them in order.
+char test_sparse_ott_id_index_matches_map(const TestHarness &) {
+    std::mt19937 rng(1);
+    std::vector<int> values(100);
+    OttIdIndex<const int *> index;
+    std::map<OttId, const int *> expected;
+    for (int i = 0; i < 100000; ++i) {
+        const OttId id = static_cast<OttId>(rng() % max_ott_id) - 1000;
+        if (rng() % 3 == 0) {
+            // Mostly erase ids that are there, to exercise the shifting of cells.
+            auto it = expected.lower_bound(id);
+            const OttId victim = (it != expected.end() and rng() % 4 != 0) ? it->first : id;
+            if (index.erase(victim) != expected.erase(victim)) {
+                std::cerr << "erase(" << victim << ") differs\n";
+                return 'F';
+            }
+        } else {
+            const int * v = &values[rng() % values.size()];
+            index.set(id, v);
+            expected[id] = v;
+        }
+        if (i % 1000 == 0 and keys(index) != keys(expected)) {
+            std::cerr << "keys differ after " << i << " changes\n";
+            return 'F';
+        }
+    }
+    if (index.size() != expected.size()) {
+        std::cerr << index.size() << " ids in the index, but " << expected.size() << " in the map\n";
+        return 'F';
+    }
+    for (const auto & el : expected) {
+        if (index.lookup(el.first) != el.second or index.find(el.first)->second != el.second) {
+            std::cerr << "wrong value for " << el.first << '\n';
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+// A small tree whose ids are known: each id maps to the node with that label, internal ids
+//   included, and absent ids map to nothing.
+char test_small_tree_id_maps(const TestHarness &) {
+    auto tree = tree_from_newick_string<Tree_t>("((a_ott1,b_ott2)ab_ott10,(c_ott3,(d_ott4,e_ott900000)de_ott11)cde_ott12)root_ott13;", ParsingRules());
+    // The parser turns underscores into spaces.
+    const std::map<OttId, std::string> expected = {{1, "a ott1"}, {2, "b ott2"}, {3, "c ott3"}, {4, "d ott4"},
+                                                   {900000, "e ott900000"}, {10, "ab ott10"}, {11, "de ott11"},
+                                                   {12, "cde ott12"}, {13, "root ott13"}};
+    const auto const_nodes = get_ottid_to_const_node_map(*tree);
+    const auto & ott_id_to_node = tree->get_data().ott_id_to_node;
+    if (ott_id_to_node.size() != expected.size() or const_nodes.size() != expected.size()
+        or keys(ott_id_to_node) != keys(const_nodes)) {
+        std::cerr << "the tree has " << ott_id_to_node.size() << " ids, but there are " << expected.size() << '\n';
+        return 'F';
+    }
+    for (const auto & e : expected) {
+        auto nd = tree->get_data().get_node_by_ott_id(e.first);
+        if (nd == nullptr or nd->get_name() != e.second or const_nodes.lookup(e.first) != nd) {
+            std::cerr << "ott" << e.first << " is not mapped to " << e.second << '\n';
+            return 'F';
+        }
+    }
+    for (OttId absent : {0, 5, 14, 899999, 900001, -1}) {
+        if (tree->get_data().get_node_by_ott_id(absent) != nullptr or const_nodes.count(absent) != 0) {
+            std::cerr << "ott" << absent << " is mapped to a node\n";
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+// The leaves that two small trees share, from either side; the shared ids are written out.
+char test_small_induced_leaves(const TestHarness &) {
+    auto tree1 = tree_from_newick_string<Tree_t>("((ott1,ott2),(ott3,(ott4,ott900000)));", ParsingRules());
+    auto tree2 = tree_from_newick_string<Tree_t>("((ott2,ott7),(ott900000,(ott4,ott8,ott9)));", ParsingRules());
+    auto tree3 = tree_from_newick_string<Tree_t>("(ott4,ott5);", ParsingRules());
+    const auto nodes1 = get_ottid_to_const_node_map(*tree1);
+    const auto nodes2 = get_ottid_to_const_node_map(*tree2);
+    const auto nodes3 = get_ottid_to_const_node_map(*tree3);
+    auto leaf_ids = [](const std::vector<const node_type *> & leaves, const OttIdIndex<const node_type *> & nodes) {
+        OttIdSet ids;
+        for (auto leaf : leaves) {
+            // The leaves belong to the first tree.
+            if (nodes.lookup(leaf->get_ott_id()) != leaf) {
+                return OttIdSet{-1};
+            }
+            ids.insert(leaf->get_ott_id());
+        }
+        return ids;
+    };
+    // The first tree is the smaller one in one pair and the larger one in the other, so both loops
+    //   of get_induced_leaves are used.
+    if (leaf_ids(get_induced_leaves(*tree1, nodes1, *tree2, nodes2), nodes1) != OttIdSet{2, 4, 900000}
+        or leaf_ids(get_induced_leaves(*tree2, nodes2, *tree1, nodes1), nodes2) != OttIdSet{2, 4, 900000}
+        or leaf_ids(get_induced_leaves(*tree1, nodes1, *tree3, nodes3), nodes1) != OttIdSet{4}
+        or leaf_ids(get_induced_leaves(*tree3, nodes3, *tree1, nodes1), nodes3) != OttIdSet{4}) {
+        std::cerr << "wrong induced leaves\n";
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    tests.push_back(TestFn{"sparse OttIdIndex matches std::map", test_sparse_ott_id_index_matches_map});
+    tests.push_back(TestFn{"small tree id maps", test_small_tree_id_maps});
+    tests.push_back(TestFn{"small induced leaves", test_small_induced_leaves});
+    return th.run_tests(tests);
+}
@@ -0,0 +1,89 @@
+#include "otc/test_harness.h"
+#include "ws/rcu_pointer.h"
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+using namespace otc;
+
+// Counts the versions that have not been destroyed yet.
+struct Version {
+    static std::atomic<int> num_alive;
+    const int number;
+    explicit Version(int n)
+        :number(n) {
+        num_alive++;
+    }
+    ~Version() {
+        num_alive--;
+    }
+};
+std::atomic<int> Version::num_alive(0);
+
+// A thread that read a version and then went idle (like a server thread between requests) must not
+//   keep that version alive once a newer one is published.
+char test_idle_reader_does_not_pin(const TestHarness &) {
+    RCUPointer<Version> published(std::make_shared<const Version>(1));
+    std::mutex m;
+    std::condition_variable cv;
+    bool has_read = false;
+    bool may_exit = false;
+    int number_read = 0;
+    std::thread reader([&]() {
+        {
+            auto v = published.read();
+            number_read = v->number;
+        }
+        std::unique_lock<std::mutex> lock(m);
+        has_read = true;
+        cv.notify_all();
+        cv.wait(lock, [&]() {return may_exit;});
+    });
+    char result = '.';
+    {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&]() {return has_read;});
+        published.publish(std::make_shared<const Version>(2));
+        if (number_read != 1 or Version::num_alive != 1) {
+            std::cerr << "the idle reader kept the retired version alive\n";
+            result = 'F';
+        }
+        may_exit = true;
+        cv.notify_all();
+    }
+    reader.join();
+    return result;
+}
+
+// A version being read stays alive until the reader is done, and nested reads see that version
+//   even if a newer one was published in between.  load() does not keep anything alive.
+char test_retired_version_freed_after_read(const TestHarness &) {
+    RCUPointer<Version> published(std::make_shared<const Version>(1));
+    if (published.load()->number != 1) {
+        return 'F';
+    }
+    {
+        auto outer = published.read();
+        published.publish(std::make_shared<const Version>(2));
+        auto inner = published.read();
+        if (inner.get() != outer.get() or inner->number != 1 or Version::num_alive != 2) {
+            std::cerr << "a nested read did not see the version of the outer read\n";
+            return 'F';
+        }
+    }
+    if (Version::num_alive != 1) {
+        std::cerr << "the retired version outlived its last reader\n";
+        return 'F';
+    }
+    if (published.read()->number != 2) {
+        return 'F';
+    }
+    published.publish(std::make_shared<const Version>(3));
+    return Version::num_alive == 1 ? '.' : 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn{"idle reader does not pin", test_idle_reader_does_not_pin},
+                   TestFn{"retired version freed after read", test_retired_version_freed_after_read}};
+    return th.run_tests(tests);
+}
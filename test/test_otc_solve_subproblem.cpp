@@ -0,0 +1,163 @@
+#include "otc/otcli.h"
+#include "otc/solve_subproblem.h"
+#include "otc/test_harness.h"
+#include <random>
+#include <sstream>
+using namespace otc;
+
+typedef TreeMappedWithSplits Tree_t;
+typedef std::vector<std::unique_ptr<Tree_t>> TreeVec;
+
+// The summary tree of a subproblem, with BUILD kept between splits or rerun for every split.
+std::string solve(TreeVec trees, const OttIdSet & incertae_sedis, bool incremental) {
+    SolveSubproblemOptions options;
+    options.incremental = incremental;
+    auto tree = solve_subproblem(trees, incertae_sedis, options);
+    std::ostringstream out;
+    write_tree_as_newick(out, *tree);
+    return out.str();
+}
+
+// The incremental BUILD must give the tree that rerunning BUILD for every split gives.
+char check_incremental_matches_full(const std::function<TreeVec()> & read_trees, const OttIdSet & incertae_sedis, const std::string & label) {
+    const auto incremental = solve(read_trees(), incertae_sedis, true);
+    const auto full = solve(read_trees(), incertae_sedis, false);
+    if (incremental != full) {
+        std::cerr << label << ": incremental BUILD gave " << incremental << " but the full rebuild gave " << full << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+// The subproblems that expected/solve-subproblem runs otc-solve-subproblem on.
+class TestSubproblemFiles {
+        const std::vector<std::string> filenames;
+        const std::string incertae_sedis_filename;
+    public:
+        TestSubproblemFiles(const std::vector<std::string> & fns, const std::string & is_fn)
+            :filenames(fns),
+            incertae_sedis_filename(is_fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            std::vector<std::string> paths;
+            for (const auto & fn : filenames) {
+                std::ifstream inp;
+                if (!h.open_test_file(fn, inp)) {
+                    return 'U';
+                }
+                paths.push_back(h.get_filepath(fn));
+            }
+            OttIdSet incertae_sedis;
+            if (not incertae_sedis_filename.empty()) {
+                incertae_sedis = load_incertae_sedis_ids(h.get_filepath(incertae_sedis_filename));
+            }
+            auto read_trees = [&paths]() {
+                return get_trees<Tree_t>(paths, ParsingRules());
+            };
+            return check_incremental_matches_full(read_trees, incertae_sedis, filenames.front());
+        }
+};
+
+// Newick for a random clade on the tips with ids ids[first..last), which are shuffled.  Splits
+//   are sometimes polytomies.
+void write_random_clade(std::ostream & out, std::vector<OttId> & ids, std::size_t first, std::size_t last, std::mt19937 & rng) {
+    if (last - first == 1) {
+        out << "t_ott" << ids[first];
+        return;
+    }
+    const std::size_t num_children = (last - first > 2 and rng() % 3 == 0) ? 3 : 2;
+    std::vector<std::size_t> bounds = {first};
+    for (std::size_t c = 1; c < num_children; ++c) {
+        bounds.push_back(bounds.back() + 1 + rng() % (last - bounds.back() - (num_children - c)));
+    }
+    bounds.push_back(last);
+    out << '(';
+    for (std::size_t c = 0; c < num_children; ++c) {
+        if (c > 0) {
+            out << ',';
+        }
+        write_random_clade(out, ids, bounds[c], bounds[c + 1], rng);
+    }
+    out << ')';
+}
+
+// Random subproblems: input trees on random subsets of the tips, which mostly conflict with each
+//   other, and a taxonomy that has a few clades.
+char test_random_subproblems(const TestHarness &) {
+    std::mt19937 rng(1);
+    for (int problem = 0; problem < 300; ++problem) {
+        const std::size_t num_tips = 4 + rng() % 12;
+        std::vector<OttId> tip_ids;
+        for (std::size_t i = 0; i < num_tips; ++i) {
+            tip_ids.push_back(static_cast<OttId>(i + 1));
+        }
+        std::vector<std::string> newicks;
+        const std::size_t num_input_trees = 1 + rng() % 6;
+        for (std::size_t t = 0; t < num_input_trees; ++t) {
+            std::shuffle(tip_ids.begin(), tip_ids.end(), rng);
+            const std::size_t n = 2 + rng() % (num_tips - 1);
+            std::ostringstream out;
+            write_random_clade(out, tip_ids, 0, n, rng);
+            out << ';';
+            newicks.push_back(out.str());
+        }
+        // The taxonomy: the tips in a few genera below the root.
+        std::shuffle(tip_ids.begin(), tip_ids.end(), rng);
+        std::ostringstream taxonomy;
+        taxonomy << '(';
+        OttId genus_id = 1000;
+        for (std::size_t i = 0; i < num_tips;) {
+            const std::size_t genus_size = std::min(num_tips - i, std::size_t(1 + rng() % 4));
+            taxonomy << (i > 0 ? "," : "");
+            if (genus_size > 1) {
+                taxonomy << '(';
+            }
+            for (std::size_t j = 0; j < genus_size; ++j) {
+                taxonomy << (j > 0 ? "," : "") << "t_ott" << tip_ids[i + j];
+            }
+            if (genus_size > 1) {
+                taxonomy << ")g_ott" << genus_id++;
+            }
+            i += genus_size;
+        }
+        taxonomy << ")life_ott805080;";
+        newicks.push_back(taxonomy.str());
+        auto read_trees = [&newicks]() {
+            TreeVec trees;
+            for (const auto & newick : newicks) {
+                trees.push_back(tree_from_newick_string<Tree_t>(newick, ParsingRules()));
+            }
+            return trees;
+        };
+        if (check_incremental_matches_full(read_trees, OttIdSet(), "random subproblem " + std::to_string(problem)) != '.') {
+            for (const auto & newick : newicks) {
+                std::cerr << "  " << newick << '\n';
+            }
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::pair<std::vector<std::string>, std::string>> subproblems = {
+        {{"attachresolved/tree1.tre", "attachresolved/tree2.tre", "attachresolved/tree3.tre", "attachresolved/taxonomy.tre"}, ""},
+        {{"place-is/tree1.tre", "place-is/tax.tre"}, ""},
+        {{"place-is/tree1.tre", "place-is/tax.tre"}, "place-is/is.txt"},
+        {{"is-naming/tree1.tre", "is-naming/tax1.tre"}, "is-naming/is1.txt"},
+        {{"is-naming/tree2.tre", "is-naming/tax2.tre"}, "is-naming/is2.txt"},
+        {{"is-clade/tree1.tre", "is-clade/tax.tre"}, "is-clade/is.txt"},
+        {{"is-clade/tree2.tre", "is-clade/tax.tre"}, "is-clade/is.txt"},
+        {{"is-within-is/tree1.tre", "is-within-is/tax.tre"}, "is-within-is/is.txt"}};
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    for (const auto & sp : subproblems) {
+        const TestSubproblemFiles tsf{sp.first, sp.second};
+        TestCallBack tcb = [tsf](const TestHarness &h) {
+            return tsf.runTest(h);
+        };
+        tests.push_back(TestFn{sp.first.front() + " " + sp.second, tcb});
+    }
+    tests.push_back(TestFn{"random subproblems", test_random_subproblems});
+    return th.run_tests(tests);
+}
@@ -0,0 +1,184 @@
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/test_harness.h"
+#include "otc/util.h"
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+using namespace otc;
+namespace fs = boost::filesystem;
+
+std::string node_summary(const RTRichTaxNode * nd) {
+    if (nd == nullptr) {
+        return "null";
+    }
+    const auto & d = nd->get_data();
+    std::ostringstream out;
+    out << nd->get_ott_id() << ' ' << nd->get_name() << ' ' << d.get_nonuniqname() << ' ' << d.get_rank()
+        << ' ' << d.flags << ' ' << d.source_info << ' ' << d.depth << ' ' << d.trav_enter << ' ' << d.trav_exit
+        << ' ' << (nd->get_parent() ? nd->get_parent()->get_ott_id() : -1);
+    for (auto js : d.junior_synonyms) {
+        out << " syn:" << js->get_name() << ':' << js->source_string << ':' << js->primary->get_ott_id();
+    }
+    return out.str();
+}
+
+// Everything that the web services can see of a RichTaxonomy, as a list of lines.
+std::vector<std::string> taxonomy_summary(const RichTaxonomy & taxonomy) {
+    std::vector<std::string> lines;
+    const auto & tree = taxonomy.get_tax_tree();
+    const auto & td = tree.get_data();
+    lines.push_back(taxonomy.get_version() + ' ' + taxonomy.get_version_number());
+    for (auto nd : iter_pre_const(tree)) {
+        lines.push_back(node_summary(nd));
+    }
+    for (const auto & [name, nd] : td.name_to_node) {
+        lines.push_back("name " + std::string(name) + " -> " + node_summary(nd));
+    }
+    for (const auto & [name, nodes] : td.homonym_to_node) {
+        for (auto nd : nodes) {
+            lines.push_back("homonym " + std::string(name) + " -> " + node_summary(nd));
+        }
+    }
+    for (const auto & [name, ids] : td.non_unique_taxon_names) {
+        for (auto id : ids) {
+            lines.push_back("non-unique " + name + " -> " + std::to_string(id));
+        }
+    }
+    for (const auto & [flags, j] : td.flags2json) {
+        lines.push_back("flags " + flags.to_string() + " -> " + j.dump());
+    }
+    std::map<std::string, std::set<std::string>> foreign;
+    for (const auto & [prefix, m] : {std::make_pair("ncbi", &td.ncbi_id_map), std::make_pair("gbif", &td.gbif_id_map),
+                                      std::make_pair("worms", &td.worms_id_map), std::make_pair("if", &td.if_id_map),
+                                      std::make_pair("irmng", &td.irmng_id_map)}) {
+        for (const auto & [foreign_id, nd] : *m) {
+            foreign[prefix].insert(std::to_string(foreign_id) + " -> " + node_summary(nd));
+        }
+    }
+    for (const auto & [prefix, entries] : foreign) {
+        for (const auto & e : entries) {
+            lines.push_back(prefix + ':' + e);
+        }
+    }
+    for (const auto & [name, tr] : td.name_to_record) {
+        lines.push_back("filtered name " + std::string(name) + " -> " + (tr ? std::string(tr->line) : "null"));
+    }
+    std::set<OttId> filtered_ids;
+    for (const auto & [id, tr] : td.id_to_record) {
+        filtered_ids.insert(id);
+    }
+    for (auto id : filtered_ids) {
+        lines.push_back("filtered id " + std::to_string(id));
+    }
+    for (const auto & tjs : taxonomy.get_synonyms_list()) {
+        lines.push_back("synonym " + tjs.name + ' ' + tjs.source_string + ' ' + std::to_string(tjs.primary->get_ott_id()));
+    }
+    for (auto id : taxonomy.get_ids_to_suppress_from_tnrs()) {
+        lines.push_back("suppressed " + std::to_string(id));
+    }
+    for (OttId id : {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 100, 101, 102}) {
+        auto nd = taxonomy.included_taxon_from_id(id);
+        lines.push_back("included " + std::to_string(id) + " -> " + node_summary(nd));
+    }
+    return lines;
+}
+
+void write_file(const fs::path & p, const std::string & contents) {
+    std::ofstream out(p.string());
+    out << contents;
+}
+
+// A small taxonomy with homonyms, synonyms, foreign ids, forwards, and a filtered taxon.
+fs::path write_test_taxonomy(const fs::path & dir) {
+    fs::create_directories(dir);
+    write_file(dir / "version.txt", "3.2draft9\n");
+    write_file(dir / "taxonomy.tsv",
+               "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t\n"
+               "1\t|\t\t|\tlife\t|\tno rank\t|\t\t|\t\t|\t\t|\t\n"
+               "2\t|\t1\t|\tAus\t|\tgenus\t|\tncbi:20,gbif:21\t|\tAus (genus in Bacteria)\t|\t\t|\t\n"
+               "3\t|\t1\t|\tAus\t|\tgenus\t|\tncbi:30,worms:31\t|\tAus (genus in Eukaryota)\t|\textinct\t|\t\n"
+               "4\t|\t2\t|\tAus bus\t|\tspecies\t|\tif:40,irmng:41\t|\t\t|\t\t|\t\n"
+               "5\t|\t3\t|\tAus cus\t|\tspecies\t|\tncbi:50\t|\t\t|\tenvironmental\t|\t\n"
+               "6\t|\t3\t|\tDus eus\t|\tspecies\t|\tgbif:60\t|\t\t|\thidden\t|\t\n"
+               "7\t|\t6\t|\tDus eus fus\t|\tsubspecies\t|\t\t|\t\t|\t\t|\t\n"
+               "8\t|\t1\t|\tGus\t|\tgenus\t|\tirmng:80\t|\t\t|\tnot_otu\t|\t\n");
+    write_file(dir / "synonyms.tsv",
+               "name\t|\tuid\t|\ttype\t|\tuniqname\t|\tsourceinfo\t|\t\n"
+               "Aus bus\t|\t5\t|\tsynonym\t|\tAus bus (synonym for Aus cus)\t|\tncbi:51\t|\t\n"
+               "Hus\t|\t2\t|\tsynonym\t|\tHus (synonym for Aus)\t|\t\t|\t\n"
+               "Hus\t|\t3\t|\tsynonym\t|\tHus (synonym for Aus)\t|\tgbif:32\t|\t\n");
+    write_file(dir / "forwards.tsv", "id\treplacement\n100\t4\n101\t100\n");
+    return dir;
+}
+
+class TestSnapshotRoundTrip {
+        const std::string dirname;
+        std::bitset<32> cleaning_flags;
+    public:
+        TestSnapshotRoundTrip(const std::string & dn, std::bitset<32> cf)
+            :dirname(dn),
+            cleaning_flags(cf) {
+        }
+        char runTest(const TestHarness &h) const {
+            fs::path dir = h.get_filepath(dirname);
+            const auto tmp = fs::temp_directory_path() / fs::unique_path();
+            if (dirname.empty()) {
+                dir = write_test_taxonomy(tmp / "taxonomy");
+            } else if (not fs::exists(dir)) {
+                return 'U';
+            }
+            fs::create_directories(tmp);
+            const auto snapshot = (tmp / "taxonomy.snapshot").string();
+            char result = '.';
+            {
+                RichTaxonomy parsed(dir.string(), cleaning_flags);
+                parsed.write_snapshot(snapshot);
+                auto loaded = RichTaxonomy::load_snapshot(snapshot, dir.string(), cleaning_flags);
+                if (not test_vec_element_equality(taxonomy_summary(parsed), taxonomy_summary(loaded))) {
+                    result = 'F';
+                }
+                // Moving the taxonomy must not invalidate the views into the snapshot.
+                RichTaxonomy moved = std::move(loaded);
+                if (not test_vec_element_equality(taxonomy_summary(parsed), taxonomy_summary(moved))) {
+                    result = 'F';
+                }
+            }
+            // A snapshot made with other cleaning flags, or a corrupt one, is rejected.
+            try {
+                RichTaxonomy::load_snapshot(snapshot, dir.string(), cleaning_flags ^ std::bitset<32>(1));
+                std::cerr << "snapshot with different cleaning flags was accepted\n";
+                result = 'F';
+            } catch (OTCError &) {
+            }
+            {
+                std::fstream f(snapshot, std::ios::in | std::ios::out | std::ios::binary);
+                f.seekg(-1, std::ios::end);
+                char c = static_cast<char>(f.get());
+                f.seekp(-1, std::ios::end);
+                f.put(static_cast<char>(c ^ 0x20));
+            }
+            try {
+                RichTaxonomy::load_snapshot(snapshot, dir.string(), cleaning_flags);
+                std::cerr << "corrupt snapshot was accepted\n";
+                result = 'F';
+            } catch (OTCError &) {
+            }
+            fs::remove_all(tmp);
+            return result;
+        }
+};
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests;
+    const std::vector<std::pair<std::string, std::string>> cases = {{"ex-tax-1", ""},
+                                                                    {"", ""},
+                                                                    {"", "not_otu"}};
+    for (const auto & [dirname, flags] : cases) {
+        const TestSnapshotRoundTrip tsrt{dirname, flags_from_string(flags)};
+        TestCallBack tcb = [tsrt](const TestHarness &h) {
+            return tsrt.runTest(h);
+        };
+        tests.push_back(TestFn{(dirname.empty() ? "generated taxonomy" : dirname) + " " + flags, tcb});
+    }
+    return th.run_tests(tests);
+}
@@ -0,0 +1,205 @@
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/test_harness.h"
+#include "otc/util.h"
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <fstream>
+using namespace otc;
+namespace fs = boost::filesystem;
+
+typedef TaxonNameIndex::Entry Entry;
+
+bool matches(std::string_view name, const std::string & query, bool prefix) {
+    auto n = TaxonNameIndex::normalize(name);
+    auto q = TaxonNameIndex::normalize(query);
+    return prefix ? n.compare(0, q.size(), q) == 0 : n == q;
+}
+
+// What the web services found by scanning the context subtree, before there was an index.
+std::vector<std::string> scan(const RTRichTaxNode * context_root, const std::string & query, bool prefix, bool synonyms) {
+    std::vector<std::string> hits;
+    for (auto nd : iter_post_n_const(*context_root)) {
+        if (not synonyms) {
+            if (matches(nd->get_data().get_nonuniqname(), query, prefix)) {
+                hits.push_back(nd->get_name());
+            }
+            continue;
+        }
+        for (auto tjs : nd->get_data().junior_synonyms) {
+            if (matches(tjs->get_name(), query, prefix)) {
+                hits.push_back(nd->get_name() + " / " + tjs->get_name());
+            }
+        }
+    }
+    return hits;
+}
+
+std::vector<std::string> lookup(const TaxonNameIndex & index, const RTRichTaxNode * context_root, const std::string & query, bool prefix, bool synonyms) {
+    std::vector<std::string> hits;
+    auto entries = synonyms ? index.find_synonyms(query, context_root, prefix) : index.find_names(query, context_root, prefix);
+    for (auto e : entries) {
+        hits.push_back(synonyms ? e->taxon->get_name() + " / " + e->synonym->get_name() : e->taxon->get_name());
+    }
+    return hits;
+}
+
+void write_file(const fs::path & p, const std::string & contents) {
+    std::ofstream out(p.string());
+    out << contents;
+}
+
+// Homonyms in different parts of the tree, names that are prefixes of other names, and mixed case.
+void write_test_taxonomy(const fs::path & dir) {
+    fs::create_directories(dir);
+    write_file(dir / "version.txt", "3.2draft9\n");
+    write_file(dir / "taxonomy.tsv",
+               "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t\n"
+               "1\t|\t\t|\tlife\t|\tno rank\t|\t\t|\t\t|\t\t|\t\n"
+               "2\t|\t1\t|\tAus\t|\tgenus\t|\t\t|\tAus (genus in Bacteria)\t|\t\t|\t\n"
+               "3\t|\t1\t|\tAUS\t|\tgenus\t|\t\t|\tAUS (genus in Eukaryota)\t|\t\t|\t\n"
+               "4\t|\t2\t|\tAus bus\t|\tspecies\t|\t\t|\t\t|\t\t|\t\n"
+               "5\t|\t3\t|\tAus cus\t|\tspecies\t|\t\t|\t\t|\t\t|\t\n"
+               "6\t|\t3\t|\tAusa\t|\tgenus\t|\t\t|\t\t|\t\t|\t\n"
+               "7\t|\t6\t|\tausa bus\t|\tspecies\t|\t\t|\t\t|\t\t|\t\n"
+               "8\t|\t2\t|\tDus\t|\tgenus\t|\t\t|\t\t|\t\t|\t\n");
+    write_file(dir / "synonyms.tsv",
+               "name\t|\tuid\t|\ttype\t|\tuniqname\t|\tsourceinfo\t|\t\n"
+               "Aus bus\t|\t5\t|\tsynonym\t|\tAus bus (synonym for Aus cus)\t|\t\t|\t\n"
+               "Hus\t|\t2\t|\tsynonym\t|\tHus (synonym for Aus)\t|\t\t|\t\n"
+               "hus\t|\t3\t|\tsynonym\t|\thus (synonym for AUS)\t|\t\t|\t\n"
+               "Ausb\t|\t3\t|\tsynonym\t|\tAusb (synonym for AUS)\t|\t\t|\t\n"
+               "Aus\t|\t8\t|\tsynonym\t|\tAus (synonym for Dus)\t|\t\t|\t\n");
+}
+
+// Every name and synonym, some prefixes and case variants, in every context.
+char test_index_matches_scan(const TestHarness &) {
+    const auto dir = fs::temp_directory_path() / fs::unique_path();
+    write_test_taxonomy(dir);
+    char result = '.';
+    {
+        RichTaxonomy taxonomy(dir.string());
+        taxonomy.build_name_index();
+        const auto & index = *taxonomy.get_name_index();
+        std::set<std::string> queries = {"", "a", "AU", "zz", "aus b", "Aus bus x"};
+        for (auto nd : iter_pre_const(taxonomy.get_tax_tree())) {
+            std::string name{nd->get_data().get_nonuniqname()};
+            queries.insert(name);
+            queries.insert(TaxonNameIndex::normalize(name));
+            queries.insert(name.substr(0, 2));
+            for (auto tjs : nd->get_data().junior_synonyms) {
+                queries.insert(tjs->get_name());
+            }
+        }
+        for (auto context_root : iter_pre_const(taxonomy.get_tax_tree())) {
+            for (const auto & query : queries) {
+                for (bool prefix : {false, true}) {
+                    for (bool synonyms : {false, true}) {
+                        auto expected = scan(context_root, query, prefix, synonyms);
+                        auto obtained = lookup(index, context_root, query, prefix, synonyms);
+                        if (not test_vec_element_equality(expected, obtained)) {
+                            std::cerr << "  query '" << query << "' below " << context_root->get_name()
+                                      << (prefix ? " (prefix)" : "") << (synonyms ? " (synonyms)" : "") << '\n';
+                            result = 'F';
+                        }
+                    }
+                }
+            }
+        }
+        if (not index.find_names("aus", nullptr, false).empty()) {
+            result = 'F';
+        }
+    }
+    fs::remove_all(dir);
+    return result;
+}
+
+unsigned edit_distance(const std::string & a, const std::string & b) {
+    std::vector<std::vector<unsigned>> d(a.size() + 1, std::vector<unsigned>(b.size() + 1));
+    for (std::size_t i = 0; i <= a.size(); i++) {
+        for (std::size_t j = 0; j <= b.size(); j++) {
+            if (i == 0 or j == 0) {
+                d[i][j] = i + j;
+            } else {
+                d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            }
+        }
+    }
+    return d[a.size()][b.size()];
+}
+
+// The best-scoring name or synonym of every taxon below the context root that has one close enough
+//   to the query, with its score, and whether the taxon's own name is among the best.
+std::set<std::string> scan_approximate(const RTRichTaxNode * context_root, const std::string & query, unsigned max_distance) {
+    std::set<std::string> hits;
+    const auto q = TaxonNameIndex::normalize(query);
+    for (auto nd : iter_post_n_const(*context_root)) {
+        std::vector<std::string> names = {TaxonNameIndex::normalize(nd->get_data().get_nonuniqname())};
+        for (auto tjs : nd->get_data().junior_synonyms) {
+            names.push_back(TaxonNameIndex::normalize(tjs->get_name()));
+        }
+        double best_score = -1.0;
+        bool name_is_best = false;
+        for (std::size_t i = 0; i < names.size(); i++) {
+            auto d = edit_distance(names[i], q);
+            if (d > max_distance) {
+                continue;
+            }
+            double score = 1.0 - double(d) / double(std::max(names[i].size(), q.size()));
+            if (score > best_score) {
+                best_score = score;
+                name_is_best = (i == 0);
+            }
+        }
+        if (best_score >= 0.0) {
+            hits.insert(nd->get_name() + (name_is_best ? " " : " / synonym ") + std::to_string(best_score));
+        }
+    }
+    return hits;
+}
+
+// Approximate matches agree with computing the edit distance to every name, give each taxon once
+//   with its best-scoring name, and come out best first.
+char test_approximate_matches_scan(const TestHarness &) {
+    const auto dir = fs::temp_directory_path() / fs::unique_path();
+    write_test_taxonomy(dir);
+    char result = '.';
+    {
+        RichTaxonomy taxonomy(dir.string());
+        taxonomy.build_name_index();
+        const auto & index = *taxonomy.get_name_index();
+        const std::vector<std::string> queries = {"", "a", "aus", "Ausx", "sua", "Aus bu", "aus cbus", "AUSA BUS", "dsu", "hux", "zzzzzz"};
+        for (auto context_root : iter_pre_const(taxonomy.get_tax_tree())) {
+            for (const auto & query : queries) {
+                for (unsigned max_distance : {0U, 1U, 2U, 3U}) {
+                    auto expected = scan_approximate(context_root, query, max_distance);
+                    std::set<std::string> obtained;
+                    std::size_t num_matches = 0;
+                    unsigned last_distance = 0;
+                    for (const auto & m : index.find_approximate(query, context_root, max_distance)) {
+                        const auto & e = *m.entry;
+                        obtained.insert(e.taxon->get_name() + (e.synonym ? " / synonym " : " ") + std::to_string(m.score));
+                        num_matches++;
+                        if (m.distance < last_distance or m.score > 1.0) {
+                            result = 'F';
+                        }
+                        last_distance = m.distance;
+                    }
+                    if (expected != obtained or num_matches != obtained.size()) {
+                        std::cerr << "  approximate query '" << query << "' below " << context_root->get_name()
+                                  << " within " << max_distance << '\n';
+                        result = 'F';
+                    }
+                }
+            }
+        }
+    }
+    fs::remove_all(dir);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn{"index matches scan", test_index_matches_scan},
+                   TestFn{"approximate matches scan", test_approximate_matches_scan}};
+    return th.run_tests(tests);
+}
@@ -69,11 +69,11 @@ struct hash<pair<T,U>> {
 using Tree_t = ConflictTree;
 using node_t = Tree_t::node_type;
 
-void compute_summary_leaves(Tree_t& tree, const map<OttId,Tree_t::node_type*>& summaryOttIdToNode);
+void compute_summary_leaves(Tree_t& tree, const OttIdIndex<Tree_t::node_type*>& summaryOttIdToNode);
 string get_source_node_name_if_available(const Tree_t::node_type* node);
 
 // uses the OTT Ids in `tree` to fill in the `summary_node` field of each leaf
-void compute_summary_leaves(Tree_t& tree, const map<OttId,Tree_t::node_type*>& summaryOttIdToNode) {
+void compute_summary_leaves(Tree_t& tree, const OttIdIndex<Tree_t::node_type*>& summaryOttIdToNode) {
     for(auto leaf: iter_leaf(tree)) {
         summary_node(leaf) = summaryOttIdToNode.at(leaf->get_ott_id());
     }
@@ -249,11 +249,14 @@ json gen_json(const Tree_t& summaryTree, const map<string,string>& monotypic_nod
 }
 
 void mapNextTree(const Tree_t& summaryTree,
-                 const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
+                 const LCAIndex<const Tree_t::node_type>& summary_lca,
+                 const OttIdIndex<const Tree_t::node_type*>& constSummaryOttIdToNode,
                  const Tree_t & tree,
                  const string& source_name) {
     typedef Tree_t::node_type node_type;
-    std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
+    LCAIndex<const node_type> tree_lca(tree.get_root());
+    std::function<const node_type*(const node_type*,const node_type*)> tree_mrca = [&tree_lca](const node_type* n1, const node_type* n2) {return tree_lca.mrca(n1,n2);};
+    std::function<const node_type*(const node_type*,const node_type*)> summary_mrca = [&summary_lca](const node_type* n1, const node_type* n2) {return summary_lca.mrca(n1,n2);};
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
     {
         auto log_supported_by    = [&](const node_t* node2, const node_t* node1) {set_supported_by(node2,node1,source_name);};
@@ -262,8 +265,8 @@ void mapNextTree(const Tree_t& summaryTree,
         auto log_resolved_by     = [&](const node_t* node2, const node_t* node1) {set_resolved_by(node2,node1,source_name);};
         auto log_terminal        = [&](const node_t* node2, const node_t* node1) {set_terminal(node2,node1,source_name);};
 
-        perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
-                                  summaryTree, constSummaryOttIdToNode, mrca_of_pair,
+        perform_conflict_analysis(tree, ottid_to_node, tree_mrca,
+                                  summaryTree, constSummaryOttIdToNode, summary_mrca,
                                   log_supported_by,
                                   log_partial_path_of,
                                   log_conflicts_with,
@@ -277,8 +280,8 @@ void mapNextTree(const Tree_t& summaryTree,
         auto log_resolved_by     = [&](const node_t* node2, const node_t* node1) {set_resolves(node1,node2,source_name);};
         auto log_terminal        = [&](const node_t*, const node_t*) {};
 
-        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
-                                  tree, ottid_to_node, mrca_of_pair,
+        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, summary_mrca,
+                                  tree, ottid_to_node, tree_mrca,
                                   log_supported_by,
                                   log_partial_path_of,
                                   log_conflicts_with,
@@ -300,6 +303,7 @@ int main(int argc, char *argv[]) {
         auto constSummaryOttIdToNode = get_ottid_to_const_node_map(*summaryTree);
         auto monotypic_nodes = suppress_and_record_monotypic(*summaryTree);
         compute_depth(*summaryTree);
+        const LCAIndex<const Tree_t::node_type> summary_lca(summaryTree->get_root());
         // 2. Load and process input trees.
         json sources;
         for(const auto& filename: inputs) {
@@ -307,7 +311,7 @@ int main(int argc, char *argv[]) {
             compute_depth(*tree);
             compute_summary_leaves(*tree, summaryOttIdToNode);
             string source_name = source_from_tree_name(tree->get_name());
-            mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, source_name);
+            mapNextTree(*summaryTree, summary_lca, constSummaryOttIdToNode, *tree, source_name);
             sources.push_back(source_name);
         }
         // 3. Generate json document and print it.
@@ -184,7 +184,7 @@ struct FindUnsupportedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
                 // not in taxoSummary, or having real (non-name-only) support
                 if ((!isTaxoSummary) || (t & SEEN_IN_AN_INPUT_BOTH)) {
                     if (isTaxoSummary) {
-                        const OttIdSet & di = nd->get_data().des_ids;
+                        const auto & di = nd->get_data().des_ids;
                         if (nd->has_ott_id()) {
                             const auto ottId = nd->get_ott_id();
                             const auto taxoNode = taxonomy->get_data().get_node_by_ott_id(ottId);
@@ -474,7 +474,7 @@ struct FindUnsupportedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
         if (par == nullptr) {
             return;
         }
-        const OttIdSet * nmp = nullptr;
+        const DesIdSet * nmp = nullptr;
         if (nd->is_outdegree_one_node()) {
             if (!nd->has_ott_id()) {
                 return;
@@ -1,5 +1,8 @@
 // See https://github.com/OpenTreeOfLife/opentree/wiki/Open-Tree-of-Life-APIs-v3#synthetic-tree
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <tuple>
 #include <sstream>
 #include <cstring>
@@ -7,6 +10,7 @@
 #include <unordered_set>
 #include "otc/conflict.h"
 #include "otc/otcli.h"
+#include "otc/run_jobs.h"
 #include "otc/supertree_util.h"
 #include "otc/tree_operations.h"
 
@@ -48,8 +52,13 @@ variables_map parse_cmd_line(int argc,char* argv[])
         ("names,N","Write out node names instead of counts.")
         ;
 
+    options_description parallel("Parallelism options");
+    parallel.add_options()
+        ("threads,j",value<unsigned>(),"Number of input trees to compare at once (default: number of cores)")
+        ;
+
     options_description visible;
-    visible.add(reporting).add(otc::standard_options());
+    visible.add(reporting).add(parallel).add(otc::standard_options());
 
     // positional options
     positional_options_description p;
@@ -79,11 +88,11 @@ struct hash<pair<T,U>> {
 using Tree_t = ConflictTree;
 using node_t = Tree_t::node_type;
 
-void compute_summary_leaves(Tree_t& tree, const map<OttId,Tree_t::node_type*>& summaryOttIdToNode);
+void compute_summary_leaves(Tree_t& tree, const OttIdIndex<Tree_t::node_type*>& summaryOttIdToNode);
 string get_source_node_name_if_available(const Tree_t::node_type* node);
 
 // uses the OTT Ids in `tree` to fill in the `summary_node` field of each leaf
-void compute_summary_leaves(Tree_t& tree, const map<OttId,Tree_t::node_type*>& summaryOttIdToNode) {
+void compute_summary_leaves(Tree_t& tree, const OttIdIndex<Tree_t::node_type*>& summaryOttIdToNode) {
     for(auto leaf: iter_leaf(tree)) {
         summary_node(leaf) = summaryOttIdToNode.at(leaf->get_ott_id());
     }
@@ -150,11 +159,14 @@ void add_element(set<pair<string, string>>& s,
 }
 
 void mapNextTree1(const Tree_t& summaryTree,
-                  const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
+                  const LCAIndex<const Tree_t::node_type>& summary_lca,
+                  const OttIdIndex<const Tree_t::node_type*>& constSummaryOttIdToNode,
                   const Tree_t & tree,
                   stats& s) {
     typedef Tree_t::node_type node_type;
-    std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
+    LCAIndex<const node_type> tree_lca(tree.get_root());
+    std::function<const node_type*(const node_type*,const node_type*)> tree_mrca = [&tree_lca](const node_type* n1, const node_type* n2) {return tree_lca.mrca(n1,n2);};
+    std::function<const node_type*(const node_type*,const node_type*)> summary_mrca = [&summary_lca](const node_type* n1, const node_type* n2) {return summary_lca.mrca(n1,n2);};
     string source_name = source_from_tree_name(tree.get_name());
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
     {
@@ -164,8 +176,8 @@ void mapNextTree1(const Tree_t& summaryTree,
         auto log_resolved_by     = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.resolved_by,node2,node1,source_name);};
         auto log_terminal        = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.terminal,node2,node1,source_name);};
 
-        perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
-                                  summaryTree, constSummaryOttIdToNode, mrca_of_pair,
+        perform_conflict_analysis(tree, ottid_to_node, tree_mrca,
+                                  summaryTree, constSummaryOttIdToNode, summary_mrca,
                                   log_supported_by,
                                   log_partial_path_of,
                                   log_conflicts_with,
@@ -176,8 +188,8 @@ void mapNextTree1(const Tree_t& summaryTree,
         auto nothing    = [](const node_t*, const node_t*) {};
         auto log_resolved_by     = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.resolves,node1,node2,source_name);};
 
-        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
-                                  tree, ottid_to_node, mrca_of_pair,
+        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, summary_mrca,
+                                  tree, ottid_to_node, tree_mrca,
                                   nothing,
                                   nothing,
                                   nothing,
@@ -187,11 +199,14 @@ void mapNextTree1(const Tree_t& summaryTree,
 }
 
 void mapNextTree2(const Tree_t& summaryTree,
-                  const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
+                  const LCAIndex<const Tree_t::node_type>& summary_lca,
+                  const OttIdIndex<const Tree_t::node_type*>& constSummaryOttIdToNode,
                   const Tree_t & tree,
                   stats& s) {
     typedef Tree_t::node_type node_type;
-    std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
+    LCAIndex<const node_type> tree_lca(tree.get_root());
+    std::function<const node_type*(const node_type*,const node_type*)> tree_mrca = [&tree_lca](const node_type* n1, const node_type* n2) {return tree_lca.mrca(n1,n2);};
+    std::function<const node_type*(const node_type*,const node_type*)> summary_mrca = [&summary_lca](const node_type* n1, const node_type* n2) {return summary_lca.mrca(n1,n2);};
     string source_name = source_from_tree_name(summaryTree.get_name());
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
     {
@@ -201,8 +216,8 @@ void mapNextTree2(const Tree_t& summaryTree,
         auto log_resolved_by     = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.resolved_by,node2,node1,source_name);};
         auto log_terminal        = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.terminal,node2,node1,source_name);};
 
-        perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
-                                  summaryTree, constSummaryOttIdToNode, mrca_of_pair,
+        perform_conflict_analysis(tree, ottid_to_node, tree_mrca,
+                                  summaryTree, constSummaryOttIdToNode, summary_mrca,
                                   log_supported_by,
                                   log_partial_path_of,
                                   log_conflicts_with,
@@ -212,8 +227,8 @@ void mapNextTree2(const Tree_t& summaryTree,
     {
         auto nothing    = [](const node_t*, const node_t*) {};
         auto log_resolved_by     = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.resolves,node1,node2,source_name);};
-        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
-                                  tree, ottid_to_node, mrca_of_pair,
+        perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, summary_mrca,
+                                  tree, ottid_to_node, tree_mrca,
                                   nothing,
                                   nothing,
                                   nothing,
@@ -223,17 +238,27 @@ void mapNextTree2(const Tree_t& summaryTree,
 }
 
 void mapNextTree(const Tree_t& summaryTree,
-                 const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
+                 const LCAIndex<const Tree_t::node_type>& summary_lca,
+                 const OttIdIndex<const Tree_t::node_type*>& constSummaryOttIdToNode,
                  const Tree_t & tree,
                  stats& s, //isTaxoComp is third param
                  bool sw) {
     if (not sw) {
-        mapNextTree1(summaryTree, constSummaryOttIdToNode, tree, s);
+        mapNextTree1(summaryTree, summary_lca, constSummaryOttIdToNode, tree, s);
     } else {
-        mapNextTree2(summaryTree, constSummaryOttIdToNode, tree, s);
+        mapNextTree2(summaryTree, summary_lca, constSummaryOttIdToNode, tree, s);
     }
 }
 
+void merge_stats(stats& into, const stats& from) {
+    into.supported_by.insert(from.supported_by.begin(), from.supported_by.end());
+    into.partial_path_of.insert(from.partial_path_of.begin(), from.partial_path_of.end());
+    into.terminal.insert(from.terminal.begin(), from.terminal.end());
+    into.conflicts_with.insert(from.conflicts_with.begin(), from.conflicts_with.end());
+    into.resolves.insert(from.resolves.begin(), from.resolves.end());
+    into.resolved_by.insert(from.resolved_by.begin(), from.resolved_by.end());
+}
+
 void show_header(std::ostream& o) {
     o << "supported_by" << "\t" << "partial_path_of" << "\t" << "terminal" << "\t" << "conflicts_with" << "\t" << "resolves" << "\t" << "resolved_by" << "\tname\n";
 }
@@ -269,6 +294,8 @@ int main(int argc, char *argv[]) {
         bool all = args["all"].as<bool>();
         bool names = args.count("names");
         bool sw = args.count("switch");
+        unsigned n_threads = args.count("threads") ? args["threads"].as<unsigned>() : std::thread::hardware_concurrency();
+        n_threads = std::max(n_threads, 1U);
         if (not each and not all) {
             throw OTCError() << "No output requested.";
         }
@@ -278,30 +305,43 @@ int main(int argc, char *argv[]) {
         auto constSummaryOttIdToNode = get_ottid_to_const_node_map(*summaryTree);
         auto monotypic_nodes = suppress_and_record_monotypic(*summaryTree);
         compute_depth(*summaryTree);
-        stats global;
-        // 2. Load and process input trees.
+        const LCAIndex<const Tree_t::node_type> summary_lca(summaryTree->get_root());
+        // 2. Load and process input trees, several at once.  The summary tree and its indices are
+        //    shared by all of them, and only read, so each tree is compared against it once.
+        // 3. Write out the stats of each tree as soon as those of the trees before it have been
+        //    written, so that they come out in the order of the input trees and are then dropped.
         if (not names) {
             show_header(std::cout);
         }
-        for(const auto& filename: inputs) {
-            auto tree = get_tree<Tree_t>(filename);
+        stats global;
+        std::mutex output_mutex;
+        std::map<std::size_t, pair<stats, string>> finished;
+        std::size_t next_to_write = 0;
+        run_jobs_on_threads(inputs.size(), n_threads - 1, [&](std::size_t i) {
+            pair<stats, string> result;
+            auto tree = get_tree<Tree_t>(inputs[i]);
             compute_depth(*tree);
             compute_summary_leaves(*tree, summaryOttIdToNode);
-            string source_name = source_from_tree_name(tree->get_name());
-            if (all) {
-                mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, global, sw);
-            }
-            if (each) {
-                stats local;
-                mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, local, sw);
-                if (names) {
-                    show_names(std::cout, local, source_name);
-                } else {
-                    show_stats(std::cout, local, source_name);
+            result.second = source_from_tree_name(tree->get_name());
+            mapNextTree(*summaryTree, summary_lca, constSummaryOttIdToNode, *tree, result.first, sw);
+            tree.reset();
+            std::lock_guard<std::mutex> lock(output_mutex);
+            finished.emplace(i, std::move(result));
+            for (auto it = finished.begin(); it != finished.end() and it->first == next_to_write; it = finished.erase(it)) {
+                const auto & [tree_stats, source_name] = it->second;
+                if (each) {
+                    if (names) {
+                        show_names(std::cout, tree_stats, source_name);
+                    } else {
+                        show_stats(std::cout, tree_stats, source_name);
+                    }
                 }
+                if (all) {
+                    merge_stats(global, tree_stats);
+                }
+                next_to_write++;
             }
-        }
-        // 3. Write out the stats
+        });
         if (all and names) {
             show_names(std::cout, global, "ALL");
         } else if (all) {
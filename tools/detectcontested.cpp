@@ -53,7 +53,7 @@ struct DetectContestedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
                 tctnlIt->second.push_back(nd);
             }
         }
-        std::set<OttIdSet > sourceClades;
+        std::set<DesIdSet> sourceClades;
         for (auto nd : iter_post_internal(tree)) {
             if (nd->get_parent() != nullptr && !nd->is_tip()) {
                 sourceClades.insert(std::move(nd->get_data().des_ids));
@@ -65,7 +65,7 @@ struct DetectContestedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
     }
 
     void recordContested(const std::map<OttIdSet, std::list<const NodeWithSplits *> > & prunedDesId,
-                         const std::set<OttIdSet > & sourceClades,
+                         const std::set<DesIdSet> & sourceClades,
                          std::set<const NodeWithSplits *> & contestedSet,
                          std::size_t numLeaves,
                          const std::string &treeName) {
@@ -57,7 +57,7 @@ inline NDSE operator|(NDSE f, NDSB s) {
 std::pair<NDSE, const NodeWithSplits *>
 classifyInpNode(const TreeMappedWithSplits & summaryTree,
                      const NodeWithSplits * nd,
-                     const OttIdSet & leaf_set,
+                     const DesIdSet & leaf_set,
                      const NodeWithSplits * startSummaryNd,
                      bool isTaxoComp=false);
 
@@ -71,7 +71,7 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
 std::pair<NDSE, const NodeWithSplits *>
 classifyInpNode(const TreeMappedWithSplits & summaryTree,
                      const NodeWithSplits * nd,
-                     const OttIdSet & leaf_set,
+                     const DesIdSet & leaf_set,
                      const NodeWithSplits * startSummaryNd,
                      bool isTaxoComp) {
     using CN = std::pair<NDSE, const NodeWithSplits *>;
@@ -6,7 +6,7 @@ using namespace otc;
 // which is compiled from ../doc/otc-find-resolution.tex
 
 template <typename T, typename U>
-U * resolveNode(T & tree, U & parent, const OttIdSet & newInc) {
+U * resolveNode(T & tree, U & parent, const DesIdSet & newInc) {
     std::set<U *> childrenToMove;
     for (auto nd : iter_child(parent)) {
         if (!are_disjoint(nd->get_data().des_ids, newInc)) {
@@ -20,7 +20,7 @@ U * resolveNode(T & tree, U & parent, const OttIdSet & newInc) {
     for (auto phChild : childrenToMove) {
         phChild->detach_this_node();
         insertedNodePtr->add_child(phChild);
-        const OttIdSet & cd = phChild->get_data().des_ids;
+        const auto & cd = phChild->get_data().des_ids;
         insertedNodePtr->get_data().des_ids.insert(cd.begin(), cd.end());
     }
     assert(phPar->get_out_degree() > 1);
@@ -33,18 +33,18 @@ struct FindResolutionState;
 class SupportingIDSets {
     public:
     typedef OttIdSet leafSetContainer;
-    typedef std::tuple<const OttIdSet *, const leafSetContainer *, const char *> incLSTreeNameTuple;
+    typedef std::tuple<const DesIdSet *, const leafSetContainer *, const char *> incLSTreeNameTuple;
     typedef std::list<incLSTreeNameTuple> listIncLSTreeNameTuple;
     listIncLSTreeNameTuple supporting;
     typedef std::list<listIncLSTreeNameTuple::iterator> listLIncLSTreeNameIt;
-    void addSupport(const OttIdSet *i, const leafSetContainer *pi, const char * treeName) {
+    void addSupport(const DesIdSet *i, const leafSetContainer *pi, const char * treeName) {
         supporting.push_back(incLSTreeNameTuple{i, pi, treeName});
     }
     bool attemptSplitOfSupport(OTCLI & otCLI,
                                const NodeWithSplits *nd,
                                FindResolutionState & frs,
                                const TreeMappedWithSplits & inpTree,
-                               const OttIdSet & incAdded);
+                               const DesIdSet & incAdded);
     bool causesChildToBeUnsupported(OTCLI & otCLI,
                                     const NodeWithSplits *added,
                                     FindResolutionState & frs);
@@ -212,7 +212,7 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
         }
 
         //srcNode supports nd
-        const OttIdSet * sip = &(srcNode->get_data().des_ids);
+        const DesIdSet * sip = &(srcNode->get_data().des_ids);
         auto sna = find_first_forking_anc<const NodeWithSplits>(srcNode);
         assert(sna != nullptr);
         const auto * tls = getStableLeafSetPtr(tree);
@@ -233,7 +233,7 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
 
 
     void attemptResolutionFromSourceTree(OTCLI & otCLI, TreeMappedWithSplits & tree) {
-        const OttIdSet & treeLeafSet = tree.get_root()->get_data().des_ids;
+        const auto & treeLeafSet = tree.get_root()->get_data().des_ids;
         std::set<const NodeWithSplits *> nodesFromInp;
         for (auto nd : iter_pre_internal_const(tree)) {
             if (nd->get_parent() != nullptr) {
@@ -243,7 +243,7 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
         while (!nodesFromInp.empty()) {
             std::map<NodeWithSplits *, std::list<const NodeWithSplits *> > summaryTreeToResolveNodeToResolves;
             for (const auto nd : nodesFromInp) {
-                const OttIdSet & incGroup = nd->get_data().des_ids;
+                const auto & incGroup = nd->get_data().des_ids;
                 auto r = find_mrca_using_des_ids(*summaryTreeToResolve, incGroup);
                 if (contains(protectedPolytomy, r)) {
                     continue; // skip protected
@@ -253,15 +253,15 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
                     continue;
                 }
                 assert(mrca);
-                OttIdSet md = mrca->get_data().des_ids;
-                const OttIdSet rmd = set_intersection_as_set(md, treeLeafSet);
+                const auto & md = mrca->get_data().des_ids;
+                const auto rmd = set_intersection_as_set(md, treeLeafSet);
                 // If the polytomy does not have any members of nd's 
                 //  exclude group, then nd cannot resolve it and support
                 //  the new edge.
                 if (incGroup == rmd) {
                     continue;
                 }
-                const OttIdSet excGroup = set_difference_as_set(treeLeafSet, incGroup);
+                const auto excGroup = set_difference_as_set(treeLeafSet, incGroup);
                 if (can_be_resolved_to_display_inc_exc_group(mrca, incGroup, excGroup)) {
                     if (addGroups) {
                         summaryTreeToResolveNodeToResolves[mrca].push_back(nd);
@@ -297,7 +297,7 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
                            NodeWithSplits * ndToResolve,
                            const TreeMappedWithSplits & inpTree,
                            const NodeWithSplits * ndToAdd) {
-        const OttIdSet & incGroup = ndToAdd->get_data().des_ids;
+        const auto & incGroup = ndToAdd->get_data().des_ids;
         if (otCLI.verbose) {
             otCLI.err << "processAddableNode ndToResolve = ";
             describe_unnamed_node(*ndToResolve, otCLI.err, 0, false, true);
@@ -359,7 +359,7 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
                            TreeMappedWithSplits & ,
                            NodeWithSplits * par,
                            const TreeMappedWithSplits & inpTree,
-                           const OttIdSet & incAdded,
+                           const DesIdSet & incAdded,
                            NodeWithSplits * added) {
         assert(par != nullptr);
         assert(added != nullptr);
@@ -411,7 +411,7 @@ inline bool SupportingIDSets::causesChildToBeUnsupported(OTCLI & otCLI,
         }
     }
     LOG(DEBUG) << forkingDes.size() << " supporting statements of children to check.";
-    const OttIdSet & incAdded = added->get_data().des_ids;
+    const auto & incAdded = added->get_data().des_ids;
     std::map<const NodeWithSplits *, listLIncLSTreeNameIt > toDelMap;
     for (auto fdIt : forkingDes) {
         const NodeWithSplits * fc = fdIt.first;
@@ -445,18 +445,18 @@ inline bool SupportingIDSets::attemptSplitOfSupport(OTCLI & otCLI,
                                                     const NodeWithSplits *added,
                                                     FindResolutionState & frs,
                                                     const TreeMappedWithSplits & ,
-                                                    const OttIdSet & ) {
+                                                    const DesIdSet & ) {
     //every support statement for this node, should either:
     //  1. stay in SupportingIDSets, or
     //  2. be removed
     assert(added != nullptr);
     auto p = added->get_parent(); // p is the node that is the key for `this` SupportingIDSets
     assert(p != nullptr);
-    const OttIdSet & nddi = added->get_data().des_ids;
+    const auto & nddi = added->get_data().des_ids;
     listLIncLSTreeNameIt toDel;
     auto sIt = begin(supporting);
     for (; sIt != end(supporting); ++sIt) {
-        const OttIdSet & suppInc = *std::get<0>(*sIt);
+        const auto & suppInc = *std::get<0>(*sIt);
         //const leafSetContainer & leafSetInp = *(sIt->second);
         //if (otCLI.verbose) {
         //    otCLI.err << "suppInc ";
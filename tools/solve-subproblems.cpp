@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+#include "otc/otcli.h"
+#include "otc/run_jobs.h"
+#include "otc/solve_subproblem.h"
+
+using namespace otc;
+namespace fs = boost::filesystem;
+
+using std::vector;
+using std::unique_ptr;
+using std::string;
+
+typedef TreeMappedWithSplits Tree_t;
+
+namespace po = boost::program_options;
+using po::variables_map;
+
+variables_map parse_cmd_line(int argc,char* argv[]) {
+    using namespace po;
+
+    // named options
+    options_description invisible("Invisible options");
+    invisible.add_options()
+        ("subproblem-ids", value<string>(),"File listing the subproblem files, one per line (e.g. step_7/subproblem-ids.txt).")
+        ;
+
+    options_description output("Standard options");
+    output.add_options()
+        ("subproblem-dir,d",value<string>(), "Directory holding the subproblems (default: the directory of the id file)")
+        ("solution-dir,o",value<string>(), "Directory to write the <id>-solution.tre files into")
+        ("threads,j",value<unsigned>(), "Number of subproblems to solve at once (default: number of cores)")
+        ("incertae-sedis,I",value<string>(),"File containing Incertae sedis ids")
+        ("root-name,n",value<string>(), "Rename the root of every solution to this name")
+        ("no-higher-tips,l", "Tips may be internal nodes on the taxonomy.")
+        ("prune-unrecognized,p","Prune unrecognized tips");
+
+    options_description other("Other options");
+    other.add_options()
+        ("synthesize-taxonomy,T","Make unresolved taxonomy from input tips.")
+        ("allow-no-ids,a", "Allow problems w/o OTT ids")
+        ("no-incremental", "Re-run BUILD from scratch for every split (slow; for timing comparisons).")
+        ;
+
+    options_description visible;
+    visible.add(output).add(other).add(otc::standard_options());
+
+    // positional options
+    positional_options_description p;
+    p.add("subproblem-ids", 1);
+
+    variables_map vm = otc::parse_cmd_line_standard(argc, argv,
+                                                    "Usage: otc-solve-subproblems <subproblem-ids-file> -o <solution-dir> [OPTIONS]\n"
+                                                    "Solves every subproblem listed in the id file, as otc-solve-subproblem would.\n"
+                                                    "Subproblems are solved in parallel, largest first, in a single process.\n"
+                                                    "The solution to <id>.tre is written to <solution-dir>/<id>-solution.tre",
+                                                    visible, invisible, p);
+    return vm;
+}
+
+vector<string> read_subproblem_ids(const string& filename) {
+    std::ifstream file(filename);
+    if (not file) {
+        throw OTCError() << "Cannot open subproblem id file '" << fs::absolute(filename) << "'";
+    }
+    vector<string> ids;
+    string line;
+    while (std::getline(file, line)) {
+        line = strip_surrounding_whitespace(line);
+        if (not line.empty()) {
+            ids.push_back(line);
+        }
+    }
+    return ids;
+}
+
+/// Solve the subproblem in @subproblem_path and write its solution to @solution_path.
+void solve_one(const fs::path& subproblem_path,
+               const fs::path& solution_path,
+               const ParsingRules& rules,
+               const OttIdSet& incertae_sedis,
+               const SolveSubproblemOptions& options) {
+    vector<unique_ptr<Tree_t>> trees = get_trees<Tree_t>(subproblem_path.string(), rules);
+    if (trees.empty()) {
+        throw OTCError("No trees loaded!");
+    }
+    prepare_subproblem_trees(trees, options);
+    auto tree = solve_subproblem(trees, incertae_sedis, options);
+    // Write to a temporary file first, so that an interrupted run never leaves a truncated solution behind.
+    auto tmp_path = solution_path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out(tmp_path.string());
+        if (not out) {
+            throw OTCError() << "Cannot open solution file '" << tmp_path.string() << "' for writing";
+        }
+        write_tree_as_newick(out, *tree);
+        out << "\n";
+    }
+    fs::rename(tmp_path, solution_path);
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        // 1. Parse command line arguments
+        variables_map args = parse_cmd_line(argc,argv);
+        if (not args.count("subproblem-ids")) {
+            throw OTCError("No subproblem id file provided!");
+        }
+        if (not args.count("solution-dir")) {
+            throw OTCError("No solution directory provided! Use -o <dir>");
+        }
+        ParsingRules rules;
+        rules.set_ott_ids = not (bool)args.count("allow-no-ids");
+        rules.prune_unrecognized_input_tips = (bool)args.count("prune-unrecognized");
+        SolveSubproblemOptions options;
+        options.set_ott_ids = rules.set_ott_ids;
+        options.synthesize_taxonomy = (bool)args.count("synthesize-taxonomy");
+        options.clade_tips = not (bool)args.count("no-higher-tips");
+        options.verbose = (bool)args.count("verbose");
+        options.incremental = not (bool)args.count("no-incremental");
+        if (args.count("root-name")) {
+            options.root_name = args["root-name"].as<string>();
+        }
+        const string id_filename = args["subproblem-ids"].as<string>();
+        const fs::path subproblem_dir = args.count("subproblem-dir") ? fs::path(args["subproblem-dir"].as<string>())
+                                                                      : fs::path(id_filename).parent_path();
+        const fs::path solution_dir = args["solution-dir"].as<string>();
+        unsigned n_threads = args.count("threads") ? args["threads"].as<unsigned>() : std::thread::hardware_concurrency();
+        n_threads = std::max(n_threads, 1U);
+        fs::create_directories(solution_dir);
+
+        // 2. Load the shared, read-only state once.
+        OttIdSet incertae_sedis;
+        if (args.count("incertae-sedis")) {
+            incertae_sedis = load_incertae_sedis_ids(args["incertae-sedis"].as<string>());
+        }
+
+        // 3. Queue the subproblems, largest first, so that the long solves start early and the small ones fill in the gaps.
+        struct Job {
+            string id;
+            fs::path path;
+            std::uintmax_t size;
+        };
+        vector<Job> jobs;
+        for(const auto& id: read_subproblem_ids(id_filename)) {
+            auto path = subproblem_dir / id;
+            if (not fs::exists(path)) {
+                throw OTCError() << "Subproblem file '" << path.string() << "' does not exist";
+            }
+            jobs.push_back({id, path, fs::file_size(path)});
+        }
+        std::stable_sort(jobs.begin(), jobs.end(), [](const Job& j1, const Job& j2) {return j1.size > j2.size;});
+        LOG(INFO) << "Solving " << jobs.size() << " subproblems on " << n_threads << " threads.";
+
+        // 4. Each thread takes the next unsolved subproblem until none are left.  A failed
+        //    subproblem is reported at the end rather than stopping the others.
+        std::mutex failures_mutex;
+        vector<string> failures;
+        run_jobs_on_threads(jobs.size(), n_threads - 1, [&](std::size_t i) {
+            const auto& job = jobs[i];
+            auto solution_path = solution_dir / (fs::path(job.id).stem().string() + "-solution.tre");
+            try {
+                solve_one(job.path, solution_path, rules, incertae_sedis, options);
+                LOG(INFO) << "Solved " << job.id;
+            } catch (std::exception& e) {
+                std::lock_guard<std::mutex> lock(failures_mutex);
+                LOG(ERROR) << "Failed to solve " << job.id << ": " << e.what();
+                failures.push_back(job.id);
+            }
+        });
+
+        // 5. Report failures, if any.
+        if (not failures.empty()) {
+            std::sort(failures.begin(), failures.end());
+            std::cerr << "otc-solve-subproblems: " << failures.size() << " of " << jobs.size() << " subproblems failed:";
+            for(const auto& id: failures) {
+                std::cerr << " " << id;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        return 0;
+    } catch (std::exception& e) {
+        std::cerr << "otc-solve-subproblems: Error! " << e.what() << std::endl;
+        exit(1);
+    }
+}
@@ -34,7 +34,7 @@ inline void getInformativeGroupingMaps(const T & tree2,
         }
         const auto & x = n->get_data().des_ids;
         if (x.size() > 1) {
-            tree2Splits[x] = n;
+            tree2Splits[as_ott_id_set(x)] = n;
         }
     }
 }
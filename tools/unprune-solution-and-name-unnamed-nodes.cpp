@@ -1149,7 +1149,6 @@ void report_stats(const UnpruneStats & unprune_stats, ostream * statsStreamPtr)
     const auto numForkingTaxaRejected = numTaxaRejected - numMonotypicTaxaRejected;
     const auto startNumSolnInternals = unprune_stats.start_num_monotypic_in_supertree + unprune_stats.start_num_forking_in_supertree;
     const auto numTaxaInternals = numTaxaMonotypicInternals + unprune_stats.num_forking_in_taxonomy;
-    const auto numInternalsAddedByUnpruning = numTaxaInternals - numTaxaRejected - unprune_stats.num_internals_merged_to_backbone;
     const auto numLeavesAdded = unprune_stats.num_leaves_in_taxonomy - unprune_stats.start_num_leaves_in_supertree;
     std::cerr << "Leaves:           solution = " << unprune_stats.start_num_leaves_in_supertree << "   taxonomy = " << unprune_stats.num_leaves_in_taxonomy << std::endl;
     std::cerr << "Internal:         solution = " << startNumSolnInternals << "   taxonomy = " << numTaxaInternals << std::endl;
@@ -0,0 +1,171 @@
+#include "ws/compression.h"
+#include "config.h"
+#include "otc/error.h"
+#include "otc/util.h"
+#include <algorithm>
+#include <zlib.h>
+#if defined(HAVE_BROTLI)
+#include <brotli/encode.h>
+#endif
+
+namespace otc {
+
+using std::string;
+
+// Quality 5 compresses text nearly as well as gzip -9, at a speed that suits compressing on the fly.
+#if defined(HAVE_BROTLI)
+const int BROTLI_QUALITY = 5;
+#endif
+
+ContentCoding negotiate_content_coding(const string & accept_encoding) {
+    ContentCoding best = ContentCoding::identity;
+    double best_q = 0.0;
+    double any_q = -1.0;
+    double explicit_q[4] = {-1.0, -1.0, -1.0, -1.0};
+    for (auto item : split_string(accept_encoding, ',')) {
+        auto parts = split_string(item, ';');
+        if (parts.empty()) {
+            continue;
+        }
+        auto token = strip_surrounding_whitespace(parts.front());
+        std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+        double q = 1.0;
+        for (auto p = std::next(parts.begin()); p != parts.end(); ++p) {
+            auto param = strip_surrounding_whitespace(*p);
+            if (param.size() > 2 and (param[0] == 'q' or param[0] == 'Q') and param[1] == '=') {
+                try {
+                    q = std::stod(param.substr(2));
+                } catch (std::exception &) {
+                    q = 0.0;
+                }
+            }
+        }
+        if (token == "*") {
+            any_q = q;
+        } else if (token == "deflate") {
+            explicit_q[int(ContentCoding::deflate)] = q;
+        } else if (token == "gzip" or token == "x-gzip") {
+            explicit_q[int(ContentCoding::gzip)] = q;
+        } else if (token == "br") {
+            explicit_q[int(ContentCoding::brotli)] = q;
+        }
+    }
+    // Later codings in the enum compress better, so they win ties.
+    for (auto coding : {ContentCoding::deflate, ContentCoding::gzip, ContentCoding::brotli}) {
+#       if !defined(HAVE_BROTLI)
+            if (coding == ContentCoding::brotli) {
+                continue;
+            }
+#       endif
+        double q = explicit_q[int(coding)] >= 0 ? explicit_q[int(coding)] : any_q;
+        if (q > 0 and q >= best_q) {
+            best = coding;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+const char * content_coding_name(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::deflate: return "deflate";
+        case ContentCoding::gzip: return "gzip";
+        case ContentCoding::brotli: return "br";
+        default: return "";
+    }
+}
+
+struct StreamCompressor::State {
+    ContentCoding coding;
+    z_stream zs;
+#   if defined(HAVE_BROTLI)
+        BrotliEncoderState * brotli = nullptr;
+#   endif
+};
+
+StreamCompressor::StreamCompressor(ContentCoding coding)
+    :state(std::make_unique<State>()) {
+    state->coding = coding;
+    if (coding == ContentCoding::deflate or coding == ContentCoding::gzip) {
+        state->zs = z_stream{};
+        // 15 bits of window, plus 16 for a gzip header and trailer instead of a zlib one.
+        const int window_bits = (coding == ContentCoding::gzip) ? 15 + 16 : 15;
+        if (deflateInit2(&state->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw OTCError("Could not start zlib compression");
+        }
+    }
+#   if defined(HAVE_BROTLI)
+        else if (coding == ContentCoding::brotli) {
+            state->brotli = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+            if (state->brotli == nullptr) {
+                throw OTCError("Could not start brotli compression");
+            }
+            BrotliEncoderSetParameter(state->brotli, BROTLI_PARAM_QUALITY, BROTLI_QUALITY);
+            BrotliEncoderSetParameter(state->brotli, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+        }
+#   endif
+}
+
+StreamCompressor::~StreamCompressor() {
+    if (state->coding == ContentCoding::deflate or state->coding == ContentCoding::gzip) {
+        deflateEnd(&state->zs);
+    }
+#   if defined(HAVE_BROTLI)
+        if (state->brotli != nullptr) {
+            BrotliEncoderDestroyInstance(state->brotli);
+        }
+#   endif
+}
+
+void StreamCompressor::compress(const string & input, bool finish, string & out) {
+    unsigned char buffer[1 << 14];
+    if (state->coding == ContentCoding::deflate or state->coding == ContentCoding::gzip) {
+        auto & zs = state->zs;
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        zs.avail_in = static_cast<uInt>(input.size());
+        int rc;
+        do {
+            zs.next_out = buffer;
+            zs.avail_out = sizeof(buffer);
+            rc = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            if (rc == Z_STREAM_ERROR) {
+                throw OTCError("zlib compression failed");
+            }
+            out.append(reinterpret_cast<const char *>(buffer), sizeof(buffer) - zs.avail_out);
+        } while (zs.avail_out == 0 or (finish and rc != Z_STREAM_END));
+        return;
+    }
+#   if defined(HAVE_BROTLI)
+        if (state->coding == ContentCoding::brotli) {
+            const auto op = finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+            std::size_t avail_in = input.size();
+            auto next_in = reinterpret_cast<const uint8_t *>(input.data());
+            for (;;) {
+                std::size_t avail_out = sizeof(buffer);
+                uint8_t * next_out = buffer;
+                if (not BrotliEncoderCompressStream(state->brotli, op, &avail_in, &next_in, &avail_out, &next_out, nullptr)) {
+                    throw OTCError("brotli compression failed");
+                }
+                out.append(reinterpret_cast<const char *>(buffer), sizeof(buffer) - avail_out);
+                const bool done = finish ? BrotliEncoderIsFinished(state->brotli) : avail_in == 0;
+                if (done and not BrotliEncoderHasMoreOutput(state->brotli)) {
+                    break;
+                }
+            }
+            return;
+        }
+#   endif
+    out += input;
+}
+
+string compress_body(const string & body, ContentCoding coding) {
+    if (coding == ContentCoding::identity) {
+        return body;
+    }
+    string compressed;
+    StreamCompressor compressor(coding);
+    compressor.compress(body, true, compressed);
+    return compressed;
+}
+
+} // namespace otc
@@ -0,0 +1,36 @@
+#ifndef OTC_COMPRESSION_H
+#define OTC_COMPRESSION_H
+
+#include <memory>
+#include <string>
+
+namespace otc {
+
+// The content codings that otc-tol-ws can apply to a response body.
+enum class ContentCoding {identity, deflate, gzip, brotli};
+
+// The best coding that the client accepts, according to its Accept-Encoding header.
+//   brotli is only chosen if the server was built with it.
+ContentCoding negotiate_content_coding(const std::string & accept_encoding);
+
+// The token for the Content-Encoding header ("" for identity).
+const char * content_coding_name(ContentCoding coding);
+
+// Compresses a body that is produced a piece at a time, so that it can be sent as it is produced.
+class StreamCompressor {
+    struct State;
+    std::unique_ptr<State> state;
+    public:
+    explicit StreamCompressor(ContentCoding coding);
+    ~StreamCompressor();
+    // Appends the compressed form of input to out.  The last piece must have finish set.
+    void compress(const std::string & input, bool finish, std::string & out);
+    StreamCompressor(const StreamCompressor &) = delete;
+    StreamCompressor & operator=(const StreamCompressor &) = delete;
+};
+
+std::string compress_body(const std::string & body, ContentCoding coding);
+
+} // namespace otc
+
+#endif
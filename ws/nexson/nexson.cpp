@@ -1,6 +1,9 @@
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <restbed>
 #include "nexson.h"
+#include "ws/nexson/study_cache.h"
 #include "otc/error.h"
 #include "ws/tolwsadaptors.h"
 
@@ -19,8 +22,9 @@ namespace otc {
 static string studyserver = "https://api.opentreeoflife.org";
 //static string studyserver = "http://localhost:8080";
 static string studybase = studyserver + "/v3/study/";
-// reference-taxonomy also caches a single study.  We could add a use_cache argument to do the same.
-json get_phylesystem_study(const string& study_id)
+// Fetch the study from the study server, on the calling thread.
+// Each read from the server times out, and a fetch gives up between chunks once should_stop() is true.
+static json fetch_phylesystem_study(const string& study_id, const std::function<bool()>& should_stop = {})
 {
     using namespace restbed;
 
@@ -43,7 +47,9 @@ json get_phylesystem_study(const string& study_id)
     // 2. Send request
     LOG(WARNING)<<"reading uri "<<uri.to_string();
 //    session->send(request, 
-    auto response = Http::sync( request );
+    auto settings = make_shared< Settings >( );
+    settings->set_connection_timeout( std::chrono::seconds( 30 ) );
+    auto response = Http::sync( request, settings );
 
 
     LOG(WARNING)<<"Status Code:    "<<response->get_status_code()<<"\n";
@@ -64,6 +70,9 @@ json get_phylesystem_study(const string& study_id)
 	string body;
 	for(int c=0;;c++)
 	{
+	    if (should_stop and should_stop())
+		throw OTCError()<<"Stopped fetching study "<<study_id;
+
 	    // 1. Read chunk size
 	    LOG(WARNING)<<"got HERE 2a1: "<<c;
 	    Http::fetch("\r\n", response);
@@ -126,6 +135,32 @@ json get_phylesystem_study(const string& study_id)
     return *j;
 }
 
+// Set by set_study_cache, before the service starts.
+static std::unique_ptr<StudyCache> study_cache;
+
+void set_study_cache(StudyCache::Options options)
+{
+    study_cache = std::make_unique<StudyCache>(std::move(options), fetch_phylesystem_study);
+}
+
+void prefetch_phylesystem_studies(const std::vector<string>& study_ids)
+{
+    if (study_cache)
+        study_cache->prefetch(study_ids);
+}
+
+json phylesystem_study_cache_stats()
+{
+    return study_cache ? study_cache->stats() : json();
+}
+
+json get_phylesystem_study(const string& study_id)
+{
+    if (study_cache)
+        return study_cache->get(study_id);
+    return fetch_phylesystem_study(study_id);
+}
+
 // See extract_tree_nexson in peyotl/nexson_syntax/__init__.py
 pair<json,json> extract_tree_nexson(const json& nexson, const string& treeid)
 {
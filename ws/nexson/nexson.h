@@ -7,11 +7,17 @@
 #include <map>
 #include "otc/tree.h"
 #include "ws/tolwsadaptors.h"
+#include "ws/nexson/study_cache.h"
 #include "json.hpp"
 
 namespace otc
 {
+    // Studies are fetched from the study server, unless set_study_cache has been called.
     nlohmann::json get_phylesystem_study(const std::string& study_id);
+    void set_study_cache(StudyCache::Options options);
+    // Starts fetching studies that a request is about to ask for.  Does nothing without a study cache.
+    void prefetch_phylesystem_studies(const std::vector<std::string>& study_ids);
+    nlohmann::json phylesystem_study_cache_stats();
     std::pair<nlohmann::json,nlohmann::json> extract_tree_nexson(const nlohmann::json& nexson, const std::string& treeid);
 
 // https://github.com/OpenTreeOfLife/reference-taxonomy/blob/master/org/opentreeoflife/taxa/Nexson.java#120
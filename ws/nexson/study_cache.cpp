@@ -0,0 +1,326 @@
+#include "ws/nexson/study_cache.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem/operations.hpp>
+#include "otc/otc_base_includes.h"
+#include "ws/tolws.h"
+
+namespace otc {
+
+namespace fs = boost::filesystem;
+using std::string;
+using nlohmann::json;
+
+// Study ids become file names, so they may only contain letters, digits, '_' and '-'.
+static bool is_valid_study_id(const string & study_id) {
+    if (study_id.empty() or study_id.size() > 64) {
+        return false;
+    }
+    for (char c : study_id) {
+        if (not (std::isalnum(static_cast<unsigned char>(c)) or c == '_' or c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::optional<json> read_study_file(const fs::path & path) {
+    std::ifstream inp(path.string());
+    if (not inp.good()) {
+        return {};
+    }
+    json j;
+    try {
+        inp >> j;
+    } catch (json::exception &) {
+        LOG(WARNING) << "study cache: could not parse " << path.string();
+        return {};
+    }
+    if (not j.count("nexml")) {
+        LOG(WARNING) << "study cache: no 'nexml' property in " << path.string();
+        return {};
+    }
+    return j;
+}
+
+StudyCache::StudyCache(Options options_, Fetcher fetch_)
+    :options(std::move(options_)),
+     fetch(std::move(fetch_)) {
+    if (not options.cache_dir.empty()) {
+        fs::create_directories(options.cache_dir);
+        // Pick up the files of an earlier run, the most recently written first.
+        std::vector<std::pair<std::time_t, string>> found;
+        for (const auto & de : fs::directory_iterator(options.cache_dir)) {
+            const auto & p = de.path();
+            if (p.extension() == ".json" and fs::is_regular_file(p)) {
+                found.emplace_back(fs::last_write_time(p), p.stem().string());
+            }
+        }
+        std::sort(found.begin(), found.end(), std::greater<>());
+        for (const auto & f : found) {
+            lru.push_back(f.second);
+            Entry entry{fs::file_size(cache_path(f.second)), f.first, std::prev(lru.end()), nullptr, {}};
+            num_bytes += entry.size;
+            entries.emplace(f.second, std::move(entry));
+        }
+        while (num_bytes > options.max_bytes and not lru.empty()) {
+            forget(lru.back());
+            num_evictions++;
+        }
+        LOG(INFO) << "study cache: " << entries.size() << " studies (" << num_bytes << " bytes) in " << options.cache_dir.string();
+    }
+    prefetcher = std::thread([this]() {run_prefetcher();});
+}
+
+StudyCache::~StudyCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    prefetch_cv.notify_all();
+    // A prefetch that is under way gives up at its next should_stop() check.
+    prefetcher.join();
+}
+
+fs::path StudyCache::phylesystem_path(const string & study_id) {
+    // As in peyotl: ids without a namespace are pg_ ids, and studies are grouped into
+    //    directories by the namespace and the last two characters of the id.
+    string id = study_id;
+    if (id.size() < 3 or id[2] != '_') {
+        id = "pg_" + id;
+    }
+    return fs::path("study") / (id.substr(0, 3) + id.substr(id.size() - 2)) / id / (id + ".json");
+}
+
+fs::path StudyCache::cache_path(const string & study_id) const {
+    return options.cache_dir / (study_id + ".json");
+}
+
+std::optional<json> StudyCache::read_local(const string & study_id) {
+    auto study = read_study_file(options.phylesystem_dir / phylesystem_path(study_id));
+    if (study) {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_local++;
+    }
+    return study;
+}
+
+std::optional<json> StudyCache::read_cached(const string & study_id) {
+    std::shared_ptr<const json> parsed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(study_id);
+        if (it == entries.end()) {
+            return {};
+        }
+        auto & entry = it->second;
+        if (options.max_age_seconds > 0 and std::time(nullptr) - entry.mtime > options.max_age_seconds) {
+            forget(study_id);
+            return {};
+        }
+        lru.splice(lru.begin(), lru, entry.lru_pos);
+        if (entry.study) {
+            parsed_lru.splice(parsed_lru.begin(), parsed_lru, entry.parsed_lru_pos);
+            parsed = entry.study;
+            num_hits++;
+        }
+    }
+    // Copy or read outside the lock: the file may be evicted meanwhile, but then we just fetch the
+    //   study again.
+    if (parsed) {
+        return *parsed;
+    }
+    auto study = read_study_file(cache_path(study_id));
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(study_id);
+    if (study) {
+        num_hits++;
+        // Unless a fetch has stored a newer copy meanwhile.
+        if (it != entries.end() and not it->second.study) {
+            keep_parsed(study_id, it->second, std::make_shared<const json>(*study));
+        }
+    } else if (it != entries.end()) {
+        forget(study_id);
+    }
+    return study;
+}
+
+// Called with the mutex held.
+void StudyCache::keep_parsed(const string & study_id, Entry & entry, std::shared_ptr<const json> study) {
+    if (options.max_parsed_studies == 0) {
+        return;
+    }
+    if (entry.study) {
+        parsed_lru.splice(parsed_lru.begin(), parsed_lru, entry.parsed_lru_pos);
+    } else {
+        parsed_lru.push_front(study_id);
+        entry.parsed_lru_pos = parsed_lru.begin();
+    }
+    entry.study = std::move(study);
+    while (parsed_lru.size() > options.max_parsed_studies) {
+        auto & oldest = entries.at(parsed_lru.back());
+        oldest.study.reset();
+        parsed_lru.pop_back();
+    }
+}
+
+// Called with the mutex held.
+void StudyCache::forget(const string & study_id) {
+    auto it = entries.find(study_id);
+    if (it == entries.end()) {
+        return;
+    }
+    num_bytes -= it->second.size;
+    lru.erase(it->second.lru_pos);
+    if (it->second.study) {
+        parsed_lru.erase(it->second.parsed_lru_pos);
+    }
+    entries.erase(it);
+    boost::system::error_code ec;
+    fs::remove(cache_path(study_id), ec);
+}
+
+void StudyCache::store(const string & study_id, std::shared_ptr<const json> study) {
+    // Write to a file of our own and rename it, so that readers never see a partial study.
+    std::ostringstream tmp_name;
+    tmp_name << study_id << ".json.tmp." << std::this_thread::get_id();
+    const auto tmp_path = options.cache_dir / tmp_name.str();
+    {
+        std::ofstream out(tmp_path.string());
+        out << *study;
+        if (not out.good()) {
+            LOG(WARNING) << "study cache: could not write " << tmp_path.string();
+            return;
+        }
+    }
+    const auto size = fs::file_size(tmp_path);
+    std::lock_guard<std::mutex> lock(mutex);
+    forget(study_id);
+    boost::system::error_code ec;
+    fs::rename(tmp_path, cache_path(study_id), ec);
+    if (ec) {
+        LOG(WARNING) << "study cache: could not rename " << tmp_path.string() << ": " << ec.message();
+        fs::remove(tmp_path, ec);
+        return;
+    }
+    lru.push_front(study_id);
+    auto & entry = entries.emplace(study_id, Entry{size, std::time(nullptr), lru.begin(), nullptr, {}}).first->second;
+    keep_parsed(study_id, entry, std::move(study));
+    num_bytes += size;
+    while (num_bytes > options.max_bytes and lru.size() > 1) {
+        forget(lru.back());
+        num_evictions++;
+    }
+}
+
+json StudyCache::get(const string & study_id) {
+    if (not is_valid_study_id(study_id)) {
+        throw OTCBadRequest() << "Bad study id '" << study_id << "'";
+    }
+    if (not options.phylesystem_dir.empty()) {
+        if (auto study = read_local(study_id)) {
+            return *study;
+        }
+    }
+    if (not options.cache_dir.empty()) {
+        if (auto study = read_cached(study_id)) {
+            return *study;
+        }
+    }
+    // Only one caller fetches a study at a time; the others wait for its result.
+    std::promise<json> promise;
+    std::shared_future<json> result;
+    bool fetch_here = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = in_flight.find(study_id);
+        if (it == in_flight.end()) {
+            result = promise.get_future().share();
+            in_flight.emplace(study_id, result);
+            fetch_here = true;
+            num_fetches++;
+        } else {
+            result = it->second;
+        }
+    }
+    if (fetch_here) {
+        try {
+            auto study = std::make_shared<const json>(fetch(study_id, [this]() {return stopping.load();}));
+            if (not options.cache_dir.empty()) {
+                store(study_id, study);
+            }
+            promise.set_value(*study);
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight.erase(study_id);
+    }
+    return result.get();
+}
+
+void StudyCache::prefetch(const std::vector<string> & study_ids) {
+    // Without a disk cache, there is nowhere to keep what we would fetch.
+    if (options.cache_dir.empty()) {
+        return;
+    }
+    // Look for local copies before taking the lock, so that other callers do not wait on the disk.
+    std::vector<string> wanted;
+    for (const auto & study_id : study_ids) {
+        if (not is_valid_study_id(study_id)) {
+            continue;
+        }
+        if (not options.phylesystem_dir.empty() and fs::exists(options.phylesystem_dir / phylesystem_path(study_id))) {
+            continue;
+        }
+        wanted.push_back(study_id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto & study_id : wanted) {
+            if (not entries.count(study_id) and not in_flight.count(study_id)) {
+                prefetch_queue.push_back(study_id);
+            }
+        }
+    }
+    prefetch_cv.notify_one();
+}
+
+void StudyCache::run_prefetcher() {
+    for (;;) {
+        string study_id;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            prefetch_cv.wait(lock, [this]() {return stopping or not prefetch_queue.empty();});
+            if (stopping) {
+                return;
+            }
+            study_id = prefetch_queue.front();
+            prefetch_queue.pop_front();
+            if (entries.count(study_id) or in_flight.count(study_id)) {
+                continue;
+            }
+        }
+        try {
+            get(study_id);
+        } catch (std::exception & e) {
+            LOG(WARNING) << "study cache: could not prefetch study '" << study_id << "': " << e.what();
+        }
+    }
+}
+
+json StudyCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    json j;
+    j["studies"] = entries.size();
+    j["bytes"] = num_bytes;
+    j["local"] = num_local;
+    j["hits"] = num_hits;
+    j["fetches"] = num_fetches;
+    j["evictions"] = num_evictions;
+    return j;
+}
+
+} // namespace otc
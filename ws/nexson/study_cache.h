@@ -0,0 +1,104 @@
+#ifndef OTC_WS_NEXSON_STUDY_CACHE_H
+#define OTC_WS_NEXSON_STUDY_CACHE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include "json.hpp"
+
+namespace otc {
+
+// Phylesystem studies (as NexSON 1.2.1) kept on disk, so that the conflict services do not have to
+//    fetch a study from the study server every time a tree of it is compared.
+// - Each study is a file <study id>.json in the cache directory.  The files are evicted least
+//   recently used first once they hold more than max_bytes, and are fetched again once they are
+//   older than max_age_seconds.  Files left by an earlier run are used too.
+// - If a local phylesystem checkout is given, studies are read from it, and are not cached.
+// - The parsed studies of the max_parsed_studies most recently used files are kept in memory, so
+//   that a hit does not parse the file again.
+// - Callers that want the same study at once share one fetch, and prefetch() fetches studies on a
+//   background thread so that a later get() does not have to wait for the study server.
+class StudyCache {
+    public:
+    // Fetches a study.  A fetch that takes a while should give up (by throwing) once should_stop()
+    //   returns true, which it does when the cache is being destroyed.
+    using Fetcher = std::function<nlohmann::json(const std::string & study_id, const std::function<bool()> & should_stop)>;
+
+    struct Options {
+        boost::filesystem::path cache_dir;        // empty: no disk cache
+        std::uintmax_t max_bytes = 1024ULL << 20;
+        long max_age_seconds = 24 * 60 * 60;      // 0: never refetch
+        std::size_t max_parsed_studies = 16;      // 0: parse the file on every hit
+        boost::filesystem::path phylesystem_dir;  // empty: no local checkout
+    };
+
+    StudyCache(Options options, Fetcher fetch);
+    ~StudyCache();
+
+    // The study, from the local checkout, the disk cache or the fetcher, in that order.
+    nlohmann::json get(const std::string & study_id);
+
+    // Queues the studies that are not cached yet to be fetched in the background.
+    void prefetch(const std::vector<std::string> & study_ids);
+
+    nlohmann::json stats() const;
+
+    // Where study_id lives in a phylesystem checkout, e.g. study/pg_09/pg_1709/pg_1709.json.
+    static boost::filesystem::path phylesystem_path(const std::string & study_id);
+
+    StudyCache(const StudyCache &) = delete;
+    StudyCache & operator=(const StudyCache &) = delete;
+
+    private:
+    struct Entry {
+        std::uintmax_t size;
+        std::time_t mtime;
+        std::list<std::string>::iterator lru_pos;
+        std::shared_ptr<const nlohmann::json> study;    // set while the study is in parsed_lru
+        std::list<std::string>::iterator parsed_lru_pos;
+    };
+    const Options options;
+    const Fetcher fetch;
+
+    mutable std::mutex mutex;
+    std::list<std::string> lru;         // study ids of the cached files, most recently used first
+    std::list<std::string> parsed_lru;  // study ids of the entries that hold a parsed study, likewise
+    std::unordered_map<std::string, Entry> entries;
+    std::uintmax_t num_bytes = 0;
+    std::map<std::string, std::shared_future<nlohmann::json>> in_flight;
+    std::uint64_t num_local = 0;
+    std::uint64_t num_hits = 0;
+    std::uint64_t num_fetches = 0;
+    std::uint64_t num_evictions = 0;
+
+    std::deque<std::string> prefetch_queue;
+    std::condition_variable prefetch_cv;
+    std::atomic<bool> stopping{false};
+    std::thread prefetcher;
+
+    boost::filesystem::path cache_path(const std::string & study_id) const;
+    std::optional<nlohmann::json> read_local(const std::string & study_id);
+    std::optional<nlohmann::json> read_cached(const std::string & study_id);
+    void store(const std::string & study_id, std::shared_ptr<const nlohmann::json> study);
+    void forget(const std::string & study_id);
+    void keep_parsed(const std::string & study_id, Entry & entry, std::shared_ptr<const nlohmann::json> study);
+    void run_prefetcher();
+};
+
+} // namespace otc
+
+#endif
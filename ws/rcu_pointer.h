@@ -0,0 +1,228 @@
+#ifndef RCU_POINTER_H
+#define RCU_POINTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace otc {
+
+// Publishes immutable versions of a T to many reader threads, in the style of read-copy-update.
+//
+// Readers never lock, and only write to memory of their own: the outermost read() on a thread
+//    marks the thread as reading (in a slot on its own cache line) with the current epoch, and
+//    then loads the published pointer.  The epoch and the pointer are only written by publish(),
+//    so their cache lines stay shared among the readers' cores.
+// Writers build a complete new T and publish() it.  The old version is retired with a new epoch,
+//    and destroyed once no thread is still in a read that started before that epoch: by publish()
+//    if nobody is reading, or else by the last of those readers when its outermost ReadGuard goes
+//    away.  Writers never wait for readers, and a thread that is not reading holds no version.
+//
+// Nested read()s of one RCUPointer on a thread see the same version as the outermost read(), so
+//    that one request never mixes two versions.
+namespace rcu_detail {
+
+class Domain {
+    public:
+    struct alignas(64) Reader {
+        std::atomic<std::uint64_t> epoch{0}; // 0 if the thread is not reading
+    };
+
+    static Domain & get() {
+        static Domain domain;
+        return domain;
+    }
+
+    Reader * add_reader() {
+        std::lock_guard<std::mutex> lock(mutex);
+        readers.emplace_back();
+        return &readers.back();
+    }
+
+    void remove_reader(Reader * reader) {
+        std::vector<std::shared_ptr<const void>> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readers.remove_if([reader](const Reader & r) {return &r == reader;});
+            take_unreachable(freed);
+        }
+    }
+
+    void enter(Reader & reader) {
+        reader.epoch.store(epoch.load());
+    }
+
+    void leave(Reader & reader) {
+        reader.epoch.store(0, std::memory_order_release);
+        if (num_retired.load(std::memory_order_relaxed) > 0) {
+            reclaim();
+        }
+    }
+
+    // Called after the pointer to old has been replaced.
+    void retire(std::shared_ptr<const void> old) {
+        std::vector<std::shared_ptr<const void>> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired.emplace_back(std::move(old), ++epoch);
+            num_retired.store(retired.size(), std::memory_order_relaxed);
+            take_unreachable(freed);
+        }
+    }
+
+    void reclaim() {
+        std::vector<std::shared_ptr<const void>> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            take_unreachable(freed);
+        }
+    }
+
+    private:
+    // Moves the retired versions that no reader can still be using into freed, so that they are
+    //   destroyed after the lock is released.  A reader that entered at epoch e loaded the pointer
+    //   after every version retired at an epoch <= e had been replaced.
+    void take_unreachable(std::vector<std::shared_ptr<const void>> & freed) {
+        std::uint64_t oldest = UINT64_MAX;
+        for (const auto & r : readers) {
+            const auto e = r.epoch.load();
+            if (e != 0 and e < oldest) {
+                oldest = e;
+            }
+        }
+        std::vector<std::pair<std::shared_ptr<const void>, std::uint64_t>> kept;
+        for (auto & v : retired) {
+            if (v.second <= oldest) {
+                freed.push_back(std::move(v.first));
+            } else {
+                kept.push_back(std::move(v));
+            }
+        }
+        retired.swap(kept);
+        num_retired.store(retired.size(), std::memory_order_relaxed);
+    }
+
+    std::mutex mutex; // taken by writers, by readers that find retired versions, and at thread start and exit
+    std::list<Reader> readers;
+    std::vector<std::pair<std::shared_ptr<const void>, std::uint64_t>> retired;
+    std::atomic<std::uint64_t> epoch{1};
+    std::atomic<std::size_t> num_retired{0};
+};
+
+// The reads in progress on one thread, over all RCUPointers.
+struct ThreadCache {
+    Domain::Reader * reader;
+    const void * owner = nullptr; // the RCUPointer that value came from, while depth > 0
+    const void * value = nullptr;
+    unsigned depth = 0; // ReadGuards alive on this thread
+    ThreadCache()
+        :reader(Domain::get().add_reader()) {
+    }
+    ~ThreadCache() {
+        Domain::get().remove_reader(reader);
+    }
+    ThreadCache(const ThreadCache &) = delete;
+    ThreadCache & operator=(const ThreadCache &) = delete;
+};
+
+inline ThreadCache & thread_cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+} // namespace rcu_detail
+
+template<typename T>
+class RCUPointer {
+    using ThreadCache = rcu_detail::ThreadCache;
+
+    mutable std::mutex mutex; // only taken to publish, or by load()
+    std::shared_ptr<const T> current;
+    std::atomic<const T *> current_ptr;
+
+    public:
+    class ReadGuard {
+        const T * ptr;
+        ThreadCache * cache;
+        public:
+        ReadGuard(const T * p, ThreadCache * c)
+            :ptr(p),
+            cache(c) {
+        }
+        ReadGuard(ReadGuard && other)
+            :ptr(other.ptr),
+            cache(other.cache) {
+            other.cache = nullptr;
+        }
+        ~ReadGuard() {
+            if (cache != nullptr and --cache->depth == 0) {
+                cache->owner = nullptr;
+                cache->value = nullptr;
+                rcu_detail::Domain::get().leave(*cache->reader);
+            }
+        }
+        const T * get() const {
+            return ptr;
+        }
+        const T & operator*() const {
+            return *ptr;
+        }
+        const T * operator->() const {
+            return ptr;
+        }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard & operator=(const ReadGuard &) = delete;
+        ReadGuard & operator=(ReadGuard &&) = delete;
+    };
+
+    explicit RCUPointer(std::shared_ptr<const T> value = {})
+        :current(std::move(value)),
+        current_ptr(current.get()) {
+    }
+
+    ReadGuard read() const {
+        auto & cache = rcu_detail::thread_cache();
+        if (cache.depth == 0) {
+            rcu_detail::Domain::get().enter(*cache.reader);
+            cache.owner = this;
+            cache.value = current_ptr.load();
+        }
+        cache.depth += 1;
+        if (cache.owner == this) {
+            return ReadGuard(static_cast<const T *>(cache.value), &cache);
+        }
+        // This thread is in the middle of reading another RCUPointer: the epoch that it entered
+        //   with keeps whatever version is current now alive too.
+        return ReadGuard(current_ptr.load(), &cache);
+    }
+
+    // Replaces the published version.  Readers that started earlier keep the version that they have.
+    void publish(std::shared_ptr<const T> value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            value.swap(current);
+            current_ptr.store(current.get());
+        }
+        if (value) {
+            rcu_detail::Domain::get().retire(std::move(value));
+        }
+    }
+
+    // The published version, without marking the thread as reading: for callers that need to hold
+    //    it past the lifetime of a ReadGuard, or that only look at it once.
+    std::shared_ptr<const T> load() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current;
+    }
+
+    RCUPointer(const RCUPointer &) = delete;
+    RCUPointer & operator=(const RCUPointer &) = delete;
+};
+
+} // namespace otc
+
+#endif
@@ -0,0 +1,105 @@
+#include "ws/response_cache.h"
+#include <cstdio>
+#include <functional>
+
+namespace otc {
+
+using std::string;
+using std::shared_ptr;
+
+string make_etag(const string & body) {
+    // 64-bit FNV-1a
+    std::uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : body) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(h));
+    return buffer;
+}
+
+ResponseCache::ResponseCache(std::size_t max_bytes, std::size_t num_shards)
+    :max_bytes_per_shard(max_bytes / std::max<std::size_t>(num_shards, 1)) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(num_shards, 1); i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+ResponseCache::Shard & ResponseCache::shard_for(const string & key) {
+    return *shards[std::hash<string>()(key) % shards.size()];
+}
+
+// The strings, plus a rough allowance for the list node, the index entry, and the shared_ptr block.
+std::size_t ResponseCache::entry_size(const string & key, const CachedResponse & response) {
+    return 2 * key.size() + response.body.size() + response.etag.size() + 160;
+}
+
+shared_ptr<const CachedResponse> ResponseCache::find(const string & key) {
+    auto & shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        num_misses++;
+        return nullptr;
+    }
+    num_hits++;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return it->second->second;
+}
+
+shared_ptr<const CachedResponse> ResponseCache::insert(const string & key, CachedResponse response) {
+    const auto size = entry_size(key, response);
+    auto cached = std::make_shared<const CachedResponse>(std::move(response));
+    if (size > max_bytes_per_shard) {
+        return cached;
+    }
+    auto & shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // Another thread may have computed the same response while we were computing ours.
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return it->second->second;
+    }
+    while (not shard.entries.empty() and shard.num_bytes + size > max_bytes_per_shard) {
+        const auto & [old_key, old_response] = shard.entries.back();
+        shard.num_bytes -= entry_size(old_key, *old_response);
+        shard.index.erase(old_key);
+        shard.entries.pop_back();
+        num_evictions++;
+    }
+    shard.entries.emplace_front(key, cached);
+    shard.index.emplace(shard.entries.front().first, shard.entries.begin());
+    shard.num_bytes += size;
+    return cached;
+}
+
+void ResponseCache::clear() {
+    for (auto & shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->entries.clear();
+        shard->num_bytes = 0;
+    }
+}
+
+nlohmann::json ResponseCache::stats() const {
+    std::size_t num_entries = 0;
+    std::size_t num_bytes = 0;
+    for (auto & shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        num_entries += shard->entries.size();
+        num_bytes += shard->num_bytes;
+    }
+    nlohmann::json j;
+    j["hits"] = num_hits.load();
+    j["misses"] = num_misses.load();
+    j["evictions"] = num_evictions.load();
+    j["entries"] = num_entries;
+    j["bytes"] = num_bytes;
+    j["max_bytes"] = max_bytes_per_shard * shards.size();
+    return j;
+}
+
+} // namespace otc
@@ -0,0 +1,67 @@
+#ifndef OTC_RESPONSE_CACHE_H
+#define OTC_RESPONSE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "json.hpp"
+#include "ws/compression.h"
+
+namespace otc {
+
+struct CachedResponse {
+    std::string body;
+    std::string etag;   // quoted, ready for the ETag header
+    ContentCoding coding = ContentCoding::identity; // how body is compressed
+};
+
+// A strong ETag for a response body: a hash of the bytes, so it is the same on every server that
+//    computes the same response.
+std::string make_etag(const std::string & body);
+
+// An in-process LRU cache of serialized responses, limited by the number of bytes it holds.
+// The cache is split into shards that are locked independently, so that requests for different
+//    keys rarely wait for each other.  Each shard evicts its own least-recently-used entries.
+class ResponseCache {
+    struct Shard {
+        using Entry = std::pair<std::string, std::shared_ptr<const CachedResponse>>;
+        std::mutex mutex;
+        std::list<Entry> entries; // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // views of the keys in entries
+        std::size_t num_bytes = 0;
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+    const std::size_t max_bytes_per_shard;
+    std::atomic<std::uint64_t> num_hits{0};
+    std::atomic<std::uint64_t> num_misses{0};
+    std::atomic<std::uint64_t> num_evictions{0};
+
+    Shard & shard_for(const std::string & key);
+    static std::size_t entry_size(const std::string & key, const CachedResponse & response);
+
+    public:
+    explicit ResponseCache(std::size_t max_bytes, std::size_t num_shards = 16);
+
+    // The cached response for key, or nullptr.
+    std::shared_ptr<const CachedResponse> find(const std::string & key);
+
+    // Caches response under key, unless it is too big for a shard, and returns it.
+    std::shared_ptr<const CachedResponse> insert(const std::string & key, CachedResponse response);
+
+    void clear();
+
+    nlohmann::json stats() const;
+
+    ResponseCache(const ResponseCache &) = delete;
+    ResponseCache & operator=(const ResponseCache &) = delete;
+};
+
+} // namespace otc
+
+#endif
@@ -1,8 +1,14 @@
-#include <regex>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include "ws/tolws.h"
 #include "ws/tolwsadaptors.h"
 #include "ws/trees_to_serve.h"
 #include "otc/conflict.h"
+#include "otc/node_naming.h"
+#include "otc/run_jobs.h"
 #include "otc/tree_operations.h"
 #include "otc/supertree_util.h"
 #include "nexson/nexson.h"
@@ -200,135 +206,45 @@ inline void add_str_to_str_or_vec_string(json & o, const string& first, const st
     }
 }
 
-#if !defined(JOINT_MAPPING_VEC)
-void add_support_info_vec(const char * tag,
-                          const vec_src_node_ids & v,
-                          json & noderepr,
-                          set<string> & usedSrcIds,
-                          const optional<string>& extra_src = {},
-                          const optional<string>& extra_node_id = {}) {
-    json o;
-    for (const auto & sni : v ) {
-        const auto study_node_pair = tts.decode_study_node_id_index(sni);
-        usedSrcIds.insert(*study_node_pair.first);
-        add_str_to_vec_string(o, study_node_pair.first, study_node_pair.second);
-    }
-    if (extra_src && extra_node_id) {
-        add_str_to_vec_string(o, *extra_src, *extra_node_id);
-    }
-    noderepr[tag] = o;
-}
-
-void add_support_info_single_element(const char * tag,
-                                     const vec_src_node_ids & v,
-                                     json & noderepr,
-                                     set<string> & usedSrcIds,
-                                     const optional<string>& extra_src = {},
-                                     const optional<string>& extra_node_id = {}) {
-    json o;
-    for (const auto & sni : v ) {
-        const auto study_node_pair = tts.decode_study_node_id_index(sni);
-        usedSrcIds.insert(*study_node_pair.first);
-        add_str_to_str(o, study_node_pair.first, study_node_pair.second);
-    }
-    if (extra_src && extra_node_id) {
-        add_str_to_str(o, *extra_src, *extra_node_id);
-    }
-    noderepr[tag] = o;
-}
-#endif
-
+// The source tree mappings of nd, as {study: node} for each kind of mapping ({study: [nodes]} for
+//   conflicts_with).  Taxa count as supported_by the taxonomy.
 void add_node_support_info(const TreesToServe & tts,
+                           const NodeSupportTable & support,
                            const SumTreeNode_t & nd,
                            json & noderepr,
                            set<string> & usedSrcIds) {
+    static const pair<SourceEdgeMappingType, const char *> mapping_tags[] = {
+        {SourceEdgeMappingType::CONFLICTS_WITH_MAPPING, "conflicts_with"},
+        {SourceEdgeMappingType::PARTIAL_PATH_OF_MAPPING, "partial_path_of"},
+        {SourceEdgeMappingType::RESOLVES_MAPPING, "resolves"},
+        {SourceEdgeMappingType::SUPPORTED_BY_MAPPING, "supported_by"},
+        {SourceEdgeMappingType::TERMINAL_MAPPING, "terminal"}
+    };
     const auto & d = nd.get_data();
-    optional<string> extra_src;
-    optional<string> extra_node_id;
-    string tmp;
+    for (const auto & [kind, tag] : mapping_tags) {
+        const auto mappings = support.get_mappings(d, kind);
+        if (mappings.empty()) {
+            continue;
+        }
+        json o;
+        for (auto sni : mappings) {
+            const auto & study_node_pair = support.get_source_node(sni);
+            usedSrcIds.insert(*study_node_pair.first);
+            if (kind == SourceEdgeMappingType::CONFLICTS_WITH_MAPPING) {
+                add_str_to_vec_string(o, *study_node_pair.first, *study_node_pair.second);
+            } else {
+                add_str_to_str(o, *study_node_pair.first, *study_node_pair.second);
+            }
+        }
+        noderepr[tag] = std::move(o);
+    }
     if (nd.has_ott_id()) {
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
-        extra_src = string("ott") + taxonomy.get_version();
-        extra_node_id = node_id_for_summary_tree_node(nd);
-        usedSrcIds.insert(*extra_src);
-    }
-
-#if defined(JOINT_MAPPING_VEC)
-    json supported_j; bool had_conflicts = false;
-    json conflicts_j; bool had_supported = false;
-    json partial_path_j; bool had_partial_path = false;
-    json resolves_j; bool had_resolves = false;
-    json terminal_j; bool had_terminal = false;
-    for (auto el : d.source_edge_mappings) {
-        const auto study_node_pair = tts.decode_study_node_id_index(el.second);
-        usedSrcIds.insert(*study_node_pair.first);
-        switch (el.first) {
-            // array
-            case SourceEdgeMappingType::CONFLICTS_WITH_MAPPING:
-                add_str_to_vec_string(conflicts_j, *study_node_pair.first, *study_node_pair.second);
-                had_conflicts = true;
-                break;
-            // single element
-            case SourceEdgeMappingType::PARTIAL_PATH_OF_MAPPING:
-                add_str_to_str(partial_path_j, *study_node_pair.first, *study_node_pair.second);
-                had_partial_path = true;
-                break;
-            // single element
-            case SourceEdgeMappingType::RESOLVES_MAPPING:
-                add_str_to_str(resolves_j, *study_node_pair.first, *study_node_pair.second);
-                had_resolves = true;
-                break;
-            // single element
-            case SourceEdgeMappingType::SUPPORTED_BY_MAPPING:
-                add_str_to_str(supported_j, *study_node_pair.first, *study_node_pair.second);
-                had_supported = true;
-                break;
-            // single element
-            case SourceEdgeMappingType::TERMINAL_MAPPING:
-                add_str_to_str(terminal_j, *study_node_pair.first, *study_node_pair.second);
-                had_terminal = true;
-                break;
-            // resolved_by: array
-        }
-    }
-    if (extra_src && extra_node_id) {
-        add_str_to_str(supported_j, *extra_src, *extra_node_id);
-        had_supported = true;
-    }
-    if (had_conflicts) {
-        noderepr["conflicts_with"] = conflicts_j;
-    }
-    if (had_partial_path) {
-        noderepr["partial_path_of"] = partial_path_j;
-    }
-    if (had_resolves) {
-        noderepr["resolves"] = resolves_j;
-    }
-    if (had_supported) {
-        noderepr["supported_by"] = supported_j;
-    }
-    if (had_terminal) {
-        noderepr["terminal"] = terminal_j;
-    }
-
-#else
-    if (extra_src || !d.supported_by.empty()) {
-        add_support_info_single_element("supported_by", d.supported_by, noderepr, usedSrcIds, extra_src, extra_node_id);
-    }
-    if (!d.conflicts_with.empty()) {
-        add_support_info_vec("conflicts_with", d.conflicts_with, noderepr, usedSrcIds);
-    }
-    if (!d.resolves.empty()) {
-        add_support_info_single_element("resolves", d.resolves, noderepr, usedSrcIds);
-    }
-    if (!d.partial_path_of.empty()) {
-        add_support_info_single_element("partial_path_of", d.partial_path_of, noderepr, usedSrcIds);
-    }
-    if (!d.terminal.empty()) {
-        add_support_info_single_element("terminal", d.terminal, noderepr, usedSrcIds);
+        const string taxonomy_src = string("ott") + taxonomy.get_version();
+        usedSrcIds.insert(taxonomy_src);
+        add_str_to_str(noderepr["supported_by"], taxonomy_src, node_id_for_summary_tree_node(nd));
     }
-#endif
     if (d.was_uncontested) {
         noderepr["was_uncontested"] = true;
         noderepr["was_constrained"] = true;
@@ -350,30 +266,21 @@ N * find_mrca_via_traversal_indices(N *f, N *s) {
     return f;
 }
 
-const std::regex mrca_id_pattern("^mrca(ott\\d+)(ott\\d+)$");
-const std::regex ott_id_pattern("^ott(\\d+)$");
-
 const SumTreeNode_t * find_node_by_id_str(const SummaryTree_t & tree,
                                           const string & node_id,
                                           bool & was_broken) {
     was_broken = false;
     const auto & tree_data = tree.get_data();
 
-    std::smatch matches;
-    if (std::regex_match(node_id, matches, ott_id_pattern))
+    long raw_ott_id;
+    if (parse_ott_node_id(node_id, raw_ott_id))
     {
-        // Get the OTT ID
-        long raw_ott_id = long_ott_id_from_name(node_id);
-
         // Try to find the OTT ID in the summary tree.
-        if (raw_ott_id >= 0) {
-            OttId ott_id = check_ott_id_size(raw_ott_id);
-            auto i2nit = tree_data.id_to_node.find(ott_id);
-            if (i2nit != tree_data.id_to_node.end()) {
-                return i2nit->second;
-            }
-            LOG(WARNING) << "not finding " << ott_id << " extracted from " << node_id;
+        OttId ott_id = check_ott_id_size(raw_ott_id);
+        if (auto nd = tree_data.id_to_node.lookup(ott_id)) {
+            return nd;
         }
+        LOG(WARNING) << "not finding " << ott_id << " extracted from " << node_id;
 
         // We didn't find a summary tree node for this OTT ID.  Is this node listed as broken?
         if (auto bt_it = tree_data.broken_taxa.find(node_id); bt_it != tree_data.broken_taxa.end())
@@ -386,21 +293,19 @@ const SumTreeNode_t * find_node_by_id_str(const SummaryTree_t & tree,
             return nullptr;
     }
 
-    if (std::regex_match(node_id, matches, mrca_id_pattern))
+    std::string_view first_id, second_id;
+    if (parse_mrca_node_id(node_id, first_id, second_id))
     {
         auto n2nit = tree_data.broken_name_to_node.find(node_id);
         if (n2nit != tree_data.broken_name_to_node.end()) {
             return n2nit->second;
         }
-        assert(matches.size() >= 2);
-        std::string first_id = matches[1];
-        std::string second_id = matches[2];
         bool bogus = false;
-        auto fir_nd = find_node_by_id_str(tree, first_id, bogus);
+        auto fir_nd = find_node_by_id_str(tree, string(first_id), bogus);
         if (fir_nd == nullptr) {
             return nullptr;
         }
-        auto sec_nd = find_node_by_id_str(tree, second_id, bogus);
+        auto sec_nd = find_node_by_id_str(tree, string(second_id), bogus);
         if (sec_nd == nullptr) {
             return nullptr;
         }
@@ -480,7 +385,8 @@ string tax_about_ws_method(const RichTaxonomy & taxonomy) {
 }
 
 
-inline void add_lineage(json & j, const SumTreeNode_t * focal, const RichTaxonomy & taxonomy, set<string> & usedSrcIds, bool is_arguson = false) {
+inline void add_lineage(json & j, const SumTreeNode_t * focal, const NodeSupportTable & support, const RichTaxonomy & taxonomy,
+                        set<string> & usedSrcIds, bool is_arguson = false) {
     json lineage_arr;
     const SumTreeNode_t * anc = focal->get_parent();
     if (!anc) {
@@ -491,7 +397,7 @@ inline void add_lineage(json & j, const SumTreeNode_t * focal, const RichTaxonom
     while (anc) {
         json ancj;
         add_basic_node_info(taxonomy, *anc, ancj, is_arguson);
-        add_node_support_info(tts, *anc, ancj, usedSrcIds);
+        add_node_support_info(tts, support, *anc, ancj, usedSrcIds);
         lineage_arr.push_back(ancj);
         anc = anc->get_parent();
     }
@@ -533,9 +439,10 @@ string node_info_ws_method(const TreesToServe & tts,
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
         add_basic_node_info(taxonomy, *focal, response);
-        add_node_support_info(tts, *focal, response, usedSrcIds);
+        const auto & support = tree_ptr->get_data().support;
+        add_node_support_info(tts, support, *focal, response, usedSrcIds);
         if (include_lineage) {
-            add_lineage(response, focal, taxonomy, usedSrcIds);
+            add_lineage(response, focal, support, taxonomy, usedSrcIds);
         }
         add_source_id_map(response, usedSrcIds, taxonomy, sta);
     }
@@ -576,7 +483,7 @@ string mrca_ws_method(const TreesToServe & tts,
     json mrcaj;
     set<string> usedSrcIds;
     LOG(DEBUG)<<"mrca_ws_method: 2";
-    add_node_support_info(tts, *focal, mrcaj, usedSrcIds);
+    add_node_support_info(tts, tree_ptr->get_data().support, *focal, mrcaj, usedSrcIds);
     {
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
@@ -626,24 +533,17 @@ class NodeNamerSupportedByStasher {
         mutable set<const string *> study_id_set;
         NodeNameStyle nns;
         const RichTaxonomy & taxonomy;
-        NodeNamerSupportedByStasher(NodeNameStyle in_nns, const RichTaxonomy &tax)
+        const NodeSupportTable * support; // only for summary tree nodes
+        NodeNamerSupportedByStasher(NodeNameStyle in_nns, const RichTaxonomy &tax, const NodeSupportTable * sup = nullptr)
             :nns(in_nns),
-            taxonomy(tax) {
+            taxonomy(tax),
+            support(sup) {
         }
 
         string operator()(const SumTreeNode_t *nd) const {
-            const SumTreeNodeData & d = nd->get_data();
-#           if defined(JOINT_MAPPING_VEC)
-                for (auto & el : d.source_edge_mappings) {
-                    if (el.first == SourceEdgeMappingType::SUPPORTED_BY_MAPPING) {
-                        study_id_set.insert(tts.decode_study_node_id_index(el.second).first);
-                    }
-                }
-#           else
-                for (auto & sni : d.supported_by) {
-                    study_id_set.insert(tts.decode_study_node_id_index(sni).first);
-                }
-#           endif
+            assert(support != nullptr);
+            const auto studies = support->get_supporting_studies(nd->get_data());
+            study_id_set.insert(studies.begin(), studies.end());
             if (nns != NodeNameStyle::NNS_ID_ONLY && nd->has_ott_id()) {
                 const auto * tr = taxonomy.included_taxon_from_id(nd->get_ott_id());
                 if (tr == nullptr) {
@@ -790,7 +690,7 @@ string induced_subtree_ws_method(const TreesToServe & tts,
 
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
-    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy);
+    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, &tree_ptr->get_data().support);
     ostringstream out;
     write_visited_newick(out, visited, focal, nnsbs);
 
@@ -807,12 +707,11 @@ string newick_subtree_ws_method(const TreesToServe & tts,
                                 NodeNameStyle label_format, 
                                 bool include_all_node_labels,
                                 int height_limit) {
-    const uint32_t NEWICK_TIP_LIMIT = 25000;
     const SumTreeNode_t * focal = get_node_for_subtree(tree_ptr, node_id, height_limit, NEWICK_TIP_LIMIT);
 
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
-    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy);
+    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, &tree_ptr->get_data().support);
     ostringstream out;
     write_newick_generic<const SumTreeNode_t *, NodeNamerSupportedByStasher>(out, focal, nnsbs, include_all_node_labels, height_limit);
 
@@ -823,10 +722,118 @@ string newick_subtree_ws_method(const TreesToServe & tts,
 }
 
 
+// Appends s to out as the inside of a JSON string, escaped the way json::dump() does it.
+void append_json_escaped(string & out, const string & s) {
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+// Streams {"newick": ..., "supporting_studies": [...]} in the same layout as json::dump(1).  The
+//    supporting studies are only known once the whole tree has been written, so they come last.
+template<typename T>
+class NewickResponse: public ChunkedResponse {
+    std::shared_ptr<const RichTaxonomy> taxonomy; // keeps the taxonomy alive until the response is sent
+    std::shared_ptr<const SummaryTree_t> tree; // and the summary tree, if the response is a summary subtree
+    NodeNamerSupportedByStasher nnsbs;
+    IncrementalNewickWriter<T, NodeNamerSupportedByStasher> writer;
+    const bool include_supporting_studies;
+    bool started = false;
+    bool finished = false;
+    public:
+    NewickResponse(std::shared_ptr<const RichTaxonomy> tax,
+                   std::shared_ptr<const SummaryTree_t> summary_tree,
+                   T focal,
+                   NodeNameStyle label_format,
+                   bool include_all_node_labels,
+                   int height_limit,
+                   bool supporting_studies)
+        :taxonomy(std::move(tax)),
+        tree(std::move(summary_tree)),
+        nnsbs(label_format, *taxonomy, tree ? &tree->get_data().support : nullptr),
+        writer(focal, nnsbs, include_all_node_labels, height_limit),
+        include_supporting_studies(supporting_studies) {
+    }
+
+    bool write_next(string & out, std::size_t chunk_size) override {
+        if (finished) {
+            return false;
+        }
+        if (not started) {
+            started = true;
+            out += "{\n \"newick\": \"";
+        }
+        const auto start_size = out.size();
+        ostringstream newick;
+        bool more = true;
+        while (more and out.size() - start_size < chunk_size) {
+            newick.str("");
+            more = writer.write_some(newick, 1024);
+            append_json_escaped(out, newick.str());
+        }
+        if (more) {
+            return true;
+        }
+        if (include_supporting_studies) {
+            json tail;
+            tail["supporting_studies"] = get_supporting_studies(nnsbs.study_id_set);
+            out += "\",";
+            out += tail.dump(1).substr(1);
+        } else {
+            out += "\"\n}";
+        }
+        finished = true;
+        return false;
+    }
+};
+
+std::unique_ptr<ChunkedResponse> newick_subtree_ws_stream(const TreesToServe & tts,
+                                                          const SummaryTree_t * tree_ptr,
+                                                          const string & node_id,
+                                                          NodeNameStyle label_format,
+                                                          bool include_all_node_labels,
+                                                          int height_limit) {
+    const SumTreeNode_t * focal = get_node_for_subtree(tree_ptr, node_id, height_limit, std::numeric_limits<uint32_t>::max());
+    if (focal->get_data().num_tips <= NEWICK_TIP_LIMIT || height_limit >= 0) {
+        return nullptr;
+    }
+    return std::make_unique<NewickResponse<const SumTreeNode_t *>>(tts.get_taxonomy_snapshot(), tts.share_summary_tree(tree_ptr),
+                                                                    focal, label_format,
+                                                                    include_all_node_labels, height_limit, true);
+}
+
+std::unique_ptr<ChunkedResponse> taxon_subtree_ws_stream(std::shared_ptr<const RichTaxonomy> taxonomy,
+                                                         const RTRichTaxNode * taxon_node,
+                                                         NodeNameStyle label_format) {
+    assert(taxon_node != nullptr);
+    const auto & d = taxon_node->get_data();
+    if (d.trav_exit - d.trav_enter < NEWICK_TIP_LIMIT) {
+        return nullptr;
+    }
+    return std::make_unique<NewickResponse<const RTRichTaxNode *>>(std::move(taxonomy), nullptr, taxon_node, label_format, true, -1, false);
+}
+
 template<typename T>
 inline void write_arguson(json & j,
                           const TreesToServe & tts,
                           const SummaryTreeAnnotation * sta,
+                          const NodeSupportTable & support,
                           const RichTaxonomy & taxonomy,
                           T nd,
                           long height_limit,
@@ -837,13 +844,13 @@ inline void write_arguson(json & j,
         const long nhl = height_limit - 1;
         for (auto c : iter_child_const(*nd)) {
             json cj;
-            write_arguson<T>(cj, tts, sta, taxonomy, c, nhl, usedSrcIds);
+            write_arguson<T>(cj, tts, sta, support, taxonomy, c, nhl, usedSrcIds);
             c_array.push_back(cj);
         }
         j["children"] = c_array;
     }
     add_basic_node_info(taxonomy, *nd, j, true);
-    add_node_support_info(tts, *nd, j, usedSrcIds);
+    add_node_support_info(tts, support, *nd, j, usedSrcIds);
 }
 
 string arguson_subtree_ws_method(const TreesToServe & tts,
@@ -851,7 +858,6 @@ string arguson_subtree_ws_method(const TreesToServe & tts,
                                  const SummaryTreeAnnotation * sta,
                                  const string & node_id,
                                  int height_limit) {
-    const uint32_t NEWICK_TIP_LIMIT = 25000;
     auto focal = get_node_for_subtree(tree_ptr, node_id, height_limit, NEWICK_TIP_LIMIT);
     json response;
     response["synth_id"] = sta->synth_id;
@@ -860,8 +866,9 @@ string arguson_subtree_ws_method(const TreesToServe & tts,
     {
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
-        write_arguson(a, tts, sta, taxonomy, focal, height_limit, usedSrcIds);
-        add_lineage(a, focal, taxonomy, usedSrcIds, true);
+        const auto & support = tree_ptr->get_data().support;
+        write_arguson(a, tts, sta, support, taxonomy, focal, height_limit, usedSrcIds);
+        add_lineage(a, focal, support, taxonomy, usedSrcIds, true);
         add_source_id_map(a, usedSrcIds, taxonomy, sta);
     }
     response["arguson"] = a;
@@ -885,7 +892,7 @@ void tax_service_add_taxon_info(const RichTaxonomy & taxonomy,
     const auto ott_id = nd_taxon.get_ott_id();
     const bool is_suppressed = (0 < ots.count(ott_id));
     taxonrepr["is_suppressed"] = is_suppressed;
-    auto isfs = taxonomy.get_ids_suppressed_from_summary_tree_alias();
+    auto isfs = tts.get_ids_suppressed_from_summary_tree();
     if (isfs) {
         taxonrepr["is_suppressed_from_synth"] = is_suppressed || (0 < isfs->count(ott_id));
     }
@@ -1039,7 +1046,6 @@ string taxon_subtree_ws_method(const RichTaxonomy & taxonomy,
                              const RTRichTaxNode * taxon_node,
                              NodeNameStyle label_format) {
     assert(taxon_node != nullptr);
-    const auto & taxonomy_tree = taxonomy.get_tax_tree();
     json response;
     NodeNamerSupportedByStasher nnsbs(label_format, taxonomy);
     ostringstream out;
@@ -1071,9 +1077,9 @@ bool lcase_string_equals(const string_view& s1, const T& s2)
 
 bool lcase_match_prefix(const string_view& s, const string_view& prefix)
 {
-    if (prefix.size() < s.size()) return false;
+    if (s.size() < prefix.size()) return false;
 
-    return lcase_string_equals(s.substr(prefix.size()), prefix);
+    return lcase_string_equals(s.substr(0, prefix.size()), prefix);
 }
 
 bool taxon_is_specific(const Taxon* taxon)
@@ -1093,15 +1099,49 @@ bool taxon_is_higher(const Taxon* taxon)
     return taxon->get_data().rank < TaxonomicRank::RANK_SPECIES;
 }
 
-vector<pair<const Taxon*,const string&>> exact_synonym_search(const Taxon* context_root, string query, std::function<bool(const Taxon*)> ok = [](const Taxon*){return true;})
+// Searches for taxa below context_root whose name is query (or starts with query, if prefix is true).
+//   Uses the taxonomy's name index if it has one, and otherwise scans the context subtree.
+vector<const Taxon*> name_search(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool prefix, std::function<bool(const Taxon*)> ok)
+{
+    vector<const Taxon*> hits;
+    if (auto name_index = taxonomy.get_name_index())
+    {
+	for(auto entry: name_index->find_names(query, context_root, prefix))
+	    if (ok(entry->taxon))
+		hits.push_back(entry->taxon);
+	return hits;
+    }
+
+    for(auto taxon: iter_post_n_const(*context_root))
+    {
+	if (not ok(taxon)) continue;
+
+	auto name = taxon->get_data().get_nonuniqname();
+	if (prefix ? lcase_match_prefix(name, query) : lcase_string_equals(query, name))
+	    hits.push_back(taxon);
+    }
+
+    return hits;
+}
+
+// Searches for junior synonyms of taxa below context_root that are query (or start with query, if prefix is true).
+vector<pair<const Taxon*,const string&>> synonym_search(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool prefix, std::function<bool(const Taxon*)> ok)
 {
     vector<pair<const Taxon*,const string&>> hits;
+    if (auto name_index = taxonomy.get_name_index())
+    {
+	for(auto entry: name_index->find_synonyms(query, context_root, prefix))
+	    if (ok(entry->taxon))
+		hits.push_back({entry->taxon, entry->synonym->get_name()});
+	return hits;
+    }
+
     for(auto taxon: iter_post_n_const(*context_root))
     {
 	if (not ok(taxon)) continue;
 
 	for(auto& tjs: taxon->get_data().junior_synonyms)
-	    if (lcase_string_equals(query, tjs->get_name()))
+	    if (prefix ? lcase_match_prefix(tjs->get_name(), query) : lcase_string_equals(query, tjs->get_name()))
 		hits.push_back({taxon,tjs->get_name()});
     }
 
@@ -1116,7 +1156,7 @@ vector<pair<const Taxon*,const string&>> exact_synonym_search(const RichTaxonomy
 						   return true;
 					       };
 
-    return exact_synonym_search(context_root, query, ok);
+    return synonym_search(taxonomy, context_root, query, false, ok);
 }
 
 vector<pair<const Taxon*,const string&>> exact_synonym_search_higher(const RichTaxonomy& taxonomy, const Taxon* context_root, string query, bool include_suppressed)
@@ -1128,26 +1168,7 @@ vector<pair<const Taxon*,const string&>> exact_synonym_search_higher(const RichT
 						   return true;
 					       };
 
-    return exact_synonym_search(context_root, query, ok);
-}
-
-
-
-vector<const Taxon*> exact_name_search(const Taxon* context_root, string query, std::function<bool(const Taxon*)> ok = [](const Taxon*){return true;})
-{
-    for(auto& c: query)
-	c = std::tolower(c);
-
-    vector<const Taxon*> hits;
-    for(auto taxon: iter_post_n_const(*context_root))
-    {
-	if (not ok(taxon)) continue;
-
-	if (lcase_string_equals(query, taxon->get_data().get_nonuniqname()))
-	    hits.push_back(taxon);
-    }
-
-    return hits;
+    return synonym_search(taxonomy, context_root, query, false, ok);
 }
 
 vector<const Taxon*> exact_name_search(const RichTaxonomy& taxonomy, const Taxon* context_root, string query, bool include_suppressed)
@@ -1158,7 +1179,7 @@ vector<const Taxon*> exact_name_search(const RichTaxonomy& taxonomy, const Taxon
 					    return true;
 					};
 
-    return exact_name_search(context_root, query, ok);
+    return name_search(taxonomy, context_root, query, false, ok);
 }
 
 vector<const Taxon*> exact_name_search_species(const RichTaxonomy& taxonomy, const Taxon* context_root, string query, bool include_suppressed)
@@ -1170,7 +1191,7 @@ vector<const Taxon*> exact_name_search_species(const RichTaxonomy& taxonomy, con
 					    return true;
 					};
 
-    return exact_name_search(context_root, query, ok);
+    return name_search(taxonomy, context_root, query, false, ok);
     
 }
 
@@ -1183,7 +1204,7 @@ vector<const Taxon*> exact_name_search_genus(const RichTaxonomy& taxonomy, const
 					    return true;
 					};
 
-    return exact_name_search(context_root, query, ok);
+    return name_search(taxonomy, context_root, query, false, ok);
     
 }
 
@@ -1196,21 +1217,7 @@ vector<const Taxon*> exact_name_search_higher(const RichTaxonomy& taxonomy, cons
 					    return true;
 					};
 
-    return exact_name_search(context_root, query, ok);
-}
-
-vector<const Taxon*> prefix_name_search(const Taxon* context_root, const string& query, std::function<bool(const Taxon*)> ok = [](const Taxon*){return true;})
-{
-    vector<const Taxon*> hits;
-    for(auto taxon: iter_post_n_const(*context_root))
-    {
-	if (not ok(taxon)) continue;
-
-	if (lcase_match_prefix(taxon->get_data().get_nonuniqname(), query))
-	    hits.push_back(taxon);
-    }
-
-    return hits;
+    return name_search(taxonomy, context_root, query, false, ok);
 }
 
 vector<const Taxon*> prefix_name_search(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool include_suppressed)
@@ -1221,7 +1228,7 @@ vector<const Taxon*> prefix_name_search(const RichTaxonomy& taxonomy, const Taxo
 					    return true;
 					};
 
-    return prefix_name_search(context_root, query, ok);
+    return name_search(taxonomy, context_root, query, true, ok);
 }
 
 vector<const Taxon*> prefix_name_search_higher(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool include_suppressed)
@@ -1233,33 +1240,66 @@ vector<const Taxon*> prefix_name_search_higher(const RichTaxonomy& taxonomy, con
 					    return true;
 					};
 
-    return prefix_name_search(context_root, query, ok);
+    return name_search(taxonomy, context_root, query, true, ok);
 }
 
-vector<pair<const Taxon*,const string&>> prefix_synonym_search(const Taxon* context_root, string query, std::function<bool(const Taxon*)> ok = [](const Taxon*){return true;})
+vector<pair<const Taxon*,const string&>> prefix_synonym_search(const RichTaxonomy& taxonomy, const Taxon* context_root, string query, bool include_suppressed)
 {
-    vector<pair<const Taxon*,const string&>> hits;
-    for(auto taxon: iter_post_n_const(*context_root))
-    {
-	if (not ok(taxon)) continue;
+    std::function<bool(const Taxon*)> ok = [&](const Taxon* taxon)
+					       {
+						   if (not include_suppressed and taxonomy.node_is_suppressed_from_tnrs(taxon)) return false;
+						   return true;
+					       };
 
-	for(auto& tjs: taxon->get_data().junior_synonyms)
-	    if (lcase_match_prefix(tjs->get_name(), query))
-		hits.push_back({taxon,tjs->get_name()});
-    }
+    return synonym_search(taxonomy, context_root, query, true, ok);
+}
+
+// The number of edits allowed in an approximate match for query.  Short queries get no approximate
+//   matches, since most short names are within an edit or two of many others.
+unsigned max_approximate_match_distance(const string& query)
+{
+    if (query.size() < 4) return 0;
+    if (query.size() < 8) return 1;
+    return 2;
+}
+
+// Names and synonyms of taxa below context_root that are approximate matches for query, best first.
+//   This needs the taxonomy's name index: without it, there are no approximate matches.
+vector<TaxonNameIndex::ApproximateMatch> approximate_search(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, std::function<bool(const Taxon*)> ok)
+{
+    vector<TaxonNameIndex::ApproximateMatch> hits;
+    auto name_index = taxonomy.get_name_index();
+    auto max_distance = max_approximate_match_distance(query);
+    if (not name_index or max_distance == 0) return hits;
+
+    for(auto& match: name_index->find_approximate(query, context_root, max_distance))
+	if (ok(match.entry->taxon))
+	    hits.push_back(match);
 
     return hits;
 }
 
-vector<pair<const Taxon*,const string&>> prefix_synonym_search(const RichTaxonomy& taxonomy, const Taxon* context_root, string query, bool include_suppressed)
+vector<TaxonNameIndex::ApproximateMatch> approximate_search(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool include_suppressed)
 {
     std::function<bool(const Taxon*)> ok = [&](const Taxon* taxon)
-					       {
-						   if (not include_suppressed and taxonomy.node_is_suppressed_from_tnrs(taxon)) return false;
-						   return true;
-					       };
+					{
+					    if (not include_suppressed and taxonomy.node_is_suppressed_from_tnrs(taxon)) return false;
+					    return true;
+					};
+
+    return approximate_search(taxonomy, context_root, query, ok);
+}
+
+vector<TaxonNameIndex::ApproximateMatch> approximate_search_higher(const RichTaxonomy& taxonomy, const Taxon* context_root, const string& query, bool include_suppressed)
+{
+    std::function<bool(const Taxon*)> ok = [&](const Taxon* taxon)
+					{
+					    if (not include_suppressed and taxonomy.node_is_suppressed_from_tnrs(taxon)) return false;
+					    if (not taxon_is_higher(taxon)) return false;
+					    return true;
+					};
 
-    return prefix_synonym_search(context_root, query, ok);
+    return approximate_search(taxonomy, context_root, query, ok);
 }
 
 vector<const Taxon*> exact_name_search(const RichTaxonomy& taxonomy, const string& query, bool include_suppressed)
@@ -1278,7 +1318,7 @@ struct ContextSearcher
     const Context& context;
     const Taxon* context_root;
 
-    pair<json,match_status> match_name(string query, bool do_approximate_matching, bool include_suppressed);
+    pair<json,match_status> match_name(string query, bool do_approximate_matching, bool include_suppressed) const;
 
     ContextSearcher(const RichTaxonomy& t, const Context& c): taxonomy(t), context(c)
     {
@@ -1325,7 +1365,24 @@ json exact_synonym_match_json(const string& query, const Taxon* taxon, const str
     return result;
 }
 
-pair<json,match_status> ContextSearcher::match_name(string query, bool do_approximate_matching, bool include_suppressed)
+json approximate_match_json(const string& query, const TaxonNameIndex::ApproximateMatch& match, const RichTaxonomy& taxonomy)
+{
+    const auto& entry = *match.entry;
+    json result;
+    result["taxon"] = get_taxon_json(taxonomy, *entry.taxon);
+    result["search_string"] = query;
+    result["score"] = match.score;
+    result["is_approximate_match"] = true;
+    result["nomenclature_code"] = "code";   // FIXME!
+    result["is_synonym"] = (entry.synonym != nullptr);
+    if (entry.synonym)
+	result["matched_name"] = entry.synonym->get_name();
+    else
+	result["matched_name"] = entry.taxon->get_data().get_nonuniqname();
+    return result;
+}
+
+pair<json,match_status> ContextSearcher::match_name(string query, bool do_approximate_matching, bool include_suppressed) const
 {
     for(auto& c: query)
 	c = std::tolower(c);
@@ -1344,11 +1401,14 @@ pair<json,match_status> ContextSearcher::match_name(string query, bool do_approx
     if (exact_name_matches.size() == 1)
 	status = unambiguous_match;
 
-    // 2. See if we can find an exact name match for synonyms
+    // 2. See if we can find an exact name match for synonyms.  A taxon is only reported once: its
+    //    name (or first synonym) match is as good as any other.
     auto exact_synonym_matches = exact_synonym_search(taxonomy, context_root, query, include_suppressed);
 
+    std::unordered_set<const Taxon*> matched_taxa(exact_name_matches.begin(), exact_name_matches.end());
     for(auto& [ taxon, synonym_name ]: exact_synonym_matches)
-	results.push_back(exact_synonym_match_json(query, taxon, synonym_name, taxonomy));
+	if (matched_taxa.insert(taxon).second)
+	    results.push_back(exact_synonym_match_json(query, taxon, synonym_name, taxonomy));
 
     if (status == unmatched and results.size())
 	status = ambiguous_match;
@@ -1356,7 +1416,12 @@ pair<json,match_status> ContextSearcher::match_name(string query, bool do_approx
     // 3. Do fuzzy matching ONLY for names that we couldn't match
     if (do_approximate_matching and status == unmatched)
     {
-	// do fuzzy matching.
+	for(auto& match: approximate_search(taxonomy, context_root, query, include_suppressed))
+	    results.push_back(approximate_match_json(query, match, taxonomy));
+
+	// An approximate match is never unambiguous.
+	if (results.size())
+	    status = ambiguous_match;
     }
 
     json match_results;
@@ -1396,6 +1461,97 @@ const Context* determine_context(const optional<string>& context_name)
     return context;
 }
 
+// The number of names that a match_names thread resolves at a time.
+const std::size_t MATCH_NAMES_BATCH_SIZE = 250;
+
+// Extra threads that requests of one kind can spread their work over.  At most `total` of them
+//   are in use at any time, and at most `per_request` by any one request.
+class ExtraThreads
+{
+    std::mutex mutex;
+    unsigned available = 0;
+    unsigned per_request = 0;
+public:
+    void set_limits(unsigned total, unsigned per_request_)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        available = total;
+        per_request = per_request_;
+    }
+
+    // Reserve up to `wanted` extra threads for one request.  This never waits: if the other requests
+    //   are using the threads, the request gets fewer, or none and runs on the calling thread alone.
+    unsigned reserve(unsigned wanted)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned n = std::min({wanted, per_request, available});
+        available -= n;
+        return n;
+    }
+
+    void release(unsigned n)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        available += n;
+    }
+};
+
+// Extra threads reserved from an ExtraThreads until the end of a scope.
+class ReservedThreads
+{
+    ExtraThreads& extra_threads;
+    const unsigned n;
+public:
+    ReservedThreads(ExtraThreads& e, unsigned wanted)
+        :extra_threads(e), n(e.reserve(wanted))
+    { }
+    ~ReservedThreads()
+    {
+        extra_threads.release(n);
+    }
+    ReservedThreads(const ReservedThreads&) = delete;
+    ReservedThreads& operator=(const ReservedThreads&) = delete;
+    unsigned size() const {return n;}
+};
+
+static ExtraThreads match_names_threads;
+static ExtraThreads conflict_threads;
+
+void set_match_names_thread_limits(unsigned total, unsigned per_request)
+{
+    match_names_threads.set_limits(total, per_request);
+}
+
+void set_conflict_thread_limits(unsigned total, unsigned per_request)
+{
+    conflict_threads.set_limits(total, per_request);
+}
+
+// Call job(i) for each i in [0,n), on the calling thread and whatever extra threads can be reserved.
+//   The first exception thrown by a job stops the remaining jobs from starting, and is rethrown.
+void run_jobs(ExtraThreads& extra_threads, std::size_t n, const std::function<void(std::size_t)>& job)
+{
+    // The calling thread works too, so we need at most n-1 extra threads.
+    ReservedThreads reserved(extra_threads, (n > 1) ? n - 1 : 0);
+    run_jobs_on_threads(n, reserved.size(), job);
+}
+
+// Resolve each name, with the result for names[i] in slot i.
+vector<pair<json,match_status>> match_names(const ContextSearcher& searcher,
+					    const vector<string>& names,
+					    bool do_approximate_matching,
+					    bool include_suppressed)
+{
+    vector<pair<json,match_status>> matches(names.size());
+    const std::size_t n_batches = (names.size() + MATCH_NAMES_BATCH_SIZE - 1) / MATCH_NAMES_BATCH_SIZE;
+    run_jobs(match_names_threads, n_batches, [&](std::size_t b) {
+	auto end = std::min(names.size(), (b + 1) * MATCH_NAMES_BATCH_SIZE);
+	for(auto i = b * MATCH_NAMES_BATCH_SIZE; i < end; i++)
+	    matches[i] = searcher.match_name(names[i], do_approximate_matching, include_suppressed);
+    });
+    return matches;
+}
+
 //FIXME: how is "suppressed_names" different from "deprecated_taxa"?
 
 // $ curl -X POST https://api.opentreeoflife.org/v3/tnrs/match_names  -H "content-type:application/json" -d '{"names":["Aster","Symphyotrichum","Barnadesia"]}'
@@ -1423,13 +1579,15 @@ std::string tnrs_match_names_ws_method(const vector<string>& names,
     json unmatched_names = json::array();
     json matched_names = json::array();
 
-    for(auto& name: names)
+    auto matches = match_names(searcher, names, do_approximate_matching, include_suppressed);
+
+    for(std::size_t i = 0; i < names.size(); i++)
     {
-	// Do the search
-	auto [result,status] = searcher.match_name(name, do_approximate_matching, include_suppressed);
+	const auto& name = names[i];
+	auto& [result,status] = matches[i];
 
 	// Store the result
-	results.push_back(result);
+	results.push_back(std::move(result));
 
 	// Classify name as unmatched / matched / unambiguous
 	if (status == unmatched)
@@ -1527,6 +1685,12 @@ void add_hits(json& j, const RichTaxonomy& taxonomy, const vector<pair<const Tax
 	j.push_back(autocomplete_json(taxonomy,taxon));
 }
 
+void add_hits(json& j, const RichTaxonomy& taxonomy, const vector<TaxonNameIndex::ApproximateMatch>& matches)
+{
+    for(auto& match: matches)
+	j.push_back(autocomplete_json(taxonomy,match.entry->taxon));
+}
+
 // Find all species in the genus that have the given prefix
 vector<const Taxon*> prefix_search_species_in_genus(const Taxon* genus, const string_view& species_prefix)
 {
@@ -1598,6 +1762,7 @@ string tnrs_autocomplete_name_ws_method(const string& name, const string& contex
 	if (not response.empty()) return response;
 	
 	// fuzzy search on names and synonyms
+	add_hits(response, taxonomy, approximate_search(taxonomy, context_root, escaped_query, include_suppressed));
     }
     else // does not contain a space at all
     {
@@ -1614,6 +1779,7 @@ string tnrs_autocomplete_name_ws_method(const string& name, const string& contex
 	if (not response.empty()) return response;
 	
 	// fuzzy search on higher names and synonyms
+	add_hits(response, taxonomy, approximate_search_higher(taxonomy, context_root, escaped_query, include_suppressed));
     }
     
     return response.dump(1);
@@ -1639,8 +1805,8 @@ string tnrs_infer_context_ws_method(const vector<string>& names, const RichTaxon
     
     json response;
 
-    response["context_name"] = results.first->name;
-    response["context_ott_id"] = results.first->ott_id;
+    response["context_name"] = context->name;
+    response["context_ott_id"] = context->ott_id;
     response["ambiguous_names"] = ambiguous_names;
     
     return response.dump(1);
@@ -1734,7 +1900,9 @@ struct conflict_stats
         // 4. If the newest node is not shallower then add it.
         nodes.insert(pair<string, int>({name2, min_depth_node2}));
     }
-    json get_json(const ConflictTree&, const RichTaxonomy&) const;
+    // The (name, child name) of each monotypic node of the query tree, in postorder.
+    static vector<pair<string, string>> monotypic_nodes(const ConflictTree& tree);
+    json get_json(const vector<pair<string, string>>& monotypic_nodes, const RichTaxonomy&) const;
 };
 
 using tnode_type = RTRichTaxNode;
@@ -1845,7 +2013,16 @@ json get_conflict_node_status(const set<pair<string,int>>& witnesses, string sta
 // PROBLEM: It is possible to have both x resolves y (x:resolved_by y1) and y2 resolves x (x:resolves y2)
 // Let's solve this situation by NOT reporting when tree2 resolves tree1.
 
-json conflict_stats::get_json(const ConflictTree& tree, const RichTaxonomy& Tax) const {
+vector<pair<string, string>> conflict_stats::monotypic_nodes(const ConflictTree& tree) {
+    vector<pair<string, string>> nodes;
+    for(auto it: iter_post_const(tree))
+        if (it->is_outdegree_one_node())
+            nodes.emplace_back(extract_node_name_if_present(it->get_name()),
+                               extract_node_name_if_present(it->get_first_child()->get_name()));
+    return nodes;
+}
+
+json conflict_stats::get_json(const vector<pair<string, string>>& monotypic_nodes, const RichTaxonomy& Tax) const {
     json nodes;
 //    for(auto& x: resolves) {
 //        nodes[extract_node_name_if_present(x.first)] = get_node_status(x.second, "resolves", Tax);
@@ -1866,13 +2043,8 @@ json conflict_stats::get_json(const ConflictTree& tree, const RichTaxonomy& Tax)
         nodes[extract_node_name_if_present(x.first)] = get_conflict_node_status(x.second, "conflicts_with", Tax);
     }
     // For monotypic nodes in the query, copy annotation from child.
-    for(auto it: iter_post_const(tree))
-        if (it->is_outdegree_one_node())
-        {
-            auto name = extract_node_name_if_present(it->get_name());
-            auto child_name = extract_node_name_if_present(it->get_first_child()->get_name());
-            nodes[name] = nodes.at(child_name);
-        }
+    for(auto& x: monotypic_nodes)
+        nodes[x.first] = nodes.at(x.second);
     return nodes;
 }
 
@@ -1897,15 +2069,17 @@ auto get_induced_nodes(const Tree1_t& T1, const Tree2_t& T2)
 
 template <typename Tree_t>
 std::size_t n_leaves(const Tree_t& T) {
-#pragma clang diagnostic ignored  "-Wunused-variable"
-#pragma GCC diagnostic ignored  "-Wunused-variable"
     std::size_t count = 0;
     for(auto nd: iter_leaf_const(T)){
+        (void)nd;
         count++;
     }
     return count;
 }
 
+// Query trees with at least this many leaves build the two induced trees on two threads.
+constexpr std::size_t CONCURRENT_INDUCED_TREES_MIN_LEAVES = 10000;
+
 // Get the subtree of T1 connecting the leaves of T1 that are also in T2.
 template <typename Tree1, typename Tree2, typename Tree_Out_t>
 pair<unique_ptr<Tree_Out_t>,unique_ptr<Tree_Out_t>>
@@ -1914,56 +2088,72 @@ get_induced_trees2(const Tree1& T1,
                   const Tree2& T2,
                   std::function<const typename Tree2::node_type*(const typename Tree2::node_type*,const typename Tree2::node_type*)> MRCA_of_pair2)
 {
-    LOG(WARNING)<<"T1 = "<<newick_string(T1);
-    LOG(WARNING)<<"n_leaves(T1) = "<<n_leaves(T1);
-    LOG(WARNING)<<"n_leaves(T2) = "<<n_leaves(T2);
-
-    // 1. First construct the induced tree for T2.
-
-    // 1a. Find the nodes of T2 that corresponds to leaves of T1.
-    //     Note that some of these nodes could be ancestral to other ones in T2.
-    auto T2_nodes_from_T1_leaves = get_induced_nodes(T1,T2);
-    LOG(WARNING)<<T2_nodes_from_T1_leaves.size()<<" leaves of T1 are in T2";
-
-    // 1b. Actually construct the induced tree for T2.
-    //     It might have fewer leaves than in T2_nodes_from_T1_leaves, if some of the nodes are ancestral to others.
-    auto induced_tree2 = get_induced_tree<Tree2, Tree_Out_t>(T2_nodes_from_T1_leaves, MRCA_of_pair2);
-    LOG(WARNING)<<"n_leaves(induced_tree2) = "<<n_leaves(*induced_tree2);
-    LOG(WARNING)<<"induced-tree2a = "<<newick_string(*induced_tree2);
-
-    // 1c. Rename internal nodes of synth/taxonomy to ottXXX instead of taxon name
-    for(auto node: iter_post(*induced_tree2))
-        if (node->has_ott_id())
-            node->set_name("ott"+std::to_string(node->get_ott_id()));
-    LOG(WARNING)<<"induced_tree2 = "<<newick_string(*induced_tree2);
+    // 1. Find the nodes of T2 that corresponds to leaves of T1.
+    //    Note that some of these nodes could be ancestral to other ones in T2.
+    auto& ott_to_nodes2 = T2.get_data().id_to_node;
+    std::vector<const typename Tree1::node_type*> leaves1;
+    std::vector<const typename Tree2::node_type*> T2_nodes_from_T1_leaves;
+    std::size_t num_leaves1 = 0;
+    for(auto leaf: iter_leaf_const(T1))
+    {
+        num_leaves1++;
+        if (not leaf->has_ott_id()) continue;
+        auto it = ott_to_nodes2.find(leaf->get_ott_id());
+        if (it == ott_to_nodes2.end()) continue;
+        leaves1.push_back(leaf);
+        T2_nodes_from_T1_leaves.push_back(it->second);
+    }
 
     //FIXME - handle cases like (Homo sapiens, Homo) by deleting monotypic nodes at the root.
 
-    // 2. Keep only leaves from T1 that (a) have an ottid in T2 and (b) map to a leaf of induced_tree2
-    auto ottid_to_induced_tree2_node = otc::get_ottid_to_const_node_map(*induced_tree2);
+    // 2. Keep only leaves from T1 that (a) have an ottid in T2 and (b) map to a leaf of the induced tree for T2.
+    //    A node is a leaf of the induced tree unless another of the nodes is inside its traversal range,
+    //    so we can decide this before constructing either induced tree.
+    std::vector<std::uint32_t> trav_enters;
+    trav_enters.reserve(T2_nodes_from_T1_leaves.size());
+    for(auto nd: T2_nodes_from_T1_leaves)
+        trav_enters.push_back(nd->get_data().trav_enter);
+    std::sort(trav_enters.begin(), trav_enters.end());
     std::vector<const typename Tree1::node_type*> induced_leaves1;
-    for(auto leaf: iter_leaf_const(T1))
+    for(std::size_t i = 0; i < leaves1.size(); i++)
     {
-        if (not leaf->has_ott_id())
-        {
-            LOG(WARNING)<<"Dropping tip: no ott id";
-            continue;
-        }
-
-        auto it = ottid_to_induced_tree2_node.find(leaf->get_ott_id());
-        if (it == ottid_to_induced_tree2_node.end())
-            LOG(WARNING)<<"Dropping tip "<<leaf->get_ott_id()<<": not found in induced taxonomy-or-synth tree.";
-        else if (not it->second->is_tip())
-            LOG(WARNING)<<"Dropping higher taxon tip "<<leaf->get_ott_id();
-        else
-            induced_leaves1.push_back(leaf);
+        auto& d = T2_nodes_from_T1_leaves[i]->get_data();
+        auto next = std::upper_bound(trav_enters.begin(), trav_enters.end(), d.trav_enter);
+        if (next == trav_enters.end() or *next > d.trav_exit)
+            induced_leaves1.push_back(leaves1[i]);
+    }
+
+    // 3. Construct the induced trees for T2 and T1.
+    auto make_induced_tree2 = [&]() {
+        auto induced_tree2 = get_induced_tree<Tree2, Tree_Out_t>(T2_nodes_from_T1_leaves, MRCA_of_pair2);
+        // Rename internal nodes of synth/taxonomy to ottXXX instead of taxon name
+        for(auto node: iter_post(*induced_tree2))
+            if (node->has_ott_id())
+                node->set_name("ott"+std::to_string(node->get_ott_id()));
+        return induced_tree2;
+    };
+    auto make_induced_tree1 = [&]() {
+        return get_induced_tree<Tree1, Tree_Out_t>(induced_leaves1, MRCA_of_pair1);
+    };
+    unique_ptr<Tree_Out_t> induced_tree1, induced_tree2;
+    // The second thread counts against the conflict thread limits, like the threads of a batch request.
+    //   Declared before the future, so the thread is released only after the future has been waited for.
+    std::optional<ReservedThreads> extra_thread;
+    if (num_leaves1 >= CONCURRENT_INDUCED_TREES_MIN_LEAVES)
+        extra_thread.emplace(conflict_threads, 1);
+    if (extra_thread and extra_thread->size() == 1)
+    {
+        auto induced_tree2_future = std::async(std::launch::async, make_induced_tree2);
+        induced_tree1 = make_induced_tree1();
+        induced_tree2 = induced_tree2_future.get();
     }
-    LOG(WARNING)<<"keeping "<<induced_leaves1.size()<<" leaves from T1";
-
-    // 3. Construct the induced tree for T1
-    auto induced_tree1 = get_induced_tree<Tree1, Tree_Out_t>(induced_leaves1, MRCA_of_pair1);
-    LOG(WARNING)<<"n_leaves(induced_tree1) = "<<n_leaves(*induced_tree1);
-    LOG(WARNING)<<"induced_tree1 = "<<newick_string(*induced_tree1);
+    else
+    {
+        induced_tree2 = make_induced_tree2();
+        induced_tree1 = make_induced_tree1();
+    }
+    LOG(DEBUG)<<num_leaves1<<" leaves in T1, "<<T2_nodes_from_T1_leaves.size()<<" of them in T2, keeping "
+              <<induced_leaves1.size();
 
     assert(n_leaves(*induced_tree1) == n_leaves(*induced_tree2));
 
@@ -2013,17 +2203,17 @@ json conflict_with_tree_impl(const QT & query_tree,
             stats.add_terminal(node2, node1);
     };
 
-    {
-        auto induced_trees = get_induced_trees2<QT,TT,ConflictTree>(query_tree, query_mrca, other_tree, other_mrca);
-
-        perform_conflict_analysis(*induced_trees.first,
-                                  *induced_trees.second,
-                                  log_supported_by,
-                                  log_partial_path_of,
-                                  log_conflicts_with,
-                                  log_resolved_by,
-                                  log_terminal);
-    }
+    auto induced_trees = get_induced_trees2<QT,TT,ConflictTree>(query_tree, query_mrca, other_tree, other_mrca);
+    // The analysis modifies the induced trees, so note the monotypic nodes of the query first.
+    auto monotypic_nodes = stats.monotypic_nodes(*induced_trees.first);
+
+    perform_conflict_analysis(*induced_trees.first,
+                              *induced_trees.second,
+                              log_supported_by,
+                              log_partial_path_of,
+                              log_conflicts_with,
+                              log_resolved_by,
+                              log_terminal);
 /*
 //  See PROBLEM notes above, on why we don't record when node2 resolves node1.
 //    auto log_resolves = [&stats](const QM* node1, const QM* node2) {
@@ -2046,10 +2236,7 @@ json conflict_with_tree_impl(const QT & query_tree,
     }
 */
 
-    {
-        auto induced_trees = get_induced_trees2<QT,TT,ConflictTree>(query_tree, query_mrca, other_tree, other_mrca);
-        return stats.get_json(*induced_trees.first, Tax);
-    }
+    return stats.get_json(monotypic_nodes, Tax);
 }
 
 json conflict_with_taxonomy(const ConflictTree& query_tree, const RichTaxonomy& Tax) {
@@ -2063,6 +2250,11 @@ json conflict_with_taxonomy(const ConflictTree& query_tree, const RichTaxonomy&
     tfunc taxonomy_mrca = [](const tnode_type* n1, const tnode_type* n2) {
         return mrca_from_depth(n1,n2);
     };
+    if (auto taxonomy_lca = Tax.get_lca_index()) {
+        taxonomy_mrca = [taxonomy_lca](const tnode_type* n1, const tnode_type* n2) {
+            return taxonomy_lca->mrca(n1,n2);
+        };
+    }
     return conflict_with_tree_impl(query_tree, taxonomy, query_mrca, taxonomy_mrca, Tax);
 }
 
@@ -2075,6 +2267,11 @@ json conflict_with_summary(const ConflictTree& query_tree,
     std::function<const snode_type*(const snode_type*,const snode_type*)> summary_mrca = [](const snode_type* n1, const snode_type* n2) {
         return find_mrca_via_traversal_indices(n1,n2);
     };
+    if (const auto & summary_lca = summary.get_data().lca_index) {
+        summary_mrca = [&summary_lca](const snode_type* n1, const snode_type* n2) {
+            return summary_lca->mrca(n1,n2);
+        };
+    }
     return conflict_with_tree_impl(query_tree, summary, query_mrca, summary_mrca, Tax);
 }
 
@@ -2218,47 +2415,35 @@ void check_all_nodes_have_node_names(const ConflictTree& query_tree)
 // ii) all taxa in C are present in the summary tree
 vector<OttId> extra_children_for_node(OttId id, const SummaryTree_t& summary, const RichTaxonomy& taxonomy)
 {
-    // We could maybe improve speed by:
-    // - following only nodes which are ancestors of synthesis leaves (i.e. unpruned leaves)
-    // - following only nodes which are ancestors of input phylogeny leaves, exemplified to turn higher taxon leaves -> leaf leaves.
-
     auto& id_to_node = summary.get_data().id_to_node;
-    auto& tax_id_to_node = taxonomy.get_tax_tree().get_data().id_to_node;
+    auto& tax_tree = taxonomy.get_tax_tree();
+    auto& tax_id_to_node = tax_tree.get_data().id_to_node;
 
     // If the node is in synth already, then we don't need to add any children.
     if (id_to_node.count(id)) return {};
 
+    // The coverage index lets us skip taxa with no descendants in synth, which add nothing to the frontier.
+    auto coverage = summary.get_data().taxon_coverage.read();
+    const bool use_coverage = coverage.get() != nullptr and coverage->fits(taxonomy);
+
     // Growing list of descendants of `id` that are not in synth.
     vector<OttId> children;
-    vector<OttId> bad_parents({id});
+    vector<const RTRichTaxNode*> bad_parents({tax_id_to_node.at(id)});
 
     // Walk a frontier leafward from id:
     for(std::size_t i=0;i<bad_parents.size();i++)
     {
-        auto parent_id = bad_parents[i];
-        auto tax_node = tax_id_to_node.at(bad_parents[i]);
-
-        auto parent_node = taxonomy.included_taxon_from_id(parent_id);
-
-        for(auto c: iter_child_const(*tax_node))
+        for(auto c: iter_child_const(*bad_parents[i]))
         {
-            auto child_id = c->get_ott_id();
-            auto child_node = taxonomy.included_taxon_from_id(child_id);
-
-            std::cerr << "Lost taxon " << parent_node->get_name() << " ("<<parent_id<<") -> ";
-            std::cerr << "taxon " << child_node->get_name() << " (" << child_id << ") of degree " << child_node->get_out_degree() << ":";
-
-            if (id_to_node.count(child_id))
+            if (use_coverage ? coverage->is_in_tree(c) : id_to_node.count(c->get_ott_id()) > 0)
             {
                 // In synth, we can stop expanding the frontier at this node.
-                std::cerr << "GOOD\n"; 
-                children.push_back(child_id);
+                children.push_back(c->get_ott_id());
             }
-            else
+            else if (not use_coverage or coverage->is_covered(c))
             {
                 // Not in synth, we need to consider the children of this node.
-                std::cerr << "BAD\n";
-                bad_parents.push_back(child_id);
+                bad_parents.push_back(c);
             }
         }
     }
@@ -2273,6 +2458,11 @@ void prune_ancestral_leaves(ConflictTree& query_tree, const RichTaxonomy& taxono
     tfunc taxonomy_mrca = [](const tnode_type* n1, const tnode_type* n2) {
         return mrca_from_depth(n1,n2);
     };
+    if (auto taxonomy_lca = taxonomy.get_lca_index()) {
+        taxonomy_mrca = [taxonomy_lca](const tnode_type* n1, const tnode_type* n2) {
+            return taxonomy_lca->mrca(n1,n2);
+        };
+    }
 
     auto taxonomy_nodes_from_query_leaves = get_induced_nodes(query_tree, taxonomy.get_tax_tree());
     auto induced_taxonomy = get_induced_tree<RichTaxTree, ConflictTree>(taxonomy_nodes_from_query_leaves,
@@ -2310,10 +2500,10 @@ void prune_ancestral_leaves(ConflictTree& query_tree, const RichTaxonomy& taxono
  * 4. For each tip, add as children tips from the other tree that are descendants.
  */
 
-string conflict_ws_method(const SummaryTree_t& summary,
-                          const RichTaxonomy & taxonomy,
-                          std::unique_ptr<ConflictTree>& query_tree,
-                          const string& tree2s)
+json conflict_ws_method(const SummaryTree_t& summary,
+                        const RichTaxonomy & taxonomy,
+                        std::unique_ptr<ConflictTree>& query_tree,
+                        const string& tree2s)
 {
     // 0. Prune unmapped leaves.
     auto leaf_counts = prune_unmapped_leaves(*query_tree, taxonomy);
@@ -2342,12 +2532,7 @@ string conflict_ws_method(const SummaryTree_t& summary,
             auto leaf_id = leaf->get_ott_id();
             auto c = extra_children_for_node(leaf_id, summary, taxonomy);
             if (not c.empty())
-            {
                 children_to_add.insert({leaf,c});
-                LOG(WARNING)<<"ottid "<<leaf->get_ott_id()<<" has frontier ";
-                for(auto id: c)
-                    LOG(WARNING)<<"   "<<id;
-            }
         }
 
         // Add nodes with the specified ottids
@@ -2365,9 +2550,9 @@ string conflict_ws_method(const SummaryTree_t& summary,
     compute_tips(*query_tree);
 
     if (tree2s == "ott") {
-        return conflict_with_taxonomy(*query_tree, taxonomy).dump(1);
+        return conflict_with_taxonomy(*query_tree, taxonomy);
     } else if (tree2s == "synth") {
-        return conflict_with_summary(*query_tree, summary, taxonomy).dump(1);
+        return conflict_with_summary(*query_tree, summary, taxonomy);
     }
     throw OTCBadRequest() << "tree2 = '" << tree2s << "' not recognized!";
 }
@@ -2381,7 +2566,7 @@ string newick_conflict_ws_method(const SummaryTree_t& summary,
     {
         LOG(WARNING)<<"newick conflict: tree1s = '"<<tree1s<<"'   tree1s = '"<<tree2s<<"'";
         auto query_tree = tree_from_newick_string<ConflictTree>(tree1s);
-        return conflict_ws_method(summary, taxonomy, query_tree, tree2s);
+        return conflict_ws_method(summary, taxonomy, query_tree, tree2s).dump(1);
     }
     catch (otc::OTCParsingError& e)
     {
@@ -2397,7 +2582,56 @@ string phylesystem_conflict_ws_method(const SummaryTree_t& summary,
 {
     LOG(WARNING)<<"phylesystem conflict: tree1s = '"<<tree1s<<"'   tree1s = '"<<tree2s<<"'";
     auto query_tree = get_phylesystem_tree<ConflictTree>(tree1s);
-    return conflict_ws_method(summary, taxonomy, query_tree, tree2s);
+    return conflict_ws_method(summary, taxonomy, query_tree, tree2s).dump(1);
+}
+
+// Each query tree is read and compared on its own, but they all share the indices that were built
+//   for the summary tree and taxonomy when they were loaded, so only the query side is per-tree work.
+string batch_conflict_ws_method(const SummaryTree_t& summary,
+                                const RichTaxonomy & taxonomy,
+                                const vector<ConflictQuery>& queries,
+                                const string& tree2s)
+{
+    if (tree2s != "ott" and tree2s != "synth")
+        throw OTCBadRequest() << "tree2 = '" << tree2s << "' not recognized!";
+    LOG(WARNING)<<"batch conflict: "<<queries.size()<<" trees against tree2 = '"<<tree2s<<"'";
+
+    // A bad query tree gets an error in its own slot, rather than failing the whole batch.
+    // Start fetching the studies of the phylesystem trees now, rather than when their turn comes.
+    vector<string> study_ids;
+    for(auto& query: queries)
+        if (not query.is_newick)
+            study_ids.push_back(query.tree.substr(0, query.tree.find_first_of("#@")));
+    prefetch_phylesystem_studies(study_ids);
+
+    vector<json> results(queries.size(), json::object());
+    run_jobs(conflict_threads, queries.size(), [&](std::size_t i) {
+        auto& query = queries[i];
+        json& result = results[i];
+        if (not query.is_newick)
+            result["tree1"] = query.tree;
+        try
+        {
+            std::unique_ptr<ConflictTree> query_tree;
+            if (query.is_newick)
+                query_tree = tree_from_newick_string<ConflictTree>(query.tree);
+            else
+                query_tree = get_phylesystem_tree<ConflictTree>(query.tree);
+            result["conflict"] = conflict_ws_method(summary, taxonomy, query_tree, tree2s);
+        }
+        catch (otc::OTCParsingError& e)
+        {
+            result["error"] = string("Error parsing newick:  \n:") + e.what();
+        }
+        catch (std::exception& e)
+        {
+            result["error"] = e.what();
+        }
+    });
+    json response;
+    response["tree2"] = tree2s;
+    response["results"] = results;
+    return response.dump(1);
 }
 
 
@@ -1,9 +1,13 @@
 #ifndef OTC_TOLWS_H
 #define OTC_TOLWS_H
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <boost/filesystem/operations.hpp>
@@ -12,10 +16,12 @@
 #include "otc/newick_tokenizer.h"
 #include "otc/newick.h"
 #include "otc/tree.h"
+#include "otc/lca_index.h"
+#include "otc/ott_id_index.h"
 #include "otc/error.h"
 #include "otc/taxonomy/taxonomy.h"
 #include "otc/taxonomy/flags.h"
-#include "ws/parallelreadserialwrite.h"
+#include "ws/rcu_pointer.h"
 #include "json.hpp"
 
 #define REPORT_MEMORY_USAGE 1
@@ -31,14 +37,16 @@ typedef std::vector<src_node_id> vec_src_node_id_mapper;
 
 #define JOINT_MAPPING_VEC
 
+enum SourceEdgeMappingType {
+    CONFLICTS_WITH_MAPPING = 0,
+    PARTIAL_PATH_OF_MAPPING = 1,
+    RESOLVES_MAPPING = 2,
+    SUPPORTED_BY_MAPPING = 3,
+    TERMINAL_MAPPING = 4
+};
+const int NUM_SOURCE_EDGE_MAPPING_TYPES = 5;
+
 #if defined(JOINT_MAPPING_VEC)
-    enum SourceEdgeMappingType {
-        CONFLICTS_WITH_MAPPING = 0,
-        PARTIAL_PATH_OF_MAPPING = 1,
-        RESOLVES_MAPPING = 2,
-        SUPPORTED_BY_MAPPING = 3,
-        TERMINAL_MAPPING = 4
-    };
     typedef std::pair<SourceEdgeMappingType, std::uint32_t> semt_ind_t;
     typedef std::vector<semt_ind_t> vec_src_node_ids;
 #else
@@ -88,6 +96,8 @@ class SumTreeNodeData {
     public:
     std::uint32_t trav_enter = UINT32_MAX;
     std::uint32_t trav_exit = UINT32_MAX;
+    // The mappings are only held here while the annotations are read.  After that they live in the
+    //   tree's NodeSupportTable, and these are empty.
 #   if defined(JOINT_MAPPING_VEC)
         vec_src_node_ids source_edge_mappings;
 #   else
@@ -141,12 +151,134 @@ typedef RootedTreeNode<SumTreeNodeData> SumTreeNode_t;
 typedef std::vector<const SumTreeNode_t *> SumTreeNodeVec_t;
 typedef std::pair<const SumTreeNode_t *, SumTreeNodeVec_t> BrokenMRCAAttachVec;
 
+// A read-only view of consecutive elements of a vector.
+template<typename T>
+class ConstSlice {
+    const T * first;
+    const T * last;
+    public:
+    ConstSlice(const T * b, const T * e)
+        :first(b),
+        last(e) {
+    }
+    const T * begin() const {
+        return first;
+    }
+    const T * end() const {
+        return last;
+    }
+    std::size_t size() const {
+        return last - first;
+    }
+    bool empty() const {
+        return first == last;
+    }
+};
+
+// The source tree mappings of every node of a summary tree, in flat arrays indexed by trav_enter.
+//   The mappings of each node are grouped by SourceEdgeMappingType, so the web services can read one
+//   kind of mapping without looking at the others.  The studies that support a node are also stored
+//   once, without duplicates, for the services that report supporting_studies.
+// Mappings are indices of (study, node) pairs in source_nodes.
+class NodeSupportTable {
+    vec_src_node_id_mapper source_nodes;
+    std::vector<std::uint32_t> mapping_offsets; // NUM_SOURCE_EDGE_MAPPING_TYPES per node, plus one
+    std::vector<std::uint32_t> mappings;
+    std::vector<std::uint32_t> study_offsets; // one per node, plus one
+    std::vector<const std::string *> supporting_studies;
+    public:
+    NodeSupportTable()
+        :mapping_offsets(1, 0),
+        study_offsets(1, 0) {
+    }
+    // Adds the mappings of the node whose trav_enter is num_nodes().  supporting_study_ids are the
+    //   studies of its SUPPORTED_BY_MAPPING mappings.
+    void add_node(const std::vector<std::pair<SourceEdgeMappingType, std::uint32_t>> & node_mappings,
+                  std::vector<const std::string *> supporting_study_ids);
+    void set_source_nodes(vec_src_node_id_mapper nodes) {
+        source_nodes = std::move(nodes);
+    }
+    std::size_t num_nodes() const {
+        return study_offsets.size() - 1;
+    }
+    const src_node_id & get_source_node(std::uint32_t mapping) const {
+        assert(mapping < source_nodes.size());
+        return source_nodes[mapping];
+    }
+    ConstSlice<std::uint32_t> get_mappings(const SumTreeNodeData & d, SourceEdgeMappingType kind) const {
+        const auto i = d.trav_enter * NUM_SOURCE_EDGE_MAPPING_TYPES + kind;
+        assert(i + 1 < mapping_offsets.size());
+        return {mappings.data() + mapping_offsets[i], mappings.data() + mapping_offsets[i + 1]};
+    }
+    ConstSlice<const std::string *> get_supporting_studies(const SumTreeNodeData & d) const {
+        assert(d.trav_enter + 1 < study_offsets.size());
+        return {supporting_studies.data() + study_offsets[d.trav_enter],
+                supporting_studies.data() + study_offsets[d.trav_enter + 1]};
+    }
+    std::size_t memory_used() const {
+        return source_nodes.capacity() * sizeof(src_node_id)
+               + mapping_offsets.capacity() * sizeof(std::uint32_t)
+               + mappings.capacity() * sizeof(std::uint32_t)
+               + study_offsets.capacity() * sizeof(std::uint32_t)
+               + supporting_studies.capacity() * sizeof(const std::string *);
+    }
+};
+
+// Which taxa of the taxonomy are in a summary tree, or have a descendant that is, indexed by the
+//   taxonomy's trav_enter.  Lets the conflict service expand a higher taxon into the taxa of the
+//   tree below it without walking the (often huge) parts of the taxonomy that have none.
+class TaxonCoverage {
+    std::vector<bool> in_tree;
+    std::vector<bool> covered;
+    // The taxonomy that the trav_enter indices refer to.  Weak, so that a tree does not keep an
+    //   old taxonomy alive.
+    std::weak_ptr<const RichTaxonomy> built_for;
+    public:
+    void build(const std::shared_ptr<const RichTaxonomy> & taxonomy, const OttIdIndex<const SumTreeNode_t *> & id_to_node) {
+        const auto & tax_tree = taxonomy->get_tax_tree();
+        const auto num_taxa = std::size_t(tax_tree.get_root()->get_data().trav_exit) + 1;
+        in_tree.assign(num_taxa, false);
+        covered.assign(num_taxa, false);
+        for (auto nd : iter_post_const(tax_tree)) {
+            const auto i = nd->get_data().trav_enter;
+            in_tree[i] = (id_to_node.count(nd->get_ott_id()) > 0);
+            if (in_tree[i] or covered[i]) {
+                covered[i] = true;
+                if (nd->get_parent() != nullptr) {
+                    covered[nd->get_parent()->get_data().trav_enter] = true;
+                }
+            }
+        }
+        built_for = taxonomy;
+    }
+    // False if built for a different taxonomy (or not at all).
+    bool fits(const RichTaxonomy & taxonomy) const {
+        return built_for.lock().get() == &taxonomy;
+    }
+    bool is_in_tree(const RTRichTaxNode * nd) const {
+        return in_tree[nd->get_data().trav_enter];
+    }
+    bool is_covered(const RTRichTaxNode * nd) const {
+        return covered[nd->get_data().trav_enter];
+    }
+    std::size_t memory_used() const {
+        return (in_tree.capacity() + covered.capacity()) / 8;
+    }
+};
+
 class SumTreeData {
     public:
     std::unordered_map<std::string, const SumTreeNode_t *> broken_name_to_node;
-    std::unordered_map<OttId, const SumTreeNode_t *> id_to_node;
+    OttIdIndex<const SumTreeNode_t *> id_to_node;
     
     std::unordered_map<std::string, BrokenMRCAAttachVec> broken_taxa;
+    // Built once the trav_enter indices are set; used for MRCAs in the conflict services.
+    std::unique_ptr<LCAIndex<const SumTreeNode_t>> lca_index;
+    // Filled in when the annotations are read.
+    NodeSupportTable support;
+    // Built against the taxonomy being served, and replaced along with it by publish_taxonomy.
+    //   Requests only use it if it fits the taxonomy that they hold.
+    mutable RCUPointer<TaxonCoverage> taxon_coverage;
 };
 using SummaryTree_t = otc::RootedTree<SumTreeNodeData, SumTreeData>;
 
@@ -167,8 +299,7 @@ inline std::size_t calc_memory_used(const SumTreeData &d, MemoryBookkeeper &mb)
     for (auto n : d.broken_name_to_node) {
         bn2nmem += calc_memory_used(n.first, mb) + sizeof(const SumTreeNode_t *);
     }
-    const auto i2nnum_unused_buckets = d.id_to_node.bucket_count() - d.broken_name_to_node.size();
-    std::size_t i2nmem = (d.id_to_node.size() + i2nnum_unused_buckets) * (sizeof(OttId) + sizeof(SumTreeNode_t *));
+    std::size_t i2nmem = d.id_to_node.memory_used();
     const auto btnum_unused_buckets = d.broken_taxa.bucket_count() - d.broken_taxa.size();
     std::size_t btmem = btnum_unused_buckets * (sizeof(std::string) + sizeof(BrokenMRCAAttachVec ));
     for (auto n : d.broken_taxa) {
@@ -177,7 +308,14 @@ inline std::size_t calc_memory_used(const SumTreeData &d, MemoryBookkeeper &mb)
     mb["SumTreeData broken_name_to_node"] += bn2nmem;
     mb["SumTreeData id_to_node"] += i2nmem;
     mb["SumTreeData broken_taxa"] += btmem;
-    return btmem + i2nmem + bn2nmem;
+    std::size_t lcamem = (d.lca_index ? d.lca_index->memory_used() : 0);
+    mb["SumTreeData lca_index"] += lcamem;
+    std::size_t supmem = d.support.memory_used();
+    mb["SumTreeData support"] += supmem;
+    auto coverage = d.taxon_coverage.load();
+    std::size_t covmem = (coverage ? coverage->memory_used() : 0);
+    mb["SumTreeData taxon_coverage"] += covmem;
+    return btmem + i2nmem + bn2nmem + lcamem + supmem + covmem;
 }
 #endif
 
@@ -229,10 +367,17 @@ void index_by_name_or_id(T & tree) {
     auto & td = tree.get_data();
     auto & bm = td.broken_name_to_node;
     auto & im = td.id_to_node;
+    OttId max_ott_id = -1;
+    for (auto nd : iter_pre(tree)) {
+        if (nd->has_ott_id()) {
+            max_ott_id = std::max(max_ott_id, nd->get_ott_id());
+        }
+    }
+    im.reserve_ids(max_ott_id);
     for (auto nd : iter_pre(tree)) {
         if (nd->has_ott_id()) {
             nd->set_name(empty_string);
-            im[nd->get_ott_id()] = nd;
+            im.set(nd->get_ott_id(), nd);
         } else {
             bm[nd->get_name()] = nd;
         }
@@ -275,6 +420,33 @@ std::string induced_subtree_ws_method(const TreesToServe & tts,
                                       const std::vector<std::string> & node_id_vec,
                                       NodeNameStyle label_format);
 
+// A response body that is produced a piece at a time, so that a huge response never has to be held
+//   in memory.  It must keep alive everything that it reads.
+class ChunkedResponse {
+    public:
+    virtual ~ChunkedResponse() = default;
+    // Appends roughly chunk_size more bytes of the body to out.  Returns false once the body is complete.
+    virtual bool write_next(std::string & out, std::size_t chunk_size) = 0;
+};
+
+// The same body as newick_subtree_ws_method, as a ChunkedResponse, for subtrees that are too big for
+//   newick_subtree_ws_method.  There is no tip limit.  Returns nullptr for subtrees that are small enough.
+std::unique_ptr<ChunkedResponse> newick_subtree_ws_stream(const TreesToServe & tts,
+                                                          const SummaryTree_t * tree_ptr,
+                                                          const std::string & node_id,
+                                                          NodeNameStyle label_format,
+                                                          bool include_all_node_labels,
+                                                          int height_limit);
+
+// The same body as taxon_subtree_ws_method, as a ChunkedResponse, or nullptr if the taxon has fewer
+//   than NEWICK_TIP_LIMIT descendants.
+std::unique_ptr<ChunkedResponse> taxon_subtree_ws_stream(std::shared_ptr<const RichTaxonomy> taxonomy,
+                                                         const RTRichTaxNode * taxon_node,
+                                                         NodeNameStyle label_format);
+
+// Subtrees with more tips than this are too big for newick_subtree_ws_method, and must be streamed.
+const uint32_t NEWICK_TIP_LIMIT = 25000;
+
 std::string newick_subtree_ws_method(const TreesToServe & tts,
                                      const SummaryTree_t * tree_ptr,
                                      const std::string & node_id,
@@ -313,6 +485,10 @@ std::string tnrs_match_names_ws_method(const std::vector<std::string>& names,
                                        const std::optional<std::vector<std::string>>& ids,
                                        bool include_suppressed,
                                        const RichTaxonomy& taxonomy);
+// Long name lists given to tnrs/match_names are split into batches that are resolved on extra threads.
+//   At most `total` extra threads work on match_names requests at any time, and at most `per_request`
+//   on any one request, so that one huge request cannot take every core from the other endpoints.
+void set_match_names_thread_limits(unsigned total, unsigned per_request);
 std::string tnrs_autocomplete_name_ws_method(const std::string& name,
 					     const std::string& context_name,
 					     bool include_suppressed,
@@ -332,8 +508,56 @@ std::string phylesystem_conflict_ws_method(const SummaryTree_t & summary,
                                            const std::string& tree1s,
                                            const std::string& tree2s);
 
+// One query tree of a batch conflict request: a newick string, or a phylesystem tree id.
+struct ConflictQuery {
+    std::string tree;
+    bool is_newick = false;
+};
+
+// Compares each query tree to tree2s ("ott" or "synth"), returning the results in the order of the queries.
+//   The trees are spread over at most `total` extra threads at a time, and at most `per_request` per batch.
+std::string batch_conflict_ws_method(const SummaryTree_t & summary,
+                                     const RichTaxonomy & taxonomy,
+                                     const std::vector<ConflictQuery>& queries,
+                                     const std::string& tree2s);
+void set_conflict_thread_limits(unsigned total, unsigned per_request);
+
+// Reads the trees in the subdirectories of dirname whose files have changed since they were last
+//   looked at (or that have not been looked at), and publishes them.
 bool read_trees(const boost::filesystem::path & dirname, TreesToServe & tts);
 
+// Runs read_trees on another thread when start() is called, while the trees already published
+//   keep being served.  The destructor waits for a read in progress.
+class BackgroundTreeReader {
+    public:
+    BackgroundTreeReader(const boost::filesystem::path & dirname, TreesToServe & tts);
+    ~BackgroundTreeReader();
+    // Returns false if a background read (this one's or a PeriodicTreeReader's) is already running.
+    bool start();
+    BackgroundTreeReader(const BackgroundTreeReader &) = delete;
+    BackgroundTreeReader & operator=(const BackgroundTreeReader &) = delete;
+    private:
+    const boost::filesystem::path dirname;
+    TreesToServe & tts;
+    std::mutex mutex; // serializes start() and the destructor
+    std::thread thread;
+};
+
+// Runs read_trees every `interval` on its own thread (skipping a turn if a background read is
+//   already running), until it is destroyed.  The destructor waits for a read in progress.
+class PeriodicTreeReader {
+    public:
+    PeriodicTreeReader(const boost::filesystem::path & dirname, TreesToServe & tts, std::chrono::seconds interval);
+    ~PeriodicTreeReader();
+    PeriodicTreeReader(const PeriodicTreeReader &) = delete;
+    PeriodicTreeReader & operator=(const PeriodicTreeReader &) = delete;
+    private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
 void from_json(const nlohmann::json &j, SourceTreeId & sti);
 void to_json(nlohmann::json &j, const SourceTreeId & sti);
 
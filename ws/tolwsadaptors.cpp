@@ -11,6 +11,9 @@
 #include <fstream>
 #include <cstdlib>
 #include "ws/tolwsadaptors.h"
+#include "ws/response_cache.h"
+#include "ws/nexson/nexson.h"
+#include "ws/compression.h"
 #include "otc/otcli.h"
 
 // unlike most headers, we'll go ahead an use namespaces
@@ -43,10 +46,6 @@ namespace otc {
 // global
 TreesToServe tts;
 
-#if defined(DEBUGGING_THREAD_LOCKING)
-    std::mutex otc::ParallelReadSerialWrite::cout_mutex;
-#endif
-
 }// namespace otc
 
 template<typename T>
@@ -378,13 +377,29 @@ std::string process_subtree(const json& parsedargs)
     }
 }
 
+// Newick subtrees that are too big to build in memory are streamed instead.
+std::unique_ptr<ChunkedResponse> stream_subtree(const json& parsedargs)
+{
+    string synth_id;
+    string node_id;
+    tie(synth_id, node_id) = get_synth_and_node_id(parsedargs);
+    auto format = extract_argument_or_default<string>(parsedargs, "format", "newick");
+    if (format != "newick") {
+	return nullptr;
+    }
+    NodeNameStyle nns = get_label_format(parsedargs);
+    int height_limit = extract_argument_or_default<int>(parsedargs, "height_limit", -1);
+    const SummaryTree_t * treeptr = get_summary_tree(tts, synth_id);
+    bool all_node_labels = extract_argument_or_default<bool>(parsedargs, "include_all_node_labels", false);
+    return newick_subtree_ws_stream(tts, treeptr, node_id, nns, all_node_labels, height_limit);
+}
+
 string induced_subtree_method_handler( const json& parsedargs )
 {
     string synth_id;
     vector<string> node_id_vec;
     tie(synth_id, node_id_vec) = get_synth_and_node_id_vec(parsedargs);
     NodeNameStyle nns = get_label_format(parsedargs);
-    const SummaryTreeAnnotation * sta = get_annotations(tts, synth_id);
     const SummaryTree_t * treeptr = get_summary_tree(tts, synth_id);
     return induced_subtree_ws_method(tts, treeptr, node_id_vec, nns);
 }
@@ -455,6 +470,14 @@ string taxon_subtree_method_handler( const json& parsedargs )
     return taxon_subtree_ws_method(taxonomy, taxon_node, nns);
 }
 
+std::unique_ptr<ChunkedResponse> stream_taxon_subtree( const json& parsedargs )
+{
+    NodeNameStyle nns = get_label_format(parsedargs);
+    auto taxonomy = tts.get_taxonomy_snapshot();
+    const RTRichTaxNode * taxon_node = extract_taxon_node_from_args(parsedargs, *taxonomy);
+    return taxon_subtree_ws_stream(taxonomy, taxon_node, nns);
+}
+
 // See taxomachine/src/main/java/org/opentree/taxonomy/plugins/tnrs_v3.java
 
 // 10,000 queries at .0016 second per query = 16 seconds
@@ -532,7 +555,54 @@ string conflict_status_method_handler( const json& parsed_args )
 	throw OTCBadRequest()<<"Expecting argument 'tree1' or argument 'tree1newick'";
 }
 
+// The results come back in the order of tree1newicks, followed by tree1s.
+string conflict_status_batch_method_handler( const json& parsed_args )
+{
+    auto tree1newicks = extract_argument_or_default<vector<string>>(parsed_args, "tree1newicks", {});
+    auto tree1s = extract_argument_or_default<vector<string>>(parsed_args, "tree1s", {});
+
+    string tree2 = extract_required_argument<string>(parsed_args, "tree2");
+
+    if (tree1newicks.empty() and tree1s.empty())
+	throw OTCBadRequest()<<"Expecting a non-empty argument 'tree1s' or 'tree1newicks'";
+    vector<ConflictQuery> queries;
+    for(auto& newick: tree1newicks)
+	queries.push_back({newick, true});
+    for(auto& id: tree1s)
+	queries.push_back({id, false});
+
+    const auto& summary = *tts.get_summary_tree("");
+    auto locked_taxonomy = tts.get_readable_taxonomy();
+    const auto & taxonomy = locked_taxonomy.first;
+    return batch_conflict_ws_method(summary, taxonomy, queries, tree2);
+}
+
+// Reads new synth outputs from the tree-dir for reload_trees.  Owned by run_server, which joins
+//   its thread after the service stops.
+static BackgroundTreeReader * background_tree_reader = nullptr;
+
+// Starts looking for new synth outputs in the tree-dir.  The trees it reports are the ones served
+//   before the new ones (if any) have been read.
+string reload_trees_method_handler( const json& )
+{
+    json response;
+    response["started"] = background_tree_reader->start();
+    response["synth_ids"] = tts.get_available_trees();
+    response["default_synth_id"] = tts.get_default_tree();
+    return response.dump(1);
+}
+
 /// End of method_handler. Start of global service related code
+// Responses of the endpoints that are pure functions of their arguments and of the trees and taxonomy
+//   being served.  Null if caching is turned off.
+static std::unique_ptr<ResponseCache> response_cache;
+// The Cache-Control max-age for those responses, in seconds.
+static int response_max_age = 3600;
+// Whether to compress responses for clients that accept gzip, deflate or brotli.
+static bool compress_responses = true;
+// Bodies shorter than this are sent as they are: compressing them saves less than it costs.
+static std::size_t compression_threshold = 1024;
+
 Service * global_service_ptr = nullptr;
 
 void kill_service_worker() {
@@ -541,6 +611,10 @@ void kill_service_worker() {
     if (gp == nullptr) {
         return;
     }
+    if (response_cache) {
+        LOG(INFO) << "response cache: " << response_cache->stats().dump();
+    }
+    LOG(INFO) << "study cache: " << phylesystem_study_cache_stats().dump();
     LOG(WARNING) <<  "Stopping service...";
     gp->stop();
     LOG(WARNING) <<  "Service stopped...";
@@ -608,11 +682,60 @@ multimap<string,string> request_headers(const string& rbody)
     headers.insert({ "Pragma", "no-cache"});
 // Server:Apache/2.4.10 (Debian)
 // Set-Cookie:session_id_phylesystem=152.3.12.201-82a8df2c-2a3d-4c10-aca3-3c79ca8ebdd1; Path=/
-    headers.insert({ "Vary", "Accept-Encoding"} );   // cache separately for each encoding?
+    headers.insert({ "Vary", "Accept-Encoding"} );   // responses may be compressed differently for each encoding
     headers.insert({ "X-Powered-By","otc-tol-ws"});  //X-Powered-By:web2py
     return headers;
 }
 
+// Unlike request_headers, these let clients and proxies keep the response for response_max_age seconds.
+multimap<string,string> cacheable_response_headers(const string& rbody, const string& etag)
+{
+    auto headers = request_headers(rbody);
+    for(auto key: {"Cache-Control", "Expires", "Pragma"})
+	headers.erase(key);
+    headers.insert({ "Cache-Control", "public, max-age=" + ::to_string(response_max_age)});
+    headers.insert({ "ETag", etag});
+    headers.insert({ "Expires", ctime(chrono::system_clock::now() + chrono::seconds(response_max_age))});
+    return headers;
+}
+
+// Adds the Content-Encoding header for a body compressed with coding.
+multimap<string,string> with_content_encoding(multimap<string,string> headers, ContentCoding coding)
+{
+    if (coding != ContentCoding::identity)
+	headers.insert({ "Content-Encoding", content_coding_name(coding)});
+    return headers;
+}
+
+// The coding to compress a response to request with, according to its Accept-Encoding header.
+ContentCoding response_coding(const Request& request)
+{
+    if (not compress_responses)
+	return ContentCoding::identity;
+    return negotiate_content_coding(request.get_header( "Accept-Encoding", string() ));
+}
+
+// Sends a successful response, compressed if it is big enough to be worth it.
+void close_with_body(const shared_ptr< Session > session, const string& rbody, ContentCoding coding)
+{
+    if (coding == ContentCoding::identity or rbody.size() < compression_threshold) {
+	session->close( OK, rbody, request_headers(rbody) );
+	return;
+    }
+    auto compressed = compress_body(rbody, coding);
+    session->close( OK, compressed, with_content_encoding(request_headers(compressed), coding) );
+}
+
+// Arguments are compared after parsing, so the order of keys and the white space do not matter.  The
+//   generation changes whenever the trees or the taxonomy being served change.  The generation of the
+//   trees that this request sees is included too, so a request that started before new trees were
+//   published does not cache its answer under their key.
+string response_cache_key(const string& path, const json& parsedargs)
+{
+    auto trees_generation = tts.get_readable_trees()->generation;
+    return path + '\n' + ::to_string(tts.get_generation()) + '.' + ::to_string(trees_generation) + '\n' + parsedargs.dump();
+}
+
 multimap<string,string> options_headers()
 {
     multimap<string,string> headers;
@@ -658,20 +781,138 @@ std::string error_response(const string& path, const OTCWebError& e1)
     return e2.json().dump(4)+"\n";
 }
 
+// A request handler that may stream its response.  It returns nullptr if the response is small
+//   enough for the ordinary handler.
+using StreamingHandler = std::function<std::unique_ptr<ChunkedResponse>(const json&)>;
+
+// The approximate number of bytes of a streamed response that are held in memory at once.
+const std::size_t RESPONSE_CHUNK_SIZE = 1 << 16;
+
+multimap<string,string> streaming_response_headers(ContentCoding coding)
+{
+    auto headers = with_content_encoding(request_headers(""), coding);
+    headers.erase("Content-Length");
+    headers.insert({ "Transfer-Encoding", "chunked"});
+    return headers;
+}
+
+// Compresses another ChunkedResponse as it is produced.
+class CompressedChunkedResponse: public ChunkedResponse {
+    std::unique_ptr<ChunkedResponse> body;
+    StreamCompressor compressor;
+    public:
+    CompressedChunkedResponse(std::unique_ptr<ChunkedResponse> b, ContentCoding coding)
+	:body(std::move(b)),
+	 compressor(coding)
+    { }
+    bool write_next(string& out, std::size_t chunk_size) override
+    {
+	// The compressor holds on to its input until it has a block's worth, so keep feeding it
+	//   rather than sending empty chunks.
+	bool more;
+	do {
+	    string raw;
+	    more = body->write_next(raw, chunk_size);
+	    compressor.compress(raw, not more, out);
+	} while (more and out.empty());
+	return more;
+    }
+};
+
+// Sends the next chunk of a streamed response, and asks to be called again once it has been written.
+void send_next_chunk(const shared_ptr< Session > session, const shared_ptr<ChunkedResponse> response)
+{
+    string chunk;
+    bool more = false;
+    try {
+	more = response->write_next(chunk, RESPONSE_CHUNK_SIZE);
+    } catch (std::exception& e) {
+	// The status line has already gone out, so all we can do is cut the response short.
+	LOG(WARNING)<<"streamed response failed: "<<e.what();
+	session->close();
+	return;
+    }
+    string framed;
+    if (not chunk.empty()) {
+	std::ostringstream chunk_size;
+	chunk_size<<std::hex<<chunk.size();
+	framed = chunk_size.str() + "\r\n" + chunk + "\r\n";
+    }
+    if (more)
+	session->yield( framed, [response]( const shared_ptr< Session > session ) { send_next_chunk(session, response); } );
+    else
+	session->close( framed + "0\r\n\r\n" );
+}
+
+// Caches response under key if there is a cache.
+shared_ptr<const CachedResponse> cache_response(const string& key, CachedResponse response)
+{
+    response.etag = make_etag(response.body);
+    if (not response_cache)
+	return make_shared<const CachedResponse>(std::move(response));
+    return response_cache->insert(key, std::move(response));
+}
+
+// Looks up the response in the response cache, computing and caching it if necessary.  Responses
+//   that are worth compressing are also cached in each coding that clients have asked for, so each
+//   coding is only computed once.  The coding is part of the ETag, since the bytes differ.
+shared_ptr<const CachedResponse> cached_response(const string& path, const std::function<std::string(const json&)>& process_request,
+						 const json& parsedargs, ContentCoding coding)
+{
+    auto key = response_cache ? response_cache_key(path, parsedargs) : string();
+    shared_ptr<const CachedResponse> response = response_cache ? response_cache->find(key) : nullptr;
+    if (not response)
+	response = cache_response(key, CachedResponse{process_request(parsedargs), {}});
+
+    if (coding == ContentCoding::identity or response->body.size() < compression_threshold)
+	return response;
+
+    auto encoded_key = key + '\n' + content_coding_name(coding);
+    if (response_cache)
+	if (auto cached = response_cache->find(encoded_key))
+	    return cached;
+    return cache_response(encoded_key, CachedResponse{compress_body(response->body, coding), {}, coding});
+}
+
 std::function<void(const shared_ptr< Session > session)>
-create_method_handler(const string& path, const std::function<std::string(const json&)> process_request)
+create_method_handler(const string& path, const std::function<std::string(const json&)> process_request, bool cacheable = false,
+		      const StreamingHandler stream_request = nullptr)
 {
     return [=](const shared_ptr< Session > session ) {
 	const auto request = session->get_request( );
 	size_t content_length = request->get_header( "Content-Length", 0 );
-	session->fetch( content_length, [ path, process_request, request ]( const shared_ptr< Session > session, const Bytes & body ) {
+	session->fetch( content_length, [ path, process_request, request, cacheable, stream_request ]( const shared_ptr< Session > session, const Bytes & body ) {
 		try {
 		    LOG(DEBUG)<<"request: "<<path;
+		    // Keeps the trees that the request sees from being retired while it runs.
+		    auto trees = tts.get_readable_trees();
 		    json parsedargs = parse_body_or_throw(body);
 		    LOG(DEBUG)<<"   argument "<<parsedargs.dump(1);
+		    if (stream_request) {
+			if (auto body = stream_request(parsedargs)) {
+			    LOG(DEBUG)<<"request: STREAMING";
+			    auto coding = response_coding(*request);
+			    shared_ptr<ChunkedResponse> response;
+			    if (coding == ContentCoding::identity)
+				response = std::move(body);
+			    else
+				response = make_shared<CompressedChunkedResponse>(std::move(body), coding);
+			    session->yield( OK, streaming_response_headers(coding), [response]( const shared_ptr< Session > session ) { send_next_chunk(session, response); } );
+			    return;
+			}
+		    }
+		    if (cacheable) {
+			auto response = cached_response(path, process_request, parsedargs, response_coding(*request));
+			LOG(DEBUG)<<"request: DONE";
+			if (request->get_header( "If-None-Match", string() ) == response->etag)
+			    session->close( NOT_MODIFIED, "", cacheable_response_headers("", response->etag) );
+			else
+			    session->close( OK, response->body, with_content_encoding(cacheable_response_headers(response->body, response->etag), response->coding) );
+			return;
+		    }
 		    auto rbody = process_request(parsedargs);
 		    LOG(DEBUG)<<"request: DONE";
-		    session->close( OK, rbody, request_headers(rbody) );
+		    close_with_body(session, rbody, response_coding(*request));
 		} catch (OTCWebError& e) {
 		    string rbody = error_response(path,e);
 		    session->close( e.status_code(), rbody, request_headers(rbody) );
@@ -700,12 +941,13 @@ create_GET_method_handler(const string& path, const std::function<std::string(co
 	try
 	{
 	    LOG(DEBUG)<<"request: "<<path;
+	    auto trees = tts.get_readable_trees();
 	    const auto& request = session->get_request( );
 	    json parsedargs = request_to_json(*request);
 	    LOG(DEBUG)<<"   argument "<<parsedargs.dump(1);
 	    auto rbody = process_request(parsedargs);
 	    LOG(DEBUG)<<"request: DONE";
-	    session->close( OK, rbody, request_headers(rbody) );
+	    close_with_body(session, rbody, response_coding(*request));
 	}
 	catch (OTCWebError& e)
 	{
@@ -721,11 +963,12 @@ void options_method_handler( const shared_ptr< Session > session ) {
     session->close( OK, "", options_headers() );
 }
 
-shared_ptr< Resource > path_handler(const string& path, std::function<std::string(const json &)> process_request)
+shared_ptr< Resource > path_handler(const string& path, std::function<std::string(const json &)> process_request, bool cacheable = false,
+				    StreamingHandler stream_request = nullptr)
 {
     auto r_subtree = make_shared< Resource >( );
     r_subtree->set_path( path );
-    r_subtree->set_method_handler( "POST", create_method_handler(path,process_request));
+    r_subtree->set_method_handler( "POST", create_method_handler(path,process_request,cacheable,stream_request));
     r_subtree->set_method_handler( "OPTIONS", options_method_handler);
     return r_subtree;
 }
@@ -741,6 +984,56 @@ int run_server(const po::variables_map & args) {
     if (args.count("num-threads")) {
         num_threads = args["num-threads"].as<int>();
     }
+    unsigned tnrs_threads = std::max(1U, std::thread::hardware_concurrency());
+    if (args.count("tnrs-threads")) {
+        tnrs_threads = args["tnrs-threads"].as<unsigned>();
+    }
+    unsigned tnrs_threads_per_request = std::max(1U, tnrs_threads / 2);
+    if (args.count("tnrs-threads-per-request")) {
+        tnrs_threads_per_request = args["tnrs-threads-per-request"].as<unsigned>();
+    }
+    set_match_names_thread_limits(tnrs_threads, tnrs_threads_per_request);
+    unsigned conflict_threads = std::max(1U, std::thread::hardware_concurrency());
+    if (args.count("conflict-threads")) {
+        conflict_threads = args["conflict-threads"].as<unsigned>();
+    }
+    unsigned conflict_threads_per_request = std::max(1U, conflict_threads / 2);
+    if (args.count("conflict-threads-per-request")) {
+        conflict_threads_per_request = args["conflict-threads-per-request"].as<unsigned>();
+    }
+    set_conflict_thread_limits(conflict_threads, conflict_threads_per_request);
+    std::size_t response_cache_megabytes = 256;
+    if (args.count("response-cache-size")) {
+        response_cache_megabytes = args["response-cache-size"].as<std::size_t>();
+    }
+    if (response_cache_megabytes > 0) {
+        response_cache = std::make_unique<ResponseCache>(response_cache_megabytes << 20);
+    }
+    if (args.count("response-max-age")) {
+        response_max_age = args["response-max-age"].as<int>();
+    }
+    if (args.count("no-compression")) {
+        compress_responses = false;
+    }
+    if (args.count("compression-threshold")) {
+        compression_threshold = args["compression-threshold"].as<std::size_t>();
+    }
+    if (args.count("study-cache-dir") or args.count("phylesystem-dir")) {
+        StudyCache::Options study_cache_options;
+        if (args.count("study-cache-dir")) {
+            study_cache_options.cache_dir = args["study-cache-dir"].as<string>();
+        }
+        if (args.count("study-cache-size")) {
+            study_cache_options.max_bytes = args["study-cache-size"].as<std::uintmax_t>() << 20;
+        }
+        if (args.count("study-cache-max-age")) {
+            study_cache_options.max_age_seconds = args["study-cache-max-age"].as<long>();
+        }
+        if (args.count("phylesystem-dir")) {
+            study_cache_options.phylesystem_dir = args["phylesystem-dir"].as<string>();
+        }
+        set_study_cache(study_cache_options);
+    }
     if (args.count("port")) {
         port_number = args["port"].as<int>();
     }
@@ -753,10 +1046,22 @@ int run_server(const po::variables_map & args) {
         return 1;
     }
     const fs::path topdir{args["tree-dir"].as<string>()};
+    // Declared before the service, so that a read started by reload_trees is joined after the
+    //   service has stopped.
+    BackgroundTreeReader background_reader(topdir, tts);
+    background_tree_reader = &background_reader;
+    if (args.count("max-synth-versions")) {
+        tts.set_max_synth_versions(args["max-synth-versions"].as<std::size_t>());
+    }
+    const bool allow_tree_reload = args.count("allow-tree-reload");
+    unsigned tree_reload_interval = 0;
+    if (args.count("tree-reload-interval")) {
+        tree_reload_interval = args["tree-reload-interval"].as<unsigned>();
+    }
 
     // Must load taxonomy before trees
     LOG(INFO) << "reading taxonomy...";
-    RichTaxonomy taxonomy = load_rich_taxonomy(args);
+    auto taxonomy = std::make_shared<RichTaxonomy>(load_rich_taxonomy(args));
     time_t post_tax_time;
     time(&post_tax_time);
     tts.set_taxonomy(taxonomy);
@@ -771,21 +1076,26 @@ int run_server(const po::variables_map & args) {
 	std::cerr << "No tree to serve. Exiting...\n";
         return 3;
     }
+    // Stopped and joined when run_server returns, after the service has stopped.
+    std::unique_ptr<PeriodicTreeReader> periodic_tree_reader;
+    if (tree_reload_interval > 0) {
+        periodic_tree_reader = std::make_unique<PeriodicTreeReader>(topdir, tts, chrono::seconds(tree_reload_interval));
+    }
 
     ////// v3 ROUTES
     // tree web services
     auto v3_r_about            = path_handler(v3_prefix + "/tree_of_life/about", about_method_handler);
-    auto v3_r_node_info        = path_handler(v3_prefix + "/tree_of_life/node_info", node_info_method_handler );
-    auto v3_r_mrca             = path_handler(v3_prefix + "/tree_of_life/mrca", mrca_method_handler );
-    auto v3_r_subtree          = path_handler(v3_prefix + "/tree_of_life/subtree", process_subtree);
-    auto v3_r_induced_subtree  = path_handler(v3_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
+    auto v3_r_node_info        = path_handler(v3_prefix + "/tree_of_life/node_info", node_info_method_handler, true);
+    auto v3_r_mrca             = path_handler(v3_prefix + "/tree_of_life/mrca", mrca_method_handler, true);
+    auto v3_r_subtree          = path_handler(v3_prefix + "/tree_of_life/subtree", process_subtree, true, stream_subtree);
+    auto v3_r_induced_subtree  = path_handler(v3_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler, true);
 
     // taxonomy web services
     auto v3_r_tax_about        = path_handler(v3_prefix + "/taxonomy/about", tax_about_method_handler );
-    auto v3_r_taxon_info       = path_handler(v3_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
+    auto v3_r_taxon_info       = path_handler(v3_prefix + "/taxonomy/taxon_info", taxon_info_method_handler, true);
     auto v3_r_taxon_flags      = path_handler(v3_prefix + "/taxonomy/flags", taxon_flags_method_handler );
-    auto v3_r_taxon_mrca       = path_handler(v3_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
-    auto v3_r_taxon_subtree    = path_handler(v3_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
+    auto v3_r_taxon_mrca       = path_handler(v3_prefix + "/taxonomy/mrca", taxon_mrca_method_handler, true);
+    auto v3_r_taxon_subtree    = path_handler(v3_prefix + "/taxonomy/subtree", taxon_subtree_method_handler, false, stream_taxon_subtree);
 
     // tnrs
     auto v3_r_tnrs_match_names       = path_handler(v3_prefix + "/tnrs/match_names", tnrs_match_names_handler );
@@ -795,6 +1105,7 @@ int run_server(const po::variables_map & args) {
 
     // conflict
     auto v3_r_conflict_status  = path_handler(v3_prefix + "/conflict/conflict-status", conflict_status_method_handler );
+    auto v3_r_conflict_status_batch = path_handler(v3_prefix + "/conflict/conflict-status-batch", conflict_status_batch_method_handler );
 
     // v2 conflict --
     auto v3_r_old_conflict_status = make_shared< Resource >( );
@@ -805,22 +1116,25 @@ int run_server(const po::variables_map & args) {
 	v3_r_old_conflict_status->set_method_handler( "OPTIONS", options_method_handler);
     }
 
+    // admin
+    auto v3_r_reload_trees     = path_handler(v3_prefix + "/tree_of_life/reload_trees", reload_trees_method_handler );
+
     ////// v4 ROUTES
 
     // tree web services
     auto v4_r_available_trees  = path_handler(v4_prefix + "/tree_of_life/available_trees", available_trees_method_handler);
     auto v4_r_about            = path_handler(v4_prefix + "/tree_of_life/about", about_method_handler);
-    auto v4_r_node_info        = path_handler(v4_prefix + "/tree_of_life/node_info", node_info_method_handler );
-    auto v4_r_mrca             = path_handler(v4_prefix + "/tree_of_life/mrca", mrca_method_handler );
-    auto v4_r_subtree          = path_handler(v4_prefix + "/tree_of_life/subtree", process_subtree);
-    auto v4_r_induced_subtree  = path_handler(v4_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
+    auto v4_r_node_info        = path_handler(v4_prefix + "/tree_of_life/node_info", node_info_method_handler, true);
+    auto v4_r_mrca             = path_handler(v4_prefix + "/tree_of_life/mrca", mrca_method_handler, true);
+    auto v4_r_subtree          = path_handler(v4_prefix + "/tree_of_life/subtree", process_subtree, true, stream_subtree);
+    auto v4_r_induced_subtree  = path_handler(v4_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler, true);
 
     // taxonomy web services
     auto v4_r_tax_about        = path_handler(v4_prefix + "/taxonomy/about", tax_about_method_handler );
-    auto v4_r_taxon_info       = path_handler(v4_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
+    auto v4_r_taxon_info       = path_handler(v4_prefix + "/taxonomy/taxon_info", taxon_info_method_handler, true);
     auto v4_r_taxon_flags      = path_handler(v4_prefix + "/taxonomy/flags", taxon_flags_method_handler );
-    auto v4_r_taxon_mrca       = path_handler(v4_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
-    auto v4_r_taxon_subtree    = path_handler(v4_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
+    auto v4_r_taxon_mrca       = path_handler(v4_prefix + "/taxonomy/mrca", taxon_mrca_method_handler, true);
+    auto v4_r_taxon_subtree    = path_handler(v4_prefix + "/taxonomy/subtree", taxon_subtree_method_handler, false, stream_taxon_subtree);
 
     // tnrs
     auto v4_r_tnrs_match_names       = path_handler(v4_prefix + "/tnrs/match_names", tnrs_match_names_handler );
@@ -830,6 +1144,10 @@ int run_server(const po::variables_map & args) {
 
     // conflict
     auto v4_r_conflict_status  = path_handler(v4_prefix + "/conflict/conflict-status", conflict_status_method_handler );
+    auto v4_r_conflict_status_batch = path_handler(v4_prefix + "/conflict/conflict-status-batch", conflict_status_batch_method_handler );
+
+    // admin
+    auto v4_r_reload_trees     = path_handler(v4_prefix + "/tree_of_life/reload_trees", reload_trees_method_handler );
 
     /////  SETTINGS
     auto settings = make_shared< Settings >( );
@@ -855,6 +1173,7 @@ int run_server(const po::variables_map & args) {
     service.publish( v3_r_tnrs_contexts );
     service.publish( v3_r_tnrs_infer_context );
     service.publish( v3_r_conflict_status );
+    service.publish( v3_r_conflict_status_batch );
     service.publish( v3_r_old_conflict_status );
 
     service.publish( v4_r_available_trees );
@@ -873,6 +1192,11 @@ int run_server(const po::variables_map & args) {
     service.publish( v4_r_tnrs_contexts );
     service.publish( v4_r_tnrs_infer_context );
     service.publish( v4_r_conflict_status );
+    service.publish( v4_r_conflict_status_batch );
+    if (allow_tree_reload) {
+        service.publish( v3_r_reload_trees );
+        service.publish( v4_r_reload_trees );
+    }
 
     service.set_signal_handler( SIGINT, sigterm_handler );
     service.set_signal_handler( SIGTERM, sigterm_handler );
@@ -909,6 +1233,22 @@ po::variables_map parse_cmd_line(int argc, char* argv[]) {
         ("port,P",value<int>(),"Port to bind to.")
         ("pidfile,p",value<string>(),"filepath for PID")
         ("num-threads,n",value<int>(),"number of threads")
+        ("response-cache-size",value<std::size_t>(),"Megabytes of responses to node_info, mrca, subtree, induced_subtree, taxon_info and taxonomy/mrca to keep in memory (default: 256; 0 turns the cache off)")
+        ("response-max-age",value<int>(),"Seconds for which clients and proxies may reuse those responses (default: 3600)")
+        ("no-compression","Never compress responses, even for clients that accept gzip, deflate or brotli")
+        ("compression-threshold",value<std::size_t>(),"Smallest response body, in bytes, that is worth compressing (default: 1024)")
+        ("max-synth-versions",value<std::size_t>(),"Most synth trees to serve at once; the oldest are retired when new ones are read (default: 0, no limit)")
+        ("allow-tree-reload","Serve tree_of_life/reload_trees, which reads new synth outputs from the tree-dir without a restart")
+        ("tree-reload-interval",value<unsigned>(),"Seconds between looks for new synth outputs in the tree-dir (default: 0, never)")
+        ("tnrs-threads",value<unsigned>(),"Extra threads shared by all tnrs/match_names requests (default: number of cores)")
+        ("tnrs-threads-per-request",value<unsigned>(),"Extra threads that one tnrs/match_names request may use (default: half of --tnrs-threads)")
+        ("conflict-threads",value<unsigned>(),"Extra threads shared by all conflict/conflict-status-batch requests (default: number of cores)")
+        ("conflict-threads-per-request",value<unsigned>(),"Extra threads that one conflict/conflict-status-batch request may use (default: half of --conflict-threads)")
+        ("study-cache-dir",value<string>(),"Directory in which to keep the phylesystem studies fetched for conflict requests")
+        ("study-cache-size",value<std::uintmax_t>(),"Megabytes of studies to keep in the study-cache-dir (default: 1024)")
+        ("study-cache-max-age",value<long>(),"Seconds after which a cached study is fetched again (default: 86400; 0 means never)")
+        ("phylesystem-dir",value<string>(),"Local checkout of phylesystem to read studies from, before asking the study server")
+        ("taxonomy-snapshot",value<string>(),"Binary snapshot of the taxonomy.  Loaded instead of parsing the taxonomy if it is up to date; rewritten otherwise.")
         ;
 
     options_description visible;
@@ -3,7 +3,7 @@
 #include <restbed>
 #include "ws/tolws.h"
 #include "ws/trees_to_serve.h"
-#include "ws/parallelreadserialwrite.h"
+#include "ws/rcu_pointer.h"
 #include "otc/otc_base_includes.h"
 #include <optional>
 
@@ -198,36 +198,6 @@ inline bool extract_from_request(const nlohmann::json & j,
 }
 
 
-
-inline otc::vec_src_node_ids extract_node_id_vec(otc::TreesToServe & tts,
-                                                 const nlohmann::json & sbv
-#                                                if defined(JOINT_MAPPING_VEC)
-                                                   , otc::SourceEdgeMappingType semt
-#                                                endif
-                                                 ) {
-#   if defined(JOINT_MAPPING_VEC)
-       using lel_t = otc::semt_ind_t;
-#   else
-       using lel_t = std::uint32_t;
-#   endif
-    std::list<lel_t> lsni;
-    for (nlohmann::json::const_iterator jit = sbv.begin(); jit != sbv.end(); ++jit) {
-        const std::string * kp = tts.get_stored_string(jit.key());
-        const auto & v = jit.value();
-        for (nlohmann::json::const_iterator vit = v.begin(); vit != v.end(); ++vit) {
-            const std::string * vp = tts.get_stored_string(*vit);
-            const auto sni_ind = tts.get_source_node_id_index(otc::src_node_id(kp, vp));
-#           if defined(JOINT_MAPPING_VEC)
-                lsni.push_back(lel_t(semt, sni_ind));
-#           else
-                lsni.push_back(sni_ind);
-#           endif
-        } 
-    }
-    return otc::vec_src_node_ids(lsni.begin(), lsni.end());
-}
-
-
 inline const nlohmann::json & extract_obj(const nlohmann::json &j, const char * field) {
     auto dc_el = j.find(field);
     if (dc_el == j.end()) {
@@ -1,6 +1,13 @@
 #include "ws/tolws.h"
 #include "ws/tolwsadaptors.h"
 #include "ws/trees_to_serve.h"
+#include "otc/node_naming.h"
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 namespace fs = boost::filesystem;
@@ -84,53 +91,152 @@ bool read_tree_and_annotations(const fs::path & configpath,
                                const fs::path & brokentaxapath,
                                TreesToServe & tts);
 
-// Globals. TODO: lock if we read twice
-fp_set checked_dirs;
-fp_set known_tree_dirs;
+// The files of a synth output directory that read_tree_and_annotations reads, with their sizes and
+//   modification times (0 and -1 for a missing file).  A directory is read again when this changes,
+//   so one that was still being copied when it was first seen, or that is rebuilt in place, is
+//   picked up by a later read_trees.
+typedef std::vector<std::pair<std::uintmax_t, std::time_t>> DirStamp;
+
+struct SynthDirPaths {
+    fs::path config;
+    fs::path tree;
+    fs::path broken_taxa;
+    fs::path annotations;
+
+    explicit SynthDirPaths(const fs::path & p)
+        :config(p / "config"),
+        tree(p / "labelled_supertree" / "labelled_supertree.tre"),
+        broken_taxa(p / "labelled_supertree" / "broken_taxa.json"),
+        annotations(p / "annotated_supertree" / "annotations.json") {
+    }
+
+    DirStamp stamp() const {
+        DirStamp s;
+        for (const auto * f : {&config, &tree, &broken_taxa, &annotations}) {
+            boost::system::error_code ec;
+            if (fs::is_regular_file(*f, ec)) {
+                s.emplace_back(fs::file_size(*f, ec), fs::last_write_time(*f, ec));
+            } else {
+                s.emplace_back(0, -1);
+            }
+        }
+        return s;
+    }
+};
+
+// The stamp of each subdirectory when it was last looked at.  Trees are read by one thread at a
+//   time, so reading a new synthesis release never races with another read.
+static std::mutex read_trees_mutex;
+static std::map<fs::path, DirStamp> checked_dirs;
+static fp_set known_tree_dirs;
 
 bool read_trees(const fs::path & dirname, TreesToServe & tts) {
+    std::lock_guard<std::mutex> lock(read_trees_mutex);
     auto sdr = get_subdirs(dirname);
     if (!sdr.first) {
         return false;
     }
     const auto & subdir_set = sdr.second;
     for (auto p : subdir_set) {
-        if (!contains(checked_dirs, p)) {
-            checked_dirs.insert(p);
-            fs::path configpath = p;
-            configpath /= "config";
-            fs::path treepath = p;
-            treepath /= "labelled_supertree";
-            treepath /= "labelled_supertree.tre";
-            fs::path brokentaxapath = p;
-            brokentaxapath /= "labelled_supertree";
-            brokentaxapath /= "broken_taxa.json";
-            fs::path annotationspath = p;
-            annotationspath /= "annotated_supertree";
-            annotationspath /= "annotations.json";
-            bool was_tree_par = false;
-            try {
-                if (fs::is_regular_file(treepath)
-                    && fs::is_regular_file(annotationspath)
-                    && fs::is_regular_file(configpath)) {
-                    if (read_tree_and_annotations(configpath, treepath, annotationspath, brokentaxapath, tts)) {
-                        known_tree_dirs.insert(p);
-                        was_tree_par = true;
-                    }
+        const SynthDirPaths paths(p);
+        auto stamp = paths.stamp();
+        auto checked = checked_dirs.find(p);
+        if (checked != checked_dirs.end() and checked->second == stamp) {
+            continue;
+        }
+        bool was_tree_par = false;
+        try {
+            if (fs::is_regular_file(paths.tree)
+                && fs::is_regular_file(paths.annotations)
+                && fs::is_regular_file(paths.config)) {
+                if (read_tree_and_annotations(paths.config, paths.tree, paths.annotations, paths.broken_taxa, tts)) {
+                    known_tree_dirs.insert(p);
+                    was_tree_par = true;
                 }
-            } catch (const std::exception & x) {
-                LOG(WARNING) << "Exception while reading summary tree directory:\n   ";
-                LOG(WARNING) << x.what() << '\n';
-            }
-            if (!was_tree_par) {
-                LOG(WARNING) << "Rejected \"" << p << "\" due to lack of " << treepath << " or lack of " << annotationspath << " or parsing error.\n";
             }
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Exception while reading summary tree directory:\n   ";
+            LOG(WARNING) << x.what() << '\n';
+        }
+        if (!was_tree_par) {
+            LOG(WARNING) << "Rejected \"" << p << "\" due to lack of " << paths.tree << " or lack of " << paths.annotations << " or parsing error.\n";
         }
+        // Recorded after the read, so that it is only skipped until one of its files changes.  A
+        //   file that changed while it was being read changes the stamp again.
+        checked_dirs[p] = stamp;
+    }
+    tts.publish_registered_trees();
+    return true;
+}
+
+static std::atomic<bool> background_read_running{false};
+
+static void read_trees_logging_errors(const fs::path & dirname, TreesToServe & tts) {
+    LOG(INFO) << "Looking for new trees in " << dirname << " in the background.";
+    try {
+        read_trees(dirname, tts);
+    } catch (const std::exception & x) {
+        LOG(WARNING) << "Exception while looking for new trees: " << x.what();
+    }
+}
+
+BackgroundTreeReader::BackgroundTreeReader(const fs::path & dir, TreesToServe & trees)
+    :dirname(dir),
+    tts(trees) {
+}
+
+bool BackgroundTreeReader::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (background_read_running.exchange(true)) {
+        return false;
+    }
+    // The last read started here has finished, since it cleared background_read_running.
+    if (thread.joinable()) {
+        thread.join();
+    }
+    try {
+        thread = std::thread([this]() {
+            read_trees_logging_errors(dirname, tts);
+            background_read_running = false;
+        });
+    } catch (...) {
+        background_read_running = false;
+        throw;
     }
-    tts.final_tree_added();
     return true;
 }
 
+BackgroundTreeReader::~BackgroundTreeReader() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+PeriodicTreeReader::PeriodicTreeReader(const fs::path & dirname, TreesToServe & tts, std::chrono::seconds interval) {
+    thread = std::thread([this, dirname, &tts, interval]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (not wake.wait_for(lock, interval, [this] {return stopping;})) {
+            if (background_read_running.exchange(true)) {
+                continue;
+            }
+            lock.unlock();
+            read_trees_logging_errors(dirname, tts);
+            background_read_running = false;
+            lock.lock();
+        }
+    });
+}
+
+PeriodicTreeReader::~PeriodicTreeReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
 #if defined(REPORT_MEMORY_USAGE)
 
 template<>
@@ -142,7 +248,7 @@ inline std::size_t calc_memory_used(const RTRichTaxTreeData &d, MemoryBookkeeper
     std::size_t fm_sz = calc_memory_used_by_map_eqsize(d.if_id_map, sz_el_size, mb);
     std::size_t im_sz = calc_memory_used_by_map_eqsize(d.irmng_id_map, sz_el_size, mb);
     std::size_t f2j_sz = calc_memory_used_by_map_simple(d.flags2json, mb);
-    std::size_t in_sz = calc_memory_used_by_map_simple(d.id_to_node, mb);
+    std::size_t in_sz = d.id_to_node.memory_used();
     std::size_t nn_sz = calc_memory_used_by_map_simple(d.name_to_node, mb);
     std::size_t nutn_sz = calc_memory_used_by_map_simple(d.non_unique_taxon_names, mb);
     std::size_t htn_sz = 0;
@@ -205,25 +311,371 @@ inline std::size_t calc_memory_used(const RichTaxonomy &rt, MemoryBookkeeper &mb
     mb["taxonomy tree"] += ttsz;
     mb["taxonomy synonyms list"] += slsz;
     mb["taxonomy set of ids to suppress from tnrs"] += stssz;
-    return ttsz + slsz + stssz;
+    std::size_t lcasz = (rt.get_lca_index() ? rt.get_lca_index()->memory_used() : 0);
+    mb["taxonomy lca index"] += lcasz;
+    std::size_t nisz = (rt.get_name_index() ? rt.get_name_index()->memory_used() : 0);
+    mb["taxonomy tnrs name index"] += nisz;
+    return ttsz + slsz + stssz + lcasz + nisz;
 }
 
 #endif
 
+void NodeSupportTable::add_node(const vector<pair<SourceEdgeMappingType, std::uint32_t>> & node_mappings,
+                                vector<const string *> supporting_study_ids) {
+    assert(mapping_offsets.size() == num_nodes() * NUM_SOURCE_EDGE_MAPPING_TYPES + 1);
+    // A counting sort by kind, which keeps the annotation order within each kind.
+    for (int kind = 0; kind < NUM_SOURCE_EDGE_MAPPING_TYPES; ++kind) {
+        for (const auto & el : node_mappings) {
+            if (el.first == kind) {
+                mappings.push_back(el.second);
+            }
+        }
+        mapping_offsets.push_back(mappings.size());
+    }
+    std::sort(supporting_study_ids.begin(), supporting_study_ids.end());
+    auto new_end = std::unique(supporting_study_ids.begin(), supporting_study_ids.end());
+    supporting_studies.insert(supporting_studies.end(), supporting_study_ids.begin(), new_end);
+    study_offsets.push_back(supporting_studies.size());
+}
+
+// Moves the mappings that were read into the node data into the tree's NodeSupportTable.
+void build_node_support_table(SummaryTree_t & tree, TreesToServe & tts) {
+    NodeSupportTable table;
+    table.set_source_nodes(tts.take_source_node_ids());
+    vector<pair<SourceEdgeMappingType, std::uint32_t>> node_mappings;
+    vector<const string *> supporting_study_ids;
+    for (auto nd : iter_pre(tree)) {
+        auto & d = nd->get_data();
+        assert(d.trav_enter == table.num_nodes());
+        node_mappings.clear();
+        supporting_study_ids.clear();
+#       if defined(JOINT_MAPPING_VEC)
+            node_mappings.assign(d.source_edge_mappings.begin(), d.source_edge_mappings.end());
+            vec_src_node_ids().swap(d.source_edge_mappings);
+#       else
+            for (auto [kind, v] : {pair(CONFLICTS_WITH_MAPPING, &d.conflicts_with),
+                                   pair(PARTIAL_PATH_OF_MAPPING, &d.partial_path_of),
+                                   pair(RESOLVES_MAPPING, &d.resolves),
+                                   pair(SUPPORTED_BY_MAPPING, &d.supported_by),
+                                   pair(TERMINAL_MAPPING, &d.terminal)}) {
+                for (auto sni : *v) {
+                    node_mappings.emplace_back(kind, sni);
+                }
+                vec_src_node_ids().swap(*v);
+            }
+#       endif
+        for (const auto & el : node_mappings) {
+            if (el.first == SourceEdgeMappingType::SUPPORTED_BY_MAPPING) {
+                supporting_study_ids.push_back(table.get_source_node(el.second).first);
+            }
+        }
+        table.add_node(node_mappings, supporting_study_ids);
+    }
+    tree.get_data().support = std::move(table);
+}
+
+// Annotations only name nodes that are in the tree, by OTT id or by name, so they can be looked up
+//   directly.  find_node_by_id_str handles the rest, like MRCA ids of nodes that are not named.
+static SumTreeNode_t * find_annotated_node(const SummaryTree_t & tree, const string & node_id) {
+    const auto & tree_data = tree.get_data();
+    const SumTreeNode_t * nd = nullptr;
+    long raw_ott_id;
+    if (parse_ott_node_id(node_id, raw_ott_id)) {
+        nd = tree_data.id_to_node.lookup(check_ott_id_size(raw_ott_id));
+    } else {
+        auto n2nit = tree_data.broken_name_to_node.find(node_id);
+        if (n2nit != tree_data.broken_name_to_node.end()) {
+            nd = n2nit->second;
+        }
+    }
+    if (nd == nullptr) {
+        bool was_broken = false;
+        nd = find_node_by_id_str(tree, node_id, was_broken);
+    }
+    return const_cast<SumTreeNode_t *>(nd);
+}
+
+// Reads annotations.json a token at a time.  The "nodes" object, which is nearly all of the file,
+//   is never held in memory: each mapping goes straight into its node's data.  The other fields
+//   are small, and are gathered into header for from_json.
+class AnnotationsReader: public json::json_sax_t {
+    enum class State {
+        top,            // before the outer object
+        header,         // in the outer object, between fields
+        header_value,   // building the value of a field other than "nodes"
+        nodes_value,    // after the "nodes" key
+        nodes,          // in "nodes", between nodes
+        node_value,     // after a node id
+        node,           // in a node's annotations, between kinds of mapping
+        mapping_value,  // after a kind of mapping
+        mapping,        // in a kind of mapping, between studies
+        study_value,    // after a study's key
+        study_array,    // in the array of a study's nodes
+        flag_value,     // after was_uncontested
+        done
+    };
+    SummaryTree_t & tree;
+    TreesToServe & tts;
+    State state = State::top;
+    SumTreeNodeData * node_data = nullptr;
+#   if defined(JOINT_MAPPING_VEC)
+        SourceEdgeMappingType kind = SourceEdgeMappingType::SUPPORTED_BY_MAPPING;
+#   else
+        vec_src_node_ids * kind_vec = nullptr;
+#   endif
+    const std::string * study = nullptr;
+    // For building a header field, or skipping was_constrained.
+    json * dom_root = nullptr;
+    vector<json *> dom_stack;
+    std::string dom_key;
+    State dom_return = State::header;
+    json skipped;
+    bool saw_nodes = false;
+
+    void start_dom(json * root, State return_to) {
+        dom_root = root;
+        dom_stack.clear();
+        dom_return = return_to;
+        state = State::header_value;
+    }
+
+    json * add_dom_value(json && v) {
+        json * slot;
+        if (dom_stack.empty()) {
+            slot = dom_root;
+        } else if (dom_stack.back()->is_array()) {
+            dom_stack.back()->push_back(nullptr);
+            slot = &(dom_stack.back()->back());
+        } else {
+            slot = &((*dom_stack.back())[dom_key]);
+        }
+        *slot = std::move(v);
+        if (dom_stack.empty()) {
+            state = dom_return;
+        }
+        return slot;
+    }
+
+    void start_dom_container(json && v) {
+        bool was_top = dom_stack.empty();
+        json * slot = add_dom_value(std::move(v));
+        if (was_top) {
+            state = State::header_value;
+        }
+        dom_stack.push_back(slot);
+    }
+
+    void end_dom_container() {
+        dom_stack.pop_back();
+        if (dom_stack.empty()) {
+            state = dom_return;
+        }
+    }
+
+    bool scalar(json && v) {
+        if (state == State::header_value) {
+            add_dom_value(std::move(v));
+            return true;
+        }
+        throw unexpected("a value");
+    }
+
+    OTCError unexpected(const char * what) const {
+        switch (state) {
+            case State::top: return OTCError() << "Expected the annotations to be an object, found " << what << ".";
+            case State::nodes_value: return OTCError() << "Expected \"nodes\" field to be an object, found " << what << ".";
+            case State::flag_value: return OTCError() << "Expected was_uncontested to be a boolean.";
+            case State::study_value:
+            case State::study_array: return OTCError() << "Expected the nodes of " << *study << " to be strings, found " << what << ".";
+            default: return OTCError() << "Unexpected " << what << " in the node annotations.";
+        }
+    }
+
+    public:
+    json header;
+
+    AnnotationsReader(SummaryTree_t & t, TreesToServe & s)
+        :tree(t),
+        tts(s) {
+    }
+
+    void check_finished() const {
+        if (state != State::done) {
+            throw OTCError() << "The annotations ended early.";
+        }
+        if (!saw_nodes) {
+            throw OTCError() << "Missing \"nodes\" field.\n";
+        }
+    }
+
+    bool null() override {
+        return scalar(nullptr);
+    }
+
+    bool boolean(bool val) override {
+        if (state == State::flag_value) {
+            node_data->was_uncontested = val;
+            state = State::node;
+            return true;
+        }
+        return scalar(val);
+    }
+
+    bool number_integer(number_integer_t val) override {
+        return scalar(val);
+    }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        return scalar(val);
+    }
+
+    bool number_float(number_float_t val, const string_t &) override {
+        return scalar(val);
+    }
+
+    bool string(string_t & val) override {
+        if (state == State::study_value || state == State::study_array) {
+            const auto sni = tts.get_source_node_id_index(src_node_id(study, tts.get_stored_string(val)));
+#           if defined(JOINT_MAPPING_VEC)
+                node_data->source_edge_mappings.emplace_back(kind, sni);
+#           else
+                kind_vec->push_back(sni);
+#           endif
+            if (state == State::study_value) {
+                state = State::mapping;
+            }
+            return true;
+        }
+        return scalar(std::move(val));
+    }
+
+    bool start_object(std::size_t) override {
+        switch (state) {
+            case State::top: state = State::header; break;
+            case State::nodes_value: state = State::nodes; break;
+            case State::node_value: state = State::node; break;
+            case State::mapping_value: state = State::mapping; break;
+            case State::header_value: start_dom_container(json::object()); break;
+            default: throw unexpected("an object");
+        }
+        return true;
+    }
+
+    bool key(string_t & val) override {
+        switch (state) {
+            case State::header:
+                if (val == "nodes") {
+                    saw_nodes = true;
+                    state = State::nodes_value;
+                } else {
+                    start_dom(&header[val], State::header);
+                }
+                break;
+            case State::nodes: {
+                SumTreeNode_t * nd = find_annotated_node(tree, val);
+                if (nd == nullptr) {
+                    throw OTCError() << "Node " << val << " from annotations not found in tree.";
+                }
+                node_data = &(nd->get_data());
+                state = State::node_value;
+                break;
+            }
+            case State::node:
+                if (val == "was_uncontested") {
+                    state = State::flag_value;
+                    break;
+                }
+                if (val == "was_constrained") {
+                    start_dom(&skipped, State::node);
+                    break;
+                }
+#               if defined(JOINT_MAPPING_VEC)
+                    if (val == "supported_by") {
+                        kind = SourceEdgeMappingType::SUPPORTED_BY_MAPPING;
+                    } else if (val == "terminal") {
+                        kind = SourceEdgeMappingType::TERMINAL_MAPPING;
+                    } else if (val == "conflicts_with") {
+                        kind = SourceEdgeMappingType::CONFLICTS_WITH_MAPPING;
+                    } else if (val == "partial_path_of") {
+                        kind = SourceEdgeMappingType::PARTIAL_PATH_OF_MAPPING;
+                    } else if (val == "resolves") {
+                        kind = SourceEdgeMappingType::RESOLVES_MAPPING;
+                    }
+#               else
+                    if (val == "supported_by") {
+                        kind_vec = &(node_data->supported_by);
+                    } else if (val == "terminal") {
+                        kind_vec = &(node_data->terminal);
+                    } else if (val == "conflicts_with") {
+                        kind_vec = &(node_data->conflicts_with);
+                    } else if (val == "partial_path_of") {
+                        kind_vec = &(node_data->partial_path_of);
+                    } else if (val == "resolves") {
+                        kind_vec = &(node_data->resolves);
+                    }
+#               endif
+                else {
+                    throw OTCError() << "Unrecognized annotations key " << val;
+                }
+                state = State::mapping_value;
+                break;
+            case State::mapping:
+                study = tts.get_stored_string(val);
+                state = State::study_value;
+                break;
+            case State::header_value:
+                dom_key = val;
+                break;
+            default:
+                throw unexpected("a key");
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        switch (state) {
+            case State::header: state = State::done; break;
+            case State::nodes: state = State::header; break;
+            case State::node: state = State::nodes; break;
+            case State::mapping: state = State::node; break;
+            case State::header_value: end_dom_container(); break;
+            default: throw unexpected("the end of an object");
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (state == State::study_value) {
+            state = State::study_array;
+        } else if (state == State::header_value) {
+            start_dom_container(json::array());
+        } else {
+            throw unexpected("an array");
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        if (state == State::study_array) {
+            state = State::mapping;
+        } else if (state == State::header_value) {
+            end_dom_container();
+        } else {
+            throw unexpected("the end of an array");
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception & x) override {
+        throw OTCError() << x.what();
+    }
+};
+
 bool read_tree_and_annotations(const fs::path & config_path,
                                const fs::path & tree_path,
                                const fs::path & annotations_path,
                                const fs::path & brokentaxa_path,
                                TreesToServe & tts) {
-    std::string annot_str = annotations_path.native();
-    std::ifstream annotations_stream(annot_str.c_str());
-    json annotations_obj;
-    try {
-        annotations_stream >> annotations_obj;
-    } catch (...) {
-        LOG(WARNING) << "Could not read \"" << annotations_path << "\" as JSON.\n";
-        throw;
-    }
     std::string bt_str = brokentaxa_path.native();
     std::ifstream brokentaxa_stream(bt_str.c_str());
     json brokentaxa_obj;
@@ -245,87 +697,23 @@ bool read_tree_and_annotations(const fs::path & config_path,
     try {
         SummaryTree_t & tree = tree_and_ann.first;
         SummaryTreeAnnotation & sta = tree_and_ann.second;
-        sta = annotations_obj;
+        auto & sum_tree_data = tree.get_data();
+        // read the node annotations into the tree, and the rest into sta.
+        AnnotationsReader annotations_reader(tree, tts);
+        try {
+            std::string annot_str = annotations_path.native();
+            std::ifstream annotations_stream(annot_str.c_str());
+            json::sax_parse(annotations_stream, &annotations_reader);
+            annotations_reader.check_finished();
+        } catch (...) {
+            LOG(WARNING) << "Could not read \"" << annotations_path << "\" as JSON.\n";
+            throw;
+        }
+        sta = annotations_reader.header;
         json tref;
         tref["taxonomy"] = taxonomy.get_version();
         sta.full_source_id_map_json[taxonomy.get_version()] = tref;
-
-        // read the node annotations and add them to the tree.
-        auto node_obj = extract_obj(annotations_obj, "nodes");
-        auto & sum_tree_data = tree.get_data();
-        //const auto & n2n = sum_tree_data.name_to_node;
-        for (json::const_iterator nit = node_obj.begin(); nit != node_obj.end(); ++nit) {
-            string k = nit.key();
-            bool was_broken = false;
-            const SumTreeNode_t * stn = find_node_by_id_str(tree, k, was_broken);
-            //auto stnit = n2n.find(k);
-            if (stn == nullptr) {
-                throw OTCError() << "Node " << k << " from annotations not found in tree.";
-            }
-            //const SumTreeNode_t * stn = stnit->second;
-            SumTreeNode_t * mstn = const_cast<SumTreeNode_t *>(stn);
-            SumTreeNodeData & mstnd = mstn->get_data();
-            const auto & supportj = nit.value();
-#           if defined(JOINT_MAPPING_VEC)
-                vec_src_node_ids tmpv;
-#           endif
-            for (json::const_iterator sbit = supportj.begin(); sbit != supportj.end(); ++sbit) {
-                const auto & sbk = sbit.key();
-                const auto & sbv = sbit.value();
-                if (sbk == "supported_by") {            
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::SUPPORTED_BY_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.supported_by = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "terminal") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::TERMINAL_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.terminal = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "conflicts_with") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::CONFLICTS_WITH_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.conflicts_with = extract_node_id_vec(tts, sbv)
-#                   endif
-                } else if (sbk == "partial_path_of") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::PARTIAL_PATH_OF_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.partial_path_of = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "resolves") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::RESOLVES_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.resolves = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "was_uncontested") {
-                    if (sbv.is_boolean()) {
-                        mstnd.was_uncontested =  sbv.get<bool>();
-                    } else {
-                        throw OTCError() << "Expected was_uncontested to be a boolean.";
-                    }
-                } else {
-                    if (sbk != "was_constrained") {
-                        throw OTCError() << "Unrecognized annotations key " << sbit.key();
-                    }
-                }
-            }
-#           if defined(JOINT_MAPPING_VEC)
-                mstnd.source_edge_mappings.clear();
-                std::swap(mstnd.source_edge_mappings, tmpv);
-                //LOG(INFO) << "mstnd.source_edge_mappings size = " << mstnd.source_edge_mappings.size() << " for k = " << k;
-#           endif
-
-        }
+        build_node_support_table(tree, tts);
         auto & tree_broken_taxa = sum_tree_data.broken_taxa;
         // read the info from the broken taxa file
         if (brokentaxa_obj.count("non_monophyletic_taxa")
@@ -10,17 +10,13 @@ using std::vector;
 using std::string;
 using std::pair;
 using std::unique_ptr;    
+using std::optional;
 
 TreesToServe::TreesToServe()
-    :taxonomy_thread_safety("taxonomy")
+    :published_trees(std::make_shared<const ServedTrees>())
 { }
 
-const src_node_id & TreesToServe::decode_study_node_id_index(std::uint32_t sni_ind) const {
-    return src_node_id_storer.at(sni_ind);
-}
-
 std::uint32_t TreesToServe::get_source_node_id_index(src_node_id sni) {
-    assert(!finalized); // should only be called while registering
     auto it = lookup_for_node_ids_while_registering_trees.find(sni);
     std::uint32_t r;
     if (it == lookup_for_node_ids_while_registering_trees.end()) {
@@ -33,6 +29,13 @@ std::uint32_t TreesToServe::get_source_node_id_index(src_node_id sni) {
     return r;
 }
 
+vec_src_node_id_mapper TreesToServe::take_source_node_ids() {
+    vec_src_node_id_mapper ids;
+    std::swap(ids, src_node_id_storer);
+    lookup_for_node_ids_while_registering_trees.clear();
+    return ids;
+}
+
 const string * TreesToServe::get_stored_string(const string & k) {
     const string * v = stored_strings[k];
     if (v == nullptr) {
@@ -43,34 +46,56 @@ const string * TreesToServe::get_stored_string(const string & k) {
     return v;
 }
 
-void TreesToServe::set_taxonomy(RichTaxonomy &taxonomy) {
-    assert(taxonomy_ptr == nullptr);
-    taxonomy_ptr = &taxonomy;
-    taxonomy_tree = &(taxonomy.get_tax_tree());
+void TreesToServe::set_taxonomy(std::shared_ptr<RichTaxonomy> taxonomy) {
+    assert(published_taxonomy.load() == nullptr);
+    taxonomy->build_lca_index();
+    taxonomy->build_name_index();
+    published_taxonomy.publish(taxonomy);
 }
-using ReadableTaxonomy = pair<const RichTaxonomy &,
-                              unique_ptr<ReadMutexWrapper> >;
 
-using WritableTaxonomy = pair<RichTaxonomy &,
-                              unique_ptr<WriteMutexWrapper> >;
+static std::shared_ptr<const TaxonCoverage> build_taxon_coverage(const std::shared_ptr<const RichTaxonomy> & taxonomy,
+                                                                 const SummaryTree_t & tree) {
+    auto coverage = std::make_shared<TaxonCoverage>();
+    coverage->build(taxonomy, tree.get_data().id_to_node);
+    return coverage;
+}
 
-ReadableTaxonomy TreesToServe::get_readable_taxonomy() const {
-    assert(taxonomy_ptr != nullptr);
-    return {*taxonomy_ptr,
-            std::make_unique<ReadMutexWrapper>(taxonomy_thread_safety)};
+// The new taxonomy is fully built and indexed before any request can see it.  The taxon_coverage
+//    of each served tree is rebuilt for it first, and published right after it; in between, a
+//    request finds that the coverage does not fit its taxonomy and does without.
+//    Requests that already hold the old taxonomy finish with it; the last one to let go frees it.
+void TreesToServe::publish_taxonomy(std::shared_ptr<RichTaxonomy> taxonomy) {
+    taxonomy->build_lca_index();
+    taxonomy->build_name_index();
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    auto trees = published_trees.load();
+    vector<pair<const SummaryTree_t *, std::shared_ptr<const TaxonCoverage>>> coverages;
+    for (const auto & el : trees->id_to_tree) {
+        coverages.emplace_back(el.second.get(), build_taxon_coverage(taxonomy, *el.second));
+    }
+    published_taxonomy.publish(taxonomy);
+    for (auto & tc : coverages) {
+        tc.first->get_data().taxon_coverage.publish(std::move(tc.second));
+    }
+    generation++;
 }
 
-WritableTaxonomy TreesToServe::get_writable_taxonomy() {
-    assert(taxonomy_ptr != nullptr);
-    return {*taxonomy_ptr,
-            std::make_unique<WriteMutexWrapper>(taxonomy_thread_safety)};
+using ReadableTaxonomy = TreesToServe::ReadableTaxonomy;
+
+ReadableTaxonomy TreesToServe::get_readable_taxonomy() const {
+    auto guard = published_taxonomy.read();
+    assert(guard.get() != nullptr);
+    const RichTaxonomy & taxonomy = *guard;
+    return {taxonomy, std::move(guard)};
 }
 
 void TreesToServe::fill_ott_id_set(const std::bitset<32> & flags,
                                    OttIdSet & ott_id_set,
                                    OttIdSet & suppressed_from_tree) {
     ott_id_set.clear();
-    for (const auto nd : iter_node_const(*taxonomy_tree)) {
+    auto taxonomy = get_taxonomy_snapshot();
+    assert(taxonomy != nullptr);
+    for (const auto nd : iter_node_const(taxonomy->get_tax_tree())) {
         const auto & tax_record_flags = nd->get_data().get_flags();
         auto intersection = flags & tax_record_flags;
         const auto ott_id = nd->get_ott_id();
@@ -89,8 +114,6 @@ TreesToServe::SumTreeInitPair TreesToServe::get_new_tree_and_annotations(const s
     auto cleaning_flags = cleaning_flags_from_config_file(configfilename);
     fill_ott_id_set(cleaning_flags, ott_id_set, suppressed_id_set);
 
-    assert(taxonomy_ptr != nullptr);
-
     // Load tree from file
     ParsingRules parsingRules;
     parsingRules.ott_id_validator = &ott_id_set;
@@ -98,15 +121,18 @@ TreesToServe::SumTreeInitPair TreesToServe::get_new_tree_and_annotations(const s
     parsingRules.set_ott_idForInternals = true;
     parsingRules.require_ott_ids = true;
     parsingRules.set_ott_ids = true;
-    unique_ptr<SummaryTree_t> nt = first_newick_tree_from_file<SummaryTree_t>(filename, parsingRules);
+    parsingRules.use_node_arena = true;
+    std::shared_ptr<SummaryTree_t> nt = first_newick_tree_from_file<SummaryTree_t>(filename, parsingRules);
 
     index_by_name_or_id(*nt);
     set_traversal_entry_exit_and_num_tips(*nt);
-    tree_list.push_back(move(nt));
-    annotation_list.emplace(annotation_list.end());
-    auto & sta = annotation_list.back();
-    sta.suppressed_from_tree = suppressed_id_set;
-    return {*(tree_list.back()), sta};
+    nt->get_data().lca_index = std::make_unique<LCAIndex<const SumTreeNode_t>>(nt->get_root());
+    nt->get_data().taxon_coverage.publish(build_taxon_coverage(get_taxonomy_snapshot(), *nt));
+    auto sta = std::make_shared<SummaryTreeAnnotation>();
+    sta->suppressed_from_tree = suppressed_id_set;
+    loading.emplace_back(nt, sta);
+    take_source_node_ids();
+    return {*nt, *sta};
 }
 
 vector<int> synth_id_to_version(const string& id) {
@@ -138,71 +164,121 @@ int compare_versions(const vector<int>& v1, const vector<int>& v2) {
 }
 
 
-int compare_synth_ids(const string& id1, const string& id2) {
-    auto v1 = synth_id_to_version(id1);
-    auto v2 = synth_id_to_version(id2);
-    return compare_versions(v1,v2);
+// Orders synth ids from oldest to newest.  Ids without a version number come first, so a lone
+//   unversioned tree can still be served.
+bool is_older_synth_id(const string& id1, const string& id2) {
+    optional<vector<int>> v1, v2;
+    try { v1 = synth_id_to_version(id1); } catch (OTCError &) { }
+    try { v2 = synth_id_to_version(id2); } catch (OTCError &) { }
+    if (v1 and v2) {
+        return compare_versions(*v1, *v2) < 0;
+    }
+    if (v1 or v2) {
+        return bool(v2);
+    }
+    return id1 < id2;
 }
 
 void TreesToServe::register_last_tree_and_annotations() {
-    const SummaryTreeAnnotation & sta = annotation_list.back();
-    const SummaryTree_t & tree = *(tree_list.back());
-    id_to_tree[sta.synth_id] = &tree;
-    id_to_annotations[sta.synth_id] = &sta;
-    if (default_synth_id.empty() or compare_synth_ids(default_synth_id,sta.synth_id) < 0) {
-        default_synth_id = sta.synth_id;
-    }
+    assert(not loading.empty());
+    registered.splice(registered.end(), loading, std::prev(loading.end()));
 }
 
 void TreesToServe::free_last_tree_and_annotations() {
-    tree_list.back()->clear();
-    tree_list.pop_back();
-    annotation_list.pop_back();
+    assert(not loading.empty());
+    loading.back().first->clear();
+    loading.pop_back();
+}
+
+std::size_t TreesToServe::publish_registered_trees() {
+    if (registered.empty()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    // A tree that was read while publish_taxonomy ran has its coverage built for the old taxonomy.
+    auto taxonomy = published_taxonomy.load();
+    for (auto & [tree, sta] : registered) {
+        auto coverage = tree->get_data().taxon_coverage.load();
+        if (coverage == nullptr or not coverage->fits(*taxonomy)) {
+            tree->get_data().taxon_coverage.publish(build_taxon_coverage(taxonomy, *tree));
+        }
+    }
+    auto current = published_trees.load();
+    auto trees = std::make_shared<ServedTrees>(*current);
+    std::size_t num_published = 0;
+    for (auto & [tree, sta] : registered) {
+        const auto & synth_id = sta->synth_id;
+        if (trees->id_to_tree.count(synth_id)) {
+            LOG(INFO) << "Replacing the served tree " << synth_id;
+        }
+        trees->id_to_tree[synth_id] = tree;
+        trees->id_to_annotations[synth_id] = sta;
+        num_published++;
+    }
+    registered.clear();
+    vector<string> synth_ids;
+    for (const auto & el : trees->id_to_tree) {
+        synth_ids.push_back(el.first);
+    }
+    std::sort(synth_ids.begin(), synth_ids.end(), is_older_synth_id);
+    for (std::size_t i = 0; max_synth_versions > 0 and i + max_synth_versions < synth_ids.size(); i++) {
+        LOG(INFO) << "Retiring the served tree " << synth_ids[i];
+        trees->id_to_tree.erase(synth_ids[i]);
+        trees->id_to_annotations.erase(synth_ids[i]);
+    }
+    trees->default_synth_id = synth_ids.back();
+    trees->generation = ++generation;
+    published_trees.publish(std::move(trees));
+    return num_published;
+}
+
+std::shared_ptr<const SummaryTree_t> TreesToServe::share_summary_tree(const SummaryTree_t * tree_ptr) const {
+    auto trees = published_trees.read();
+    for (const auto & el : trees->id_to_tree) {
+        if (el.second.get() == tree_ptr) {
+            return el.second;
+        }
+    }
+    throw OTCError() << "The summary tree is no longer being served.";
 }
 
 string TreesToServe::get_default_tree() const
 {
-    return default_synth_id;
+    return published_trees.read()->default_synth_id;
 }
 
 set<string> TreesToServe::get_available_trees() const
 {
     set<string> synth_ids;
-    for(auto& x: id_to_tree)
+    for(auto& x: published_trees.read()->id_to_tree)
 	synth_ids.insert(x.first);
     return synth_ids;
 }
 	
 const SummaryTreeAnnotation * TreesToServe::get_annotations(string synth_id) const {
-    const auto & key = synth_id.empty() ? default_synth_id : synth_id;
-    auto mit = id_to_annotations.find(key);
-    return mit == id_to_annotations.end() ? nullptr : mit->second;
+    auto trees = published_trees.read();
+    const auto & key = synth_id.empty() ? trees->default_synth_id : synth_id;
+    auto mit = trees->id_to_annotations.find(key);
+    return mit == trees->id_to_annotations.end() ? nullptr : mit->second.get();
 }
 
 const SummaryTree_t * TreesToServe::get_summary_tree(string synth_id) const {
-    const auto & key = synth_id.empty() ? default_synth_id : synth_id;
-    auto mit = id_to_tree.find(key);
-    return mit == id_to_tree.end() ? nullptr : mit->second;
+    auto trees = published_trees.read();
+    const auto & key = synth_id.empty() ? trees->default_synth_id : synth_id;
+    auto mit = trees->id_to_tree.find(key);
+    return mit == trees->id_to_tree.end() ? nullptr : mit->second.get();
 }
 
 std::size_t TreesToServe::get_num_trees() const {
-    return id_to_tree.size();
+    return published_trees.load()->id_to_tree.size();
 }
 
-void TreesToServe::final_tree_added() {
-    finalized = true;
-    if (get_num_trees() == 1) {
-        const auto & annot = annotation_list.back();
-        const auto & sft = annot.suppressed_from_tree;
-        assert(taxonomy_ptr != nullptr);
-        // TODO: make taxonomy_ptr non-const or make the relevant field mutable. Probably the former.
-        auto nct = const_cast<RichTaxonomy *>(taxonomy_ptr);
-        nct->set_ids_suppressed_from_summary_tree_alias(&sft);
+const OttIdSet * TreesToServe::get_ids_suppressed_from_summary_tree() const {
+    auto trees = published_trees.read();
+    if (trees->id_to_annotations.size() != 1) {
+        return nullptr;
     }
-
-    map<src_node_id, std::uint32_t> tmpm;
-    std::swap(lookup_for_node_ids_while_registering_trees, tmpm);
+    return &(trees->id_to_annotations.begin()->second->suppressed_from_tree);
 }
 
-
 }
@@ -1,46 +1,76 @@
 #ifndef TREES_TO_SERVE_H
 #define TREES_TO_SERVE_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include "tolws.h"
 namespace otc
 {
 
+// The summary trees that requests see, and their annotations.  A published ServedTrees never
+//   changes: loading more trees publishes a new one.
+struct ServedTrees {
+    std::map<std::string, std::shared_ptr<const SummaryTree_t>> id_to_tree;
+    std::map<std::string, std::shared_ptr<const SummaryTreeAnnotation>> id_to_annotations;
+    std::string default_synth_id;
+    // The TreesToServe generation at which these trees were published.
+    std::uint64_t generation = 0;
+};
+
 class TreesToServe
 {
-    std::list< SummaryTreeAnnotation> annotation_list;
-    std::list<std::unique_ptr<SummaryTree_t> > tree_list;
-    std::map<std::string, const SummaryTree_t *> id_to_tree;
-    std::map<std::string, const SummaryTreeAnnotation *> id_to_annotations;
-    std::string default_synth_id;
-    RichTaxonomy * taxonomy_ptr = nullptr;
+    // Trees that are being read, and trees that have been read but not published yet.  These are
+    //   only used by the thread that is loading trees (see read_trees).
+    std::list<std::pair<std::shared_ptr<SummaryTree_t>, std::shared_ptr<SummaryTreeAnnotation>>> loading;
+    std::list<std::pair<std::shared_ptr<SummaryTree_t>, std::shared_ptr<SummaryTreeAnnotation>>> registered;
     std::map<std::string, const std::string *> stored_strings;
     std::list<std::string> stored_strings_list;
-    const RichTaxTree * taxonomy_tree = nullptr;
+    // The source nodes of the tree that is being read.
     vec_src_node_id_mapper src_node_id_storer;
     std::map<src_node_id, std::uint32_t> lookup_for_node_ids_while_registering_trees;
-    bool finalized = false;
-    mutable ParallelReadSerialWrite taxonomy_thread_safety;
+    std::size_t max_synth_versions = 0;
+    RCUPointer<RichTaxonomy> published_taxonomy;
+    RCUPointer<ServedTrees> published_trees;
+    std::atomic<std::uint64_t> generation{0};
+    // Serializes publish_taxonomy and publish_registered_trees, so that every tree is published
+    //   with a taxon_coverage for the taxonomy published with (or before) it.
+    std::mutex publish_mutex;
 
 public:
     explicit TreesToServe();
 
-    const src_node_id & decode_study_node_id_index(std::uint32_t sni_ind) const;
-
     std::uint32_t get_source_node_id_index(src_node_id sni);
 
+    // The source nodes indexed by get_source_node_id_index since the current tree was started.
+    vec_src_node_id_mapper take_source_node_ids();
+
     const std::string * get_stored_string(const std::string & k);
 
-    void set_taxonomy(RichTaxonomy &taxonomy);
+    // Sets the first taxonomy, before any tree is read.
+    void set_taxonomy(std::shared_ptr<RichTaxonomy> taxonomy);
 
+    // Replaces the taxonomy that requests see, without waiting for requests that use the old one,
+    //   and the taxon_coverage of the served trees with it.  The trees' annotations (like the
+    //   taxa suppressed from them) stay as they were read.
+    void publish_taxonomy(std::shared_ptr<RichTaxonomy> taxonomy);
+
+    // The taxonomy stays valid, and unchanged, for as long as the ReadGuard lives.
     using ReadableTaxonomy = std::pair<const RichTaxonomy &,
-				       std::unique_ptr<ReadMutexWrapper> >;
-    using WritableTaxonomy = std::pair<RichTaxonomy &,
-				       std::unique_ptr<WriteMutexWrapper> >;
+				       RCUPointer<RichTaxonomy>::ReadGuard>;
     ReadableTaxonomy get_readable_taxonomy() const;
 
-    WritableTaxonomy get_writable_taxonomy();
+    // Shared ownership of the current taxonomy, for work that outlives a request handler (like a streamed response).
+    std::shared_ptr<const RichTaxonomy> get_taxonomy_snapshot() const {
+        return published_taxonomy.load();
+    }
+
+    // Changes whenever the trees or taxonomy being served change, so responses computed before can be told apart.
+    std::uint64_t get_generation() const {
+        return generation.load(std::memory_order_acquire);
+    }
 
     void fill_ott_id_set(const std::bitset<32> & flags,
 			 OttIdSet & ott_id_set,
@@ -54,6 +84,28 @@ public:
 
     void free_last_tree_and_annotations();
 
+    // Makes the registered trees visible to requests, alongside the ones already served (a tree
+    //   with the synth_id of one already served replaces it).  The newest synth_id becomes the
+    //   default.  If more than max_synth_versions trees would be served, the oldest are retired.
+    //   Requests that are using a replaced or retired tree finish with it; the last one frees it.
+    //   Returns the number of trees published.
+    std::size_t publish_registered_trees();
+
+    // 0 means that trees are never retired.
+    void set_max_synth_versions(std::size_t n) {
+        max_synth_versions = n;
+    }
+
+    // The trees stay valid, and unchanged, for as long as the ReadGuard lives.  The request handlers
+    //   hold one, so the pointers returned by the methods below stay valid for the whole request.
+    using ReadableTrees = RCUPointer<ServedTrees>::ReadGuard;
+    ReadableTrees get_readable_trees() const {
+        return published_trees.read();
+    }
+
+    // Shared ownership of a tree being served, for work that outlives a request handler.
+    std::shared_ptr<const SummaryTree_t> share_summary_tree(const SummaryTree_t * tree_ptr) const;
+
     std::string get_default_tree() const;
 
     std::set<std::string> get_available_trees() const;
@@ -62,9 +114,12 @@ public:
 
     const SummaryTree_t * get_summary_tree(std::string synth_id) const;
 
+    // Does not go through the thread's read cache, so it can be called from threads that do not
+    //   serve requests (like the one that runs run_server).
     std::size_t get_num_trees() const;
 
-    void final_tree_added();
+    // The taxa that are suppressed from the summary tree, if only one tree is served.
+    const OttIdSet * get_ids_suppressed_from_summary_tree() const;
 };
 
 }